@@ -0,0 +1,261 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2020, Intel Corporation */
+
+/*
+ * pmem2_map_find.cpp -- benchmark for the lookup of registered mappings
+ *
+ * Measures how lookups in the structure behind pmem2_map_find() scale with
+ * the number of threads doing them concurrently.
+ */
+
+#include <cassert>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#include "benchmark.hpp"
+#include "os_thread.h"
+#include "rand.h"
+
+/* an internal libpmemcore code */
+#include "range_map.h"
+
+/*
+ * The number of lookups done in one operation, used to get more accurate
+ * results, because a single lookup takes less time than the framework
+ * overhead.
+ */
+#define LOOKUPS_PER_OP 1000
+
+/*
+ * map_find_args -- benchmark specific command line options
+ */
+struct map_find_args {
+	unsigned n_maps; /* number of registered mappings */
+	size_t map_size; /* size of a single mapping */
+	bool rwlock;	 /* serialize lookups with a reader-writer lock */
+};
+
+/*
+ * map_find_bench -- benchmark context
+ */
+struct map_find_bench {
+	struct map_find_args *pa; /* prog_args structure */
+	struct range_map *rm;	  /* registered mappings */
+	os_rwlock_t lock;	  /* used only with the rwlock option */
+};
+
+/*
+ * map_find_worker -- worker context
+ */
+struct map_find_worker {
+	uintptr_t *addrs; /* addresses looked up by the worker */
+};
+
+/*
+ * map_find_op -- do LOOKUPS_PER_OP lookups of random addresses
+ */
+static int
+map_find_op(struct benchmark *bench, struct operation_info *info)
+{
+	auto *mb = (struct map_find_bench *)pmembench_get_priv(bench);
+	auto *mw = (struct map_find_worker *)info->worker->priv;
+
+	for (size_t i = 0; i < LOOKUPS_PER_OP; i++) {
+		uintptr_t addr = mw->addrs[i];
+		void *map;
+
+		if (mb->pa->rwlock) {
+			os_rwlock_rdlock(&mb->lock);
+			map = range_map_find(mb->rm, addr, 1);
+			os_rwlock_unlock(&mb->lock);
+		} else {
+			map = range_map_find(mb->rm, addr, 1);
+		}
+
+		if (map == nullptr) {
+			fprintf(stderr, "mapping for 0x%jx not found\n",
+				(uintmax_t)addr);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * map_find_init_worker -- prepare the addresses looked up by the worker
+ */
+static int
+map_find_init_worker(struct benchmark *bench, struct benchmark_args *args,
+		     struct worker_info *worker)
+{
+	auto *mb = (struct map_find_bench *)pmembench_get_priv(bench);
+
+	struct map_find_worker *mw =
+		(struct map_find_worker *)malloc(sizeof(*mw));
+	if (mw == nullptr) {
+		perror("malloc");
+		return -1;
+	}
+
+	mw->addrs = (uintptr_t *)malloc(LOOKUPS_PER_OP * sizeof(uintptr_t));
+	if (mw->addrs == nullptr) {
+		perror("malloc");
+		free(mw);
+		return -1;
+	}
+
+	rng_t rng;
+	randomize_r(&rng, args->seed + worker->index);
+
+	for (size_t i = 0; i < LOOKUPS_PER_OP; i++) {
+		uint64_t map = rnd64_r(&rng) % mb->pa->n_maps;
+		uint64_t off = rnd64_r(&rng) % mb->pa->map_size;
+		mw->addrs[i] = (uintptr_t)((map + 1) * mb->pa->map_size + off);
+	}
+
+	worker->priv = mw;
+	return 0;
+}
+
+/*
+ * map_find_free_worker -- cleanup worker
+ */
+static void
+map_find_free_worker(struct benchmark *bench, struct benchmark_args *args,
+		     struct worker_info *worker)
+{
+	auto *mw = (struct map_find_worker *)worker->priv;
+
+	free(mw->addrs);
+	free(mw);
+}
+
+/*
+ * map_find_init -- register n_maps adjacent fake mappings
+ */
+static int
+map_find_init(struct benchmark *bench, struct benchmark_args *args)
+{
+	assert(bench != nullptr);
+	assert(args != nullptr);
+	assert(args->opts != nullptr);
+
+	struct map_find_bench *mb =
+		(struct map_find_bench *)malloc(sizeof(*mb));
+	if (mb == nullptr) {
+		perror("malloc");
+		return -1;
+	}
+
+	mb->pa = (struct map_find_args *)args->opts;
+
+	if (mb->pa->map_size == 0 ||
+	    (mb->pa->n_maps + 1ULL) > UINTPTR_MAX / mb->pa->map_size) {
+		fprintf(stderr, "invalid number or size of mappings\n");
+		goto err;
+	}
+
+	mb->rm = range_map_new();
+	if (mb->rm == nullptr) {
+		perror("range_map_new");
+		goto err;
+	}
+
+	/* the ranges are never dereferenced, start above the NULL page */
+	for (unsigned i = 0; i < mb->pa->n_maps; i++) {
+		uintptr_t addr = (i + 1) * mb->pa->map_size;
+		if (range_map_insert(mb->rm, addr, mb->pa->map_size,
+				     (void *)addr)) {
+			fprintf(stderr, "range_map_insert failed\n");
+			goto err_delete;
+		}
+	}
+
+	os_rwlock_init(&mb->lock);
+
+	pmembench_set_priv(bench, mb);
+	return 0;
+
+err_delete:
+	range_map_delete(mb->rm);
+err:
+	free(mb);
+	return -1;
+}
+
+/*
+ * map_find_exit -- benchmark cleanup
+ */
+static int
+map_find_exit(struct benchmark *bench, struct benchmark_args *args)
+{
+	auto *mb = (struct map_find_bench *)pmembench_get_priv(bench);
+
+	os_rwlock_destroy(&mb->lock);
+	range_map_delete(mb->rm);
+	free(mb);
+
+	return 0;
+}
+
+static struct benchmark_clo map_find_clo[3];
+static struct benchmark_info map_find_info;
+
+CONSTRUCTOR(pmem2_map_find_constructor)
+void
+pmem2_map_find_constructor(void)
+{
+	map_find_clo[0].opt_short = 'M';
+	map_find_clo[0].opt_long = "maps";
+	map_find_clo[0].descr = "Number of registered mappings";
+	map_find_clo[0].def = "64";
+	map_find_clo[0].off = clo_field_offset(struct map_find_args, n_maps);
+	map_find_clo[0].type = CLO_TYPE_UINT;
+	map_find_clo[0].type_uint.size =
+		clo_field_size(struct map_find_args, n_maps);
+	map_find_clo[0].type_uint.base = CLO_INT_BASE_DEC;
+	map_find_clo[0].type_uint.min = 1;
+	map_find_clo[0].type_uint.max = UINT_MAX;
+
+	map_find_clo[1].opt_short = 'z';
+	map_find_clo[1].opt_long = "map-size";
+	map_find_clo[1].descr = "Size of a single mapping";
+	map_find_clo[1].def = "2097152";
+	map_find_clo[1].off = clo_field_offset(struct map_find_args, map_size);
+	map_find_clo[1].type = CLO_TYPE_UINT;
+	map_find_clo[1].type_uint.size =
+		clo_field_size(struct map_find_args, map_size);
+	map_find_clo[1].type_uint.base = CLO_INT_BASE_DEC | CLO_INT_BASE_HEX;
+	map_find_clo[1].type_uint.min = 1;
+	map_find_clo[1].type_uint.max = ULONG_MAX;
+
+	map_find_clo[2].opt_short = 'l';
+	map_find_clo[2].opt_long = "rwlock";
+	map_find_clo[2].descr = "Serialize lookups with a reader-writer "
+				"lock, as a baseline";
+	map_find_clo[2].def = "false";
+	map_find_clo[2].off = clo_field_offset(struct map_find_args, rwlock);
+	map_find_clo[2].type = CLO_TYPE_FLAG;
+
+	map_find_info.name = "pmem2_map_find";
+	map_find_info.brief = "Benchmark for lookups of registered "
+			      "pmem2 mappings";
+	map_find_info.init = map_find_init;
+	map_find_info.exit = map_find_exit;
+	map_find_info.init_worker = map_find_init_worker;
+	map_find_info.free_worker = map_find_free_worker;
+	map_find_info.multithread = true;
+	map_find_info.multiops = true;
+	map_find_info.operation = map_find_op;
+	map_find_info.measure_time = true;
+	map_find_info.clos = map_find_clo;
+	map_find_info.nclos = ARRAY_SIZE(map_find_clo);
+	map_find_info.opts_size = sizeof(struct map_find_args);
+	map_find_info.rm_file = false;
+	map_find_info.allow_poolset = false;
+	REGISTER_BENCHMARK(map_find_info);
+}
@@ -0,0 +1,288 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2020, Intel Corporation */
+
+/*
+ * pmem2_memcpy_async.cpp -- benchmark for the asynchronous pmem2 memcpy
+ *
+ * Every operation copies a chunk of data to pmem and does a configurable
+ * amount of computation. In the synchronous mode the two happen one after
+ * another, in the asynchronous mode the copy is submitted to a pmem2 mover
+ * and the computation overlaps with it.
+ */
+
+#include <cassert>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+
+#include "benchmark.hpp"
+#include "file.h"
+#include "libpmem2.h"
+#include "os.h"
+
+/*
+ * memcpy_async_args -- benchmark specific command line options
+ */
+struct memcpy_async_args {
+	bool async;		/* submit the copies to a mover */
+	unsigned mover_threads; /* number of the mover workers */
+	unsigned compute;	/* iterations of computation per operation */
+	bool nontemporal;	/* use PMEM2_F_MEM_NONTEMPORAL */
+};
+
+/*
+ * memcpy_async_bench -- benchmark context
+ */
+struct memcpy_async_bench {
+	struct memcpy_async_args *pa; /* prog_args structure */
+	int fd;
+	size_t fsize;
+	struct pmem2_source *src;
+	struct pmem2_map *map;
+	pmem2_memcpy_fn memcpy_fn;
+	struct pmem2_mover *mover;
+	char *pmem_addr;
+	char *buf; /* source of the copies */
+	unsigned flags;
+};
+
+/*
+ * memcpy_async_compute -- simulate computation done alongside the copy
+ */
+static uint64_t
+memcpy_async_compute(unsigned iterations, uint64_t seed)
+{
+	volatile uint64_t x = seed;
+	for (unsigned i = 0; i < iterations; i++)
+		x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+
+	return x;
+}
+
+/*
+ * memcpy_async_op -- copy a chunk of data and do the computation
+ */
+static int
+memcpy_async_op(struct benchmark *bench, struct operation_info *info)
+{
+	auto *mb = (struct memcpy_async_bench *)pmembench_get_priv(bench);
+	size_t dsize = info->args->dsize;
+	size_t idx = info->worker->index * info->args->n_ops_per_thread +
+		info->index;
+	char *dest = mb->pmem_addr + idx * dsize;
+	char *src = mb->buf + info->worker->index * dsize;
+
+	if (!mb->pa->async) {
+		mb->memcpy_fn(dest, src, dsize, mb->flags);
+		memcpy_async_compute(mb->pa->compute, idx);
+		return 0;
+	}
+
+	struct pmem2_future *future;
+	int ret = pmem2_memcpy_async(mb->mover, mb->map, dest, src, dsize,
+				     mb->flags, &future);
+	if (ret) {
+		pmem2_perror("pmem2_memcpy_async");
+		return -1;
+	}
+
+	memcpy_async_compute(mb->pa->compute, idx);
+
+	pmem2_future_wait(&future);
+
+	return 0;
+}
+
+/*
+ * memcpy_async_init -- create and map the file, set up the mover
+ */
+static int
+memcpy_async_init(struct benchmark *bench, struct benchmark_args *args)
+{
+	assert(bench != nullptr);
+	assert(args != nullptr);
+	assert(args->opts != nullptr);
+
+	enum file_type type = util_file_get_type(args->fname);
+	if (type == OTHER_ERROR) {
+		fprintf(stderr, "could not check type of file %s\n",
+			args->fname);
+		return -1;
+	}
+
+	struct memcpy_async_bench *mb =
+		(struct memcpy_async_bench *)calloc(1, sizeof(*mb));
+	if (mb == nullptr) {
+		perror("calloc");
+		return -1;
+	}
+
+	mb->pa = (struct memcpy_async_args *)args->opts;
+	mb->flags = mb->pa->nontemporal ? PMEM2_F_MEM_NONTEMPORAL : 0;
+	mb->fsize = args->dsize * args->n_ops_per_thread * args->n_threads;
+
+	struct pmem2_config *cfg;
+	int ret;
+
+	mb->buf = (char *)malloc(args->dsize * args->n_threads);
+	if (mb->buf == nullptr) {
+		perror("malloc");
+		goto err_free_mb;
+	}
+	memset(mb->buf, 0xc5, args->dsize * args->n_threads);
+
+	if (type == TYPE_DEVDAX) {
+		mb->fd = os_open(args->fname, O_RDWR);
+	} else {
+		mb->fd = os_open(args->fname, O_CREAT | O_EXCL | O_RDWR,
+				 args->fmode);
+	}
+	if (mb->fd < 0) {
+		perror(args->fname);
+		goto err_free_buf;
+	}
+
+	if (type != TYPE_DEVDAX &&
+	    (errno = os_posix_fallocate(mb->fd, 0, (os_off_t)mb->fsize)) !=
+		    0) {
+		perror("posix_fallocate");
+		goto err_close;
+	}
+
+	if (pmem2_source_from_fd(&mb->src, mb->fd)) {
+		pmem2_perror("pmem2_source_from_fd");
+		goto err_close;
+	}
+
+	if (pmem2_config_new(&cfg)) {
+		pmem2_perror("pmem2_config_new");
+		goto err_source;
+	}
+
+	ret = pmem2_config_set_required_store_granularity(
+		cfg, PMEM2_GRANULARITY_PAGE);
+	if (ret == 0)
+		ret = pmem2_config_set_length(cfg, mb->fsize);
+	if (ret == 0)
+		ret = pmem2_map_new(&mb->map, cfg, mb->src);
+	pmem2_config_delete(&cfg);
+	if (ret) {
+		pmem2_perror("pmem2_map_new");
+		goto err_source;
+	}
+
+	mb->pmem_addr = (char *)pmem2_map_get_address(mb->map);
+	mb->memcpy_fn = pmem2_get_memcpy_fn(mb->map);
+
+	if (mb->pa->async &&
+	    pmem2_mover_new(&mb->mover, mb->pa->mover_threads)) {
+		pmem2_perror("pmem2_mover_new");
+		goto err_map;
+	}
+
+	pmembench_set_priv(bench, mb);
+	return 0;
+
+err_map:
+	pmem2_map_delete(&mb->map);
+err_source:
+	pmem2_source_delete(&mb->src);
+err_close:
+	os_close(mb->fd);
+err_free_buf:
+	free(mb->buf);
+err_free_mb:
+	free(mb);
+	return -1;
+}
+
+/*
+ * memcpy_async_exit -- benchmark cleanup
+ */
+static int
+memcpy_async_exit(struct benchmark *bench, struct benchmark_args *args)
+{
+	auto *mb = (struct memcpy_async_bench *)pmembench_get_priv(bench);
+
+	pmem2_mover_delete(&mb->mover);
+	pmem2_map_delete(&mb->map);
+	pmem2_source_delete(&mb->src);
+	os_close(mb->fd);
+	free(mb->buf);
+	free(mb);
+
+	return 0;
+}
+
+static struct benchmark_clo memcpy_async_clo[4];
+static struct benchmark_info memcpy_async_info;
+
+CONSTRUCTOR(pmem2_memcpy_async_constructor)
+void
+pmem2_memcpy_async_constructor(void)
+{
+	memcpy_async_clo[0].opt_short = 'a';
+	memcpy_async_clo[0].opt_long = "async";
+	memcpy_async_clo[0].descr = "Submit the copies to a pmem2 mover";
+	memcpy_async_clo[0].def = "false";
+	memcpy_async_clo[0].off = clo_field_offset(struct memcpy_async_args,
+						   async);
+	memcpy_async_clo[0].type = CLO_TYPE_FLAG;
+
+	memcpy_async_clo[1].opt_short = 'M';
+	memcpy_async_clo[1].opt_long = "mover-threads";
+	memcpy_async_clo[1].descr = "Number of the mover worker threads, "
+				    "0 for the default";
+	memcpy_async_clo[1].def = "0";
+	memcpy_async_clo[1].off = clo_field_offset(struct memcpy_async_args,
+						   mover_threads);
+	memcpy_async_clo[1].type = CLO_TYPE_UINT;
+	memcpy_async_clo[1].type_uint.size =
+		clo_field_size(struct memcpy_async_args, mover_threads);
+	memcpy_async_clo[1].type_uint.base = CLO_INT_BASE_DEC;
+	memcpy_async_clo[1].type_uint.min = 0;
+	memcpy_async_clo[1].type_uint.max = UINT_MAX;
+
+	memcpy_async_clo[2].opt_short = 'c';
+	memcpy_async_clo[2].opt_long = "compute";
+	memcpy_async_clo[2].descr = "Iterations of computation done by "
+				    "each operation besides the copy";
+	memcpy_async_clo[2].def = "0";
+	memcpy_async_clo[2].off = clo_field_offset(struct memcpy_async_args,
+						   compute);
+	memcpy_async_clo[2].type = CLO_TYPE_UINT;
+	memcpy_async_clo[2].type_uint.size =
+		clo_field_size(struct memcpy_async_args, compute);
+	memcpy_async_clo[2].type_uint.base = CLO_INT_BASE_DEC;
+	memcpy_async_clo[2].type_uint.min = 0;
+	memcpy_async_clo[2].type_uint.max = UINT_MAX;
+
+	memcpy_async_clo[3].opt_short = 'n';
+	memcpy_async_clo[3].opt_long = "nontemporal";
+	memcpy_async_clo[3].descr = "Use non-temporal stores";
+	memcpy_async_clo[3].def = "false";
+	memcpy_async_clo[3].off = clo_field_offset(struct memcpy_async_args,
+						   nontemporal);
+	memcpy_async_clo[3].type = CLO_TYPE_FLAG;
+
+	memcpy_async_info.name = "pmem2_memcpy_async";
+	memcpy_async_info.brief = "Benchmark for synchronous and "
+				  "asynchronous pmem2 memcpy";
+	memcpy_async_info.init = memcpy_async_init;
+	memcpy_async_info.exit = memcpy_async_exit;
+	memcpy_async_info.multithread = true;
+	memcpy_async_info.multiops = true;
+	memcpy_async_info.operation = memcpy_async_op;
+	memcpy_async_info.measure_time = true;
+	memcpy_async_info.clos = memcpy_async_clo;
+	memcpy_async_info.nclos = ARRAY_SIZE(memcpy_async_clo);
+	memcpy_async_info.opts_size = sizeof(struct memcpy_async_args);
+	memcpy_async_info.rm_file = true;
+	memcpy_async_info.allow_poolset = false;
+	memcpy_async_info.print_bandwidth = true;
+	REGISTER_BENCHMARK(memcpy_async_info);
+}
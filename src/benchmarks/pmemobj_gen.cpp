@@ -3,7 +3,7 @@
 
 /*
  * pmemobj_gen.cpp -- benchmark for pmemobj_direct()
- * and pmemobj_open() functions.
+ * and pmemobj_open() functions, including opening pool sets with many parts.
  */
 
 #include <cassert>
@@ -18,6 +18,7 @@
 
 #include "benchmark.hpp"
 #include "libpmemobj.h"
+#include "os.h"
 
 #define LAYOUT_NAME "benchmark"
 #define FACTOR 4
@@ -25,6 +26,7 @@
 #define FILE_MODE 0666
 #define PART_NAME "/part"
 #define MAX_DIGITS 2
+#define POOLSET_NAME "/pool.set"
 
 struct pobj_bench;
 struct pobj_worker;
@@ -121,6 +123,31 @@ struct pobj_bench {
 	fn_num_t obj;
 };
 
+/*
+ * pobj_parts_args - Stores command line parsed arguments of the
+ * obj_open_parts benchmark.
+ *
+ * n_parts	: Number of parts of the pool set.
+ *
+ * part_size	: Size of each part.
+ */
+struct pobj_parts_args {
+	unsigned n_parts;
+	size_t part_size;
+};
+
+/*
+ * pobj_parts_bench - Stores variables used in the obj_open_parts benchmark.
+ *
+ * pop			: Pointer to the persistent pool.
+ *
+ * set			: Path of the pool set file.
+ */
+struct pobj_parts_bench {
+	PMEMobjpool *pop;
+	char *set;
+};
+
 /*
  * pobj_worker - Stores variables used by one thread.
  */
@@ -545,6 +572,119 @@ pobj_open_op(struct benchmark *bench, struct operation_info *info)
 	return 0;
 }
 
+/*
+ * pobj_parts_init -- initialization of the obj_open_parts benchmark, creates
+ * a pool set with the requested number of parts in the directory given as
+ * the file name.
+ */
+static int
+pobj_parts_init(struct benchmark *bench, struct benchmark_args *args)
+{
+	assert(bench != nullptr);
+	assert(args != nullptr);
+	assert(args->opts != nullptr);
+
+	auto *pa = (struct pobj_parts_args *)args->opts;
+
+	if (args->is_poolset || args->is_dynamic_poolset) {
+		fprintf(stderr, "the pool set is created by the benchmark,"
+				" please specify a directory instead\n");
+		return -1;
+	}
+
+	if (util_file_mkdir(args->fname, DIR_MODE) != 0) {
+		fprintf(stderr, "cannot create directory\n");
+		return -1;
+	}
+
+	auto *pb = (struct pobj_parts_bench *)calloc(
+		1, sizeof(struct pobj_parts_bench));
+	if (pb == nullptr) {
+		perror("calloc");
+		return -1;
+	}
+
+	size_t path_len = strlen(args->fname) + strlen(POOLSET_NAME) + 1;
+	pb->set = (char *)malloc(path_len);
+	if (pb->set == nullptr) {
+		perror("malloc");
+		goto free_pb;
+	}
+
+	if (util_snprintf(pb->set, path_len, "%s%s", args->fname,
+			  POOLSET_NAME) < 0) {
+		perror("snprintf");
+		goto free_set;
+	}
+
+	FILE *f;
+	f = os_fopen(pb->set, "w");
+	if (f == nullptr) {
+		perror(pb->set);
+		goto free_set;
+	}
+
+	fprintf(f, "PMEMPOOLSET\n");
+	for (unsigned i = 0; i < pa->n_parts; i++)
+		fprintf(f, "%zu %s%s%u\n", pa->part_size, args->fname,
+			PART_NAME, i);
+
+	if (fclose(f) != 0) {
+		perror(pb->set);
+		goto free_set;
+	}
+
+	pb->pop = pmemobj_create(pb->set, LAYOUT_NAME, 0, FILE_MODE);
+	if (pb->pop == nullptr) {
+		perror(pmemobj_errormsg());
+		goto free_set;
+	}
+
+	pmembench_set_priv(bench, pb);
+
+	return 0;
+free_set:
+	free(pb->set);
+free_pb:
+	free(pb);
+
+	return -1;
+}
+
+/*
+ * pobj_parts_exit -- exit function of the obj_open_parts benchmark
+ */
+static int
+pobj_parts_exit(struct benchmark *bench, struct benchmark_args *args)
+{
+	auto *pb = (struct pobj_parts_bench *)pmembench_get_priv(bench);
+
+	if (pb->pop != nullptr)
+		pmemobj_close(pb->pop);
+	free(pb->set);
+	free(pb);
+
+	return 0;
+}
+
+/*
+ * pobj_parts_open_op -- main operation of the obj_open_parts benchmark.
+ */
+static int
+pobj_parts_open_op(struct benchmark *bench, struct operation_info *info)
+{
+	auto *pb = (struct pobj_parts_bench *)pmembench_get_priv(bench);
+
+	pmemobj_close(pb->pop);
+	pb->pop = pmemobj_open(pb->set, LAYOUT_NAME);
+	if (pb->pop == nullptr) {
+		perror(pmemobj_errormsg());
+		return -1;
+	}
+
+	return 0;
+}
+
 /*
  * pobj_free_worker -- worker exit function
  */
@@ -562,12 +702,15 @@ pobj_free_worker(struct benchmark *bench, struct benchmark_args *args,
 
 static struct benchmark_info obj_open;
 static struct benchmark_info obj_direct;
+static struct benchmark_info obj_open_parts;
 
 /* Array defining common command line arguments. */
 static struct benchmark_clo pobj_direct_clo[4];
 
 static struct benchmark_clo pobj_open_clo[3];
 
+static struct benchmark_clo pobj_parts_clo[2];
+
 CONSTRUCTOR(pmemobj_gen_constructor)
 void
 pmemobj_gen_constructor(void)
@@ -668,4 +811,45 @@ pmemobj_gen_constructor(void)
 	obj_direct.rm_file = true;
 	obj_direct.allow_poolset = true;
 	REGISTER_BENCHMARK(obj_direct);
+
+	pobj_parts_clo[0].opt_short = 'N';
+	pobj_parts_clo[0].opt_long = "parts";
+	pobj_parts_clo[0].type = CLO_TYPE_UINT;
+	pobj_parts_clo[0].descr = "Number of parts of the pool set";
+	pobj_parts_clo[0].off =
+		clo_field_offset(struct pobj_parts_args, n_parts);
+	pobj_parts_clo[0].def = "64";
+	pobj_parts_clo[0].type_uint.size =
+		clo_field_size(struct pobj_parts_args, n_parts);
+	pobj_parts_clo[0].type_uint.base = CLO_INT_BASE_DEC;
+	pobj_parts_clo[0].type_uint.min = 1;
+	pobj_parts_clo[0].type_uint.max = UINT_MAX;
+
+	pobj_parts_clo[1].opt_short = 'z';
+	pobj_parts_clo[1].opt_long = "part-size";
+	pobj_parts_clo[1].type = CLO_TYPE_UINT;
+	pobj_parts_clo[1].descr = "Size of each part of the pool set";
+	pobj_parts_clo[1].off =
+		clo_field_offset(struct pobj_parts_args, part_size);
+	pobj_parts_clo[1].def = "8388608";
+	pobj_parts_clo[1].type_uint.size =
+		clo_field_size(struct pobj_parts_args, part_size);
+	pobj_parts_clo[1].type_uint.base = CLO_INT_BASE_DEC | CLO_INT_BASE_HEX;
+	pobj_parts_clo[1].type_uint.min = PMEMOBJ_MIN_PART;
+	pobj_parts_clo[1].type_uint.max = UINT64_MAX;
+
+	obj_open_parts.name = "obj_open_parts";
+	obj_open_parts.brief = "pmemobj_open() of a pool set with many parts";
+	obj_open_parts.init = pobj_parts_init;
+	obj_open_parts.exit = pobj_parts_exit;
+	obj_open_parts.multithread = false;
+	obj_open_parts.multiops = true;
+	obj_open_parts.operation = pobj_parts_open_op;
+	obj_open_parts.measure_time = true;
+	obj_open_parts.clos = pobj_parts_clo;
+	obj_open_parts.nclos = ARRAY_SIZE(pobj_parts_clo);
+	obj_open_parts.opts_size = sizeof(struct pobj_parts_args);
+	obj_open_parts.rm_file = true;
+	obj_open_parts.allow_poolset = false;
+	REGISTER_BENCHMARK(obj_open_parts);
 };
@@ -1,10 +1,12 @@
 // SPDX-License-Identifier: BSD-3-Clause
-/* Copyright 2016-2019, Intel Corporation */
+/* Copyright 2016-2020, Intel Corporation */
 
 /*
  * ctl_prefault.c -- implementation of the prefault CTL namespace
  */
 
+#include <errno.h>
+
 #include "ctl.h"
 #include "set.h"
 #include "out.h"
@@ -52,12 +54,64 @@ CTL_WRITE_HANDLER(at_open)(void *ctx, enum ctl_query_source source,
 	return 0;
 }
 
+static int
+CTL_READ_HANDLER(threads)(void *ctx, enum ctl_query_source source,
+	void *arg, struct ctl_indexes *indexes)
+{
+	int *arg_out = arg;
+	*arg_out = Prefault_threads;
+
+	return 0;
+}
+
+static int
+CTL_WRITE_HANDLER(threads)(void *ctx, enum ctl_query_source source,
+	void *arg, struct ctl_indexes *indexes)
+{
+	int arg_in = *(int *)arg;
+
+	if (arg_in < 0) {
+		ERR("number of prefault threads cannot be negative");
+		errno = EINVAL;
+		return -1;
+	}
+
+	Prefault_threads = arg_in;
+
+	return 0;
+}
+
+static int
+CTL_READ_HANDLER(lazy_data)(void *ctx, enum ctl_query_source source,
+	void *arg, struct ctl_indexes *indexes)
+{
+	int *arg_out = arg;
+	*arg_out = Prefault_lazy_data;
+
+	return 0;
+}
+
+static int
+CTL_WRITE_HANDLER(lazy_data)(void *ctx, enum ctl_query_source source,
+	void *arg, struct ctl_indexes *indexes)
+{
+	int arg_in = *(int *)arg;
+
+	Prefault_lazy_data = arg_in;
+
+	return 0;
+}
+
 static const struct ctl_argument CTL_ARG(at_create) = CTL_ARG_BOOLEAN;
 static const struct ctl_argument CTL_ARG(at_open) = CTL_ARG_BOOLEAN;
+static const struct ctl_argument CTL_ARG(threads) = CTL_ARG_INT;
+static const struct ctl_argument CTL_ARG(lazy_data) = CTL_ARG_BOOLEAN;
 
 static const struct ctl_node CTL_NODE(prefault)[] = {
 	CTL_LEAF_RW(at_create),
 	CTL_LEAF_RW(at_open),
+	CTL_LEAF_RW(threads),
+	CTL_LEAF_RW(lazy_data),
 
 	CTL_NODE_END
 };
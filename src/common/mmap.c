@@ -14,8 +14,8 @@
 #include <unistd.h>
 
 #include "file.h"
-#include "queue.h"
 #include "mmap.h"
+#include "ravl_interval.h"
 #include "sys_util.h"
 #include "os.h"
 #include "alloc.h"
@@ -23,10 +23,33 @@
 
 int Mmap_no_random;
 void *Mmap_hint;
-static os_rwlock_t Mmap_list_lock;
 
-static PMDK_SORTEDQ_HEAD(map_list_head, map_tracker) Mmap_list =
-		PMDK_SORTEDQ_HEAD_INITIALIZER(Mmap_list);
+/*
+ * Mmap_tree -- interval tree of all tracked mappings; readers share
+ * Mmap_tree_lock, so concurrent lookups do not serialize on each other
+ */
+static os_rwlock_t Mmap_tree_lock;
+static struct ravl_interval *Mmap_tree;
+
+/*
+ * util_range_min -- (internal) return min boundary of the map tracker
+ */
+static size_t
+util_range_min(void *addr)
+{
+	struct map_tracker *mt = addr;
+	return (size_t)mt->base_addr;
+}
+
+/*
+ * util_range_max -- (internal) return max boundary of the map tracker
+ */
+static size_t
+util_range_max(void *addr)
+{
+	struct map_tracker *mt = addr;
+	return (size_t)mt->end_addr;
+}
 
 /*
  * util_mmap_init -- initialize the mmap utils
@@ -38,7 +61,11 @@ util_mmap_init(void)
 {
 	LOG(3, NULL);
 
-	util_rwlock_init(&Mmap_list_lock);
+	util_rwlock_init(&Mmap_tree_lock);
+
+	Mmap_tree = ravl_interval_new(util_range_min, util_range_max);
+	if (!Mmap_tree)
+		abort();
 
 	/*
 	 * For testing, allow overriding the default mmap() hint address.
@@ -72,7 +99,10 @@ util_mmap_fini(void)
 {
 	LOG(3, NULL);
 
-	util_rwlock_destroy(&Mmap_list_lock);
+	ravl_interval_delete(Mmap_tree);
+	Mmap_tree = NULL;
+
+	util_rwlock_destroy(&Mmap_tree_lock);
 }
 
 /*
@@ -225,15 +255,6 @@ util_range_none(void *addr, size_t len)
 	return retval;
 }
 
-/*
- * util_range_comparer -- (internal) compares the two mapping trackers
- */
-static intptr_t
-util_range_comparer(struct map_tracker *a, struct map_tracker *b)
-{
-	return ((intptr_t)a->base_addr - (intptr_t)b->base_addr);
-}
-
 /*
  * util_range_find_unlocked -- (internal) find the map tracker
  * for given address range
@@ -247,22 +268,28 @@ util_range_find_unlocked(uintptr_t addr, size_t len)
 {
 	LOG(10, "addr 0x%016" PRIxPTR " len %zu", addr, len);
 
-	uintptr_t end = addr + len;
+	/* an empty range still has to match the entry containing addr */
+	struct map_tracker range;
+	range.base_addr = addr;
+	range.end_addr = addr + (len ? len : 1);
 
-	struct map_tracker *mt;
+	struct ravl_interval_node *node = ravl_interval_find(Mmap_tree, &range);
+	if (node == NULL)
+		return NULL;
 
-	PMDK_SORTEDQ_FOREACH(mt, &Mmap_list, entry) {
-		if (addr < mt->end_addr &&
-		    (addr >= mt->base_addr || end > mt->base_addr))
-			goto out;
+	struct map_tracker *mt = ravl_interval_data(node);
 
-		/* break if there is no chance to find matching entry */
-		if (addr < mt->base_addr)
+	/*
+	 * The tree returns any of the overlapping entries, walk back to the
+	 * one with the lowest address.
+	 */
+	while ((node = ravl_interval_find_closest_prior(Mmap_tree, mt))) {
+		struct map_tracker *prev = ravl_interval_data(node);
+		if (prev->end_addr <= addr)
 			break;
+		mt = prev;
 	}
-	mt = NULL;
 
-out:
 	return mt;
 }
 
@@ -275,16 +302,16 @@ util_range_find(uintptr_t addr, size_t len)
 {
 	LOG(10, "addr 0x%016" PRIxPTR " len %zu", addr, len);
 
-	util_rwlock_rdlock(&Mmap_list_lock);
+	util_rwlock_rdlock(&Mmap_tree_lock);
 
 	struct map_tracker *mt = util_range_find_unlocked(addr, len);
 
-	util_rwlock_unlock(&Mmap_list_lock);
+	util_rwlock_unlock(&Mmap_tree_lock);
 	return mt;
 }
 
 /*
- * util_range_register -- add a memory range into a map tracking list
+ * util_range_register -- add a memory range into a map tracking tree
  */
 int
 util_range_register(const void *addr, size_t len, const char *path,
@@ -292,15 +319,6 @@ util_range_register(const void *addr, size_t len, const char *path,
 {
 	LOG(3, "addr %p len %zu path %s type %d", addr, len, path, type);
 
-	/* check if not tracked already */
-	if (util_range_find((uintptr_t)addr, len) != NULL) {
-		ERR(
-		"duplicated persistent memory range; presumably unmapped with munmap() instead of pmem_unmap(): addr %p len %zu",
-			addr, len);
-		errno = ENOMEM;
-		return -1;
-	}
-
 	struct map_tracker *mt;
 	mt  = Malloc(sizeof(struct map_tracker));
 	if (mt == NULL) {
@@ -316,19 +334,37 @@ util_range_register(const void *addr, size_t len, const char *path,
 		int ret = util_ddax_region_find(path, &region_id);
 		if (ret < 0) {
 			ERR("Cannot find DAX device region id");
-			return -1;
+			goto err;
 		}
 		mt->region_id = region_id;
 	}
 
-	util_rwlock_wrlock(&Mmap_list_lock);
+	util_rwlock_wrlock(&Mmap_tree_lock);
 
-	PMDK_SORTEDQ_INSERT(&Mmap_list, mt, entry, struct map_tracker,
-			util_range_comparer);
+	/* check if not tracked already */
+	if (util_range_find_unlocked((uintptr_t)addr, len) != NULL) {
+		util_rwlock_unlock(&Mmap_tree_lock);
+		ERR(
+		"duplicated persistent memory range; presumably unmapped with munmap() instead of pmem_unmap(): addr %p len %zu",
+			addr, len);
+		errno = ENOMEM;
+		goto err;
+	}
 
-	util_rwlock_unlock(&Mmap_list_lock);
+	int ret = ravl_interval_insert(Mmap_tree, mt);
+
+	util_rwlock_unlock(&Mmap_tree_lock);
+
+	if (ret) {
+		ERR("!ravl_interval_insert");
+		goto err;
+	}
 
 	return 0;
+
+err:
+	Free(mt);
+	return -1;
 }
 
 /*
@@ -392,22 +428,33 @@ util_range_split(struct map_tracker *mt, const void *addrp, const void *endp)
 		mte->type = mt->type;
 	}
 
-	PMDK_SORTEDQ_REMOVE(&Mmap_list, mt, entry);
+	struct ravl_interval_node *node = ravl_interval_find_equal(Mmap_tree,
+			mt);
+	ASSERTne(node, NULL);
+	ravl_interval_remove(Mmap_tree, node);
 
-	if (mtb) {
-		PMDK_SORTEDQ_INSERT(&Mmap_list, mtb, entry,
-				struct map_tracker, util_range_comparer);
+	if (mtb && ravl_interval_insert(Mmap_tree, mtb)) {
+		ERR("!ravl_interval_insert");
+		goto err_restore;
 	}
 
-	if (mte) {
-		PMDK_SORTEDQ_INSERT(&Mmap_list, mte, entry,
-				struct map_tracker, util_range_comparer);
+	if (mte && ravl_interval_insert(Mmap_tree, mte)) {
+		ERR("!ravl_interval_insert");
+		if (mtb) {
+			node = ravl_interval_find_equal(Mmap_tree, mtb);
+			ravl_interval_remove(Mmap_tree, node);
+		}
+		goto err_restore;
 	}
 
 	/* free entry for the original mapping */
 	Free(mt);
 	return 0;
 
+err_restore:
+	/* removing a node has just freed enough memory to put it back */
+	if (ravl_interval_insert(Mmap_tree, mt))
+		FATAL("cannot restore the map tracker");
 err:
 	Free(mtb);
 	Free(mte);
@@ -416,7 +463,7 @@ err:
 
 /*
  * util_range_unregister -- remove a memory range
- * from map tracking list
+ * from map tracking tree
  *
  * Remove the region between [begin,end].  If it's in a middle of the existing
  * mapping, it results in two new map trackers.
@@ -428,10 +475,10 @@ util_range_unregister(const void *addr, size_t len)
 
 	int ret = 0;
 
-	util_rwlock_wrlock(&Mmap_list_lock);
+	util_rwlock_wrlock(&Mmap_tree_lock);
 
 	/*
-	 * Changes in the map tracker list must match the underlying behavior.
+	 * Changes in the map tracker tree must match the underlying behavior.
 	 *
 	 * $ man 2 mmap:
 	 *	The address addr must be a multiple of the page size (but length
@@ -444,7 +491,6 @@ util_range_unregister(const void *addr, size_t len)
 
 	void *end = (char *)addr + len;
 
-	/* XXX optimize the loop */
 	struct map_tracker *mt;
 	while ((mt = util_range_find_unlocked((uintptr_t)addr, len)) != NULL) {
 		if (util_range_split(mt, addr, end) != 0) {
@@ -453,7 +499,7 @@ util_range_unregister(const void *addr, size_t len)
 		}
 	}
 
-	util_rwlock_unlock(&Mmap_list_lock);
+	util_rwlock_unlock(&Mmap_tree_lock);
 	return ret;
 }
 
@@ -469,10 +515,10 @@ util_range_is_pmem(const void *addrp, size_t len)
 	uintptr_t addr = (uintptr_t)addrp;
 	int retval = 1;
 
-	util_rwlock_rdlock(&Mmap_list_lock);
+	util_rwlock_rdlock(&Mmap_tree_lock);
 
 	do {
-		struct map_tracker *mt = util_range_find(addr, len);
+		struct map_tracker *mt = util_range_find_unlocked(addr, len);
 		if (mt == NULL) {
 			LOG(4, "address not found 0x%016" PRIxPTR, addr);
 			retval = 0;
@@ -498,7 +544,7 @@ util_range_is_pmem(const void *addrp, size_t len)
 		addr += map_len;
 	} while (len > 0);
 
-	util_rwlock_unlock(&Mmap_list_lock);
+	util_rwlock_unlock(&Mmap_tree_lock);
 
 	return retval;
 }
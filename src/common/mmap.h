@@ -79,7 +79,6 @@ enum pmem_map_type {
  * this structure tracks the file mappings outstanding per file handle
  */
 struct map_tracker {
-	PMDK_SORTEDQ_ENTRY(map_tracker) entry;
 	uintptr_t base_addr;
 	uintptr_t end_addr;
 	unsigned region_id;
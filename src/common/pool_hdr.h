@@ -99,8 +99,18 @@ typedef struct {
  */
 #define POOL_HDR_SIG_LEN 8
 #define POOL_HDR_UNUSED_SIZE 1904
-#define POOL_HDR_UNUSED2_SIZE 1976
+#define POOL_HDR_UNUSED2_SIZE 1960
 #define POOL_HDR_ALIGN_PAD (PMEM_PAGESIZE - 4096)
+
+/*
+ * range of a lazily updated replica which may be older than the data of
+ * the other replicas, kept outside of the checksummed part of the header
+ */
+struct pool_hdr_lag {
+	uint64_t begin;		/* offset of the first stale byte */
+	uint64_t end;		/* end of the stale range, 0 if up to date */
+};
+
 struct pool_hdr {
 	char signature[POOL_HDR_SIG_LEN];
 	uint32_t major;			/* format major version number */
@@ -116,6 +126,7 @@ struct pool_hdr {
 	unsigned char unused[POOL_HDR_UNUSED_SIZE];	/* must be zero */
 	/* not checksumed */
 	unsigned char unused2[POOL_HDR_UNUSED2_SIZE];	/* must be zero */
+	struct pool_hdr_lag lag;	/* stale range of a lazy replica */
 	struct shutdown_state sds;	/* shutdown status */
 	uint64_t checksum;		/* checksum of above fields */
 
@@ -188,9 +199,11 @@ static const features_t features_zero =
 #define POOL_FEAT_SINGLEHDR	0x0001U	/* pool header only in the first part */
 #define POOL_FEAT_CKSUM_2K	0x0002U	/* only first 2K of hdr checksummed */
 #define POOL_FEAT_SDS		0x0004U	/* check shutdown state */
+#define POOL_FEAT_LAG		0x0008U	/* replica data may be stale */
 
 #define POOL_FEAT_INCOMPAT_ALL \
-	(POOL_FEAT_SINGLEHDR | POOL_FEAT_CKSUM_2K | POOL_FEAT_SDS)
+	(POOL_FEAT_SINGLEHDR | POOL_FEAT_CKSUM_2K | POOL_FEAT_SDS | \
+	POOL_FEAT_LAG)
 
 /*
  * incompat features effective values (if applicable)
@@ -53,6 +53,7 @@
 #include <stddef.h>
 #include <time.h>
 #include <ctype.h>
+#include <limits.h>
 #include <linux/limits.h>
 #include <sys/mman.h>
 
@@ -61,6 +62,7 @@
 #include "set.h"
 #include "file.h"
 #include "os.h"
+#include "os_thread.h"
 #include "mmap.h"
 #include "util.h"
 #include "out.h"
@@ -103,6 +105,8 @@ static void *Rpmem_handle_remote;
 
 int Prefault_at_open = 0;
 int Prefault_at_create = 0;
+int Prefault_threads = 0;
+int Prefault_lazy_data = 0;
 int SDS_at_create = POOL_FEAT_INCOMPAT_DEFAULT & POOL_E_FEAT_SDS ? 1 : 0;
 int Fallocate_at_create = 1;
 int COW_at_open = 0;
@@ -341,21 +345,213 @@ static const char *parser_errstr[PARSER_MAX_CODE] = {
 	"" /* format correct */
 };
 
+#if defined(__linux__) && !defined(MADV_POPULATE_WRITE)
+#define MADV_POPULATE_WRITE 23 /* available since Linux 5.14 */
+#endif
+
+/* smallest range worth handing over to a separate prefault thread */
+#define PREFAULT_MIN_THREAD_LEN (1ULL << 30) /* 1 GiB */
+#define PREFAULT_MAX_THREADS 64
+
+struct parallel_worker {
+	os_thread_t thread;
+	char *addr;
+	size_t len;
+	util_range_fn fn;
+	void *arg;
+	int bind;
+	unsigned node;
+};
+
 /*
- * util_replica_force_page_allocation - (internal) forces page allocation for
- * replica
+ * util_prefault_pages -- (internal) forces page allocation for the range,
+ *	either by asking the kernel to populate it or by writing to each page
  */
 static void
-util_replica_force_page_allocation(struct pool_replica *rep)
+util_prefault_pages(char *addr, size_t len, size_t pagesize)
 {
-	volatile char *cur_addr = rep->part[0].addr;
-	char *addr_end = (char *)cur_addr + rep->resvsize;
-	for (; cur_addr < addr_end; cur_addr += Pagesize) {
+#ifdef __linux__
+	if (os_madvise(addr, len, MADV_POPULATE_WRITE) == 0)
+		return;
+#endif
+	volatile char *cur_addr = addr;
+	char *addr_end = addr + len;
+	for (; cur_addr < addr_end; cur_addr += pagesize) {
 		*cur_addr = *cur_addr;
 		VALGRIND_SET_CLEAN(cur_addr, 1);
 	}
 }
 
+/*
+ * util_parallel_worker -- (internal) util_parallel_range thread routine
+ */
+static void *
+util_parallel_worker(void *arg)
+{
+	struct parallel_worker *w = arg;
+
+	if (w->bind && os_thread_bind_numa_node(w->node) != 0)
+		LOG(2, "cannot bind thread to node %u", w->node);
+
+	w->fn(w->addr, w->len, w->arg);
+
+	return NULL;
+}
+
+/*
+ * util_parallel_range -- calls fn for consecutive parts of the range, split
+ *	at addresses aligned to align, from up to nthreads threads, each running
+ *	on the NUMA node of the memory of its own part
+ *
+ * The node of a part is the one of its first byte. A range spanning several
+ * nodes (e.g. a pool set with parts on different DIMMs) has every thread
+ * bound to the node of the memory it writes to.
+ */
+void
+util_parallel_range(char *addr, size_t len, size_t align, unsigned nthreads,
+	util_range_fn fn, void *arg)
+{
+	struct parallel_worker *workers = NULL;
+	if (nthreads > 1)
+		workers = Malloc(nthreads * sizeof(*workers));
+
+	if (workers == NULL) {
+		fn(addr, len, arg);
+		return;
+	}
+
+	int numa = os_numa_node_count() > 1;
+
+	size_t chunk = ALIGN_UP((len + nthreads - 1) / nthreads, align);
+	size_t off = 0;
+	unsigned n = 0;
+	while (off < len) {
+		ASSERT(n < nthreads);
+		struct parallel_worker *w = &workers[n];
+
+		/* no two threads write to the same page */
+		size_t end = ALIGN_DOWN((uintptr_t)addr + off + chunk, align) -
+			(uintptr_t)addr;
+		if (end > len || n == nthreads - 1)
+			end = len;
+
+		w->addr = addr + off;
+		w->len = end - off;
+		w->fn = fn;
+		w->arg = arg;
+		/* looking up the node faults the page in, if it was not yet */
+		w->node = 0;
+		w->bind = numa && os_numa_node_of_addr(w->addr, &w->node) == 0;
+
+		if (os_thread_create(&w->thread, NULL,
+				util_parallel_worker, w) != 0) {
+			LOG(2, "cannot create thread");
+			break;
+		}
+
+		off += w->len;
+		n++;
+	}
+
+	/* whatever was not handed over to a thread is done here */
+	if (off < len)
+		fn(addr + off, len - off, arg);
+
+	for (unsigned i = 0; i < n; ++i)
+		os_thread_join(&workers[i].thread, NULL);
+
+	Free(workers);
+}
+
+/*
+ * util_prefault_nthreads -- (internal) returns the number of threads which
+ *	should prefault a range of the given length
+ */
+static unsigned
+util_prefault_nthreads(size_t len)
+{
+	size_t max = len / PREFAULT_MIN_THREAD_LEN;
+	size_t nthreads;
+
+	if (Prefault_threads > 0) {
+		nthreads = (size_t)Prefault_threads;
+	} else {
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		nthreads = cpus < 1 ? 1 : (size_t)cpus;
+		if (nthreads > PREFAULT_MAX_THREADS)
+			nthreads = PREFAULT_MAX_THREADS;
+	}
+
+	if (nthreads > max)
+		nthreads = max;
+
+	return nthreads == 0 ? 1 : (unsigned)nthreads;
+}
+
+/*
+ * util_prefault_part -- (internal) util_range_fn prefaulting a part of
+ *	the range
+ */
+static void
+util_prefault_part(char *addr, size_t len, void *arg)
+{
+	util_prefault_pages(addr, len, *(size_t *)arg);
+}
+
+/*
+ * util_prefault_range -- (internal) forces page allocation for the range,
+ *	splitting it between threads running on the NUMA nodes of the memory
+ */
+static void
+util_prefault_range(char *addr, size_t len, size_t pagesize)
+{
+	unsigned nthreads = util_prefault_nthreads(len);
+	if (nthreads == 1) {
+		util_prefault_pages(addr, len, pagesize);
+		return;
+	}
+
+	util_parallel_range(addr, len, pagesize, nthreads,
+		util_prefault_part, &pagesize);
+}
+
+/*
+ * util_prefault -- forces page allocation for the given range of a mapped
+ *	pool, see prefault.threads
+ */
+void
+util_prefault(void *addr, size_t len)
+{
+	LOG(3, "addr %p len %zu", addr, len);
+
+	char *begin = (char *)ALIGN_DOWN((uintptr_t)addr, Pagesize);
+	char *end = (char *)ALIGN_UP((uintptr_t)addr + len, Pagesize);
+	if (begin == end)
+		return;
+
+	util_prefault_range(begin, (size_t)(end - begin), Pagesize);
+}
+
+/*
+ * util_replica_force_page_allocation - (internal) forces page allocation for
+ * replica
+ *
+ * If prefault.lazy_data is set, the pool's metadata is prefaulted by
+ * the library which knows where it is, and the data is faulted on demand.
+ */
+static void
+util_replica_force_page_allocation(struct pool_replica *rep)
+{
+	if (Prefault_lazy_data)
+		return;
+
+	/* touching a single byte faults in a whole Device DAX page */
+	size_t pagesize = rep->part[0].is_dev_dax ?
+		rep->part[0].alignment : Pagesize;
+
+	util_prefault_range(rep->part[0].addr, rep->resvsize, pagesize);
+}
+
 /*
  * util_map_hdr -- map a header of a pool set
  */
@@ -854,6 +1050,29 @@ parser_read_replica(char *line, char **node_addr, char **pool_desc)
 	return PARSER_CONTINUE;
 }
 
+/*
+ * parser_is_lazy_replica -- (internal) check if the rest of the 'REPLICA'
+ *                           line marks a lazily updated local replica
+ */
+static int
+parser_is_lazy_replica(const char *line)
+{
+	if (!isblank((unsigned char)*line))
+		return 0;
+
+	while (isblank((unsigned char)*line))
+		line++;
+
+	if (strncmp(line, POOLSET_LAZY_SIG, POOLSET_LAZY_SIG_LEN) != 0)
+		return 0;
+
+	line += POOLSET_LAZY_SIG_LEN;
+	while (isblank((unsigned char)*line))
+		line++;
+
+	return *line == '\0';
+}
+
 /*
  * parser_read_options -- (internal) read line and validate options
  */
@@ -1589,7 +1808,9 @@ util_poolset_parse(struct pool_set **setp, const char *path, int fd)
 			}
 		} else if (strncmp(line, POOLSET_REPLICA_SIG,
 					POOLSET_REPLICA_SIG_LEN) == 0) {
-			if (line[POOLSET_REPLICA_SIG_LEN] != '\0') {
+			int lazy = parser_is_lazy_replica(
+					line + POOLSET_REPLICA_SIG_LEN);
+			if (line[POOLSET_REPLICA_SIG_LEN] != '\0' && !lazy) {
 				/* something more than 'REPLICA' */
 				char c = line[POOLSET_REPLICA_SIG_LEN];
 				if (!isblank((unsigned char)c)) {
@@ -1612,12 +1833,14 @@ util_poolset_parse(struct pool_set **setp, const char *path, int fd)
 				}
 			} else if (nparts >= 1) {
 				/* 'REPLICA' signature detected */
-				LOG(10, "REPLICA");
+				LOG(10, "REPLICA%s", lazy ? " LAZY" : "");
 
 				int ret = util_parse_add_replica(&set);
 				if (ret != 0)
 					goto err;
 
+				set->replica[set->nreplicas - 1]->lazy = lazy;
+
 				nparts = 0;
 				result = PARSER_CONTINUE;
 			} else {
@@ -1999,6 +2222,146 @@ util_poolset_remote_open(struct pool_replica *rep, unsigned repidx,
 	return 0;
 }
 
+/* pool sets with fewer parts per thread are opened by the calling thread */
+#define PARTS_PARALLEL_MIN_PER_THREAD 4
+#define PARTS_PARALLEL_MAX_THREADS 16
+
+/* which parts are processed by util_parts_parallel() */
+enum parts_parallel_scope {
+	PARTS_LOCAL,	/* all parts of local replicas */
+	PARTS_HDRS,	/* parts with headers, of all replicas */
+};
+
+typedef int (*parts_parallel_fn)(struct pool_set *set, unsigned repidx,
+	unsigned partidx, void *arg);
+
+struct parts_parallel {
+	struct pool_set *set;
+	unsigned repidx;	/* single replica or UINT_MAX for all of them */
+	enum parts_parallel_scope scope;
+	parts_parallel_fn fn;
+	void *arg;
+
+	unsigned next;		/* index of the next part to be processed */
+	int failed;
+};
+
+/*
+ * util_parts_parallel_nparts -- (internal) returns the number of parts of
+ *	the replica covered by the scope
+ */
+static unsigned
+util_parts_parallel_nparts(struct parts_parallel *pp, unsigned r)
+{
+	struct pool_replica *rep = pp->set->replica[r];
+
+	if (pp->scope == PARTS_HDRS)
+		return rep->nhdrs;
+
+	return rep->remote ? 0 : rep->nparts;
+}
+
+/*
+ * util_parts_parallel_worker -- (internal) processes parts until all of them
+ *	are done or any of them fails
+ */
+static void *
+util_parts_parallel_worker(void *arg)
+{
+	struct parts_parallel *pp = arg;
+	struct pool_set *set = pp->set;
+	unsigned rfirst = pp->repidx == UINT_MAX ? 0 : pp->repidx;
+	unsigned rlast = pp->repidx == UINT_MAX ?
+		set->nreplicas : pp->repidx + 1;
+
+	while (1) {
+		int failed;
+		util_atomic_load_explicit32(&pp->failed, &failed,
+			memory_order_acquire);
+		if (failed)
+			break;
+
+		unsigned i = util_fetch_and_add32(&pp->next, 1);
+
+		unsigned r = rfirst;
+		for (; r < rlast; ++r) {
+			unsigned nparts = util_parts_parallel_nparts(pp, r);
+			if (i < nparts)
+				break;
+			i -= nparts;
+		}
+
+		if (r == rlast)
+			break;
+
+		if (pp->fn(set, r, i, pp->arg) != 0)
+			util_atomic_store_explicit32(&pp->failed, 1,
+				memory_order_release);
+	}
+
+	return NULL;
+}
+
+/*
+ * util_parts_parallel -- (internal) calls fn for each part in the scope,
+ *	spreading the parts between threads if there are many of them
+ *
+ * Errors reported by other threads are not visible to the caller, so on
+ * failure the caller is expected to repeat the work sequentially to get
+ * the error message and errno of the failing part.
+ */
+static int
+util_parts_parallel(struct pool_set *set, unsigned repidx,
+	enum parts_parallel_scope scope, parts_parallel_fn fn, void *arg)
+{
+	struct parts_parallel pp = {set, repidx, scope, fn, arg, 0, 0};
+
+	unsigned total = 0;
+	for (unsigned r = 0; r < set->nreplicas; ++r) {
+		if (repidx == UINT_MAX || repidx == r)
+			total += util_parts_parallel_nparts(&pp, r);
+	}
+
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned nthreads = total / PARTS_PARALLEL_MIN_PER_THREAD;
+	if (cpus > 0 && nthreads > (unsigned long)cpus)
+		nthreads = (unsigned)cpus;
+	if (nthreads > PARTS_PARALLEL_MAX_THREADS)
+		nthreads = PARTS_PARALLEL_MAX_THREADS;
+
+	/* the calling thread is one of the workers */
+	os_thread_t threads[PARTS_PARALLEL_MAX_THREADS];
+	unsigned n = 0;
+	for (; n + 1 < nthreads; ++n) {
+		if (os_thread_create(&threads[n], NULL,
+				util_parts_parallel_worker, &pp) != 0) {
+			LOG(2, "cannot create pool set part thread");
+			break;
+		}
+	}
+
+	util_parts_parallel_worker(&pp);
+
+	for (unsigned i = 0; i < n; ++i)
+		os_thread_join(&threads[i], NULL);
+
+	return pp.failed ? -1 : 0;
+}
+
+/*
+ * util_part_open_parallel -- (internal) util_parts_parallel() callback
+ *	opening an existing part file
+ */
+static int
+util_part_open_parallel(struct pool_set *set, unsigned repidx,
+	unsigned partidx, void *arg)
+{
+	size_t minpartsize = *(size_t *)arg;
+
+	return util_part_open(&set->replica[repidx]->part[partidx],
+		minpartsize, 0);
+}
+
 /*
  * util_poolset_files_local -- (internal) open or create all the local
  *                              part files of a pool set and replica sets
@@ -2008,6 +2371,19 @@ util_poolset_files_local(struct pool_set *set, size_t minpartsize, int create)
 {
 	LOG(3, "set %p minpartsize %zu create %d", set, minpartsize, create);
 
+	/*
+	 * Existing part files can be opened in any order, but the files
+	 * which are created have to be deleted if the pool creation fails.
+	 */
+	if (!create) {
+		if (util_parts_parallel(set, UINT_MAX, PARTS_LOCAL,
+				util_part_open_parallel, &minpartsize) == 0)
+			return 0;
+
+		/* find out which part has failed, with a proper error */
+		util_poolset_fdclose_always(set);
+	}
+
 	for (unsigned r = 0; r < set->nreplicas; r++) {
 		struct pool_replica *rep = set->replica[r];
 		if (!rep->remote) {
@@ -2436,9 +2812,14 @@ util_header_check(struct pool_set *set, unsigned repidx, unsigned partidx,
 		return -1;
 	}
 
-	/* check compatibility features */
+	/*
+	 * check compatibility features, a lagging replica is marked only in
+	 * the header of its first part
+	 */
+	uint32_t incompat = le32toh(HDR(rep, 0)->features.incompat);
 	if (HDR(rep, 0)->features.compat != hdrp->features.compat ||
-	    HDR(rep, 0)->features.incompat != hdrp->features.incompat ||
+	    (incompat & ~POOL_FEAT_LAG) !=
+			(hdr.features.incompat & ~POOL_FEAT_LAG) ||
 	    HDR(rep, 0)->features.ro_compat != hdrp->features.ro_compat) {
 		ERR("incompatible feature flags");
 		errno = EINVAL;
@@ -3357,6 +3738,24 @@ util_pool_create(struct pool_set **setp, const char *path, size_t poolsize,
 			minpartsize, attr, nlanes, can_have_rep, POOL_LOCAL);
 }
 
+/*
+ * util_map_hdr_parallel -- (internal) util_parts_parallel() callback mapping
+ *	a header of a part
+ */
+static int
+util_map_hdr_parallel(struct pool_set *set, unsigned repidx,
+	unsigned partidx, void *arg)
+{
+	int flags = *(int *)arg;
+	struct pool_set_part *part = &set->replica[repidx]->part[partidx];
+
+	/* headers stay mapped when the replica mapping is retried */
+	if (part->hdr != NULL)
+		return 0;
+
+	return util_map_hdr(part, flags, 0);
+}
+
 /*
  * util_replica_open_local -- (internal) open a memory pool local replica
  */
@@ -3399,8 +3798,17 @@ util_replica_open_local(struct pool_set *set, unsigned repidx, int flags)
 		VALGRIND_REGISTER_PMEM_FILE(rep->part[0].fd,
 			rep->part[0].addr, rep->resvsize, 0);
 
-		/* map all headers - don't care about the address */
+		/*
+		 * map all headers - don't care about the address; a header
+		 * which failed to be mapped in parallel is retried below
+		 */
+		util_parts_parallel(set, repidx, PARTS_HDRS,
+			util_map_hdr_parallel, &flags);
+
 		for (unsigned p = 0; p < rep->nhdrs; p++) {
+			if (rep->part[p].hdr != NULL)
+				continue;
+
 			if (util_map_hdr(&rep->part[p], flags, 0) != 0) {
 				LOG(2, "header mapping failed - part #%d", p);
 				goto err;
@@ -3675,6 +4083,17 @@ util_unmap_all_hdrs(struct pool_set *set)
 	}
 }
 
+/*
+ * util_header_check_parallel -- (internal) util_parts_parallel() callback
+ *	validating a header of a part
+ */
+static int
+util_header_check_parallel(struct pool_set *set, unsigned repidx,
+	unsigned partidx, void *arg)
+{
+	return util_header_check(set, repidx, partidx, arg);
+}
+
 /*
  * util_replica_check -- check headers, check UUID's, check replicas linkage
  */
@@ -3686,10 +4105,14 @@ util_replica_check(struct pool_set *set, const struct pool_attr *attr)
 	/* read shutdown state toggle from header */
 	set->ignore_sds |= IGNORE_SDS(HDR(REP(set, 0), 0));
 
+	/* on failure, the headers are checked again to report the error */
+	int checked = util_parts_parallel(set, UINT_MAX, PARTS_HDRS,
+		util_header_check_parallel, (void *)attr) == 0;
+
 	for (unsigned r = 0; r < set->nreplicas; r++) {
 		struct pool_replica *rep = set->replica[r];
 		for (unsigned p = 0; p < rep->nhdrs; p++) {
-			if (util_header_check(set, r, p, attr) != 0) {
+			if (!checked && util_header_check(set, r, p, attr)) {
 				LOG(2, "header check failed - part #%d", p);
 				return -1;
 			}
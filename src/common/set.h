@@ -66,6 +66,9 @@ extern "C" {
 #define POOLSET_OPTION_SIG "OPTION"
 #define POOLSET_OPTION_SIG_LEN 6	/* does NOT include '\0' */
 
+#define POOLSET_LAZY_SIG "LAZY"
+#define POOLSET_LAZY_SIG_LEN 4	/* does NOT include '\0' */
+
 /* pool set option flags */
 enum pool_set_option_flag {
 	OPTION_UNKNOWN = 0x0,
@@ -142,6 +145,7 @@ struct pool_replica {
 	size_t repsize;		/* total size of all the parts (mappings) */
 	size_t resvsize;	/* min size of the address space reservation */
 	int is_pmem;		/* true if all the parts are in PMEM */
+	int lazy;		/* updated lazily, local replicas only */
 	struct remote_replica *remote;	/* not NULL if the replica */
 					/* is a remote one */
 	VEC(, struct pool_set_directory) directory;
@@ -331,10 +335,18 @@ HDRP(struct pool_replica *rep, unsigned p)
 
 extern int Prefault_at_open;
 extern int Prefault_at_create;
+extern int Prefault_threads;
+extern int Prefault_lazy_data;
 extern int SDS_at_create;
 extern int Fallocate_at_create;
 extern int COW_at_open;
 
+void util_prefault(void *addr, size_t len);
+
+typedef void (*util_range_fn)(char *addr, size_t len, void *arg);
+void util_parallel_range(char *addr, size_t len, size_t align,
+	unsigned nthreads, util_range_fn fn, void *arg);
+
 int util_poolset_parse(struct pool_set **setp, const char *path, int fd);
 int util_poolset_read(struct pool_set **setp, const char *path);
 int util_poolset_create_set(struct pool_set **setp, const char *path,
@@ -0,0 +1,284 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2020, Intel Corporation */
+
+/*
+ * line_batch.c -- line_batch implementation
+ *
+ * Code updating many scattered fields flushes each of them separately, so
+ * a line holding several of them is written back several times. The batch
+ * instead records the ranges, rounded to whole lines, and flushes each line
+ * once, after sorting the ranges and merging the adjacent and overlapping
+ * ones, so the lines are also written back in the order of addresses.
+ *
+ * Most of the recorded ranges are single fields, which fit in one line.
+ * Such lines are also kept in a small open-addressed hash set, so a line
+ * recorded again is dropped right away instead of taking another entry.
+ * The set is emptied in constant time by bumping its generation: a slot
+ * tagged with an older one is free. It is only a hint, the merging of
+ * the ranges is what makes the lines unique, so it is also emptied whenever
+ * it gets half full.
+ */
+
+#include <stdlib.h>
+
+#include "alloc.h"
+#include "line_batch.h"
+#include "out.h"
+#include "util.h"
+
+/* the initial capacity of the batch */
+#define LINE_BATCH_MIN_RANGES 64
+
+/*
+ * line_batch_range -- a range of whole lines
+ */
+struct line_batch_range {
+	uintptr_t begin;
+	uintptr_t end;
+};
+
+/*
+ * line_batch_slot -- a slot of the set of the recorded single lines
+ */
+struct line_batch_slot {
+	uintptr_t line;
+	uint64_t gen; /* the slot is free if it is not the current one */
+};
+
+struct line_batch {
+	size_t line; /* the size of a line, a power of 2 */
+
+	struct line_batch_range *ranges;
+	size_t nranges;
+	size_t capacity;
+
+	struct line_batch_slot *set; /* twice as many slots as ranges */
+	unsigned set_bits; /* log2 of the number of the slots */
+	size_t set_count; /* the number of the slots in use */
+	uint64_t gen;
+};
+
+/*
+ * line_batch_new -- create an empty batch of ranges of lines of the given
+ * size
+ */
+struct line_batch *
+line_batch_new(size_t line)
+{
+	ASSERTne(line, 0);
+	ASSERTeq(line & (line - 1), 0);
+
+	struct line_batch *lb = Zalloc(sizeof(*lb));
+	if (lb == NULL)
+		return NULL;
+
+	lb->line = line;
+	lb->gen = 1;
+
+	return lb;
+}
+
+/*
+ * line_batch_delete -- release the batch, the recorded ranges are dropped
+ */
+void
+line_batch_delete(struct line_batch *lb)
+{
+	if (lb == NULL)
+		return;
+
+	Free(lb->set);
+	Free(lb->ranges);
+	Free(lb);
+}
+
+/*
+ * line_batch_hash -- (internal) the slot at which the probing for the line
+ * starts
+ */
+static inline size_t
+line_batch_hash(const struct line_batch *lb, uintptr_t line)
+{
+	uint64_t h = (uint64_t)(line / lb->line) * 0x9E3779B97F4A7C15ULL;
+
+	return (size_t)(h >> (64 - lb->set_bits));
+}
+
+/*
+ * line_batch_set_insert -- (internal) insert the line into the set, return
+ * 0 if it was already there
+ */
+static int
+line_batch_set_insert(struct line_batch *lb, uintptr_t line)
+{
+	size_t mask = (1ULL << lb->set_bits) - 1;
+
+	if (lb->set_count > mask / 2) {
+		lb->gen++;
+		lb->set_count = 0;
+	}
+
+	size_t i = line_batch_hash(lb, line);
+
+	while (lb->set[i].gen == lb->gen) {
+		if (lb->set[i].line == line)
+			return 0;
+		i = (i + 1) & mask;
+	}
+
+	lb->set[i].line = line;
+	lb->set[i].gen = lb->gen;
+	lb->set_count++;
+
+	return 1;
+}
+
+/*
+ * line_batch_range_cmp -- (internal) compare the ranges by their beginnings
+ */
+static int
+line_batch_range_cmp(const void *a, const void *b)
+{
+	const struct line_batch_range *ra = a;
+	const struct line_batch_range *rb = b;
+
+	if (ra->begin < rb->begin)
+		return -1;
+	return ra->begin > rb->begin;
+}
+
+/*
+ * line_batch_coalesce -- (internal) sort the ranges and merge the adjacent
+ * and overlapping ones
+ */
+static void
+line_batch_coalesce(struct line_batch *lb)
+{
+	if (lb->nranges < 2)
+		return;
+
+	struct line_batch_range *ranges = lb->ranges;
+
+	qsort(ranges, lb->nranges, sizeof(*ranges), line_batch_range_cmp);
+
+	size_t n = 0;
+	for (size_t i = 1; i < lb->nranges; ++i) {
+		if (ranges[i].begin <= ranges[n].end)
+			ranges[n].end = MAX(ranges[n].end, ranges[i].end);
+		else
+			ranges[++n] = ranges[i];
+	}
+
+	lb->nranges = n + 1;
+}
+
+/*
+ * line_batch_reserve -- (internal) make room for one more range, merging
+ * the recorded ones first
+ */
+static int
+line_batch_reserve(struct line_batch *lb)
+{
+	if (lb->nranges < lb->capacity)
+		return 0;
+
+	line_batch_coalesce(lb);
+
+	/* grow only if merging did not free a fair part of the batch */
+	if (lb->capacity && lb->nranges < lb->capacity / 2)
+		return 0;
+
+	size_t capacity = MAX(lb->capacity * 2, LINE_BATCH_MIN_RANGES);
+	unsigned set_bits = util_mssb_index64(capacity) + 1;
+
+	struct line_batch_slot *set = Zalloc(sizeof(*set) << set_bits);
+	if (set == NULL)
+		return -1;
+
+	struct line_batch_range *ranges = Realloc(lb->ranges,
+			capacity * sizeof(*ranges));
+	if (ranges == NULL) {
+		Free(set);
+		return -1;
+	}
+
+	lb->ranges = ranges;
+	lb->capacity = capacity;
+
+	/* move the lines recorded in the current generation to the new set */
+	struct line_batch_slot *old = lb->set;
+	size_t old_nslots = old ? 1ULL << lb->set_bits : 0;
+
+	lb->set = set;
+	lb->set_bits = set_bits;
+	lb->set_count = 0;
+
+	for (size_t i = 0; i < old_nslots; ++i) {
+		if (old[i].gen == lb->gen)
+			line_batch_set_insert(lb, old[i].line);
+	}
+
+	Free(old);
+
+	return 0;
+}
+
+/*
+ * line_batch_add -- record the range to be flushed, return -1 if there is
+ * no memory to record it, in which case it has to be flushed right away
+ */
+int
+line_batch_add(struct line_batch *lb, const void *addr, size_t len)
+{
+	if (len == 0)
+		return 0;
+
+	uintptr_t begin = ALIGN_DOWN((uintptr_t)addr, lb->line);
+	uintptr_t end = ALIGN_UP((uintptr_t)addr + len, lb->line);
+
+	if (lb->nranges) {
+		struct line_batch_range *last = &lb->ranges[lb->nranges - 1];
+
+		/* the common case of updating a structure piece by piece */
+		if (begin <= last->end && last->begin <= end) {
+			last->begin = MIN(last->begin, begin);
+			last->end = MAX(last->end, end);
+			return 0;
+		}
+	}
+
+	if (line_batch_reserve(lb))
+		return -1;
+
+	if (end - begin == lb->line && !line_batch_set_insert(lb, begin))
+		return 0;
+
+	lb->ranges[lb->nranges].begin = begin;
+	lb->ranges[lb->nranges].end = end;
+	lb->nranges++;
+
+	return 0;
+}
+
+/*
+ * line_batch_flush -- flush all the recorded lines, each of them once and
+ * in the order of addresses, and empty the batch; returns the number of
+ * the calls to the flush function
+ */
+size_t
+line_batch_flush(struct line_batch *lb, line_batch_flush_fn flush, void *arg)
+{
+	line_batch_coalesce(lb);
+
+	size_t n = lb->nranges;
+	for (size_t i = 0; i < n; ++i) {
+		flush((const void *)lb->ranges[i].begin,
+			lb->ranges[i].end - lb->ranges[i].begin, arg);
+	}
+
+	lb->nranges = 0;
+	lb->gen++;
+	lb->set_count = 0;
+
+	return n;
+}
@@ -0,0 +1,34 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright 2020, Intel Corporation */
+
+/*
+ * line_batch.h -- internal definitions for line_batch, a set of ranges to be
+ *	flushed, coalesced at the granularity of a cache line (or a page)
+ */
+
+#ifndef LINE_BATCH_H
+#define LINE_BATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct line_batch;
+
+/* flushes a range made of whole lines */
+typedef void (*line_batch_flush_fn)(const void *addr, size_t len, void *arg);
+
+struct line_batch *line_batch_new(size_t line);
+void line_batch_delete(struct line_batch *lb);
+int line_batch_add(struct line_batch *lb, const void *addr, size_t len);
+size_t line_batch_flush(struct line_batch *lb, line_batch_flush_fn flush,
+		void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -169,6 +169,15 @@ int os_thread_setaffinity_np(os_thread_t *thread, size_t set_size,
 int os_thread_atfork(void (*prepare)(void), void (*parent)(void),
 	void (*child)(void));
 
+/* NUMA topology */
+
+int os_thread_numa_node(unsigned *node);
+unsigned os_numa_node_count(void);
+int os_numa_node_online(unsigned node);
+int os_numa_node_of_addr(const void *addr, unsigned *node);
+int os_thread_bind_numa_node(unsigned node);
+int os_numa_prefer_node(void *addr, size_t len, unsigned node);
+
 int os_semaphore_init(os_semaphore_t *sem, unsigned value);
 int os_semaphore_destroy(os_semaphore_t *sem);
 int os_semaphore_wait(os_semaphore_t *sem);
@@ -6,11 +6,17 @@
  */
 
 #define _GNU_SOURCE
+#include <errno.h>
 #include <pthread.h>
 #ifdef __FreeBSD__
 #include <pthread_np.h>
 #endif
 #include <semaphore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
 
 #include "os_thread.h"
 #include "util.h"
@@ -389,6 +395,205 @@ os_cpu_set(size_t cpu, os_cpu_set_t *set)
 	CPU_SET(cpu, (cpu_set_t *)set);
 }
 
+/*
+ * os_thread_numa_node -- returns the NUMA node of the CPU the calling thread
+ *	is currently running on
+ */
+int
+os_thread_numa_node(unsigned *node)
+{
+#if defined(__linux__) && defined(SYS_getcpu)
+	unsigned cpu;
+	if (syscall(SYS_getcpu, &cpu, node, NULL) != 0)
+		return -1;
+
+	return 0;
+#else
+	*node = 0;
+	return 0;
+#endif
+}
+
+#ifdef __linux__
+/*
+ * numa_node_list_read -- (internal) parses the list of nodes in the given
+ *	file of /sys/devices/system/node, sets *highest to the highest ID in
+ *	it and returns whether the given node is in it, or -1 on failure
+ */
+static int
+numa_node_list_read(const char *name, unsigned node, long *highest)
+{
+	char path[64];
+	snprintf(path, sizeof(path), "/sys/devices/system/node/%s", name);
+
+	FILE *f = fopen(path, "r");
+	if (f == NULL)
+		return -1;
+
+	char buf[256];
+	char *line = fgets(buf, sizeof(buf), f);
+	fclose(f);
+	if (line == NULL)
+		return -1;
+
+	/* the list looks like "0-1,3", IDs in it are ascending */
+	int found = 0;
+	*highest = -1;
+	char *p = buf;
+	while (*p >= '0' && *p <= '9') {
+		unsigned long first = strtoul(p, &p, 10);
+		unsigned long last = first;
+		if (*p == '-')
+			last = strtoul(p + 1, &p, 10);
+		if (last >= UINT16_MAX)
+			return -1;
+		if (node >= first && node <= last)
+			found = 1;
+		*highest = (long)last;
+		if (*p == ',')
+			p++;
+	}
+
+	return *highest >= 0 ? found : -1;
+}
+#endif
+
+/*
+ * os_numa_node_count -- returns one more than the highest ID of the NUMA
+ *	nodes with CPUs, or 1 if the topology cannot be determined
+ *
+ * The IDs may be sparse, so some of the nodes below the returned count may
+ * not exist or have no CPUs; the callers index per-node state with the node
+ * of the running CPU and leave such entries unused.
+ */
+unsigned
+os_numa_node_count(void)
+{
+#ifdef __linux__
+	long highest;
+	if (numa_node_list_read("has_cpu", 0, &highest) < 0 &&
+			numa_node_list_read("online", 0, &highest) < 0)
+		return 1;
+
+	return (unsigned)highest + 1;
+#else
+	return 1;
+#endif
+}
+
+/*
+ * os_numa_node_online -- returns whether the NUMA node is online, including
+ *	the nodes having only memory and no CPUs
+ */
+int
+os_numa_node_online(unsigned node)
+{
+#ifdef __linux__
+	long highest;
+	int ret = numa_node_list_read("online", node, &highest);
+	if (ret >= 0)
+		return ret;
+#endif
+	return node == 0;
+}
+
+/*
+ * os_numa_node_of_addr -- returns the NUMA node of the memory backing
+ *	the given (already faulted) address
+ */
+int
+os_numa_node_of_addr(const void *addr, unsigned *node)
+{
+#if defined(__linux__) && defined(SYS_get_mempolicy)
+	/* MPOL_F_NODE | MPOL_F_ADDR, see get_mempolicy(2) */
+	int mode;
+	if (syscall(SYS_get_mempolicy, &mode, NULL, 0, addr,
+			(1 << 0) | (1 << 1)) != 0)
+		return -1;
+
+	*node = (unsigned)mode;
+	return 0;
+#else
+	return -1;
+#endif
+}
+
+/*
+ * os_thread_bind_numa_node -- restricts the calling thread to the CPUs of
+ *	the given NUMA node
+ */
+int
+os_thread_bind_numa_node(unsigned node)
+{
+#ifdef __linux__
+	char path[64];
+	snprintf(path, sizeof(path),
+		"/sys/devices/system/node/node%u/cpulist", node);
+
+	FILE *f = fopen(path, "r");
+	if (f == NULL)
+		return -1;
+
+	char buf[1024];
+	char *line = fgets(buf, sizeof(buf), f);
+	fclose(f);
+	if (line == NULL)
+		return -1;
+
+	/* the list looks like "0-3,8-11" */
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	char *p = buf;
+	while (*p >= '0' && *p <= '9') {
+		unsigned long first = strtoul(p, &p, 10);
+		unsigned long last = first;
+		if (*p == '-')
+			last = strtoul(p + 1, &p, 10);
+		if (last >= CPU_SETSIZE)
+			last = CPU_SETSIZE - 1;
+		for (unsigned long cpu = first; cpu <= last; ++cpu)
+			CPU_SET(cpu, &set);
+		if (*p == ',')
+			p++;
+	}
+
+	if (CPU_COUNT(&set) == 0)
+		return -1;
+
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+	return -1;
+#endif
+}
+
+/*
+ * os_numa_prefer_node -- makes the pages of the range, which are not
+ *	allocated yet, be allocated on the given NUMA node if possible
+ */
+int
+os_numa_prefer_node(void *addr, size_t len, unsigned node)
+{
+#if defined(__linux__) && defined(SYS_mbind)
+	/* the node mask has as many bits as an unsigned long */
+	if (node >= sizeof(unsigned long) * 8) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	unsigned long mask = 1UL << node;
+
+	/*
+	 * MPOL_PREFERRED, see mbind(2); the kernel uses one bit less than
+	 * maxnode, so it is one more than the number of bits in the mask
+	 */
+	return (int)syscall(SYS_mbind, addr, len, 1, &mask,
+			sizeof(mask) * 8 + 1, 0);
+#else
+	errno = ENOTSUP;
+	return -1;
+#endif
+}
+
 /*
  * os_semaphore_init -- initializes semaphore instance
  */
@@ -593,6 +593,87 @@ os_thread_setaffinity_np(os_thread_t *thread, size_t set_size,
 	return ret != 0 ? 0 : EINVAL;
 }
 
+/*
+ * os_thread_numa_node -- returns the NUMA node of the processor the calling
+ *	thread is currently running on
+ */
+int
+os_thread_numa_node(unsigned *node)
+{
+	PROCESSOR_NUMBER proc;
+	USHORT proc_node;
+
+	GetCurrentProcessorNumberEx(&proc);
+	if (!GetNumaProcessorNodeEx(&proc, &proc_node))
+		return -1;
+
+	*node = proc_node;
+	return 0;
+}
+
+/*
+ * os_numa_node_count -- returns the number of NUMA nodes, or 1 if
+ *	the topology cannot be determined
+ */
+unsigned
+os_numa_node_count(void)
+{
+	ULONG highest;
+	if (!GetNumaHighestNodeNumber(&highest))
+		return 1;
+
+	return (unsigned)highest + 1;
+}
+
+/*
+ * os_numa_node_online -- returns whether the NUMA node exists in the system
+ */
+int
+os_numa_node_online(unsigned node)
+{
+	ULONG highest;
+	if (!GetNumaHighestNodeNumber(&highest))
+		return node == 0;
+
+	return node <= highest;
+}
+
+/*
+ * os_numa_node_of_addr -- returns the NUMA node of the memory backing
+ *	the given address, not supported on Windows
+ */
+int
+os_numa_node_of_addr(const void *addr, unsigned *node)
+{
+	return -1;
+}
+
+/*
+ * os_thread_bind_numa_node -- restricts the calling thread to the processors
+ *	of the given NUMA node
+ */
+int
+os_thread_bind_numa_node(unsigned node)
+{
+	GROUP_AFFINITY affinity;
+	if (!GetNumaNodeProcessorMaskEx((USHORT)node, &affinity))
+		return -1;
+
+	return SetThreadGroupAffinity(GetCurrentThread(), &affinity, NULL) ?
+		0 : -1;
+}
+
+/*
+ * os_numa_prefer_node -- makes the pages of the range be allocated on
+ *	the given NUMA node, not supported on Windows
+ */
+int
+os_numa_prefer_node(void *addr, size_t len, unsigned node)
+{
+	errno = ENOTSUP;
+	return -1;
+}
+
 /*
  * os_semaphore_init -- initializes a new semaphore instance
  */
@@ -0,0 +1,472 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2020, Intel Corporation */
+
+/*
+ * range_map.c -- range_map implementation
+ *
+ * The ranges are kept in an immutable array sorted by address. Every change
+ * builds a new copy of the array and publishes it with a single pointer
+ * store, so lookups are a lock-free binary search over whatever array was
+ * current when they started.
+ *
+ * An old array can be freed only after all the lookups which might still be
+ * reading it are finished. Every thread doing lookups gets its own reader
+ * slot, padded to a cache line, in which it announces the epoch it started
+ * in. A writer bumps the global epoch after publishing a new array and puts
+ * the old one on a list of retired arrays, which are freed by later writers
+ * once no slot holds an older epoch. Lookups therefore never write to memory
+ * shared with other threads and writers never wait for the readers.
+ *
+ * The last replaced snapshot is kept instead of being freed, so that a range
+ * can be removed even when the new array cannot be allocated: the writer then
+ * waits until no lookup uses the kept snapshot anymore and reuses its memory,
+ * which always fits the ranges left after the removal.
+ */
+
+#include <errno.h>
+#include <sched.h>
+#include <string.h>
+
+#include "alloc.h"
+#include "os_thread.h"
+#include "out.h"
+#include "range_map.h"
+#include "sys_util.h"
+#include "util.h"
+
+/*
+ * range_map_entry -- a single registered range
+ */
+struct range_map_entry {
+	uintptr_t addr;
+	uintptr_t end;
+	void *data;
+};
+
+/*
+ * range_map_snapshot -- immutable array of ranges sorted by address
+ */
+struct range_map_snapshot {
+	/* set when the snapshot gets replaced, never read by lookups */
+	struct range_map_snapshot *next_retired;
+	uint64_t retire_epoch;
+
+	size_t nranges;
+	struct range_map_entry ranges[];
+};
+
+/*
+ * range_map_reader -- per-thread lookup state
+ */
+struct range_map_reader {
+	uint64_t epoch; /* epoch of the lookup in progress, 0 when idle */
+	int in_use; /* owned by a live thread */
+	struct range_map_reader *next;
+};
+
+#define RANGE_MAP_READER_SIZE\
+	ALIGN_UP(sizeof(struct range_map_reader), CACHELINE_SIZE)
+
+struct range_map {
+	/* current snapshot, read without taking any lock */
+	struct range_map_snapshot *snapshot;
+	uint64_t epoch;
+
+	/* replaced snapshots which may still be in use by lookups */
+	struct range_map_snapshot *retired;
+	/* the last replaced snapshot, reused when out of memory */
+	struct range_map_snapshot *spare;
+
+	/* serializes writers and guards the list of reader slots */
+	os_mutex_t lock;
+	struct range_map_reader *readers;
+	os_tls_key_t reader_key;
+};
+
+/*
+ * range_map_reader_release -- (internal) give the reader slot of an exiting
+ * thread back to the pool
+ */
+static void
+range_map_reader_release(void *arg)
+{
+	struct range_map_reader *r = arg;
+
+	util_atomic_store_explicit32(&r->in_use, 0, memory_order_release);
+}
+
+/*
+ * range_map_reader_get -- (internal) return the reader slot of the calling
+ * thread, assigning one on its first lookup
+ */
+static struct range_map_reader *
+range_map_reader_get(struct range_map *rm)
+{
+	struct range_map_reader *r = os_tls_get(rm->reader_key);
+	if (r)
+		return r;
+
+	util_mutex_lock(&rm->lock);
+
+	for (r = rm->readers; r != NULL; r = r->next) {
+		int in_use;
+		util_atomic_load_explicit32(&r->in_use, &in_use,
+			memory_order_acquire);
+		if (!in_use)
+			break;
+	}
+
+	if (r == NULL) {
+		r = util_aligned_malloc(CACHELINE_SIZE, RANGE_MAP_READER_SIZE);
+		if (r != NULL) {
+			r->epoch = 0;
+			r->next = rm->readers;
+			rm->readers = r;
+		}
+	}
+
+	if (r != NULL) {
+		r->in_use = 1;
+		if (os_tls_set(rm->reader_key, r)) {
+			r->in_use = 0;
+			r = NULL;
+		}
+	}
+
+	util_mutex_unlock(&rm->lock);
+
+	return r;
+}
+
+/*
+ * range_map_lower_bound -- (internal) return the index of the first range
+ * which ends above addr
+ */
+static size_t
+range_map_lower_bound(const struct range_map_snapshot *snap, uintptr_t addr)
+{
+	size_t lo = 0;
+	size_t hi = snap ? snap->nranges : 0;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (snap->ranges[mid].end <= addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/*
+ * range_map_min_epoch -- (internal) return the epoch of the oldest lookup in
+ * progress, UINT64_MAX if there is none
+ *
+ * Has to be called with the lock held.
+ */
+static uint64_t
+range_map_min_epoch(struct range_map *rm)
+{
+	uint64_t min_epoch = UINT64_MAX;
+
+	for (struct range_map_reader *r = rm->readers; r != NULL;
+			r = r->next) {
+		uint64_t e;
+		util_atomic_load_explicit64(&r->epoch, &e,
+			memory_order_seq_cst);
+		if (e != 0 && e < min_epoch)
+			min_epoch = e;
+	}
+
+	return min_epoch;
+}
+
+/*
+ * range_map_snapshot_find -- (internal) return the index of the earliest
+ * range overlapping with (addr, addr+len), or nranges if there is none
+ */
+static size_t
+range_map_snapshot_find(const struct range_map_snapshot *snap,
+		uintptr_t addr, size_t len)
+{
+	size_t nranges = snap ? snap->nranges : 0;
+	size_t i = range_map_lower_bound(snap, addr);
+
+	if (i == nranges || snap->ranges[i].addr >= addr + len)
+		return nranges;
+
+	return i;
+}
+
+/*
+ * range_map_reclaim -- (internal) free the retired snapshots which no lookup
+ * can be using anymore
+ *
+ * Has to be called with the lock held.
+ */
+static void
+range_map_reclaim(struct range_map *rm)
+{
+	uint64_t min_epoch = range_map_min_epoch(rm);
+
+	/*
+	 * A lookup which started in the epoch in which a snapshot was
+	 * retired, or later, cannot see that snapshot anymore.
+	 */
+	struct range_map_snapshot **prev = &rm->retired;
+	while (*prev) {
+		struct range_map_snapshot *snap = *prev;
+		if (snap->retire_epoch <= min_epoch) {
+			*prev = snap->next_retired;
+			Free(snap);
+		} else {
+			prev = &snap->next_retired;
+		}
+	}
+}
+
+/*
+ * range_map_publish -- (internal) replace the current snapshot
+ *
+ * Has to be called with the lock held.
+ */
+static void
+range_map_publish(struct range_map *rm, struct range_map_snapshot *snap)
+{
+	struct range_map_snapshot *old = rm->snapshot;
+
+	util_atomic_store_explicit64((uint64_t *)&rm->snapshot,
+		(uint64_t)snap, memory_order_seq_cst);
+
+	/* full barrier, orders the store above with the epoch loads below */
+	uint64_t epoch = util_fetch_and_add64(&rm->epoch, 1) + 1;
+
+	if (old) {
+		old->retire_epoch = epoch;
+
+		if (rm->spare) {
+			rm->spare->next_retired = rm->retired;
+			rm->retired = rm->spare;
+		}
+		rm->spare = old;
+	}
+
+	range_map_reclaim(rm);
+}
+
+/*
+ * range_map_take_spare -- (internal) wait until no lookup uses the last
+ * replaced snapshot and return it for reuse
+ *
+ * The spare snapshot was current right before the current one, so it holds
+ * at most one range less than the current one and its memory fits the ranges
+ * left after a removal. Has to be called with the lock held.
+ */
+static struct range_map_snapshot *
+range_map_take_spare(struct range_map *rm)
+{
+	struct range_map_snapshot *spare = rm->spare;
+	if (spare == NULL)
+		return NULL;
+
+	/* the lookups are short and cannot be blocked by the lock */
+	while (range_map_min_epoch(rm) < spare->retire_epoch)
+		sched_yield();
+
+	rm->spare = NULL;
+
+	return spare;
+}
+
+/*
+ * range_map_new -- create an empty range map
+ */
+struct range_map *
+range_map_new(void)
+{
+	struct range_map *rm = Malloc(sizeof(*rm));
+	if (rm == NULL)
+		return NULL;
+
+	rm->snapshot = NULL;
+	rm->epoch = 1;
+	rm->retired = NULL;
+	rm->spare = NULL;
+	rm->readers = NULL;
+
+	if (os_tls_key_create(&rm->reader_key, range_map_reader_release)) {
+		Free(rm);
+		return NULL;
+	}
+
+	util_mutex_init(&rm->lock);
+
+	return rm;
+}
+
+/*
+ * range_map_delete -- delete the range map, no lookups may be in progress
+ */
+void
+range_map_delete(struct range_map *rm)
+{
+	os_tls_key_delete(rm->reader_key);
+
+	while (rm->readers) {
+		struct range_map_reader *r = rm->readers;
+		rm->readers = r->next;
+		util_aligned_free(r);
+	}
+
+	while (rm->retired) {
+		struct range_map_snapshot *snap = rm->retired;
+		rm->retired = snap->next_retired;
+		Free(snap);
+	}
+
+	Free(rm->spare);
+	Free(rm->snapshot);
+	util_mutex_destroy(&rm->lock);
+	Free(rm);
+}
+
+/*
+ * range_map_insert -- insert the (addr, addr+len) range, which may not
+ * overlap with any range already in the map
+ */
+int
+range_map_insert(struct range_map *rm, uintptr_t addr, size_t len,
+		void *data)
+{
+	uintptr_t end = addr + len;
+	int ret = 0;
+
+	util_mutex_lock(&rm->lock);
+
+	struct range_map_snapshot *old = rm->snapshot;
+	size_t nranges = old ? old->nranges : 0;
+	size_t i = range_map_lower_bound(old, addr);
+
+	if (i < nranges && old->ranges[i].addr < end) {
+		ret = -EEXIST;
+		goto out;
+	}
+
+	struct range_map_snapshot *snap = Malloc(sizeof(*snap) +
+			(nranges + 1) * sizeof(struct range_map_entry));
+	if (snap == NULL) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	snap->nranges = nranges + 1;
+	if (i > 0)
+		memcpy(snap->ranges, old->ranges,
+			i * sizeof(struct range_map_entry));
+	snap->ranges[i].addr = addr;
+	snap->ranges[i].end = end;
+	snap->ranges[i].data = data;
+	if (i < nranges)
+		memcpy(&snap->ranges[i + 1], &old->ranges[i],
+			(nranges - i) * sizeof(struct range_map_entry));
+
+	range_map_publish(rm, snap);
+
+out:
+	util_mutex_unlock(&rm->lock);
+
+	return ret;
+}
+
+/*
+ * range_map_remove -- remove the (addr, addr+len) range, which has to be in
+ * the map exactly as it was inserted
+ *
+ * Does not fail for a range which is in the map, even when out of memory.
+ */
+int
+range_map_remove(struct range_map *rm, uintptr_t addr, size_t len)
+{
+	int ret = 0;
+
+	util_mutex_lock(&rm->lock);
+
+	struct range_map_snapshot *old = rm->snapshot;
+	size_t nranges = old ? old->nranges : 0;
+	size_t i = range_map_lower_bound(old, addr);
+
+	if (i == nranges || old->ranges[i].addr != addr ||
+			old->ranges[i].end != addr + len) {
+		ret = -ENOENT;
+		goto out;
+	}
+
+	struct range_map_snapshot *snap = NULL;
+	if (nranges > 1) {
+		snap = Malloc(sizeof(*snap) +
+			(nranges - 1) * sizeof(struct range_map_entry));
+		if (snap == NULL)
+			snap = range_map_take_spare(rm);
+		ASSERTne(snap, NULL);
+
+		snap->nranges = nranges - 1;
+		memcpy(snap->ranges, old->ranges,
+			i * sizeof(struct range_map_entry));
+		memcpy(&snap->ranges[i], &old->ranges[i + 1],
+			(nranges - i - 1) * sizeof(struct range_map_entry));
+	}
+
+	range_map_publish(rm, snap);
+
+out:
+	util_mutex_unlock(&rm->lock);
+
+	return ret;
+}
+
+/*
+ * range_map_find -- return the data of the earliest range overlapping with
+ * (addr, addr+len), or NULL if there is none
+ */
+void *
+range_map_find(struct range_map *rm, uintptr_t addr, size_t len)
+{
+	struct range_map_reader *r = range_map_reader_get(rm);
+	struct range_map_snapshot *snap;
+	void *data = NULL;
+	size_t i;
+
+	if (r == NULL) {
+		/* no reader slot, fall back to excluding the writers */
+		util_mutex_lock(&rm->lock);
+		snap = rm->snapshot;
+		i = range_map_snapshot_find(snap, addr, len);
+		if (snap && i < snap->nranges)
+			data = snap->ranges[i].data;
+		util_mutex_unlock(&rm->lock);
+
+		return data;
+	}
+
+	/*
+	 * Both loads are ordered with the stores of the writers, so the
+	 * announced epoch is never newer than the snapshot read below.
+	 */
+	uint64_t epoch;
+	util_atomic_load_explicit64(&rm->epoch, &epoch, memory_order_seq_cst);
+	util_atomic_store_explicit64(&r->epoch, epoch, memory_order_seq_cst);
+
+	uint64_t snapshot;
+	util_atomic_load_explicit64((uint64_t *)&rm->snapshot, &snapshot,
+		memory_order_seq_cst);
+	snap = (struct range_map_snapshot *)snapshot;
+
+	i = range_map_snapshot_find(snap, addr, len);
+	if (snap && i < snap->nranges)
+		data = snap->ranges[i].data;
+
+	util_atomic_store_explicit64(&r->epoch, 0, memory_order_release);
+
+	return data;
+}
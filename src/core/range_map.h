@@ -0,0 +1,32 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright 2020, Intel Corporation */
+
+/*
+ * range_map.h -- internal definitions for range_map, a read-mostly set of
+ *	non-overlapping address ranges with lock-free lookups
+ */
+
+#ifndef RANGE_MAP_H
+#define RANGE_MAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct range_map;
+
+struct range_map *range_map_new(void);
+void range_map_delete(struct range_map *rm);
+int range_map_insert(struct range_map *rm, uintptr_t addr, size_t len,
+		void *data);
+int range_map_remove(struct range_map *rm, uintptr_t addr, size_t len);
+void *range_map_find(struct range_map *rm, uintptr_t addr, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
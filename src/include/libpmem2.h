@@ -71,6 +71,12 @@ extern "C" {
 #define PMEM2_E_VM_RESERVATION_NOT_EMPTY	(-100033)
 #define PMEM2_E_MAP_EXISTS			(-100034)
 #define PMEM2_E_FILE_DESCRIPTOR_NOT_SET		(-100035)
+#define PMEM2_E_ASYNC_RANGE			(-100036)
+#define PMEM2_E_INVALID_CALIBRATION_VALUE	(-100037)
+#define PMEM2_E_INVALID_WRITEBACK_VALUE		(-100038)
+#define PMEM2_E_MEMORY_POISONED			(-100039)
+#define PMEM2_E_INVALID_NUMA_NODE		(-100040)
+#define PMEM2_E_INVALID_ASYNC_PERSIST_VALUE	(-100041)
 
 /* source setup */
 
@@ -105,6 +111,11 @@ int pmem2_vm_reservation_new(struct pmem2_vm_reservation **rsv_ptr,
 
 int pmem2_vm_reservation_delete(struct pmem2_vm_reservation **rsv_ptr);
 
+int pmem2_vm_reservation_extend(struct pmem2_vm_reservation *rsv, size_t size);
+
+int pmem2_vm_reservation_shrink(struct pmem2_vm_reservation *rsv,
+		size_t offset, size_t size);
+
 /* config setup */
 
 struct pmem2_config;
@@ -142,9 +153,41 @@ int pmem2_config_set_sharing(struct pmem2_config *cfg,
 int pmem2_config_set_protection(struct pmem2_config *cfg,
 				unsigned prot);
 
+#define PMEM2_VM_RESERVATION_OFFSET_ANY ((size_t)-1)
+
 int pmem2_config_set_vm_reservation(struct pmem2_config *cfg,
 		struct pmem2_vm_reservation *rsv, size_t offset);
 
+enum pmem2_calibration {
+	PMEM2_CALIBRATION_NONE,
+	PMEM2_CALIBRATION_CACHED,
+	PMEM2_CALIBRATION_FORCE,
+};
+
+int pmem2_config_set_calibration(struct pmem2_config *cfg,
+		enum pmem2_calibration calibration);
+
+enum pmem2_writeback {
+	PMEM2_WRITEBACK_IMMEDIATE,
+	PMEM2_WRITEBACK_DEFERRED,
+	PMEM2_WRITEBACK_BACKGROUND,
+};
+
+int pmem2_config_set_writeback(struct pmem2_config *cfg,
+		enum pmem2_writeback writeback);
+
+#define PMEM2_NUMA_NODE_ANY (-1)
+
+int pmem2_config_set_numa_node(struct pmem2_config *cfg, int numa_node);
+
+enum pmem2_async_persist {
+	PMEM2_ASYNC_PERSIST_MOVER,
+	PMEM2_ASYNC_PERSIST_OS,
+};
+
+int pmem2_config_set_async_persist(struct pmem2_config *cfg,
+		enum pmem2_async_persist async_persist);
+
 /* mapping */
 
 struct pmem2_map;
@@ -177,6 +220,35 @@ pmem2_flush_fn pmem2_get_flush_fn(struct pmem2_map *map);
 
 pmem2_drain_fn pmem2_get_drain_fn(struct pmem2_map *map);
 
+enum pmem2_store_flavor {
+	PMEM2_STORE_FLAVOR_GENERIC,
+	PMEM2_STORE_FLAVOR_NOFLUSH,
+	PMEM2_STORE_FLAVOR_CLFLUSH,
+	PMEM2_STORE_FLAVOR_CLFLUSHOPT,
+	PMEM2_STORE_FLAVOR_CLWB,
+};
+
+struct pmem2_store_ops {
+	enum pmem2_store_flavor flavor;
+	pmem2_persist_fn persist;
+	pmem2_flush_fn flush;
+	pmem2_drain_fn drain;
+};
+
+void pmem2_get_store_ops(struct pmem2_map *map, struct pmem2_store_ops *ops);
+
+struct pmem2_flush_batch;
+
+int pmem2_flush_batch_new(struct pmem2_flush_batch **batch,
+		struct pmem2_map *map);
+
+int pmem2_flush_batch_delete(struct pmem2_flush_batch **batch);
+
+void pmem2_flush_batch_add(struct pmem2_flush_batch *batch, const void *ptr,
+		size_t size);
+
+void pmem2_flush_batch_persist(struct pmem2_flush_batch *batch);
+
 #define PMEM2_F_MEM_NODRAIN	(1U << 0)
 
 #define PMEM2_F_MEM_NONTEMPORAL	(1U << 1)
@@ -209,10 +281,78 @@ pmem2_memcpy_fn pmem2_get_memcpy_fn(struct pmem2_map *map);
 
 pmem2_memset_fn pmem2_get_memset_fn(struct pmem2_map *map);
 
+struct pmem2_memcpy_desc {
+	void *pmemdest;
+	const void *src;
+	size_t len;
+};
+
+typedef void (*pmem2_memmovev_fn)(const struct pmem2_memcpy_desc *descs,
+		size_t ndescs, unsigned flags);
+
+typedef void (*pmem2_memcpyv_fn)(const struct pmem2_memcpy_desc *descs,
+		size_t ndescs, unsigned flags);
+
+pmem2_memmovev_fn pmem2_get_memmovev_fn(struct pmem2_map *map);
+
+pmem2_memcpyv_fn pmem2_get_memcpyv_fn(struct pmem2_map *map);
+
+int pmem2_map_calibrate(struct pmem2_map *map,
+		enum pmem2_calibration calibration);
+
+size_t pmem2_map_get_movnt_threshold(struct pmem2_map *map);
+
+/* asynchronous data movement */
+
+struct pmem2_mover;
+
+struct pmem2_future;
+
+int pmem2_mover_new(struct pmem2_mover **mover, unsigned nthreads);
+
+int pmem2_mover_delete(struct pmem2_mover **mover);
+
+int pmem2_memcpy_async(struct pmem2_mover *mover, struct pmem2_map *map,
+		void *pmemdest, const void *src, size_t len, unsigned flags,
+		struct pmem2_future **future);
+
+int pmem2_memset_async(struct pmem2_mover *mover, struct pmem2_map *map,
+		void *pmemdest, int c, size_t len, unsigned flags,
+		struct pmem2_future **future);
+
+int pmem2_memcpy_async_batch(struct pmem2_mover *mover, struct pmem2_map *map,
+		const struct pmem2_memcpy_desc *descs, size_t ndescs,
+		unsigned flags, struct pmem2_future **future);
+
+int pmem2_persist_async(struct pmem2_mover *mover, struct pmem2_map *map,
+		const void *ptr, size_t size, struct pmem2_future **future);
+
+int pmem2_future_poll(struct pmem2_future *future);
+
+int pmem2_future_wait(struct pmem2_future **future);
+
+int pmem2_memcpy_parallel(struct pmem2_map *map, void *pmemdest,
+		const void *src, size_t len, unsigned flags);
+
+int pmem2_memset_parallel(struct pmem2_map *map, void *pmemdest, int c,
+		size_t len, unsigned flags);
+
 /* RAS */
 
 int pmem2_deep_flush(struct pmem2_map *map, void *ptr, size_t size);
 
+struct pmem2_deep_flush_desc {
+	struct pmem2_map *map;
+	void *ptr;
+	size_t size;
+};
+
+int pmem2_deep_flush_batch(const struct pmem2_deep_flush_desc *descs,
+		size_t ndescs);
+
+int pmem2_memcpy_mcsafe(struct pmem2_map *map, void *dest, const void *src,
+		size_t len, size_t *poisoned_off);
+
 #ifndef _WIN32
 int pmem2_source_device_id(const struct pmem2_source *src,
 	char *id, size_t *len);
@@ -226,6 +366,8 @@ int pmem2_source_device_idU(const struct pmem2_source *src,
 
 int pmem2_source_device_usc(const struct pmem2_source *src, uint64_t *usc);
 
+int pmem2_source_numa_node(const struct pmem2_source *src, int *numa_node);
+
 struct pmem2_badblock_context;
 
 struct pmem2_badblock {
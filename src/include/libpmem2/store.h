@@ -0,0 +1,240 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright 2020, Intel Corporation */
+
+/*
+ * libpmem2/store.h -- inline persist primitives for small fixed-size stores
+ *
+ * The functions below store and persist an 8-byte word, a 16-byte pair or
+ * a whole 64-byte cache line without calling through the function pointers
+ * of the mapping. The flavor returned by pmem2_get_store_ops(3) selects
+ * the flush instruction, so each of them compiles down to the store,
+ * a flush and a fence. The *_<flavor>() variants can be called directly
+ * once the flavor is known, which leaves no branches at all.
+ *
+ * See pmem2_get_store_ops(3) for details.
+ */
+
+#ifndef LIBPMEM2_STORE_H
+#define LIBPMEM2_STORE_H 1
+
+#include <stdint.h>
+#include <string.h>
+
+#include <libpmem2.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define _PMEM2_STORE_X86_64 1
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <immintrin.h>
+#endif
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PMEM2_STORE_LINE_SIZE 64
+
+#ifdef _PMEM2_STORE_X86_64
+
+#ifdef _MSC_VER
+#define _pmem2_clflushopt(addr) _mm_clflushopt((void *)(addr))
+#define _pmem2_clwb(addr) _mm_clwb((void *)(addr))
+#else
+/*
+ * The instructions are encoded by hand, so that the header does not need
+ * -mclflushopt or -mclwb, like the flush functions of the library.
+ */
+#define _pmem2_clflushopt(addr)\
+	__asm__ __volatile__(".byte 0x66; clflush %0" :\
+		"+m" (*(volatile char *)(addr)))
+#define _pmem2_clwb(addr)\
+	__asm__ __volatile__(".byte 0x66; xsaveopt %0" :\
+		"+m" (*(volatile char *)(addr)))
+#endif
+
+#define _pmem2_clflush(addr) _mm_clflush((const void *)(addr))
+#define _pmem2_noflush(addr) ((void)(addr))
+
+/*
+ * _PMEM2_STORE_FLAVOR -- (internal) define the primitives of the flavor,
+ * the destinations have to be aligned to their size, so that a single
+ * line has to be flushed
+ */
+#define _PMEM2_STORE_FLAVOR(flavor, flush_line)\
+static inline void \
+pmem2_store_drain_##flavor(void)\
+{\
+	_mm_sfence();\
+}\
+static inline void \
+pmem2_store64_flush_##flavor(uint64_t *dst, uint64_t val)\
+{\
+	*(volatile uint64_t *)dst = val;\
+	flush_line(dst);\
+}\
+static inline void \
+pmem2_store64_persist_##flavor(uint64_t *dst, uint64_t val)\
+{\
+	*(volatile uint64_t *)dst = val;\
+	flush_line(dst);\
+	_mm_sfence();\
+}\
+static inline void \
+pmem2_store128_persist_##flavor(void *dst, const void *src)\
+{\
+	_mm_store_si128((__m128i *)dst,\
+		_mm_loadu_si128((const __m128i *)src));\
+	flush_line(dst);\
+	_mm_sfence();\
+}\
+static inline void \
+pmem2_store_line_persist_##flavor(void *dst, const void *src)\
+{\
+	memcpy(dst, src, PMEM2_STORE_LINE_SIZE);\
+	flush_line(dst);\
+	_mm_sfence();\
+}
+
+_PMEM2_STORE_FLAVOR(noflush, _pmem2_noflush)
+_PMEM2_STORE_FLAVOR(clflush, _pmem2_clflush)
+_PMEM2_STORE_FLAVOR(clflushopt, _pmem2_clflushopt)
+_PMEM2_STORE_FLAVOR(clwb, _pmem2_clwb)
+
+/*
+ * _pmem2_store_line_nt -- (internal) store the line bypassing the caches
+ * and wait for the stores to complete, no flush is needed in any flavor
+ */
+static inline void
+_pmem2_store_line_nt(void *dst, const void *src)
+{
+	const __m128i *s = (const __m128i *)src;
+	__m128i *d = (__m128i *)dst;
+
+	__m128i x0 = _mm_loadu_si128(s + 0);
+	__m128i x1 = _mm_loadu_si128(s + 1);
+	__m128i x2 = _mm_loadu_si128(s + 2);
+	__m128i x3 = _mm_loadu_si128(s + 3);
+
+	_mm_stream_si128(d + 0, x0);
+	_mm_stream_si128(d + 1, x1);
+	_mm_stream_si128(d + 2, x2);
+	_mm_stream_si128(d + 3, x3);
+	_mm_sfence();
+}
+
+#define _PMEM2_STORE_DISPATCH(ops, func, args)\
+	switch ((ops)->flavor) {\
+		case PMEM2_STORE_FLAVOR_CLWB:\
+			func##_clwb args;\
+			return;\
+		case PMEM2_STORE_FLAVOR_CLFLUSHOPT:\
+			func##_clflushopt args;\
+			return;\
+		case PMEM2_STORE_FLAVOR_CLFLUSH:\
+			func##_clflush args;\
+			return;\
+		case PMEM2_STORE_FLAVOR_NOFLUSH:\
+			func##_noflush args;\
+			return;\
+		default:\
+			break;\
+	}
+
+#else
+
+#define _PMEM2_STORE_DISPATCH(ops, func, args)
+
+#endif /* _PMEM2_STORE_X86_64 */
+
+/*
+ * pmem2_store_drain -- wait for the flushes of the *_flush() primitives
+ */
+static inline void
+pmem2_store_drain(const struct pmem2_store_ops *ops)
+{
+	_PMEM2_STORE_DISPATCH(ops, pmem2_store_drain, ())
+
+	ops->drain();
+}
+
+/*
+ * pmem2_store64_flush -- store the 8-byte aligned word and flush it,
+ * without waiting for the flush
+ */
+static inline void
+pmem2_store64_flush(const struct pmem2_store_ops *ops, uint64_t *dst,
+		uint64_t val)
+{
+	_PMEM2_STORE_DISPATCH(ops, pmem2_store64_flush, (dst, val))
+
+	*(volatile uint64_t *)dst = val;
+	ops->flush(dst, sizeof(*dst));
+}
+
+/*
+ * pmem2_store64_persist -- store the 8-byte aligned word and persist it
+ */
+static inline void
+pmem2_store64_persist(const struct pmem2_store_ops *ops, uint64_t *dst,
+		uint64_t val)
+{
+	_PMEM2_STORE_DISPATCH(ops, pmem2_store64_persist, (dst, val))
+
+	*(volatile uint64_t *)dst = val;
+	ops->persist(dst, sizeof(*dst));
+}
+
+/*
+ * pmem2_store128_persist -- copy 16 bytes to the 16-byte aligned
+ * destination and persist them
+ */
+static inline void
+pmem2_store128_persist(const struct pmem2_store_ops *ops, void *dst,
+		const void *src)
+{
+	_PMEM2_STORE_DISPATCH(ops, pmem2_store128_persist, (dst, src))
+
+	memcpy(dst, src, 16);
+	ops->persist(dst, 16);
+}
+
+/*
+ * pmem2_store_line_persist -- copy a cache line to the 64-byte aligned
+ * destination through the caches and persist it
+ */
+static inline void
+pmem2_store_line_persist(const struct pmem2_store_ops *ops, void *dst,
+		const void *src)
+{
+	_PMEM2_STORE_DISPATCH(ops, pmem2_store_line_persist, (dst, src))
+
+	memcpy(dst, src, PMEM2_STORE_LINE_SIZE);
+	ops->persist(dst, PMEM2_STORE_LINE_SIZE);
+}
+
+/*
+ * pmem2_store_line_nt -- copy a cache line to the 64-byte aligned
+ * destination with non-temporal stores and persist it
+ */
+static inline void
+pmem2_store_line_nt(const struct pmem2_store_ops *ops, void *dst,
+		const void *src)
+{
+#ifdef _PMEM2_STORE_X86_64
+	if (ops->flavor != PMEM2_STORE_FLAVOR_GENERIC) {
+		_pmem2_store_line_nt(dst, src);
+		return;
+	}
+#endif
+
+	memcpy(dst, src, PMEM2_STORE_LINE_SIZE);
+	ops->persist(dst, PMEM2_STORE_LINE_SIZE);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* libpmem2/store.h */
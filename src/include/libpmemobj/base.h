@@ -142,6 +142,19 @@ void *pmemobj_direct(PMEMoid oid);
 #define pmemobj_direct pmemobj_direct_inline
 #endif
 
+/*
+ * pmemobj_direct_batch flags
+ */
+#define POBJ_DIRECT_PREFETCH		(1U << 0)
+
+#define POBJ_DIRECT_VALID_FLAGS		(POBJ_DIRECT_PREFETCH)
+
+/*
+ * Returns the direct pointers of an array of objects.
+ */
+int pmemobj_direct_batch(const PMEMoid *oids, void **ptrs, size_t noids,
+	unsigned flags);
+
 struct pmemvlt {
 	uint64_t runid;
 };
@@ -144,6 +144,34 @@ enum pobj_stats_enabled {
 	POBJ_STATS_DISABLED,
 };
 
+/*
+ * Statistics of a single transaction, collected when "stats.tx.enabled" is set
+ */
+struct pobj_tx_stats {
+	uint64_t ranges; /* number of ranges added to the transaction */
+	uint64_t snapshot_bytes; /* number of bytes snapshotted in undo log */
+	uint64_t redo_entries; /* number of entries stored in redo log */
+	uint64_t ulog_extensions; /* number of times a log was extended */
+	uint64_t flushes; /* number of flush calls */
+	uint64_t drains; /* number of drain calls */
+	uint64_t work_ns; /* time spent in TX_STAGE_WORK */
+	uint64_t oncommit_ns; /* time spent in TX_STAGE_ONCOMMIT */
+	uint64_t onabort_ns; /* time spent in TX_STAGE_ONABORT */
+	uint64_t finally_ns; /* time spent in TX_STAGE_FINALLY */
+};
+
+typedef void (*pmemobj_tx_stats_callback)(PMEMobjpool *pop,
+	const struct pobj_tx_stats *stats, void *arg);
+
+/*
+ * Callback invoked at the end of every outermost transaction, once it
+ * reaches TX_STAGE_NONE
+ */
+struct pobj_tx_stats_callback_desc {
+	pmemobj_tx_stats_callback cb;
+	void *arg;
+};
+
 #ifndef _WIN32
 /* EXPERIMENTAL */
 int pmemobj_ctl_get(PMEMobjpool *pop, const char *name, void *arg);
@@ -32,6 +32,26 @@ PMEMoid pmemobj_first(PMEMobjpool *pop);
  */
 PMEMoid pmemobj_next(PMEMoid oid);
 
+/*
+ * pmemobj_foreach_part flags
+ */
+#define POBJ_FOREACH_TYPE_NUM	(((uint64_t)1) << 0)
+
+#define POBJ_FOREACH_VALID_FLAGS	(POBJ_FOREACH_TYPE_NUM)
+
+/*
+ * Callback of pmemobj_foreach_part, terminates iteration if the return value
+ * is non-zero.
+ */
+typedef int (*pmemobj_foreach_cb)(PMEMoid oid, void *arg);
+
+/*
+ * Calls cb for every object in the given part of the pool split into
+ * nparts partitions, which can be iterated concurrently.
+ */
+int pmemobj_foreach_part(PMEMobjpool *pop, unsigned part, unsigned nparts,
+	uint64_t type_num, uint64_t flags, pmemobj_foreach_cb cb, void *arg);
+
 #ifdef __cplusplus
 }
 #endif
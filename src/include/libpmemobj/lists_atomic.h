@@ -113,6 +113,20 @@ pmemobj_list_insert_new((pop),\
 	(head), (listelm).oid, 1 /* before */, (size),\
 	TOID_TYPE_NUM_OF((head)->pe_first), (constr), (arg))
 
+#define POBJ_LIST_INSERT_TAIL_BATCH(pop, head, oids, noids, field)\
+pmemobj_list_insert_batch((pop),\
+	TOID_OFFSETOF(POBJ_LIST_FIRST(head), field),\
+	(head), OID_NULL,\
+	POBJ_LIST_DEST_TAIL, (oids), (noids))
+
+#define POBJ_LIST_INSERT_NEW_TAIL_BATCH(pop, head, field, size, constr, arg,\
+	oids, noids)\
+pmemobj_list_insert_new_batch((pop),\
+	TOID_OFFSETOF((head)->pe_first, field),\
+	(head), OID_NULL, POBJ_LIST_DEST_TAIL, (size),\
+	TOID_TYPE_NUM_OF((head)->pe_first), (constr), (arg),\
+	(oids), (noids))
+
 #define POBJ_LIST_REMOVE(pop, head, elm, field)\
 pmemobj_list_remove((pop),\
 	TOID_OFFSETOF(POBJ_LIST_FIRST(head), field),\
@@ -123,6 +137,16 @@ pmemobj_list_remove((pop),\
 	TOID_OFFSETOF(POBJ_LIST_FIRST(head), field),\
 	(head), (elm).oid, 1 /* free */)
 
+#define POBJ_LIST_REMOVE_BATCH(pop, head, oids, noids, field)\
+pmemobj_list_remove_batch((pop),\
+	TOID_OFFSETOF(POBJ_LIST_FIRST(head), field),\
+	(head), (oids), (noids), 0 /* no free */)
+
+#define POBJ_LIST_REMOVE_FREE_BATCH(pop, head, oids, noids, field)\
+pmemobj_list_remove_batch((pop),\
+	TOID_OFFSETOF(POBJ_LIST_FIRST(head), field),\
+	(head), (oids), (noids), 1 /* free */)
+
 #define POBJ_LIST_MOVE_ELEMENT_HEAD(pop, head, head_new, elm, field, field_new)\
 pmemobj_list_move((pop),\
 	TOID_OFFSETOF(POBJ_LIST_FIRST(head), field),\
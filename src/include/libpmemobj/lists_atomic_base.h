@@ -28,6 +28,16 @@ PMEMoid pmemobj_list_insert_new(PMEMobjpool *pop, size_t pe_offset, void *head,
 int pmemobj_list_remove(PMEMobjpool *pop, size_t pe_offset, void *head,
 	PMEMoid oid, int free);
 
+int pmemobj_list_insert_batch(PMEMobjpool *pop, size_t pe_offset, void *head,
+	PMEMoid dest, int before, const PMEMoid *oids, size_t noids);
+
+int pmemobj_list_insert_new_batch(PMEMobjpool *pop, size_t pe_offset,
+	void *head, PMEMoid dest, int before, size_t size, uint64_t type_num,
+	pmemobj_constr constructor, void *arg, PMEMoid *oids, size_t noids);
+
+int pmemobj_list_remove_batch(PMEMobjpool *pop, size_t pe_offset, void *head,
+	const PMEMoid *oids, size_t noids, int free);
+
 int pmemobj_list_move(PMEMobjpool *pop, size_t pe_old_offset,
 	void *head_old, size_t pe_new_offset, void *head_new,
 	PMEMoid dest, int before, PMEMoid oid);
@@ -65,6 +65,12 @@ int pmemobj_checkW(const wchar_t *path, const wchar_t *layout);
 #endif
 
 void pmemobj_close(PMEMobjpool *pop);
+
+/*
+ * Waits until all writes completed before the call are copied to the replicas
+ * updated in the lazy mode.
+ */
+int pmemobj_replica_sync(PMEMobjpool *pop);
 /*
  * If called for the first time on a newly created pool, the root object
  * of given size is allocated.  Otherwise, it returns the existing root object.
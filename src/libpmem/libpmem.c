@@ -10,6 +10,7 @@
 
 #include "libpmem.h"
 
+#include "deep_flush.h"
 #include "pmem.h"
 #include "pmemcommon.h"
 
@@ -39,6 +40,9 @@ libpmem_fini(void)
 {
 	LOG(3, NULL);
 
+#ifndef _WIN32
+	pmem2_deep_flush_fini();
+#endif
 	common_fini();
 }
 
@@ -0,0 +1,479 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2020, Intel Corporation */
+
+/*
+ * calibrate.c -- calibration of the memcpy and memset functions
+ *
+ * The length from which the non-temporal stores are faster than the regular
+ * ones and the fastest family of kernels (SSE2, AVX, AVX512F) depend on
+ * the CPU and the memory. They are measured by rewriting the beginning of
+ * the mapping with its own content, copied from a DRAM buffer at the same
+ * offsets, so the content of the mapping does not change and the stores go
+ * to the medium the mapping lives on. pmem2_map_new() calibrates before
+ * the mapping is returned, when no other thread can store to it.
+ *
+ * The memcpy functions take no mapping, so the result applies to the whole
+ * process. They are switched only once per process, by the first successful
+ * calibration, and a copy running in another thread at that moment uses
+ * either the previous or the new functions, both of which are correct.
+ * The result is saved in a small file per CPU model and device of the mapping
+ * and reused by PMEM2_CALIBRATION_CACHED.
+ */
+
+#include <ctype.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#if !defined(_WIN32) && !defined(__FreeBSD__)
+#include <sys/sysmacros.h>
+#endif
+
+#include "alloc.h"
+#include "calibrate.h"
+#include "libpmem2.h"
+#include "map.h"
+#include "os.h"
+#include "os_thread.h"
+#include "out.h"
+#include "persist.h"
+#include "pmem2_arch.h"
+#include "pmem2_utils.h"
+#include "sys_util.h"
+#include "util.h"
+
+/* the maximum length of the rewritten part of the mapping */
+#define CALIBRATE_REGION_SIZE (4ULL << 20) /* 4 MiB */
+
+/* the range of the tested lengths */
+#define CALIBRATE_MIN_SIZE 256
+#define CALIBRATE_MAX_SIZE (64ULL << 10) /* 64 KiB */
+
+/* the best of that many measurements counts */
+#define CALIBRATE_ROUNDS 3
+
+/* the kernel chosen by CPUID is replaced only by a faster one by 1/20 */
+#define CALIBRATE_KERNEL_MARGIN 20
+
+#define CALIBRATE_NAME_MAX 64
+#define CALIBRATE_VERSION 1
+#define CALIBRATE_FILE_PREFIX "pmem2_calibration_"
+
+static os_mutex_t Calibrate_lock;
+
+/* the functions of this process have been switched */
+static int Calibrated;
+
+/*
+ * calibrate_now -- (internal) return the monotonic time in nanoseconds
+ */
+static uint64_t
+calibrate_now(void)
+{
+	struct timespec ts;
+	os_clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * calibrate_time -- (internal) measure the time of copying the region in
+ * pieces of the given size with the given flags
+ */
+static uint64_t
+calibrate_time(const struct pmem2_arch_info *info, char *dest,
+		const char *src, size_t region, size_t size, unsigned flags)
+{
+	uint64_t best = UINT64_MAX;
+
+	for (int r = 0; r < CALIBRATE_ROUNDS; ++r) {
+		uint64_t start = calibrate_now();
+
+		for (size_t off = 0; off + size <= region; off += size) {
+			info->memmove_nodrain(dest + off, src + off, size,
+					flags, info->flush);
+			info->fence();
+		}
+
+		best = MIN(best, calibrate_now() - start);
+	}
+
+	return best;
+}
+
+/*
+ * calibrate_install -- (internal) switch all the mappings to the kernel of
+ * the given name and the given threshold of the non-temporal stores, called
+ * at most once per process
+ */
+static int
+calibrate_install(const char *kernel, size_t threshold)
+{
+	struct pmem2_arch_info *info = pmem2_persist_get_arch_info();
+
+	for (unsigned k = 0; k < info->nkernels; ++k) {
+		struct pmem2_arch_info ki = *info;
+		if (strcmp(info->use_kernel(&ki, k), kernel) != 0)
+			continue;
+
+		info->memmove_nodrain = ki.memmove_nodrain;
+		info->memmove_nodrain_eadr = ki.memmove_nodrain_eadr;
+		info->memset_nodrain = ki.memset_nodrain;
+		info->memset_nodrain_eadr = ki.memset_nodrain_eadr;
+
+		if (!info->movnt_threshold_fixed)
+			*info->movnt_threshold = threshold;
+
+		LOG(3, "using %s kernels, movnt threshold %zu", kernel,
+			*info->movnt_threshold);
+
+		return 0;
+	}
+
+	LOG(2, "kernel %s is not available", kernel);
+
+	return -1;
+}
+
+/*
+ * calibrate_run -- (internal) find the fastest kernel and the threshold of
+ * the non-temporal stores on the memory of the mapping
+ */
+static int
+calibrate_run(struct pmem2_map *map, const char **kernel, size_t *threshold)
+{
+	const struct pmem2_arch_info *info = pmem2_persist_get_arch_info();
+
+	size_t region = MIN(map->content_length, CALIBRATE_REGION_SIZE);
+	size_t max_size = CALIBRATE_MAX_SIZE;
+
+	if (region < max_size) {
+		ERR("mapping of %zu bytes is too small to be calibrated",
+			map->content_length);
+		return PMEM2_E_NOSUPP;
+	}
+
+	int ret;
+	char *src = pmem2_malloc(region, &ret);
+	if (ret)
+		return ret;
+
+	/* every copy stores to the mapping what it already contains */
+	char *dest = map->addr;
+	memcpy(src, dest, region);
+
+	/* the page faults are not to be measured */
+	info->memmove_nodrain(dest, src, region, 0, info->flush);
+	info->fence();
+
+	struct pmem2_arch_info best = *info;
+	const char *best_name = NULL;
+	uint64_t best_time = 0;
+
+	/* the last kernel is the one chosen by CPUID */
+	for (unsigned k = info->nkernels; k > 0; --k) {
+		struct pmem2_arch_info ki = *info;
+		const char *name = info->use_kernel(&ki, k - 1);
+
+		uint64_t t = calibrate_time(&ki, dest, src, region, max_size,
+				PMEM2_F_MEM_NONTEMPORAL);
+		LOG(3, "%s kernels: %" PRIu64 " ns", name, t);
+
+		if (best_name == NULL ||
+				t < best_time - best_time /
+				CALIBRATE_KERNEL_MARGIN) {
+			best = ki;
+			best_name = name;
+			best_time = t;
+		}
+	}
+
+	*kernel = best_name;
+
+	if (info->movnt_threshold_fixed) {
+		*threshold = *info->movnt_threshold;
+		goto out;
+	}
+
+	/* the smallest length from which the non-temporal stores win */
+	*threshold = max_size * 2;
+	for (size_t size = max_size; size >= CALIBRATE_MIN_SIZE; size /= 2) {
+		uint64_t t_mov = calibrate_time(&best, dest, src, region, size,
+				PMEM2_F_MEM_TEMPORAL);
+		uint64_t t_movnt = calibrate_time(&best, dest, src, region,
+				size, PMEM2_F_MEM_NONTEMPORAL);
+		LOG(3, "size %zu: mov %" PRIu64 " ns, movnt %" PRIu64 " ns",
+			size, t_mov, t_movnt);
+
+		if (t_movnt > t_mov)
+			break;
+
+		*threshold = size;
+	}
+
+out:
+	Free(src);
+
+	return ret;
+}
+
+/*
+ * calibrate_medium -- (internal) return the name of the device the mapping
+ * lives on
+ */
+static int
+calibrate_medium(const struct pmem2_map *map, char *name, size_t size)
+{
+	const struct pmem2_source *src = &map->source;
+
+	if (src->type == PMEM2_SOURCE_ANON)
+		return util_snprintf(name, size, "anon") < 0 ? -1 : 0;
+
+#ifdef _WIN32
+	BY_HANDLE_FILE_INFORMATION fi;
+	if (!GetFileInformationByHandle(src->value.handle, &fi))
+		return -1;
+
+	return util_snprintf(name, size, "vol%08lx",
+		fi.dwVolumeSerialNumber) < 0 ? -1 : 0;
+#else
+	/* a file lives on the device of its file system */
+	dev_t dev = src->value.ftype == PMEM2_FTYPE_DEVDAX ?
+		src->value.st_rdev : src->value.st_dev;
+
+	return util_snprintf(name, size, "dev%u-%u", os_major(dev),
+		os_minor(dev)) < 0 ? -1 : 0;
+#endif
+}
+
+/*
+ * calibrate_cache_path -- (internal) return the path of the cached result
+ * for this CPU model and the device of the mapping
+ */
+static int
+calibrate_cache_path(const struct pmem2_map *map, char *path, size_t size)
+{
+	const struct pmem2_arch_info *info = pmem2_persist_get_arch_info();
+
+	char model[CALIBRATE_NAME_MAX] = "generic";
+	if (info->cpu_model)
+		info->cpu_model(model, sizeof(model));
+
+	for (char *c = model; *c; ++c) {
+		if (!isalnum((unsigned char)*c) && *c != '-')
+			*c = '_';
+	}
+
+	char medium[CALIBRATE_NAME_MAX];
+	if (calibrate_medium(map, medium, sizeof(medium)))
+		return -1;
+
+	const char *dir = os_getenv("PMEM2_CALIBRATION_DIR");
+	const char *sub = "";
+#ifdef _WIN32
+	if (dir == NULL)
+		dir = os_getenv("LOCALAPPDATA");
+#else
+	if (dir == NULL)
+		dir = os_getenv("XDG_CACHE_HOME");
+	if (dir == NULL) {
+		dir = os_getenv("HOME");
+		sub = "/.cache";
+	}
+#endif
+	if (dir == NULL)
+		return -1;
+
+	if (util_snprintf(path, size, "%s%s/" CALIBRATE_FILE_PREFIX "%s_%s",
+			dir, sub, model, medium) < 0)
+		return -1;
+
+	return 0;
+}
+
+/*
+ * calibrate_cache_read -- (internal) read the cached result
+ */
+static int
+calibrate_cache_read(const char *path, char *kernel, size_t *threshold)
+{
+	FILE *f = os_fopen(path, "r");
+	if (f == NULL)
+		return -1;
+
+	char line[CALIBRATE_NAME_MAX * 2];
+	int version = 0;
+	int has_threshold = 0;
+	kernel[0] = '\0';
+
+	while (fgets(line, sizeof(line), f) != NULL) {
+		unsigned long long val;
+
+		if (sscanf(line, "version %d", &version) == 1)
+			continue;
+
+		if (sscanf(line, "kernel %63s", kernel) == 1)
+			continue;
+
+		if (sscanf(line, "movnt_threshold %llu", &val) == 1) {
+			*threshold = (size_t)val;
+			has_threshold = 1;
+		}
+	}
+
+	os_fclose(f);
+
+	if (version != CALIBRATE_VERSION || kernel[0] == '\0' ||
+			!has_threshold) {
+		LOG(2, "invalid calibration cache %s", path);
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * calibrate_cache_write -- (internal) save the result
+ */
+static void
+calibrate_cache_write(const char *path, const char *kernel, size_t threshold)
+{
+	FILE *f = os_fopen(path, "w");
+	if (f == NULL) {
+		LOG(2, "cannot create calibration cache %s", path);
+		return;
+	}
+
+	fprintf(f, "version %d\nkernel %s\nmovnt_threshold %zu\n",
+		CALIBRATE_VERSION, kernel, threshold);
+
+	if (os_fclose(f))
+		LOG(2, "cannot write calibration cache %s", path);
+}
+
+/*
+ * pmem2_calibrate -- calibrate the memcpy and memset functions used by
+ * the mapping and all the other mappings of the process
+ */
+int
+pmem2_calibrate(struct pmem2_map *map, enum pmem2_calibration calibration)
+{
+	if (calibration == PMEM2_CALIBRATION_NONE)
+		return 0;
+
+	if (calibration != PMEM2_CALIBRATION_CACHED &&
+			calibration != PMEM2_CALIBRATION_FORCE) {
+		ERR("unknown calibration value %d", calibration);
+		return PMEM2_E_INVALID_CALIBRATION_VALUE;
+	}
+
+	if (map->effective_granularity == PMEM2_GRANULARITY_PAGE) {
+		ERR("mapping with the page granularity cannot be calibrated");
+		return PMEM2_E_NOSUPP;
+	}
+
+	if (!(map->protection_flag & PMEM2_PROT_WRITE)) {
+		ERR("read-only mapping cannot be calibrated");
+		return PMEM2_E_NOSUPP;
+	}
+
+	const struct pmem2_arch_info *info = pmem2_persist_get_arch_info();
+	if (info->nkernels == 0) {
+		ERR("no memcpy kernels to calibrate");
+		return PMEM2_E_NOSUPP;
+	}
+
+	char path[PATH_MAX];
+	int has_path = calibrate_cache_path(map, path, sizeof(path)) == 0;
+
+	char cached[CALIBRATE_NAME_MAX];
+	const char *kernel = NULL;
+	size_t threshold = 0;
+	int ret = 0;
+
+	util_mutex_lock(&Calibrate_lock);
+
+	if (calibration == PMEM2_CALIBRATION_CACHED) {
+		if (Calibrated)
+			goto out;
+
+		if (has_path && calibrate_cache_read(path, cached,
+				&threshold) == 0 &&
+				calibrate_install(cached, threshold) == 0) {
+			Calibrated = 1;
+			goto out;
+		}
+	}
+
+	ret = calibrate_run(map, &kernel, &threshold);
+	if (ret)
+		goto out;
+
+	/* a forced calibration after the switch only refreshes the cache */
+	if (!Calibrated) {
+		if (calibrate_install(kernel, threshold))
+			FATAL("the measured kernel %s is not available",
+				kernel);
+
+		Calibrated = 1;
+	}
+
+	if (has_path)
+		calibrate_cache_write(path, kernel, threshold);
+
+out:
+	util_mutex_unlock(&Calibrate_lock);
+
+	return ret;
+}
+
+/*
+ * pmem2_map_calibrate -- calibrate the memcpy and memset functions used by
+ * the mapping
+ */
+int
+pmem2_map_calibrate(struct pmem2_map *map, enum pmem2_calibration calibration)
+{
+	LOG(3, "map %p calibration %d", map, calibration);
+	PMEM2_ERR_CLR();
+
+	return pmem2_calibrate(map, calibration);
+}
+
+/*
+ * pmem2_map_get_movnt_threshold -- return the length from which the memcpy
+ * and memset functions of the mapping use the non-temporal stores
+ */
+size_t
+pmem2_map_get_movnt_threshold(struct pmem2_map *map)
+{
+	LOG(3, "map %p", map);
+	/* we do not need to clear err because this function cannot fail */
+
+	const struct pmem2_arch_info *info = pmem2_persist_get_arch_info();
+
+	/* the eADR functions use the non-temporal stores only on request */
+	if (map->effective_granularity == PMEM2_GRANULARITY_BYTE ||
+			info->nkernels == 0)
+		return SIZE_MAX;
+
+	return *info->movnt_threshold;
+}
+
+/*
+ * pmem2_calibrate_init -- initialize calibrate module
+ */
+void
+pmem2_calibrate_init(void)
+{
+	util_mutex_init(&Calibrate_lock);
+}
+
+/*
+ * pmem2_calibrate_fini -- cleanup calibrate module
+ */
+void
+pmem2_calibrate_fini(void)
+{
+	util_mutex_destroy(&Calibrate_lock);
+}
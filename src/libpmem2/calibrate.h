@@ -0,0 +1,25 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright 2020, Intel Corporation */
+
+/*
+ * calibrate.h -- internal definitions for libpmem2 calibrate module
+ */
+#ifndef PMEM2_CALIBRATE_H
+#define PMEM2_CALIBRATE_H
+
+#include "libpmem2.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void pmem2_calibrate_init(void);
+void pmem2_calibrate_fini(void);
+
+int pmem2_calibrate(struct pmem2_map *map, enum pmem2_calibration calibration);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
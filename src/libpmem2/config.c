@@ -9,6 +9,7 @@
 #include "alloc.h"
 #include "config.h"
 #include "libpmem2.h"
+#include "os_thread.h"
 #include "out.h"
 #include "pmem2.h"
 #include "pmem2_utils.h"
@@ -26,6 +27,10 @@ pmem2_config_init(struct pmem2_config *cfg)
 	cfg->protection_flag = PMEM2_PROT_READ | PMEM2_PROT_WRITE;
 	cfg->reserv = NULL;
 	cfg->reserv_offset = 0;
+	cfg->calibration = PMEM2_CALIBRATION_NONE;
+	cfg->writeback = PMEM2_WRITEBACK_IMMEDIATE;
+	cfg->numa_node = PMEM2_NUMA_NODE_ANY;
+	cfg->async_persist = PMEM2_ASYNC_PERSIST_MOVER;
 }
 
 /*
@@ -216,3 +221,95 @@ pmem2_config_set_protection(struct pmem2_config *cfg,
 	cfg->protection_flag = prot;
 	return 0;
 }
+
+/*
+ * pmem2_config_set_calibration -- set whether pmem2_map_new will calibrate
+ * the memcpy functions
+ */
+int
+pmem2_config_set_calibration(struct pmem2_config *cfg,
+		enum pmem2_calibration calibration)
+{
+	PMEM2_ERR_CLR();
+
+	switch (calibration) {
+		case PMEM2_CALIBRATION_NONE:
+		case PMEM2_CALIBRATION_CACHED:
+		case PMEM2_CALIBRATION_FORCE:
+			cfg->calibration = calibration;
+			break;
+		default:
+			ERR("unknown calibration value %d", calibration);
+			return PMEM2_E_INVALID_CALIBRATION_VALUE;
+	}
+
+	return 0;
+}
+
+/*
+ * pmem2_config_set_writeback -- set when the data flushed to a page
+ * granularity mapping is written back
+ */
+int
+pmem2_config_set_writeback(struct pmem2_config *cfg,
+		enum pmem2_writeback writeback)
+{
+	PMEM2_ERR_CLR();
+
+	switch (writeback) {
+		case PMEM2_WRITEBACK_IMMEDIATE:
+		case PMEM2_WRITEBACK_DEFERRED:
+		case PMEM2_WRITEBACK_BACKGROUND:
+			cfg->writeback = writeback;
+			break;
+		default:
+			ERR("unknown writeback value %d", writeback);
+			return PMEM2_E_INVALID_WRITEBACK_VALUE;
+	}
+
+	return 0;
+}
+
+/*
+ * pmem2_config_set_async_persist -- set who does the asynchronous persists
+ * of a page granularity mapping
+ */
+int
+pmem2_config_set_async_persist(struct pmem2_config *cfg,
+		enum pmem2_async_persist async_persist)
+{
+	PMEM2_ERR_CLR();
+
+	switch (async_persist) {
+		case PMEM2_ASYNC_PERSIST_MOVER:
+		case PMEM2_ASYNC_PERSIST_OS:
+			cfg->async_persist = async_persist;
+			break;
+		default:
+			ERR("unknown async persist value %d", async_persist);
+			return PMEM2_E_INVALID_ASYNC_PERSIST_VALUE;
+	}
+
+	return 0;
+}
+
+/*
+ * pmem2_config_set_numa_node -- set the NUMA node the mapping should be local
+ * to
+ */
+int
+pmem2_config_set_numa_node(struct pmem2_config *cfg, int numa_node)
+{
+	PMEM2_ERR_CLR();
+
+	if (numa_node != PMEM2_NUMA_NODE_ANY &&
+			(numa_node < 0 ||
+			!os_numa_node_online((unsigned)numa_node))) {
+		ERR("invalid NUMA node %d", numa_node);
+		return PMEM2_E_INVALID_NUMA_NODE;
+	}
+
+	cfg->numa_node = numa_node;
+
+	return 0;
+}
@@ -24,6 +24,14 @@ struct pmem2_config {
 	unsigned protection_flag;
 	struct pmem2_vm_reservation *reserv;
 	size_t reserv_offset;
+	/* calibration of the memcpy functions done by pmem2_map_new */
+	enum pmem2_calibration calibration;
+	/* write-back mode of the page granularity mappings */
+	enum pmem2_writeback writeback;
+	/* preferred NUMA node of the mapping, PMEM2_NUMA_NODE_ANY if none */
+	int numa_node;
+	/* who does the asynchronous persists of a page granularity mapping */
+	enum pmem2_async_persist async_persist;
 };
 
 void pmem2_config_init(struct pmem2_config *cfg);
@@ -6,21 +6,22 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
+#include "alloc.h"
 #include "libpmem2.h"
 #include "deep_flush.h"
 #include "out.h"
 #include "pmem2_utils.h"
+#include "util.h"
 
 /*
- * pmem2_deep_flush -- performs deep flush operation
+ * deep_flush_check_range -- (internal) check if the range lies within
+ * the mapping
  */
-int
-pmem2_deep_flush(struct pmem2_map *map, void *ptr, size_t size)
+static int
+deep_flush_check_range(struct pmem2_map *map, void *ptr, size_t size)
 {
-	LOG(3, "map %p ptr %p size %zu", map, ptr, size);
-	PMEM2_ERR_CLR();
-
 	uintptr_t map_addr = (uintptr_t)map->addr;
 	uintptr_t map_end = map_addr + map->content_length;
 	uintptr_t flush_addr = (uintptr_t)ptr;
@@ -32,7 +33,23 @@ pmem2_deep_flush(struct pmem2_map *map, void *ptr, size_t size)
 		return PMEM2_E_DEEP_FLUSH_RANGE;
 	}
 
-	int ret = map->deep_flush_fn(map, ptr, size);
+	return 0;
+}
+
+/*
+ * pmem2_deep_flush -- performs deep flush operation
+ */
+int
+pmem2_deep_flush(struct pmem2_map *map, void *ptr, size_t size)
+{
+	LOG(3, "map %p ptr %p size %zu", map, ptr, size);
+	PMEM2_ERR_CLR();
+
+	int ret = deep_flush_check_range(map, ptr, size);
+	if (ret)
+		return ret;
+
+	ret = map->deep_flush_fn(map, ptr, size, NULL);
 	if (ret) {
 		LOG(1, "cannot perform deep flush operation for map %p", map);
 		return ret;
@@ -40,3 +57,104 @@ pmem2_deep_flush(struct pmem2_map *map, void *ptr, size_t size)
 
 	return 0;
 }
+
+/*
+ * deep_flush_desc_cmp -- (internal) order the ranges by their mappings and
+ * addresses
+ */
+static int
+deep_flush_desc_cmp(const void *lhs, const void *rhs)
+{
+	const struct pmem2_deep_flush_desc *l = lhs;
+	const struct pmem2_deep_flush_desc *r = rhs;
+
+	if ((uintptr_t)l->map != (uintptr_t)r->map)
+		return (uintptr_t)l->map < (uintptr_t)r->map ? -1 : 1;
+	if ((uintptr_t)l->ptr != (uintptr_t)r->ptr)
+		return (uintptr_t)l->ptr < (uintptr_t)r->ptr ? -1 : 1;
+
+	return 0;
+}
+
+/*
+ * pmem2_deep_flush_batch -- performs deep flush operation on many ranges
+ *
+ * The ranges of a mapping which overlap or share a page are flushed
+ * together, and every Device DAX region is deep flushed only once, after
+ * all the ranges are flushed from the CPU caches.
+ */
+int
+pmem2_deep_flush_batch(const struct pmem2_deep_flush_desc *descs,
+		size_t ndescs)
+{
+	LOG(3, "descs %p ndescs %zu", descs, ndescs);
+	PMEM2_ERR_CLR();
+
+	int ret;
+	for (size_t i = 0; i < ndescs; ++i) {
+		ret = deep_flush_check_range(descs[i].map, descs[i].ptr,
+				descs[i].size);
+		if (ret)
+			return ret;
+	}
+
+	if (ndescs == 0)
+		return 0;
+
+	if (ndescs > SIZE_MAX / sizeof(*descs)) {
+		ERR("too many ranges in a batch: %zu", ndescs);
+		return PMEM2_E_LENGTH_OUT_OF_RANGE;
+	}
+
+	struct pmem2_deep_flush_desc *sorted =
+		pmem2_malloc(ndescs * sizeof(*sorted), &ret);
+	if (ret)
+		return ret;
+
+	struct deep_flush_regions regions;
+	regions.nids = 0;
+	regions.ids = pmem2_malloc(ndescs * sizeof(unsigned), &ret);
+	if (ret)
+		goto end_free_sorted;
+
+	memcpy(sorted, descs, ndescs * sizeof(*sorted));
+	qsort(sorted, ndescs, sizeof(*sorted), deep_flush_desc_cmp);
+
+	size_t i = 0;
+	while (i < ndescs) {
+		struct pmem2_map *map = sorted[i].map;
+		uintptr_t begin = (uintptr_t)sorted[i].ptr;
+		uintptr_t end = begin + sorted[i].size;
+
+		for (++i; i < ndescs && sorted[i].map == map; ++i) {
+			uintptr_t next = (uintptr_t)sorted[i].ptr;
+			if (ALIGN_DOWN(next, Pagesize) > end)
+				break;
+
+			end = MAX(end, next + sorted[i].size);
+		}
+
+		ret = map->deep_flush_fn(map, (void *)begin, end - begin,
+				&regions);
+		if (ret) {
+			LOG(1, "cannot perform deep flush operation for map %p",
+				map);
+			goto end;
+		}
+	}
+
+	for (size_t r = 0; r < regions.nids; ++r) {
+		ret = pmem2_deep_flush_write(regions.ids[r]);
+		if (ret) {
+			LOG(1, "cannot write to deep_flush file for region %u",
+				regions.ids[r]);
+			goto end;
+		}
+	}
+
+end:
+	Free(regions.ids);
+end_free_sorted:
+	Free(sorted);
+	return ret;
+}
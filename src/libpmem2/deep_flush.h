@@ -14,11 +14,25 @@
 extern "C" {
 #endif
 
+/*
+ * deep_flush_regions -- Device DAX regions whose deep flush is postponed
+ * until the end of a batch, so that each of them is flushed only once
+ */
+struct deep_flush_regions {
+	unsigned *ids;
+	size_t nids;
+};
+
+void pmem2_deep_flush_fini(void);
 int pmem2_deep_flush_write(unsigned region_id);
-int pmem2_deep_flush_dax(struct pmem2_map *map, void *ptr, size_t size);
-int pmem2_deep_flush_page(struct pmem2_map *map, void *ptr, size_t size);
-int pmem2_deep_flush_cache(struct pmem2_map *map, void *ptr, size_t size);
-int pmem2_deep_flush_byte(struct pmem2_map *map, void *ptr, size_t size);
+int pmem2_deep_flush_dax(struct pmem2_map *map, void *ptr, size_t size,
+		struct deep_flush_regions *regions);
+int pmem2_deep_flush_page(struct pmem2_map *map, void *ptr, size_t size,
+		struct deep_flush_regions *regions);
+int pmem2_deep_flush_cache(struct pmem2_map *map, void *ptr, size_t size,
+		struct deep_flush_regions *regions);
+int pmem2_deep_flush_byte(struct pmem2_map *map, void *ptr, size_t size,
+		struct deep_flush_regions *regions);
 
 #ifdef __cplusplus
 }
@@ -19,26 +19,51 @@
 #include "pmem2_utils.h"
 #include "region_namespace.h"
 
+/* regions with a higher id do not get their deep_flush file cached */
+#define DEEP_FLUSH_MAX_REGIONS 256
+
 /*
- * pmem2_deep_flush_write -- perform write to deep_flush file
- * on given region_id
+ * The deep_flush files of the regions, indexed by the region id. 0 means
+ * the file was not opened yet (or opening it failed and has to be retried),
+ * -1 that the region does not need to be deep flushed, any other value is
+ * the file descriptor plus one.
  */
-int
-pmem2_deep_flush_write(unsigned region_id)
-{
-	LOG(3, "region_id %d", region_id);
+static int Deep_flush_fds[DEEP_FLUSH_MAX_REGIONS];
 
+/*
+ * deep_flush_open -- (internal) open the deep_flush file of the region for
+ * writing, *fd is set to -1 if deep flushing is not needed (*needed is then
+ * 0) or not possible at the moment
+ */
+static int
+deep_flush_open(unsigned region_id, int *fd, int *needed)
+{
 	char deep_flush_path[PATH_MAX];
 	int deep_flush_fd;
 	char rbuf[2];
 
+	*fd = -1;
+	*needed = 1;
+
 	if (util_snprintf(deep_flush_path, PATH_MAX,
 		"/sys/bus/nd/devices/region%u/deep_flush", region_id) < 0) {
 		ERR("!snprintf");
 		return PMEM2_E_ERRNO;
 	}
 
-	if ((deep_flush_fd = os_open(deep_flush_path, O_RDONLY)) < 0) {
+	/*
+	 * Reading the file is allowed to more users than writing to it.
+	 * The descriptor is cached for the life of the process, so it must
+	 * not leak into the programs it executes.
+	 */
+	int writable = 1;
+	deep_flush_fd = os_open(deep_flush_path, O_RDWR | O_CLOEXEC);
+	if (deep_flush_fd < 0) {
+		writable = 0;
+		deep_flush_fd = os_open(deep_flush_path, O_RDONLY | O_CLOEXEC);
+	}
+
+	if (deep_flush_fd < 0) {
 		LOG(1, "!os_open(\"%s\", O_RDONLY)", deep_flush_path);
 		return 0;
 	}
@@ -50,34 +75,141 @@ pmem2_deep_flush_write(unsigned region_id)
 
 	if (rbuf[0] == '0' && rbuf[1] == '\n') {
 		LOG(3, "Deep flushing not needed");
+		*needed = 0;
 		goto end;
 	}
 
-	os_close(deep_flush_fd);
-
-	if ((deep_flush_fd = os_open(deep_flush_path, O_WRONLY)) < 0) {
+	if (!writable) {
 		LOG(1, "Cannot open deep_flush file %s to write",
 			deep_flush_path);
-		return 0;
-	}
-
-	if (write(deep_flush_fd, "1", 1) != 1) {
-		LOG(1, "Cannot write to deep_flush file %d", deep_flush_fd);
 		goto end;
 	}
 
+	*fd = deep_flush_fd;
+	return 0;
+
 end:
 	os_close(deep_flush_fd);
 	return 0;
 }
 
+/*
+ * pmem2_deep_flush_write -- perform write to deep_flush file
+ * on given region_id
+ *
+ * The deep_flush file is opened and checked only on the first successful
+ * call for a region, and kept open until the library is unloaded. A file
+ * which could not be opened or read is retried on the next call.
+ */
+int
+pmem2_deep_flush_write(unsigned region_id)
+{
+	LOG(3, "region_id %d", region_id);
+
+	int *cached = region_id < DEEP_FLUSH_MAX_REGIONS ?
+		&Deep_flush_fds[region_id] : NULL;
+
+	int val = 0;
+	if (cached)
+		util_atomic_load_explicit32(cached, &val, memory_order_acquire);
+
+	if (val == 0) {
+		int fd;
+		int needed;
+		int ret = deep_flush_open(region_id, &fd, &needed);
+		if (ret)
+			return ret;
+
+		/* a failure is not cached, so that it is retried */
+		if (fd < 0 && needed)
+			return 0;
+
+		val = fd < 0 ? -1 : fd + 1;
+
+		if (cached && !util_bool_compare_and_swap32(cached, 0, val)) {
+			/* another thread was first to open the file */
+			if (fd >= 0)
+				os_close(fd);
+			util_atomic_load_explicit32(cached, &val,
+				memory_order_acquire);
+		}
+	}
+
+	if (val < 0)
+		return 0;
+
+	int deep_flush_fd = val - 1;
+	if (write(deep_flush_fd, "1", 1) != 1)
+		LOG(1, "Cannot write to deep_flush file %d", deep_flush_fd);
+
+	if (!cached)
+		os_close(deep_flush_fd);
+
+	return 0;
+}
+
+/*
+ * pmem2_deep_flush_fini -- close the cached deep_flush files
+ */
+void
+pmem2_deep_flush_fini(void)
+{
+	for (unsigned i = 0; i < DEEP_FLUSH_MAX_REGIONS; ++i) {
+		if (Deep_flush_fds[i] > 0)
+			os_close(Deep_flush_fds[i] - 1);
+		Deep_flush_fds[i] = 0;
+	}
+}
+
+/*
+ * deep_flush_region_id -- (internal) get the id of the Device DAX region of
+ * the mapping, which is looked up only once
+ */
+static int
+deep_flush_region_id(struct pmem2_map *map, unsigned *region_id)
+{
+	unsigned cached;
+	util_atomic_load_explicit32(&map->deep_flush_region, &cached,
+		memory_order_acquire);
+	if (cached) {
+		*region_id = cached - 1;
+		return 0;
+	}
+
+	int ret = pmem2_get_region_id(&map->source, region_id);
+	if (ret < 0)
+		return ret;
+
+	util_atomic_store_explicit32(&map->deep_flush_region, *region_id + 1,
+		memory_order_release);
+
+	return 0;
+}
+
+/*
+ * deep_flush_regions_add -- (internal) add the region to the ones to be
+ * deep flushed at the end of a batch
+ */
+static void
+deep_flush_regions_add(struct deep_flush_regions *regions, unsigned region_id)
+{
+	for (size_t i = 0; i < regions->nids; ++i) {
+		if (regions->ids[i] == region_id)
+			return;
+	}
+
+	regions->ids[regions->nids++] = region_id;
+}
+
 /*
  * pmem2_deep_flush_dax -- reads file type for map and check
  * if it is device dax or reg file, depend on file type
- * performs proper flush operation
+ * performs proper flush operation, the write to the deep_flush file of
+ * a Device DAX region is postponed if the regions of a batch are given
  */
 int
-pmem2_deep_flush_dax(struct pmem2_map *map, void *ptr, size_t size)
+pmem2_deep_flush_dax(struct pmem2_map *map, void *ptr, size_t size,
+		struct deep_flush_regions *regions)
 {
 	int ret;
 	enum pmem2_file_type type = map->source.value.ftype;
@@ -104,12 +236,18 @@ pmem2_deep_flush_dax(struct pmem2_map *map, void *ptr, size_t size)
 		}
 	} else if (type == PMEM2_FTYPE_DEVDAX) {
 		unsigned region_id;
-		int ret = pmem2_get_region_id(&map->source, &region_id);
+		int ret = deep_flush_region_id(map, &region_id);
 		if (ret < 0) {
 			LOG(1, "cannot find region id for dev %lu",
 				map->source.value.st_rdev);
 			return ret;
 		}
+
+		if (regions) {
+			deep_flush_regions_add(regions, region_id);
+			return 0;
+		}
+
 		ret = pmem2_deep_flush_write(region_id);
 		if (ret) {
 			LOG(1, "cannot write to deep_flush file for region %d",
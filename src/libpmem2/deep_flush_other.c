@@ -19,7 +19,8 @@
  * pmem2_deep_flush_dax -- performs flush buffer operation
  */
 int
-pmem2_deep_flush_dax(struct pmem2_map *map, void *ptr, size_t size)
+pmem2_deep_flush_dax(struct pmem2_map *map, void *ptr, size_t size,
+		struct deep_flush_regions *regions)
 {
 	int ret = pmem2_flush_file_buffers_os(map, ptr, size, 0);
 	if (ret) {
@@ -45,3 +46,11 @@ pmem2_deep_flush_write(unsigned region_id)
 	/* not supported */
 	return PMEM2_E_NOSUPP;
 }
+
+/*
+ * pmem2_deep_flush_fini -- nothing is cached on this OS
+ */
+void
+pmem2_deep_flush_fini(void)
+{
+}
@@ -0,0 +1,138 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2020, Intel Corporation */
+
+/*
+ * flush_batch.c -- implementation of the flush batches of a mapping
+ *
+ * A batch collects the ranges which an application would otherwise flush
+ * one by one with pmem2_flush_fn and writes back every cache line (or page,
+ * depending on the store granularity) they cover exactly once, in the order
+ * of addresses, before a single drain.
+ */
+
+#include "alloc.h"
+#include "libpmem2.h"
+#include "line_batch.h"
+#include "map.h"
+#include "out.h"
+#include "pmem2_utils.h"
+#include "util.h"
+
+struct pmem2_flush_batch {
+	struct pmem2_map *map;
+	struct line_batch *lines; /* NULL if the mapping needs no flushes */
+};
+
+/*
+ * pmem2_flush_batch_new -- create an empty flush batch of the mapping
+ */
+int
+pmem2_flush_batch_new(struct pmem2_flush_batch **batch, struct pmem2_map *map)
+{
+	LOG(3, "batch %p map %p", batch, map);
+	PMEM2_ERR_CLR();
+
+	*batch = NULL;
+
+	int ret;
+	struct pmem2_flush_batch *b = pmem2_malloc(sizeof(*b), &ret);
+	if (ret)
+		return ret;
+
+	b->map = map;
+	b->lines = NULL;
+
+	size_t line = 0;
+	switch (map->effective_granularity) {
+		case PMEM2_GRANULARITY_BYTE:
+			/* the caches are persistent, nothing to flush */
+			break;
+		case PMEM2_GRANULARITY_CACHE_LINE:
+			line = CACHELINE_SIZE;
+			break;
+		case PMEM2_GRANULARITY_PAGE:
+			line = Pagesize;
+			break;
+		default:
+			ASSERT(0);
+	}
+
+	if (line) {
+		b->lines = line_batch_new(line);
+		if (b->lines == NULL) {
+			ERR("!malloc");
+			Free(b);
+			return PMEM2_E_ERRNO;
+		}
+	}
+
+	*batch = b;
+
+	return 0;
+}
+
+/*
+ * pmem2_flush_batch_delete -- delete the flush batch, the ranges added since
+ * the last persist are not flushed
+ */
+int
+pmem2_flush_batch_delete(struct pmem2_flush_batch **batch)
+{
+	LOG(3, "batch %p", batch);
+	PMEM2_ERR_CLR();
+
+	struct pmem2_flush_batch *b = *batch;
+	if (b == NULL)
+		return 0;
+
+	line_batch_delete(b->lines);
+	Free(b);
+	*batch = NULL;
+
+	return 0;
+}
+
+/*
+ * pmem2_flush_batch_add -- add the range to be flushed by the next persist
+ */
+void
+pmem2_flush_batch_add(struct pmem2_flush_batch *batch, const void *ptr,
+		size_t size)
+{
+	LOG(15, "batch %p ptr %p size %zu", batch, ptr, size);
+
+	if (batch->lines == NULL)
+		return;
+
+	/* there's no memory to defer it, so flush it right now */
+	if (line_batch_add(batch->lines, ptr, size))
+		batch->map->flush_fn(ptr, size);
+}
+
+/*
+ * flush_batch_flush_range -- (internal) flush the range of whole lines
+ */
+static void
+flush_batch_flush_range(const void *addr, size_t len, void *arg)
+{
+	struct pmem2_map *map = arg;
+
+	map->flush_fn(addr, len);
+}
+
+/*
+ * pmem2_flush_batch_persist -- flush all the ranges added since the last
+ * persist and drain
+ */
+void
+pmem2_flush_batch_persist(struct pmem2_flush_batch *batch)
+{
+	LOG(15, "batch %p", batch);
+
+	if (batch->lines) {
+		line_batch_flush(batch->lines, flush_batch_flush_range,
+			batch->map);
+	}
+
+	batch->map->drain_fn();
+}
@@ -7,11 +7,17 @@
 
 #include "libpmem2.h"
 
+#include "calibrate.h"
+#include "deep_flush.h"
 #include "map.h"
+#include "mcsafe.h"
+#include "mover.h"
 #include "out.h"
 #include "persist.h"
 #include "pmem2.h"
+#include "uring.h"
 #include "util.h"
+#include "writeback.h"
 
 /*
  * libpmem2_init -- load-time initialization for libpmem2
@@ -30,6 +36,10 @@ libpmem2_init(void)
 
 	pmem2_map_init();
 	pmem2_persist_init();
+	pmem2_calibrate_init();
+	pmem2_mover_init();
+	pmem2_uring_init();
+	pmem2_writeback_init();
 }
 
 /*
@@ -43,6 +53,12 @@ libpmem2_fini(void)
 {
 	LOG(3, NULL);
 
+	pmem2_mcsafe_fini();
+	pmem2_writeback_fini();
+	pmem2_mover_fini();
+	pmem2_uring_fini();
+	pmem2_calibrate_fini();
+	pmem2_deep_flush_fini();
 	pmem2_map_fini();
 	out_fini();
 }
@@ -10,13 +10,12 @@
 #include "alloc.h"
 #include "config.h"
 #include "map.h"
-#include "ravl_interval.h"
 #include "os.h"
 #include "os_thread.h"
 #include "persist.h"
 #include "pmem2.h"
 #include "pmem2_utils.h"
-#include "ravl.h"
+#include "range_map.h"
 #include "sys_util.h"
 #include "valgrind_internal.h"
 
@@ -134,29 +133,8 @@ pmem2_validate_offset(const struct pmem2_config *cfg, size_t *offset,
 	return 0;
 }
 
-/*
- * mapping_min - return min boundary for mapping
- */
-static size_t
-mapping_min(void *addr)
-{
-	struct pmem2_map *map = (struct pmem2_map *)addr;
-	return (size_t)map->addr;
-}
-
-/*
- * mapping_max - return max boundary for mapping
- */
-static size_t
-mapping_max(void *addr)
-{
-	struct pmem2_map *map = (struct pmem2_map *)addr;
-	return (size_t)map->addr + map->content_length;
-}
-
 static struct pmem2_state {
-	struct ravl_interval *range_map;
-	os_rwlock_t range_map_lock;
+	struct range_map *range_map;
 } State;
 
 /*
@@ -165,12 +143,7 @@ static struct pmem2_state {
 void
 pmem2_map_init()
 {
-	util_rwlock_init(&State.range_map_lock);
-
-	util_rwlock_wrlock(&State.range_map_lock);
-	State.range_map = ravl_interval_new(mapping_min, mapping_max);
-	util_rwlock_unlock(&State.range_map_lock);
-
+	State.range_map = range_map_new();
 	if (!State.range_map)
 		abort();
 }
@@ -181,66 +154,47 @@ pmem2_map_init()
 void
 pmem2_map_fini(void)
 {
-	util_rwlock_wrlock(&State.range_map_lock);
-	ravl_interval_delete(State.range_map);
-	util_rwlock_unlock(&State.range_map_lock);
+	range_map_delete(State.range_map);
+	State.range_map = NULL;
 }
 
 /*
- * pmem2_register_mapping -- register mapping in the mappings tree
+ * pmem2_register_mapping -- register mapping in the range map
  */
 int
 pmem2_register_mapping(struct pmem2_map *map)
 {
-	util_rwlock_wrlock(&State.range_map_lock);
-	int ret = ravl_interval_insert(State.range_map, map);
-	util_rwlock_unlock(&State.range_map_lock);
-
-	return ret;
+	return range_map_insert(State.range_map, (uintptr_t)map->addr,
+			map->content_length, map);
 }
 
 /*
- * pmem2_unregister_mapping -- unregister mapping from the mappings tree
+ * pmem2_unregister_mapping -- unregister mapping from the range map, fails
+ * only if the mapping is not registered
  */
 int
 pmem2_unregister_mapping(struct pmem2_map *map)
 {
-	int ret = 0;
-	struct ravl_interval_node *node;
-
-	util_rwlock_wrlock(&State.range_map_lock);
-	node = ravl_interval_find_equal(State.range_map, map);
-	if (!(node && !ravl_interval_remove(State.range_map, node))) {
+	int ret = range_map_remove(State.range_map, (uintptr_t)map->addr,
+			map->content_length);
+	if (ret == -ENOENT) {
 		ERR("Cannot find mapping %p to delete", map);
 		ret = PMEM2_E_MAPPING_NOT_FOUND;
 	}
 
-	util_rwlock_unlock(&State.range_map_lock);
-
 	return ret;
 }
 
 /*
  * pmem2_map_find -- find the earliest mapping overlapping with
  * (addr, addr+size) range
+ *
+ * The lookup does not take any lock, see range_map.c.
  */
 struct pmem2_map *
 pmem2_map_find(const void *addr, size_t len)
 {
-	struct pmem2_map map;
-	map.addr = (void *)addr;
-	map.content_length = len;
-
-	struct ravl_interval_node *node;
-
-	util_rwlock_rdlock(&State.range_map_lock);
-	node = ravl_interval_find(State.range_map, &map);
-	util_rwlock_unlock(&State.range_map_lock);
-
-	if (!node)
-		return NULL;
-
-	return (struct pmem2_map *)ravl_interval_data(node);
+	return range_map_find(State.range_map, (uintptr_t)addr, len);
 }
 
 /*
@@ -266,6 +220,10 @@ pmem2_map_from_existing(struct pmem2_map **map_ptr,
 	pmem2_set_flush_fns(map);
 	pmem2_set_mem_fns(map);
 	map->source = *src;
+	map->uring_fd = INVALID_FD;
+	map->uring_offset = 0;
+	map->uring_inflight = 0;
+	map->numa_node = PMEM2_NUMA_NODE_ANY;
 
 #ifndef _WIN32
 	/* fd should not be used after map */
@@ -22,8 +22,10 @@
 extern "C" {
 #endif
 
+struct deep_flush_regions;
+
 typedef int (*pmem2_deep_flush_fn)(struct pmem2_map *map,
-		void *ptr, size_t size);
+		void *ptr, size_t size, struct deep_flush_regions *regions);
 
 struct pmem2_map {
 	void *addr; /* base address */
@@ -36,10 +38,24 @@ struct pmem2_map {
 	pmem2_flush_fn flush_fn;
 	pmem2_drain_fn drain_fn;
 	pmem2_deep_flush_fn deep_flush_fn;
+	/* id + 1 of the Device DAX region of the mapping, 0 if not known */
+	unsigned deep_flush_region;
+	/* write-back mode, other than immediate only for page granularity */
+	enum pmem2_writeback writeback;
+	/* the node the pages were placed on, PMEM2_NUMA_NODE_ANY if none */
+	int numa_node;
+	unsigned protection_flag; /* PMEM2_PROT_* flags of the mapping */
+
+	/* duplicate of the file descriptor for the asynchronous persists */
+	int uring_fd;
+	size_t uring_offset; /* offset of the mapping in the file */
+	unsigned uring_inflight; /* the requests not completed yet */
 
 	pmem2_memmove_fn memmove_fn;
 	pmem2_memcpy_fn memcpy_fn;
 	pmem2_memset_fn memset_fn;
+	pmem2_memmovev_fn memmovev_fn;
+	pmem2_memcpyv_fn memcpyv_fn;
 
 	struct pmem2_source source;
 	struct pmem2_vm_reservation *reserv;
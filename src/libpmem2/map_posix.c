@@ -14,15 +14,19 @@
 
 #include "alloc.h"
 #include "auto_flush.h"
+#include "calibrate.h"
 #include "config.h"
 #include "file.h"
 #include "map.h"
+#include "os_thread.h"
 #include "out.h"
 #include "persist.h"
 #include "pmem2_utils.h"
 #include "source.h"
 #include "sys_util.h"
+#include "uring.h"
 #include "valgrind_internal.h"
+#include "writeback.h"
 
 #ifndef MAP_SYNC
 #define MAP_SYNC 0x80000
@@ -263,8 +267,8 @@ unmap(void *addr, size_t len)
 static int
 vm_reservation_mend(struct pmem2_vm_reservation *rsv, void *addr, size_t size)
 {
-	void *rsv_addr = pmem2_vm_reservation_get_address(rsv);
-	size_t rsv_size = pmem2_vm_reservation_get_size(rsv);
+	void *rsv_addr = vm_reservation_get_address(rsv);
+	size_t rsv_size = vm_reservation_get_size(rsv);
 
 	ASSERT((char *)addr >= (char *)rsv_addr &&
 			(char *)addr + size <= (char *)rsv_addr + rsv_size);
@@ -377,13 +381,12 @@ pmem2_map_new(struct pmem2_map **map_ptr, const struct pmem2_config *cfg,
 	void *reserv_region = NULL;
 	void *rsv = cfg->reserv;
 	if (rsv) {
-		void *rsv_addr = pmem2_vm_reservation_get_address(rsv);
-		size_t rsv_size = pmem2_vm_reservation_get_size(rsv);
 		size_t rsv_offset = cfg->reserv_offset;
 
 		reserved_length = roundup(content_length, Pagesize);
 
-		if (rsv_offset % Mmap_align) {
+		if (rsv_offset != PMEM2_VM_RESERVATION_OFFSET_ANY &&
+				rsv_offset % Mmap_align) {
 			ret = PMEM2_E_OFFSET_UNALIGNED;
 			ERR(
 				"virtual memory reservation offset %zu is not a multiple of %llu",
@@ -391,33 +394,49 @@ pmem2_map_new(struct pmem2_map **map_ptr, const struct pmem2_config *cfg,
 			return ret;
 		}
 
-		if (rsv_offset + reserved_length > rsv_size) {
+		/*
+		 * The reservation can be resized concurrently, its address
+		 * and size are valid only while the lock is held.
+		 */
+		vm_reservation_acquire(rsv);
+		void *rsv_addr = vm_reservation_get_address(rsv);
+		size_t rsv_size = vm_reservation_get_size(rsv);
+
+		if (rsv_offset == PMEM2_VM_RESERVATION_OFFSET_ANY) {
+			/* choose the free region of the reservation */
+			ret = vm_reservation_map_place(rsv, reserved_length,
+					alignment, &rsv_offset);
+			if (ret)
+				goto err_reservation_release;
+
+			reserv_region = (char *)rsv_addr + rsv_offset;
+		} else if (rsv_offset + reserved_length > rsv_size) {
 			ret = PMEM2_E_LENGTH_OUT_OF_RANGE;
 			ERR(
 				"Reservation %p has not enough space for the intended content",
 					rsv);
-			return ret;
-		}
-
-		reserv_region = (char *)rsv_addr + rsv_offset;
-		if ((size_t)reserv_region % alignment) {
-			ret = PMEM2_E_ADDRESS_UNALIGNED;
-			ERR(
-				"base mapping address %p (virtual memory reservation address + offset)" \
-				" is not a multiple of %zu required by device DAX",
-					reserv_region, alignment);
-			return ret;
-		}
-
-		/* check if the region in the reservation is occupied */
-		if (vm_reservation_map_find_acquire(rsv, rsv_offset,
-				reserved_length)) {
-			ret = PMEM2_E_MAPPING_EXISTS;
-			ERR(
-				"region of the reservation %p at the offset %zu and "
-				"length %zu is at least partly occupied by other mapping",
-				rsv, rsv_offset, reserved_length);
 			goto err_reservation_release;
+		} else {
+			reserv_region = (char *)rsv_addr + rsv_offset;
+			if ((size_t)reserv_region % alignment) {
+				ret = PMEM2_E_ADDRESS_UNALIGNED;
+				ERR(
+					"base mapping address %p (virtual memory reservation address + offset)" \
+					" is not a multiple of %zu required by device DAX",
+						reserv_region, alignment);
+				goto err_reservation_release;
+			}
+
+			/* check if the region in the reservation is occupied */
+			if (vm_reservation_map_find(rsv, rsv_offset,
+					reserved_length)) {
+				ret = PMEM2_E_MAPPING_EXISTS;
+				ERR(
+					"region of the reservation %p at the offset %zu and "
+					"length %zu is at least partly occupied by other mapping",
+					rsv, rsv_offset, reserved_length);
+				goto err_reservation_release;
+			}
 		}
 	} else {
 		/* find a hint for the mapping */
@@ -501,13 +520,55 @@ pmem2_map_new(struct pmem2_map **map_ptr, const struct pmem2_config *cfg,
 	map->effective_granularity = available_min_granularity;
 	pmem2_set_flush_fns(map);
 	pmem2_set_mem_fns(map);
+
+	if (cfg->writeback != PMEM2_WRITEBACK_IMMEDIATE &&
+			map->effective_granularity == PMEM2_GRANULARITY_PAGE) {
+		ret = pmem2_writeback_enable(map, cfg->writeback);
+		if (ret)
+			goto err_free_map_struct;
+	}
+
 	map->reserv = rsv;
 	map->source = *src;
 	map->source.value.fd = INVALID_FD; /* fd should not be used after map */
+	map->numa_node = PMEM2_NUMA_NODE_ANY;
+	map->protection_flag = cfg->protection_flag;
+
+	/*
+	 * The pages of the anonymous and page cache backed mappings are
+	 * allocated by the kernel on the first touch, so they can be placed on
+	 * the requested node. The pages of a DAX mapping are the device itself.
+	 * The node is recorded only if the placement is applied, the movers
+	 * rely on it instead of looking up the node of the memory.
+	 */
+	if (cfg->numa_node != PMEM2_NUMA_NODE_ANY &&
+			(src->type == PMEM2_SOURCE_ANON ||
+			map->effective_granularity == PMEM2_GRANULARITY_PAGE)) {
+		if (os_numa_prefer_node(addr, content_length,
+				(unsigned)cfg->numa_node) == 0)
+			map->numa_node = cfg->numa_node;
+		else
+			LOG(2, "!cannot place the mapping %p on node %d", addr,
+				cfg->numa_node);
+	}
+
+	/*
+	 * The calibration is best effort, the mapping is usable anyway. It is
+	 * done before the mapping is returned, so no other thread stores to
+	 * the rewritten range.
+	 */
+	if (cfg->calibration != PMEM2_CALIBRATION_NONE &&
+			(cfg->protection_flag & PMEM2_PROT_WRITE) &&
+			pmem2_calibrate(map, cfg->calibration))
+		LOG(2, "calibration on the mapping %p failed", map);
+
+	ret = pmem2_uring_map_init(map, cfg, src->value.fd, effective_offset);
+	if (ret)
+		goto err_free_map_struct;
 
 	ret = pmem2_register_mapping(map);
 	if (ret) {
-		goto err_free_map_struct;
+		goto err_uring_map_fini;
 	}
 
 	if (rsv) {
@@ -528,6 +589,8 @@ pmem2_map_new(struct pmem2_map **map_ptr, const struct pmem2_config *cfg,
 
 err_unregister_map:
 	pmem2_unregister_mapping(map);
+err_uring_map_fini:
+	pmem2_uring_map_fini(map);
 err_free_map_struct:
 	Free(map);
 err_undo_mapping:
@@ -560,6 +623,13 @@ pmem2_map_delete(struct pmem2_map **map_ptr)
 	void *map_addr = map->addr;
 	struct pmem2_vm_reservation *rsv = map->reserv;
 
+	/* the ranges still waiting for a drain may refer to the mapping */
+	if (map->writeback != PMEM2_WRITEBACK_IMMEDIATE)
+		pmem2_writeback_sync();
+
+	/* a failed asynchronous persist is retried on the mapping */
+	pmem2_uring_map_drain(map);
+
 	ret = pmem2_unregister_mapping(map);
 	if (ret)
 		return ret;
@@ -573,9 +643,10 @@ pmem2_map_delete(struct pmem2_map **map_ptr)
 		VALGRIND_REMOVE_PMEM_MAPPING(map_addr, map_len);
 
 		if (rsv) {
-			void *rsv_addr = pmem2_vm_reservation_get_address(rsv);
+			vm_reservation_acquire(rsv);
+			void *rsv_addr = vm_reservation_get_address(rsv);
 			size_t rsv_offset = (size_t)map_addr - (size_t)rsv_addr;
-			if (!vm_reservation_map_find_acquire(rsv, rsv_offset,
+			if (!vm_reservation_map_find(rsv, rsv_offset,
 					map_len)) {
 				ret = PMEM2_E_MAPPING_NOT_FOUND;
 				goto err_reservation_release;
@@ -595,6 +666,7 @@ pmem2_map_delete(struct pmem2_map **map_ptr)
 		}
 	}
 
+	pmem2_uring_map_fini(map);
 	Free(map);
 	*map_ptr = NULL;
 
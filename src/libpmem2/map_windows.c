@@ -11,6 +11,7 @@
 
 #include "alloc.h"
 #include "auto_flush.h"
+#include "calibrate.h"
 #include "config.h"
 #include "map.h"
 #include "os_thread.h"
@@ -20,6 +21,7 @@
 #include "source.h"
 #include "sys_util.h"
 #include "util.h"
+#include "writeback.h"
 
 #define HIDWORD(x) ((DWORD)((x) >> 32))
 #define LODWORD(x) ((DWORD)((x) & 0xFFFFFFFF))
@@ -116,8 +118,8 @@ static int
 vm_reservation_unmap(struct pmem2_vm_reservation *rsv, void *addr,
 		size_t length)
 {
-	void *rsv_addr = pmem2_vm_reservation_get_address(rsv);
-	size_t rsv_size = pmem2_vm_reservation_get_size(rsv);
+	void *rsv_addr = vm_reservation_get_address(rsv);
+	size_t rsv_size = vm_reservation_get_size(rsv);
 
 	if (addr < rsv_addr ||
 			(char *)addr + length > (char *)rsv_addr + rsv_size)
@@ -142,8 +144,8 @@ static int
 vm_reservation_merge(struct pmem2_vm_reservation *rsv, void *addr,
 		size_t length)
 {
-	void *rsv_addr = pmem2_vm_reservation_get_address(rsv);
-	size_t rsv_size = pmem2_vm_reservation_get_size(rsv);
+	void *rsv_addr = vm_reservation_get_address(rsv);
+	size_t rsv_size = vm_reservation_get_size(rsv);
 	size_t rsv_offset = (size_t)addr - (size_t)rsv_addr;
 
 	/*
@@ -200,8 +202,8 @@ vm_reservation_split(struct pmem2_vm_reservation *rsv, size_t rsv_offset,
 {
 	LOG(3, "rsv %p rsv_offset %zu length %zu", rsv, rsv_offset, length);
 
-	void *rsv_addr = pmem2_vm_reservation_get_address(rsv);
-	size_t rsv_size = pmem2_vm_reservation_get_size(rsv);
+	void *rsv_addr = vm_reservation_get_address(rsv);
+	size_t rsv_size = vm_reservation_get_size(rsv);
 
 	LOG(3, "rsv_addr %p rsv_size %zu", rsv_addr, rsv_size);
 
@@ -353,11 +355,10 @@ pmem2_map_new(struct pmem2_map **map_ptr, const struct pmem2_config *cfg,
 	void *base;
 	void *rsv = cfg->reserv;
 	if (rsv) {
-		void *rsv_addr = pmem2_vm_reservation_get_address(rsv);
-		size_t rsv_size = pmem2_vm_reservation_get_size(rsv);
 		size_t rsv_offset = cfg->reserv_offset;
 
-		if (rsv_offset % Mmap_align) {
+		if (rsv_offset != PMEM2_VM_RESERVATION_OFFSET_ANY &&
+				rsv_offset % Mmap_align) {
 			ret = PMEM2_E_OFFSET_UNALIGNED;
 			ERR(
 				"offset from the beggining of virtual memory "
@@ -366,23 +367,39 @@ pmem2_map_new(struct pmem2_map **map_ptr, const struct pmem2_config *cfg,
 			goto err_close_mapping_handle;
 		}
 
-		if (rsv_offset + length > rsv_size) {
-			ret = PMEM2_E_LENGTH_OUT_OF_RANGE;
-			ERR(
-				"length of the mapping %zu combined with the "
-				"offset into the reservation %zu exceeds virtual "
-				"memory reservation size %zu",
-				length, effective_offset, rsv_size);
-			goto err_close_mapping_handle;
-		}
+		/*
+		 * The reservation can be resized concurrently, its address
+		 * and size are valid only while the lock is held.
+		 */
+		vm_reservation_acquire(rsv);
+		void *rsv_addr = vm_reservation_get_address(rsv);
+		size_t rsv_size = vm_reservation_get_size(rsv);
+
+		if (rsv_offset == PMEM2_VM_RESERVATION_OFFSET_ANY) {
+			/* choose the free region of the reservation */
+			ret = vm_reservation_map_place(rsv, length,
+					Mmap_align, &rsv_offset);
+			if (ret)
+				goto err_reservation_release;
+		} else {
+			if (rsv_offset + length > rsv_size) {
+				ret = PMEM2_E_LENGTH_OUT_OF_RANGE;
+				ERR(
+					"length of the mapping %zu combined with the "
+					"offset into the reservation %zu exceeds virtual "
+					"memory reservation size %zu",
+					length, effective_offset, rsv_size);
+				goto err_reservation_release;
+			}
 
-		if (vm_reservation_map_find_acquire(rsv, rsv_offset, length)) {
-			ret = PMEM2_E_MAPPING_EXISTS;
-			ERR(
-				"region of the reservation %p at the offset %zu and "
-				"length %zu is at least partly occupied by other mapping",
-				rsv, rsv_offset, length);
-			goto err_reservation_release;
+			if (vm_reservation_map_find(rsv, rsv_offset, length)) {
+				ret = PMEM2_E_MAPPING_EXISTS;
+				ERR(
+					"region of the reservation %p at the offset %zu and "
+					"length %zu is at least partly occupied by other mapping",
+					rsv, rsv_offset, length);
+				goto err_reservation_release;
+			}
 		}
 
 		void *addr = (char *)rsv_addr + rsv_offset;
@@ -490,6 +507,29 @@ pmem2_map_new(struct pmem2_map **map_ptr, const struct pmem2_config *cfg,
 	map->source = *src;
 	pmem2_set_flush_fns(map);
 	pmem2_set_mem_fns(map);
+	map->uring_fd = INVALID_FD;
+	map->uring_offset = effective_offset;
+	map->uring_inflight = 0;
+	/* the placement of the pages is not controlled on Windows */
+	map->numa_node = PMEM2_NUMA_NODE_ANY;
+	map->protection_flag = cfg->protection_flag;
+
+	if (cfg->writeback != PMEM2_WRITEBACK_IMMEDIATE &&
+			map->effective_granularity == PMEM2_GRANULARITY_PAGE) {
+		ret = pmem2_writeback_enable(map, cfg->writeback);
+		if (ret)
+			goto err_free_map_struct;
+	}
+
+	/*
+	 * The calibration is best effort, the mapping is usable anyway. It is
+	 * done before the mapping is returned, so no other thread stores to
+	 * the rewritten range.
+	 */
+	if (cfg->calibration != PMEM2_CALIBRATION_NONE &&
+			(cfg->protection_flag & PMEM2_PROT_WRITE) &&
+			pmem2_calibrate(map, cfg->calibration))
+		LOG(2, "calibration on the mapping %p failed", map);
 
 	ret = pmem2_register_mapping(map);
 	if (ret) {
@@ -541,15 +581,20 @@ pmem2_map_delete(struct pmem2_map **map_ptr)
 	void *map_addr = map->addr;
 	struct pmem2_vm_reservation *rsv = map->reserv;
 
+	/* the ranges still waiting for a drain may refer to the mapping */
+	if (map->writeback != PMEM2_WRITEBACK_IMMEDIATE)
+		pmem2_writeback_sync();
+
 	int ret = pmem2_unregister_mapping(map);
 	if (ret)
 		return ret;
 
 	if (map->reserved_length != 0) {
 		if (rsv) {
-			void *rsv_addr = pmem2_vm_reservation_get_address(rsv);
+			vm_reservation_acquire(rsv);
+			void *rsv_addr = vm_reservation_get_address(rsv);
 			size_t rsv_offset = (size_t)map_addr - (size_t)rsv_addr;
-			if (!vm_reservation_map_find_acquire(rsv, rsv_offset,
+			if (!vm_reservation_map_find(rsv, rsv_offset,
 					map_len)) {
 				ret = PMEM2_E_MAPPING_NOT_FOUND;
 				goto err_reservation_release;
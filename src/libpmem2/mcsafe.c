@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2020, Intel Corporation */
+
+/*
+ * mcsafe.c -- machine check safe copies from the mappings
+ *
+ * Reading a poisoned cache line of persistent memory raises a machine check,
+ * which the operating system turns into SIGBUS (or EXCEPTION_IN_PAGE_ERROR)
+ * and which kills the application, unless it is caught. The copy is done by
+ * one of the pmem2_arch_info.memcpy_mcsafe kernels, which read the source in
+ * the order of addresses, so when the platform code (mcsafe_posix.c,
+ * mcsafe_windows.c) catches the fault, everything before the faulting line
+ * is already copied and the offset of the poisoned range can be returned
+ * to the caller instead.
+ */
+
+#include "libpmem2.h"
+#include "map.h"
+#include "mcsafe.h"
+#include "out.h"
+#include "persist.h"
+#include "pmem2_arch.h"
+#include "pmem2_utils.h"
+
+/*
+ * pmem2_memcpy_mcsafe -- copy the data of the mapping to dest, reporting
+ * the poisoned memory instead of crashing on it
+ */
+int
+pmem2_memcpy_mcsafe(struct pmem2_map *map, void *dest, const void *src,
+		size_t len, size_t *poisoned_off)
+{
+	LOG(15, "map %p dest %p src %p len %zu poisoned_off %p", map, dest,
+			src, len, poisoned_off);
+	PMEM2_ERR_CLR();
+
+	uintptr_t map_addr = (uintptr_t)map->addr;
+	uintptr_t map_end = map_addr + map->content_length;
+	uintptr_t src_addr = (uintptr_t)src;
+
+	if (src_addr < map_addr || src_addr > map_end ||
+			len > map_end - src_addr) {
+		ERR("source ptr %p size %zu exceeds map range %p", src, len,
+				map);
+		return PMEM2_E_LENGTH_OUT_OF_RANGE;
+	}
+
+	if (len == 0)
+		return 0;
+
+	const struct pmem2_arch_info *info = pmem2_persist_get_arch_info();
+
+	const void *poisoned;
+	int ret = pmem2_mcsafe_copy(info->memcpy_mcsafe, dest, src, len,
+			&poisoned);
+	if (ret)
+		return ret;
+
+	if (poisoned == NULL)
+		return 0;
+
+	size_t off = (size_t)((uintptr_t)poisoned - src_addr);
+	if (poisoned_off)
+		*poisoned_off = off;
+
+	ERR("poisoned memory at offset %zu of the copied range", off);
+	return PMEM2_E_MEMORY_POISONED;
+}
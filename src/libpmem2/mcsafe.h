@@ -0,0 +1,28 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright 2020, Intel Corporation */
+
+/*
+ * mcsafe.h -- internal definitions for the copies which survive reading
+ * poisoned memory
+ */
+#ifndef PMEM2_MCSAFE_H
+#define PMEM2_MCSAFE_H
+
+#include <stddef.h>
+
+#include "pmem2_arch.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void pmem2_mcsafe_fini(void);
+
+int pmem2_mcsafe_copy(memcpy_mcsafe_func copy, void *dest, const void *src,
+		size_t len, const void **poisoned);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PMEM2_MCSAFE_H */
@@ -0,0 +1,141 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2020, Intel Corporation */
+
+/*
+ * mcsafe_posix.c -- catching the faults of the machine check safe copies
+ *
+ * The SIGBUS handler is installed on the first copy. If the fault happened
+ * in the source of a copy done by the current thread, it jumps back to the
+ * copy with the address of the poisoned range. Otherwise the signal is
+ * passed on to the handler installed before, or to the default action.
+ */
+
+#include <setjmp.h>
+#include <signal.h>
+
+#include "mcsafe.h"
+#include "os_thread.h"
+#include "out.h"
+#include "pmem2_utils.h"
+#include "util.h"
+
+struct mcsafe_ctx {
+	sigjmp_buf env;
+	uintptr_t begin;
+	uintptr_t end;
+	volatile uintptr_t poisoned;
+};
+
+static __thread struct mcsafe_ctx *volatile Mcsafe_ctx;
+
+static os_once_t Mcsafe_once = OS_ONCE_INIT;
+static int Mcsafe_errno; /* of the handler installation */
+static int Mcsafe_installed;
+static struct sigaction Mcsafe_prev;
+
+/*
+ * mcsafe_sigbus -- (internal) SIGBUS handler
+ */
+static void
+mcsafe_sigbus(int sig, siginfo_t *info, void *uctx)
+{
+	struct mcsafe_ctx *ctx = Mcsafe_ctx;
+	uintptr_t addr = (uintptr_t)info->si_addr;
+
+	if (ctx != NULL && addr >= ctx->begin && addr < ctx->end) {
+		/* the kernel reports how much memory is poisoned */
+		uintptr_t granule = CACHELINE_SIZE;
+#ifdef BUS_MCEERR_AR
+		if ((info->si_code == BUS_MCEERR_AR ||
+				info->si_code == BUS_MCEERR_AO) &&
+				info->si_addr_lsb > 0)
+			granule = 1ULL << info->si_addr_lsb;
+#endif
+		uintptr_t poisoned = ALIGN_DOWN(addr, granule);
+		ctx->poisoned = MAX(poisoned, ctx->begin);
+
+		siglongjmp(ctx->env, 1);
+	}
+
+	if (Mcsafe_prev.sa_flags & SA_SIGINFO) {
+		Mcsafe_prev.sa_sigaction(sig, info, uctx);
+	} else if (Mcsafe_prev.sa_handler != SIG_DFL &&
+			Mcsafe_prev.sa_handler != SIG_IGN) {
+		Mcsafe_prev.sa_handler(sig);
+	} else {
+		/*
+		 * A faulting access is retried after the return and takes
+		 * the default action, a signal sent by a process is resent.
+		 */
+		sigaction(SIGBUS, &Mcsafe_prev, NULL);
+		if (info->si_code <= 0)
+			raise(sig);
+	}
+}
+
+/*
+ * mcsafe_install -- (internal) install the SIGBUS handler
+ */
+static void
+mcsafe_install(void)
+{
+	struct sigaction sa;
+	sa.sa_sigaction = mcsafe_sigbus;
+	sa.sa_flags = SA_SIGINFO;
+	sigemptyset(&sa.sa_mask);
+
+	if (sigaction(SIGBUS, &sa, &Mcsafe_prev)) {
+		Mcsafe_errno = errno;
+		return;
+	}
+
+	Mcsafe_installed = 1;
+}
+
+/*
+ * pmem2_mcsafe_fini -- restore the SIGBUS handler, unless it was replaced
+ */
+void
+pmem2_mcsafe_fini(void)
+{
+	if (!Mcsafe_installed)
+		return;
+
+	struct sigaction cur;
+	if (sigaction(SIGBUS, NULL, &cur) == 0 &&
+			(cur.sa_flags & SA_SIGINFO) &&
+			cur.sa_sigaction == mcsafe_sigbus)
+		sigaction(SIGBUS, &Mcsafe_prev, NULL);
+
+	Mcsafe_installed = 0;
+}
+
+/*
+ * pmem2_mcsafe_copy -- copy with the given kernel, if it faults on the source
+ * *poisoned is set to the beginning of the poisoned range, otherwise to NULL
+ */
+int
+pmem2_mcsafe_copy(memcpy_mcsafe_func copy, void *dest, const void *src,
+		size_t len, const void **poisoned)
+{
+	os_once(&Mcsafe_once, mcsafe_install);
+	if (Mcsafe_errno) {
+		errno = Mcsafe_errno;
+		ERR("!sigaction");
+		return PMEM2_E_ERRNO;
+	}
+
+	struct mcsafe_ctx ctx;
+	ctx.begin = (uintptr_t)src;
+	ctx.end = ctx.begin + len;
+	ctx.poisoned = 0;
+
+	Mcsafe_ctx = &ctx;
+	if (sigsetjmp(ctx.env, 1) == 0)
+		copy(dest, src, len);
+	Mcsafe_ctx = NULL;
+
+	*poisoned = (const void *)ctx.poisoned;
+
+	return 0;
+}
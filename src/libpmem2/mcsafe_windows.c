@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2020, Intel Corporation */
+
+/*
+ * mcsafe_windows.c -- catching the faults of the machine check safe copies
+ *
+ * Reading poisoned memory raises EXCEPTION_IN_PAGE_ERROR, which is handled
+ * only if it happened in the source of the copy.
+ */
+
+#include <windows.h>
+
+#include "mcsafe.h"
+#include "out.h"
+#include "util.h"
+
+/*
+ * mcsafe_filter -- (internal) handle the exceptions raised by reading
+ * the source of the copy
+ */
+static int
+mcsafe_filter(EXCEPTION_POINTERS *ep, uintptr_t begin, uintptr_t end,
+		uintptr_t *poisoned)
+{
+	EXCEPTION_RECORD *rec = ep->ExceptionRecord;
+
+	if (rec->ExceptionCode != EXCEPTION_IN_PAGE_ERROR)
+		return EXCEPTION_CONTINUE_SEARCH;
+
+	uintptr_t addr = (uintptr_t)rec->ExceptionInformation[1];
+	if (addr < begin || addr >= end)
+		return EXCEPTION_CONTINUE_SEARCH;
+
+	*poisoned = MAX(ALIGN_DOWN(addr, CACHELINE_SIZE), begin);
+
+	return EXCEPTION_EXECUTE_HANDLER;
+}
+
+/*
+ * pmem2_mcsafe_fini -- nothing to clean up
+ */
+void
+pmem2_mcsafe_fini(void)
+{
+}
+
+/*
+ * pmem2_mcsafe_copy -- copy with the given kernel, if it faults on the source
+ * *poisoned is set to the beginning of the poisoned range, otherwise to NULL
+ */
+int
+pmem2_mcsafe_copy(memcpy_mcsafe_func copy, void *dest, const void *src,
+		size_t len, const void **poisoned)
+{
+	uintptr_t begin = (uintptr_t)src;
+	uintptr_t fault = 0;
+
+	__try {
+		copy(dest, src, len);
+	} __except(mcsafe_filter(GetExceptionInformation(), begin,
+			begin + len, &fault)) {
+		/* the poisoned address is already set by the filter */
+	}
+
+	*poisoned = (const void *)fault;
+
+	return 0;
+}
@@ -2,7 +2,8 @@
 /* Copyright 2018-2020, Intel Corporation */
 
 /*
- * memops_generic.c -- architecture-independent memmove & memset fallback
+ * memops_generic.c -- architecture-independent memmove, memset & machine
+ * check safe memcpy fallback
  *
  * This fallback is needed to fulfill guarantee that pmem_mem[cpy|set|move]
  * will use at least 8-byte stores (for 8-byte aligned buffers and sizes),
@@ -13,6 +14,7 @@
  */
 
 #include <stddef.h>
+#include <string.h>
 
 #include "out.h"
 #include "pmem2_arch.h"
@@ -337,3 +339,30 @@ memset_nodrain_generic(void *dst, int c, size_t len, unsigned flags,
 		pmem2_flush_flags(cdst - remaining, remaining, flags, flush);
 	return dst;
 }
+
+/*
+ * memcpy_mcsafe_generic -- generic copy from memory which may be poisoned,
+ * a cache line of the source at a time
+ */
+void
+memcpy_mcsafe_generic(void *dest, const void *src, size_t len)
+{
+	char *cdst = dest;
+	const char *csrc = src;
+
+	while (len) {
+		size_t cnt = CACHELINE_SIZE -
+			((uintptr_t)csrc & (CACHELINE_SIZE - 1));
+		if (cnt > len)
+			cnt = len;
+
+		memcpy(cdst, csrc, cnt);
+
+		/* the next line is not read before this one is stored */
+		barrier();
+
+		cdst += cnt;
+		csrc += cnt;
+		len -= cnt;
+	}
+}
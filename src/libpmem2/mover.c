@@ -0,0 +1,486 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2020, Intel Corporation */
+
+/*
+ * mover.c -- implementation of the asynchronous data movement API
+ *
+ * A mover executes memcpy and memset requests in the background and reports
+ * their completion through futures. The execution itself is delegated to
+ * a backend (see struct pmem2_mover_ops), by default a pool of worker threads
+ * using the same memcpy and memset functions as pmem2_get_memcpy_fn() and
+ * pmem2_get_memset_fn().
+ *
+ * pmem2_memcpy_parallel() and pmem2_memset_parallel() are the synchronous
+ * counterparts, which split a large operation between the workers of a mover
+ * shared by the whole process, created when it is needed for the first time.
+ */
+
+#include "alloc.h"
+#include "libpmem2.h"
+#include "mover.h"
+#include "out.h"
+#include "pmem2_utils.h"
+#include "uring.h"
+#include "sys_util.h"
+#include "util.h"
+
+/* smaller operations are not worth waking up the workers */
+#define MOVER_PARALLEL_MIN_LEN (1ULL << 22) /* 4 MiB */
+
+static os_mutex_t Parallel_lock;
+static struct pmem2_mover *Parallel_mover;
+
+/*
+ * pmem2_mover_init -- initialize the shared mover lock
+ */
+void
+pmem2_mover_init(void)
+{
+	util_mutex_init(&Parallel_lock);
+}
+
+/*
+ * pmem2_mover_fini -- release the workers of the shared mover
+ */
+void
+pmem2_mover_fini(void)
+{
+	pmem2_mover_delete(&Parallel_mover);
+	util_mutex_destroy(&Parallel_lock);
+}
+
+/*
+ * pmem2_mover_new -- create a mover backed by nthreads worker threads
+ */
+int
+pmem2_mover_new(struct pmem2_mover **mover, unsigned nthreads)
+{
+	LOG(3, "mover %p nthreads %u", mover, nthreads);
+	PMEM2_ERR_CLR();
+
+	*mover = NULL;
+
+	int ret;
+	struct pmem2_mover *m = pmem2_malloc(sizeof(*m), &ret);
+	if (ret)
+		return ret;
+
+	ret = pmem2_mover_cpu_init(m, nthreads);
+	if (ret) {
+		Free(m);
+		return ret;
+	}
+
+	*mover = m;
+
+	return 0;
+}
+
+/*
+ * pmem2_mover_delete -- wait for all submitted futures to be executed and
+ * delete the mover
+ */
+int
+pmem2_mover_delete(struct pmem2_mover **mover)
+{
+	LOG(3, "mover %p", mover);
+	PMEM2_ERR_CLR();
+
+	struct pmem2_mover *m = *mover;
+	if (m == NULL)
+		return 0;
+
+	m->ops->delete(m);
+	Free(m);
+	*mover = NULL;
+
+	return 0;
+}
+
+/*
+ * mover_check_range -- (internal) check if the destination of an operation
+ * lies within the mapping
+ */
+static int
+mover_check_range(struct pmem2_map *map, const void *dest, size_t len)
+{
+	uintptr_t map_addr = (uintptr_t)map->addr;
+	uintptr_t map_end = map_addr + map->content_length;
+	uintptr_t addr = (uintptr_t)dest;
+
+	if (addr < map_addr || addr > map_end || len > map_end - addr) {
+		ERR("destination ptr %p size %zu exceeds map range %p",
+			dest, len, map);
+		return PMEM2_E_ASYNC_RANGE;
+	}
+
+	return 0;
+}
+
+/*
+ * mover_future_new -- (internal) allocate a future for nops operations
+ */
+static struct pmem2_future *
+mover_future_new(struct pmem2_map *map, size_t nops, unsigned flags,
+		int *err)
+{
+	struct pmem2_future *f = pmem2_malloc(sizeof(*f), err);
+	if (*err)
+		return NULL;
+
+	if (nops > 1) {
+		if (nops > SIZE_MAX / sizeof(struct pmem2_mover_op)) {
+			ERR("too many operations in a batch: %zu", nops);
+			Free(f);
+			*err = PMEM2_E_LENGTH_OUT_OF_RANGE;
+			return NULL;
+		}
+
+		f->ops = pmem2_malloc(nops * sizeof(struct pmem2_mover_op),
+				err);
+		if (*err) {
+			Free(f);
+			return NULL;
+		}
+	} else {
+		f->ops = &f->op;
+	}
+
+	f->map = map;
+	f->flags = flags;
+	f->nops = nops;
+	f->backend_data = NULL;
+	f->complete = 0;
+	util_mutex_init(&f->lock);
+	util_cond_init(&f->cond);
+
+	return f;
+}
+
+/*
+ * mover_future_free -- (internal) release a future
+ */
+static void
+mover_future_free(struct pmem2_future *f)
+{
+	util_cond_destroy(&f->cond);
+	util_mutex_destroy(&f->lock);
+	if (f->ops != &f->op)
+		Free(f->ops);
+	Free(f);
+}
+
+/*
+ * mover_submit -- (internal) pass the future to the backend
+ */
+static int
+mover_submit(struct pmem2_mover *mover, struct pmem2_future *f,
+		struct pmem2_future **future)
+{
+	int ret = mover->ops->submit(mover, f);
+	if (ret) {
+		mover_future_free(f);
+		return ret;
+	}
+
+	*future = f;
+
+	return 0;
+}
+
+/*
+ * pmem2_memcpy_async -- copy len bytes from src to pmemdest in the background
+ */
+int
+pmem2_memcpy_async(struct pmem2_mover *mover, struct pmem2_map *map,
+		void *pmemdest, const void *src, size_t len, unsigned flags,
+		struct pmem2_future **future)
+{
+	LOG(3, "mover %p map %p pmemdest %p src %p len %zu flags 0x%x",
+		mover, map, pmemdest, src, len, flags);
+	PMEM2_ERR_CLR();
+
+	*future = NULL;
+
+	int ret = mover_check_range(map, pmemdest, len);
+	if (ret)
+		return ret;
+
+	struct pmem2_future *f = mover_future_new(map, 1, flags, &ret);
+	if (ret)
+		return ret;
+
+	f->op.type = PMEM2_MOVER_OP_MEMCPY;
+	f->op.dest = pmemdest;
+	f->op.src = src;
+	f->op.c = 0;
+	f->op.len = len;
+
+	return mover_submit(mover, f, future);
+}
+
+/*
+ * pmem2_memset_async -- fill len bytes at pmemdest with c in the background
+ */
+int
+pmem2_memset_async(struct pmem2_mover *mover, struct pmem2_map *map,
+		void *pmemdest, int c, size_t len, unsigned flags,
+		struct pmem2_future **future)
+{
+	LOG(3, "mover %p map %p pmemdest %p c %d len %zu flags 0x%x",
+		mover, map, pmemdest, c, len, flags);
+	PMEM2_ERR_CLR();
+
+	*future = NULL;
+
+	int ret = mover_check_range(map, pmemdest, len);
+	if (ret)
+		return ret;
+
+	struct pmem2_future *f = mover_future_new(map, 1, flags, &ret);
+	if (ret)
+		return ret;
+
+	f->op.type = PMEM2_MOVER_OP_MEMSET;
+	f->op.dest = pmemdest;
+	f->op.src = NULL;
+	f->op.c = c;
+	f->op.len = len;
+
+	return mover_submit(mover, f, future);
+}
+
+/*
+ * pmem2_memcpy_async_batch -- do all the copies described by descs in the
+ * background, with a single future tracking their completion
+ */
+int
+pmem2_memcpy_async_batch(struct pmem2_mover *mover, struct pmem2_map *map,
+		const struct pmem2_memcpy_desc *descs, size_t ndescs,
+		unsigned flags, struct pmem2_future **future)
+{
+	LOG(3, "mover %p map %p descs %p ndescs %zu flags 0x%x",
+		mover, map, descs, ndescs, flags);
+	PMEM2_ERR_CLR();
+
+	*future = NULL;
+
+	int ret;
+	for (size_t i = 0; i < ndescs; ++i) {
+		ret = mover_check_range(map, descs[i].pmemdest, descs[i].len);
+		if (ret)
+			return ret;
+	}
+
+	struct pmem2_future *f = mover_future_new(map, ndescs, flags, &ret);
+	if (ret)
+		return ret;
+
+	for (size_t i = 0; i < ndescs; ++i) {
+		f->ops[i].type = PMEM2_MOVER_OP_MEMCPY;
+		f->ops[i].dest = descs[i].pmemdest;
+		f->ops[i].src = descs[i].src;
+		f->ops[i].c = 0;
+		f->ops[i].len = descs[i].len;
+	}
+
+	return mover_submit(mover, f, future);
+}
+
+/*
+ * pmem2_persist_async -- make the range durable in the background
+ */
+int
+pmem2_persist_async(struct pmem2_mover *mover, struct pmem2_map *map,
+		const void *ptr, size_t size, struct pmem2_future **future)
+{
+	LOG(3, "mover %p map %p ptr %p size %zu", mover, map, ptr, size);
+	PMEM2_ERR_CLR();
+
+	*future = NULL;
+
+	int ret = mover_check_range(map, ptr, size);
+	if (ret)
+		return ret;
+
+	struct pmem2_future *f = mover_future_new(map, 1, 0, &ret);
+	if (ret)
+		return ret;
+
+	f->op.type = PMEM2_MOVER_OP_PERSIST;
+	f->op.dest = (void *)ptr;
+	f->op.src = NULL;
+	f->op.c = 0;
+	f->op.len = size;
+
+	if (map->effective_granularity != PMEM2_GRANULARITY_PAGE) {
+		/* flushing CPU caches is cheaper than waking up a worker */
+		map->persist_fn(ptr, size);
+		pmem2_mover_future_complete(f);
+		*future = f;
+		return 0;
+	}
+
+	ret = pmem2_uring_persist(f);
+	if (ret == 0) {
+		*future = f;
+		return 0;
+	}
+
+	if (ret != PMEM2_E_NOSUPP) {
+		mover_future_free(f);
+		return ret;
+	}
+
+	/* the msync is done by a worker of the mover */
+	return mover_submit(mover, f, future);
+}
+
+/*
+ * mover_parallel_exec -- (internal) do the operation using the workers of
+ * the shared mover and wait for it to finish
+ */
+static int
+mover_parallel_exec(struct pmem2_future *f)
+{
+	int ret = 0;
+
+	util_mutex_lock(&Parallel_lock);
+	if (Parallel_mover == NULL)
+		ret = pmem2_mover_new(&Parallel_mover, 0);
+	util_mutex_unlock(&Parallel_lock);
+
+	if (ret) {
+		mover_future_free(f);
+		return ret;
+	}
+
+	ret = mover_submit(Parallel_mover, f, &f);
+	if (ret)
+		return ret;
+
+	return pmem2_future_wait(&f);
+}
+
+/*
+ * pmem2_memcpy_parallel -- copy len bytes from src to pmemdest using several
+ * threads
+ */
+int
+pmem2_memcpy_parallel(struct pmem2_map *map, void *pmemdest, const void *src,
+		size_t len, unsigned flags)
+{
+	LOG(3, "map %p pmemdest %p src %p len %zu flags 0x%x",
+		map, pmemdest, src, len, flags);
+	PMEM2_ERR_CLR();
+
+	int ret = mover_check_range(map, pmemdest, len);
+	if (ret)
+		return ret;
+
+	if (len < MOVER_PARALLEL_MIN_LEN) {
+		map->memcpy_fn(pmemdest, src, len, flags);
+		return 0;
+	}
+
+	struct pmem2_future *f = mover_future_new(map, 1, flags, &ret);
+	if (ret)
+		return ret;
+
+	f->op.type = PMEM2_MOVER_OP_MEMCPY;
+	f->op.dest = pmemdest;
+	f->op.src = src;
+	f->op.c = 0;
+	f->op.len = len;
+
+	return mover_parallel_exec(f);
+}
+
+/*
+ * pmem2_memset_parallel -- fill len bytes at pmemdest with c using several
+ * threads
+ */
+int
+pmem2_memset_parallel(struct pmem2_map *map, void *pmemdest, int c,
+		size_t len, unsigned flags)
+{
+	LOG(3, "map %p pmemdest %p c %d len %zu flags 0x%x",
+		map, pmemdest, c, len, flags);
+	PMEM2_ERR_CLR();
+
+	int ret = mover_check_range(map, pmemdest, len);
+	if (ret)
+		return ret;
+
+	if (len < MOVER_PARALLEL_MIN_LEN) {
+		map->memset_fn(pmemdest, c, len, flags);
+		return 0;
+	}
+
+	struct pmem2_future *f = mover_future_new(map, 1, flags, &ret);
+	if (ret)
+		return ret;
+
+	f->op.type = PMEM2_MOVER_OP_MEMSET;
+	f->op.dest = pmemdest;
+	f->op.src = NULL;
+	f->op.c = c;
+	f->op.len = len;
+
+	return mover_parallel_exec(f);
+}
+
+/*
+ * pmem2_mover_future_complete -- mark the future as complete and wake up
+ * its waiters
+ */
+void
+pmem2_mover_future_complete(struct pmem2_future *future)
+{
+	util_mutex_lock(&future->lock);
+	util_atomic_store_explicit32(&future->complete, 1,
+		memory_order_release);
+	os_cond_broadcast(&future->cond);
+	util_mutex_unlock(&future->lock);
+}
+
+/*
+ * pmem2_future_poll -- check if all the operations of the future are done
+ */
+int
+pmem2_future_poll(struct pmem2_future *future)
+{
+	LOG(15, "future %p", future);
+	/* we do not need to clear err because this function cannot fail */
+
+	int complete;
+	util_atomic_load_explicit32(&future->complete, &complete,
+		memory_order_acquire);
+
+	return complete;
+}
+
+/*
+ * pmem2_future_wait -- wait for the operations of the future to be done and
+ * delete the future
+ */
+int
+pmem2_future_wait(struct pmem2_future **future)
+{
+	LOG(3, "future %p", future);
+	PMEM2_ERR_CLR();
+
+	struct pmem2_future *f = *future;
+	if (f == NULL)
+		return 0;
+
+	util_mutex_lock(&f->lock);
+	while (!f->complete)
+		os_cond_wait(&f->cond, &f->lock);
+	util_mutex_unlock(&f->lock);
+
+	mover_future_free(f);
+	*future = NULL;
+
+	return 0;
+}
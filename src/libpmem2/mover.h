@@ -0,0 +1,88 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright 2020, Intel Corporation */
+
+/*
+ * mover.h -- internal definitions for asynchronous data movement
+ */
+
+#ifndef PMEM2_MOVER_H
+#define PMEM2_MOVER_H 1
+
+#include "map.h"
+#include "os_thread.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum pmem2_mover_op_type {
+	PMEM2_MOVER_OP_MEMCPY,
+	PMEM2_MOVER_OP_MEMSET,
+	PMEM2_MOVER_OP_PERSIST,
+};
+
+/*
+ * pmem2_mover_op -- a single memcpy, memset or persist requested by the user
+ */
+struct pmem2_mover_op {
+	enum pmem2_mover_op_type type;
+	void *dest;
+	const void *src; /* used only by memcpy */
+	int c; /* used only by memset */
+	size_t len;
+};
+
+struct pmem2_future {
+	struct pmem2_map *map;
+	unsigned flags;
+
+	size_t nops;
+	struct pmem2_mover_op *ops;
+
+	/* owned by the backend until it completes the future */
+	void *backend_data;
+
+	int complete;
+	os_mutex_t lock;
+	os_cond_t cond;
+
+	/* storage for the only operation of a non-batched future */
+	struct pmem2_mover_op op;
+};
+
+/*
+ * pmem2_mover_ops -- backend of a mover
+ *
+ * The CPU worker pool in mover_cpu.c is the reference implementation,
+ * an offload engine (e.g. a DMA controller) can be plugged in by providing
+ * another set of these operations.
+ */
+struct pmem2_mover_ops {
+	/*
+	 * start executing the future, pmem2_mover_future_complete() has to be
+	 * called once all its operations are done and the backend does not
+	 * need the future anymore
+	 */
+	int (*submit)(struct pmem2_mover *mover, struct pmem2_future *future);
+
+	/* finish the submitted futures and release the backend */
+	void (*delete)(struct pmem2_mover *mover);
+};
+
+struct pmem2_mover {
+	const struct pmem2_mover_ops *ops;
+	void *backend_data;
+};
+
+void pmem2_mover_init(void);
+void pmem2_mover_fini(void);
+
+void pmem2_mover_future_complete(struct pmem2_future *future);
+
+int pmem2_mover_cpu_init(struct pmem2_mover *mover, unsigned nthreads);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,371 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2020, Intel Corporation */
+
+/*
+ * mover_cpu.c -- mover backend executing the operations on worker threads
+ *
+ * Every operation is split into chunks ending at addresses aligned to the
+ * chunk size, so that no two workers write to the same page or cache line.
+ * The chunks are put on a single queue
+ * shared by all the workers, so that a large copy is done by several threads
+ * in parallel and a batch of small ones does not wait behind a single large
+ * operation longer than it takes to copy one chunk. The last worker to finish
+ * a chunk of a future completes it.
+ *
+ * On a multi-socket system a worker moves itself to the NUMA node of
+ * the memory it writes to, since stores to a remote node are much slower.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+
+#include "alloc.h"
+#include "libpmem2.h"
+#include "mover.h"
+#include "out.h"
+#include "pmem2_utils.h"
+#include "sys_util.h"
+#include "util.h"
+
+/* size of the largest piece of an operation done by a single worker */
+#define MOVER_CPU_CHUNK_SIZE (1ULL << 21) /* 2 MiB */
+
+/* the default number of workers, more are unlikely to add any bandwidth */
+#define MOVER_CPU_MAX_DEFAULT_THREADS 4
+
+/*
+ * mover_cpu_chunk -- a part of an operation done by a single worker
+ */
+struct mover_cpu_chunk {
+	struct mover_cpu_chunk *next;
+	struct pmem2_future *future;
+	const struct pmem2_mover_op *op;
+	size_t offset;
+	size_t len;
+};
+
+/*
+ * mover_cpu_job -- the chunks of a submitted future
+ */
+struct mover_cpu_job {
+	uint64_t pending; /* the number of chunks not done yet */
+	size_t nchunks;
+	struct mover_cpu_chunk chunks[];
+};
+
+struct mover_cpu {
+	os_mutex_t lock;
+	os_cond_t cond; /* signaled when chunks are queued or on stop */
+
+	/* queue of the chunks waiting for a worker */
+	struct mover_cpu_chunk *head;
+	struct mover_cpu_chunk *tail;
+
+	int stop;
+	int numa; /* bind the workers to the node of the destination */
+
+	unsigned nthreads;
+	os_thread_t *threads;
+};
+
+/*
+ * mover_cpu_chunk_exec -- (internal) do the part of an operation described
+ * by the chunk
+ */
+static void
+mover_cpu_chunk_exec(struct mover_cpu_chunk *chunk)
+{
+	struct pmem2_future *f = chunk->future;
+	const struct pmem2_mover_op *op = chunk->op;
+	char *dest = (char *)op->dest + chunk->offset;
+
+	/*
+	 * The caller has no way to drain the stores done by a worker,
+	 * so every worker drains its own before the chunk counts as done.
+	 */
+	unsigned flags = f->flags & ~PMEM2_F_MEM_NODRAIN;
+
+	switch (op->type) {
+		case PMEM2_MOVER_OP_MEMCPY:
+			f->map->memcpy_fn(dest,
+				(const char *)op->src + chunk->offset,
+				chunk->len, flags);
+			break;
+		case PMEM2_MOVER_OP_MEMSET:
+			f->map->memset_fn(dest, op->c, chunk->len, flags);
+			break;
+		case PMEM2_MOVER_OP_PERSIST:
+			f->map->persist_fn(dest, chunk->len);
+			break;
+		default:
+			ASSERT(0);
+	}
+}
+
+/*
+ * mover_cpu_bind -- (internal) move the calling worker to the NUMA node of
+ * the destination of the chunk, node is the one it is currently bound to
+ *
+ * The node of a mapping whose pages were placed according to its config is
+ * known, so the lookup of the node of the memory is not needed for every
+ * chunk.
+ */
+static void
+mover_cpu_bind(struct mover_cpu_chunk *chunk, unsigned *node)
+{
+	const char *dest = (const char *)chunk->op->dest + chunk->offset;
+	int map_node = chunk->future->map->numa_node;
+
+	unsigned n;
+	if (map_node != PMEM2_NUMA_NODE_ANY)
+		n = (unsigned)map_node;
+	else if (os_numa_node_of_addr(dest, &n) != 0)
+		return;
+
+	if (n == *node)
+		return;
+
+	if (os_thread_bind_numa_node(n) != 0) {
+		LOG(2, "cannot bind mover worker to node %u", n);
+		return;
+	}
+
+	*node = n;
+}
+
+/*
+ * mover_cpu_worker -- (internal) worker thread routine
+ */
+static void *
+mover_cpu_worker(void *arg)
+{
+	struct mover_cpu *mc = arg;
+	unsigned node = UINT_MAX;
+
+	util_mutex_lock(&mc->lock);
+
+	while (1) {
+		while (mc->head == NULL && !mc->stop)
+			os_cond_wait(&mc->cond, &mc->lock);
+
+		/* the queued chunks are finished even when stopping */
+		struct mover_cpu_chunk *chunk = mc->head;
+		if (chunk == NULL)
+			break;
+
+		mc->head = chunk->next;
+		if (mc->head == NULL)
+			mc->tail = NULL;
+
+		util_mutex_unlock(&mc->lock);
+
+		if (mc->numa)
+			mover_cpu_bind(chunk, &node);
+
+		mover_cpu_chunk_exec(chunk);
+
+		struct pmem2_future *f = chunk->future;
+		struct mover_cpu_job *job = f->backend_data;
+		if (util_fetch_and_sub64(&job->pending, 1) == 1) {
+			/* no other worker refers to the job anymore */
+			f->backend_data = NULL;
+			Free(job);
+			pmem2_mover_future_complete(f);
+		}
+
+		util_mutex_lock(&mc->lock);
+	}
+
+	util_mutex_unlock(&mc->lock);
+
+	return NULL;
+}
+
+/*
+ * mover_cpu_nchunks -- (internal) returns the number of chunks of
+ * the operation
+ */
+static size_t
+mover_cpu_nchunks(const struct pmem2_mover_op *op)
+{
+	if (op->len == 0)
+		return 0;
+
+	uintptr_t begin = (uintptr_t)op->dest;
+
+	return (ALIGN_UP(begin + op->len, MOVER_CPU_CHUNK_SIZE) -
+		ALIGN_DOWN(begin, MOVER_CPU_CHUNK_SIZE)) / MOVER_CPU_CHUNK_SIZE;
+}
+
+/*
+ * mover_cpu_submit -- (internal) split the operations of the future into
+ * chunks and queue them
+ */
+static int
+mover_cpu_submit(struct pmem2_mover *mover, struct pmem2_future *future)
+{
+	struct mover_cpu *mc = mover->backend_data;
+
+	size_t nchunks = 0;
+	for (size_t i = 0; i < future->nops; ++i)
+		nchunks += mover_cpu_nchunks(&future->ops[i]);
+
+	if (nchunks == 0) {
+		pmem2_mover_future_complete(future);
+		return 0;
+	}
+
+	if (nchunks > (SIZE_MAX - sizeof(struct mover_cpu_job)) /
+			sizeof(struct mover_cpu_chunk)) {
+		ERR("too many chunks: %zu", nchunks);
+		return PMEM2_E_LENGTH_OUT_OF_RANGE;
+	}
+
+	int ret;
+	struct mover_cpu_job *job = pmem2_malloc(sizeof(*job) +
+			nchunks * sizeof(struct mover_cpu_chunk), &ret);
+	if (ret)
+		return ret;
+
+	job->pending = nchunks;
+	job->nchunks = nchunks;
+
+	struct mover_cpu_chunk *chunk = job->chunks;
+	for (size_t i = 0; i < future->nops; ++i) {
+		const struct pmem2_mover_op *op = &future->ops[i];
+		size_t off = 0;
+		while (off < op->len) {
+			uintptr_t addr = (uintptr_t)op->dest + off;
+			size_t len = ALIGN_DOWN(addr + MOVER_CPU_CHUNK_SIZE,
+				MOVER_CPU_CHUNK_SIZE) - addr;
+			len = MIN(op->len - off, len);
+
+			chunk->future = future;
+			chunk->op = op;
+			chunk->offset = off;
+			chunk->len = len;
+			chunk->next = chunk + 1;
+			chunk++;
+
+			off += len;
+		}
+	}
+
+	ASSERTeq((size_t)(chunk - job->chunks), nchunks);
+
+	struct mover_cpu_chunk *last = &job->chunks[nchunks - 1];
+	last->next = NULL;
+
+	future->backend_data = job;
+
+	util_mutex_lock(&mc->lock);
+
+	if (mc->tail)
+		mc->tail->next = job->chunks;
+	else
+		mc->head = job->chunks;
+	mc->tail = last;
+
+	if (nchunks == 1)
+		os_cond_signal(&mc->cond);
+	else
+		os_cond_broadcast(&mc->cond);
+
+	util_mutex_unlock(&mc->lock);
+
+	return 0;
+}
+
+/*
+ * mover_cpu_stop -- (internal) stop and join the first nthreads workers
+ */
+static void
+mover_cpu_stop(struct mover_cpu *mc, unsigned nthreads)
+{
+	util_mutex_lock(&mc->lock);
+	mc->stop = 1;
+	os_cond_broadcast(&mc->cond);
+	util_mutex_unlock(&mc->lock);
+
+	for (unsigned i = 0; i < nthreads; ++i)
+		os_thread_join(&mc->threads[i], NULL);
+}
+
+/*
+ * mover_cpu_delete -- (internal) finish the queued chunks and release
+ * the workers
+ */
+static void
+mover_cpu_delete(struct pmem2_mover *mover)
+{
+	struct mover_cpu *mc = mover->backend_data;
+
+	mover_cpu_stop(mc, mc->nthreads);
+
+	util_cond_destroy(&mc->cond);
+	util_mutex_destroy(&mc->lock);
+	Free(mc->threads);
+	Free(mc);
+}
+
+static const struct pmem2_mover_ops mover_cpu_ops = {
+	.submit = mover_cpu_submit,
+	.delete = mover_cpu_delete,
+};
+
+/*
+ * pmem2_mover_cpu_init -- set up a mover executing the operations on
+ * nthreads worker threads, 0 picks a default based on the number of CPUs
+ */
+int
+pmem2_mover_cpu_init(struct pmem2_mover *mover, unsigned nthreads)
+{
+	if (nthreads == 0) {
+		long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+		if (ncpus < 1)
+			ncpus = 1;
+		nthreads = (unsigned)MIN(ncpus, MOVER_CPU_MAX_DEFAULT_THREADS);
+	}
+
+	int ret;
+	struct mover_cpu *mc = pmem2_zalloc(sizeof(*mc), &ret);
+	if (ret)
+		return ret;
+
+	mc->threads = pmem2_malloc(nthreads * sizeof(os_thread_t), &ret);
+	if (ret)
+		goto err_free_mc;
+
+	util_mutex_init(&mc->lock);
+	util_cond_init(&mc->cond);
+
+	mc->numa = os_numa_node_count() > 1;
+
+	for (unsigned i = 0; i < nthreads; ++i) {
+		ret = os_thread_create(&mc->threads[i], NULL,
+				mover_cpu_worker, mc);
+		if (ret) {
+			errno = ret;
+			ERR("!os_thread_create");
+			ret = PMEM2_E_ERRNO;
+			mover_cpu_stop(mc, i);
+			goto err_destroy;
+		}
+	}
+
+	mc->nthreads = nthreads;
+
+	mover->ops = &mover_cpu_ops;
+	mover->backend_data = mc;
+
+	return 0;
+
+err_destroy:
+	util_cond_destroy(&mc->cond);
+	util_mutex_destroy(&mc->lock);
+	Free(mc->threads);
+err_free_mc:
+	Free(mc);
+	return ret;
+}
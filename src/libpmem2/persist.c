@@ -17,6 +17,7 @@
 #include "pmem2_arch.h"
 #include "pmem2_utils.h"
 #include "valgrind_internal.h"
+#include "writeback.h"
 
 static struct pmem2_arch_info Info;
 
@@ -77,6 +78,13 @@ pmem2_persist_init(void)
 	Info.flush = NULL;
 	Info.fence = NULL;
 	Info.flush_has_builtin_fence = 0;
+	Info.store_flavor = PMEM2_STORE_FLAVOR_GENERIC;
+	Info.memcpy_mcsafe = NULL;
+	Info.cpu_model = NULL;
+	Info.nkernels = 0;
+	Info.use_kernel = NULL;
+	Info.movnt_threshold = NULL;
+	Info.movnt_threshold_fixed = 0;
 
 	pmem2_arch_init(&Info);
 
@@ -108,6 +116,22 @@ pmem2_persist_init(void)
 			LOG(3, "using generic memset");
 		}
 	}
+
+	/* libc memcpy does not read in the order of addresses */
+	if (Info.memcpy_mcsafe == NULL) {
+		Info.memcpy_mcsafe = memcpy_mcsafe_generic;
+		LOG(3, "using generic machine check safe memcpy");
+	}
+}
+
+/*
+ * pmem2_persist_get_arch_info -- return the architecture-specific functions
+ * used by all the mappings
+ */
+struct pmem2_arch_info *
+pmem2_persist_get_arch_info(void)
+{
+	return &Info;
 }
 
 /*
@@ -254,7 +278,7 @@ pmem2_flush_file_buffers(const void *addr, size_t len, int autorestart)
 /*
  * pmem2_persist_pages -- flush processor cache for the given range
  */
-static void
+void
 pmem2_persist_pages(const void *addr, size_t len)
 {
 	/*
@@ -290,9 +314,24 @@ pmem2_drain_nop(void)
  * pmem2_deep_flush_page -- do nothing - pmem2_persist_fn already did msync
  */
 int
-pmem2_deep_flush_page(struct pmem2_map *map, void *ptr, size_t size)
+pmem2_deep_flush_page(struct pmem2_map *map, void *ptr, size_t size,
+		struct deep_flush_regions *regions)
+{
+	LOG(3, "map %p ptr %p size %zu", map, ptr, size);
+	return 0;
+}
+
+/*
+ * pmem2_deep_flush_writeback -- write back all the ranges flushed so far,
+ * the range to deep flush among them
+ */
+static int
+pmem2_deep_flush_writeback(struct pmem2_map *map, void *ptr, size_t size,
+		struct deep_flush_regions *regions)
 {
 	LOG(3, "map %p ptr %p size %zu", map, ptr, size);
+
+	pmem2_writeback_sync();
 	return 0;
 }
 
@@ -301,7 +340,8 @@ pmem2_deep_flush_page(struct pmem2_map *map, void *ptr, size_t size)
  * to deep_flush for DevDax
  */
 int
-pmem2_deep_flush_cache(struct pmem2_map *map, void *ptr, size_t size)
+pmem2_deep_flush_cache(struct pmem2_map *map, void *ptr, size_t size,
+		struct deep_flush_regions *regions)
 {
 	LOG(3, "map %p ptr %p size %zu", map, ptr, size);
 
@@ -314,7 +354,7 @@ pmem2_deep_flush_cache(struct pmem2_map *map, void *ptr, size_t size)
 	if (type == PMEM2_FTYPE_DEVDAX)
 		pmem2_persist_cpu_cache(ptr, size);
 
-	int ret = pmem2_deep_flush_dax(map, ptr, size);
+	int ret = pmem2_deep_flush_dax(map, ptr, size, regions);
 	if (ret < 0) {
 		LOG(1, "cannot perform deep flush cache for map %p", map);
 		return ret;
@@ -327,7 +367,8 @@ pmem2_deep_flush_cache(struct pmem2_map *map, void *ptr, size_t size)
  * pmem2_deep_flush_byte -- flush cpu cache and perform deep flush for dax
  */
 int
-pmem2_deep_flush_byte(struct pmem2_map *map, void *ptr, size_t size)
+pmem2_deep_flush_byte(struct pmem2_map *map, void *ptr, size_t size,
+		struct deep_flush_regions *regions)
 {
 	LOG(3, "map %p ptr %p size %zu", map, ptr, size);
 
@@ -348,7 +389,7 @@ pmem2_deep_flush_byte(struct pmem2_map *map, void *ptr, size_t size)
 	if (type == PMEM2_FTYPE_DEVDAX)
 		pmem2_persist_cpu_cache(ptr, size);
 
-	int ret = pmem2_deep_flush_dax(map, ptr, size);
+	int ret = pmem2_deep_flush_dax(map, ptr, size, regions);
 	if (ret < 0) {
 		LOG(1, "cannot perform deep flush byte for map %p", map);
 		return ret;
@@ -358,7 +399,8 @@ pmem2_deep_flush_byte(struct pmem2_map *map, void *ptr, size_t size)
 }
 
 /*
- * pmem2_set_flush_fns -- set function pointers related to flushing
+ * pmem2_set_flush_fns -- set function pointers related to flushing and
+ * forget the cached Device DAX region and the write-back mode of the mapping
  */
 void
 pmem2_set_flush_fns(struct pmem2_map *map)
@@ -386,6 +428,8 @@ pmem2_set_flush_fns(struct pmem2_map *map)
 			abort();
 	}
 
+	map->deep_flush_region = 0;
+	map->writeback = PMEM2_WRITEBACK_IMMEDIATE;
 }
 
 /*
@@ -421,6 +465,45 @@ pmem2_get_drain_fn(struct pmem2_map *map)
 	return map->drain_fn;
 }
 
+/*
+ * pmem2_get_store_ops - return the flavor of the inline store primitives
+ * and the functions they fall back to for the pmem2_map
+ */
+void
+pmem2_get_store_ops(struct pmem2_map *map, struct pmem2_store_ops *ops)
+{
+	/* we do not need to clear err because this function cannot fail */
+	enum pmem2_store_flavor flavor = PMEM2_STORE_FLAVOR_GENERIC;
+
+	/*
+	 * The inline stores are invisible to pmemcheck, let it see the flushes
+	 * done by the library instead.
+	 */
+	if (!On_pmemcheck) {
+		switch (map->effective_granularity) {
+			case PMEM2_GRANULARITY_PAGE:
+				break;
+			case PMEM2_GRANULARITY_CACHE_LINE:
+				flavor = Info.store_flavor;
+				break;
+			case PMEM2_GRANULARITY_BYTE:
+				if (Info.store_flavor !=
+						PMEM2_STORE_FLAVOR_GENERIC)
+					flavor = PMEM2_STORE_FLAVOR_NOFLUSH;
+				break;
+			default:
+				ASSERT(0);
+		}
+	}
+
+	LOG(3, "map %p flavor %d", map, flavor);
+
+	ops->flavor = flavor;
+	ops->persist = map->persist_fn;
+	ops->flush = map->flush_fn;
+	ops->drain = map->drain_fn;
+}
+
 /*
  * pmem2_memmove_nonpmem -- mem[move|cpy] followed by an msync
  */
@@ -540,6 +623,349 @@ pmem2_memset_eadr(void *pmemdest, int c, size_t len, unsigned flags)
 	return pmemdest;
 }
 
+/*
+ * Fragments shorter than this are copied with temporal stores by all
+ * the memmove implementations (unless told otherwise), so copying them without
+ * flushing and flushing whole runs of them afterwards does not change how
+ * the data is written.
+ */
+#define MEMV_SMALL_FRAGMENT 256
+
+/*
+ * memv_range -- a range of a vector of copies whose flush is deferred
+ */
+struct memv_range {
+	uintptr_t start;
+	uintptr_t end; /* start == end when the range is empty */
+	uintptr_t align; /* granularity of the flush */
+	flush_func sync;
+};
+
+/*
+ * memv_range_sync -- (internal) flush the deferred range
+ */
+static void
+memv_range_sync(struct memv_range *r)
+{
+	if (r->start == r->end)
+		return;
+
+	r->sync((void *)r->start, r->end - r->start);
+	r->start = r->end = 0;
+}
+
+/*
+ * memv_range_add -- (internal) defer flushing of (addr, addr + len)
+ *
+ * The range is merged with the deferred one if there are no units of flush
+ * in between them, so no unit is flushed more than once.
+ */
+static void
+memv_range_add(struct memv_range *r, const void *addr, size_t len)
+{
+	uintptr_t start = (uintptr_t)addr;
+	uintptr_t end = start + len;
+	size_t a = r->align;
+
+	if (r->start != r->end &&
+			ALIGN_DOWN(start, a) <= ALIGN_UP(r->end, a) &&
+			ALIGN_DOWN(r->start, a) <= ALIGN_UP(end, a)) {
+		r->start = MIN(r->start, start);
+		r->end = MAX(r->end, end);
+		return;
+	}
+
+	memv_range_sync(r);
+	r->start = start;
+	r->end = end;
+}
+
+/*
+ * memv_next -- (internal) return the next copy from the vector, merging
+ * consecutive descriptors with both destinations and sources adjacent when
+ * merge is set
+ */
+static size_t
+memv_next(const struct pmem2_memcpy_desc *descs, size_t ndescs, size_t *i,
+		int merge, char **dest, const char **src)
+{
+	*dest = descs[*i].pmemdest;
+	*src = descs[*i].src;
+	size_t len = descs[*i].len;
+
+	for (++(*i); merge && *i < ndescs; ++(*i)) {
+		if (descs[*i].pmemdest != *dest + len ||
+				descs[*i].src != *src + len)
+			break;
+		len += descs[*i].len;
+	}
+
+	return len;
+}
+
+/*
+ * pmem2_memmovev_common -- do a vector of mem[move|cpy] to pmem with a single
+ * drain at the end
+ */
+static void
+pmem2_memmovev_common(const struct pmem2_memcpy_desc *descs, size_t ndescs,
+		unsigned flags, int merge)
+{
+	/* the temporal stores of small fragments are flushed in runs */
+	int defer = !(flags & (PMEM2_F_MEM_NOFLUSH |
+			PMEM2_F_MEM_NONTEMPORAL | PMEM2_F_MEM_WC));
+	struct memv_range r = {0, 0, CACHELINE_SIZE, Info.flush};
+
+	for (size_t i = 0; i < ndescs; ) {
+		char *dest;
+		const char *src;
+		size_t len = memv_next(descs, ndescs, &i, merge, &dest, &src);
+		if (len == 0)
+			continue;
+
+		if (defer && len < MEMV_SMALL_FRAGMENT) {
+			Info.memmove_nodrain(dest, src, len,
+				flags | PMEM2_F_MEM_NOFLUSH, Info.flush);
+			memv_range_add(&r, dest, len);
+		} else {
+			Info.memmove_nodrain(dest, src, len, flags, Info.flush);
+		}
+	}
+
+	memv_range_sync(&r);
+
+	if ((flags & (PMEM2_F_MEM_NODRAIN | PMEM2_F_MEM_NOFLUSH)) == 0)
+		pmem2_drain();
+}
+
+/*
+ * pmem2_memmovev -- vector of memmoves to pmem
+ */
+static void
+pmem2_memmovev(const struct pmem2_memcpy_desc *descs, size_t ndescs,
+		unsigned flags)
+{
+	PMEM2_API_START("pmem2_memmovev");
+	pmem2_memmovev_common(descs, ndescs, flags, 0);
+	PMEM2_API_END("pmem2_memmovev");
+}
+
+/*
+ * pmem2_memcpyv -- vector of memcpys to pmem
+ */
+static void
+pmem2_memcpyv(const struct pmem2_memcpy_desc *descs, size_t ndescs,
+		unsigned flags)
+{
+	PMEM2_API_START("pmem2_memcpyv");
+	pmem2_memmovev_common(descs, ndescs, flags, 1);
+	PMEM2_API_END("pmem2_memcpyv");
+}
+
+/*
+ * pmem2_memmovev_eadr_common -- do a vector of mem[move|cpy] to pmem,
+ * platform supports eADR
+ */
+static void
+pmem2_memmovev_eadr_common(const struct pmem2_memcpy_desc *descs,
+		size_t ndescs, unsigned flags, int merge)
+{
+	for (size_t i = 0; i < ndescs; ) {
+		char *dest;
+		const char *src;
+		size_t len = memv_next(descs, ndescs, &i, merge, &dest, &src);
+		Info.memmove_nodrain_eadr(dest, src, len, flags, Info.flush);
+	}
+
+	if ((flags & (PMEM2_F_MEM_NODRAIN | PMEM2_F_MEM_NOFLUSH)) == 0)
+		pmem2_drain();
+}
+
+/*
+ * pmem2_memmovev_eadr -- vector of memmoves to pmem, platform supports eADR
+ */
+static void
+pmem2_memmovev_eadr(const struct pmem2_memcpy_desc *descs, size_t ndescs,
+		unsigned flags)
+{
+	PMEM2_API_START("pmem2_memmovev");
+	pmem2_memmovev_eadr_common(descs, ndescs, flags, 0);
+	PMEM2_API_END("pmem2_memmovev");
+}
+
+/*
+ * pmem2_memcpyv_eadr -- vector of memcpys to pmem, platform supports eADR
+ */
+static void
+pmem2_memcpyv_eadr(const struct pmem2_memcpy_desc *descs, size_t ndescs,
+		unsigned flags)
+{
+	PMEM2_API_START("pmem2_memcpyv");
+	pmem2_memmovev_eadr_common(descs, ndescs, flags, 1);
+	PMEM2_API_END("pmem2_memcpyv");
+}
+
+/*
+ * pmem2_memmovev_nonpmem_common -- do a vector of mem[move|cpy] followed by
+ * msyncs of the runs of pages they touched
+ */
+static void
+pmem2_memmovev_nonpmem_common(const struct pmem2_memcpy_desc *descs,
+		size_t ndescs, unsigned flags, int merge, flush_func sync)
+{
+	struct memv_range r = {0, 0, Pagesize, sync};
+
+	for (size_t i = 0; i < ndescs; ) {
+		char *dest;
+		const char *src;
+		size_t len = memv_next(descs, ndescs, &i, merge, &dest, &src);
+		if (len == 0)
+			continue;
+
+		Info.memmove_nodrain(dest, src, len,
+			flags & ~PMEM2_F_MEM_NODRAIN, Info.flush);
+		memv_range_add(&r, dest, len);
+	}
+
+	memv_range_sync(&r);
+}
+
+/*
+ * pmem2_memmovev_nonpmem -- vector of memmoves followed by msyncs
+ */
+static void
+pmem2_memmovev_nonpmem(const struct pmem2_memcpy_desc *descs, size_t ndescs,
+		unsigned flags)
+{
+	PMEM2_API_START("pmem2_memmovev");
+	pmem2_memmovev_nonpmem_common(descs, ndescs, flags, 0,
+			pmem2_persist_pages);
+	PMEM2_API_END("pmem2_memmovev");
+}
+
+/*
+ * pmem2_memcpyv_nonpmem -- vector of memcpys followed by msyncs
+ */
+static void
+pmem2_memcpyv_nonpmem(const struct pmem2_memcpy_desc *descs, size_t ndescs,
+		unsigned flags)
+{
+	PMEM2_API_START("pmem2_memcpyv");
+	pmem2_memmovev_nonpmem_common(descs, ndescs, flags, 1,
+			pmem2_persist_pages);
+	PMEM2_API_END("pmem2_memcpyv");
+}
+
+/*
+ * writeback_sync_fn -- (internal) return the function writing back the data
+ * stored to a mapping in the deferred write-back mode, the write-back is
+ * deferred until the next drain only when asked to skip the drain
+ */
+static flush_func
+writeback_sync_fn(unsigned flags)
+{
+	if (flags & PMEM2_F_MEM_NODRAIN)
+		return pmem2_writeback_flush;
+
+	return pmem2_persist_pages;
+}
+
+/*
+ * pmem2_memmove_writeback -- mem[move|cpy] followed by an msync or
+ * a deferred write-back
+ */
+static void *
+pmem2_memmove_writeback(void *pmemdest, const void *src, size_t len,
+		unsigned flags)
+{
+#ifdef DEBUG
+	if (flags & ~PMEM2_F_MEM_VALID_FLAGS)
+		ERR("invalid flags 0x%x", flags);
+#endif
+	PMEM2_API_START("pmem2_memmove");
+	Info.memmove_nodrain(pmemdest, src, len, flags & ~PMEM2_F_MEM_NODRAIN,
+			Info.flush);
+
+	writeback_sync_fn(flags)(pmemdest, len);
+
+	PMEM2_API_END("pmem2_memmove");
+	return pmemdest;
+}
+
+/*
+ * pmem2_memset_writeback -- memset followed by an msync or a deferred
+ * write-back
+ */
+static void *
+pmem2_memset_writeback(void *pmemdest, int c, size_t len, unsigned flags)
+{
+#ifdef DEBUG
+	if (flags & ~PMEM2_F_MEM_VALID_FLAGS)
+		ERR("invalid flags 0x%x", flags);
+#endif
+	PMEM2_API_START("pmem2_memset");
+	Info.memset_nodrain(pmemdest, c, len, flags & ~PMEM2_F_MEM_NODRAIN,
+			Info.flush);
+
+	writeback_sync_fn(flags)(pmemdest, len);
+
+	PMEM2_API_END("pmem2_memset");
+	return pmemdest;
+}
+
+/*
+ * pmem2_memmovev_writeback -- vector of memmoves followed by msyncs or
+ * a deferred write-back
+ */
+static void
+pmem2_memmovev_writeback(const struct pmem2_memcpy_desc *descs, size_t ndescs,
+		unsigned flags)
+{
+	PMEM2_API_START("pmem2_memmovev");
+	pmem2_memmovev_nonpmem_common(descs, ndescs, flags, 0,
+			writeback_sync_fn(flags));
+	PMEM2_API_END("pmem2_memmovev");
+}
+
+/*
+ * pmem2_memcpyv_writeback -- vector of memcpys followed by msyncs or
+ * a deferred write-back
+ */
+static void
+pmem2_memcpyv_writeback(const struct pmem2_memcpy_desc *descs, size_t ndescs,
+		unsigned flags)
+{
+	PMEM2_API_START("pmem2_memcpyv");
+	pmem2_memmovev_nonpmem_common(descs, ndescs, flags, 1,
+			writeback_sync_fn(flags));
+	PMEM2_API_END("pmem2_memcpyv");
+}
+
+/*
+ * pmem2_set_writeback_fns -- set function pointers of a page granularity
+ * mapping in a deferred write-back mode
+ *
+ * The flushes only record the ranges and the drain writes them back.
+ * The persists, which are expected to be durable on return, still do
+ * an msync of their range right away.
+ */
+void
+pmem2_set_writeback_fns(struct pmem2_map *map)
+{
+	ASSERTeq(map->effective_granularity, PMEM2_GRANULARITY_PAGE);
+
+	map->persist_fn = pmem2_persist_pages;
+	map->flush_fn = pmem2_writeback_flush;
+	map->drain_fn = pmem2_writeback_drain;
+	map->deep_flush_fn = pmem2_deep_flush_writeback;
+
+	map->memmove_fn = pmem2_memmove_writeback;
+	map->memcpy_fn = pmem2_memmove_writeback;
+	map->memset_fn = pmem2_memset_writeback;
+	map->memmovev_fn = pmem2_memmovev_writeback;
+	map->memcpyv_fn = pmem2_memcpyv_writeback;
+}
+
 /*
  * pmem2_set_mem_fns -- set function pointers related to mem[move|cpy|set]
  */
@@ -551,21 +977,28 @@ pmem2_set_mem_fns(struct pmem2_map *map)
 			map->memmove_fn = pmem2_memmove_nonpmem;
 			map->memcpy_fn = pmem2_memmove_nonpmem;
 			map->memset_fn = pmem2_memset_nonpmem;
+			map->memmovev_fn = pmem2_memmovev_nonpmem;
+			map->memcpyv_fn = pmem2_memcpyv_nonpmem;
 			break;
 		case PMEM2_GRANULARITY_CACHE_LINE:
 			map->memmove_fn = pmem2_memmove;
 			map->memcpy_fn = pmem2_memmove;
 			map->memset_fn = pmem2_memset;
+			map->memmovev_fn = pmem2_memmovev;
+			map->memcpyv_fn = pmem2_memcpyv;
 			break;
 		case PMEM2_GRANULARITY_BYTE:
 			map->memmove_fn = pmem2_memmove_eadr;
 			map->memcpy_fn = pmem2_memmove_eadr;
 			map->memset_fn = pmem2_memset_eadr;
+			map->memmovev_fn = pmem2_memmovev_eadr;
+			map->memcpyv_fn = pmem2_memcpyv_eadr;
 			break;
 		default:
 			abort();
 	}
 
+	map->deep_flush_region = 0;
 }
 
 /*
@@ -598,6 +1031,26 @@ pmem2_get_memset_fn(struct pmem2_map *map)
 	return map->memset_fn;
 }
 
+/*
+ * pmem2_get_memmovev_fn - return a pointer to a function
+ */
+pmem2_memmovev_fn
+pmem2_get_memmovev_fn(struct pmem2_map *map)
+{
+	/* we do not need to clear err because this function cannot fail */
+	return map->memmovev_fn;
+}
+
+/*
+ * pmem2_get_memcpyv_fn - return a pointer to a function
+ */
+pmem2_memcpyv_fn
+pmem2_get_memcpyv_fn(struct pmem2_map *map)
+{
+	/* we do not need to clear err because this function cannot fail */
+	return map->memcpyv_fn;
+}
+
 #if VG_PMEMCHECK_ENABLED
 /*
  * pmem2_emit_log -- logs library and function names to pmemcheck store log
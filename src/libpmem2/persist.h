@@ -15,12 +15,17 @@
 extern "C" {
 #endif
 
+struct pmem2_arch_info;
+
 void pmem2_persist_init(void);
+struct pmem2_arch_info *pmem2_persist_get_arch_info(void);
 
 int pmem2_flush_file_buffers_os(struct pmem2_map *map, const void *addr,
 		size_t len, int autorestart);
+void pmem2_persist_pages(const void *addr, size_t len);
 void pmem2_set_flush_fns(struct pmem2_map *map);
 void pmem2_set_mem_fns(struct pmem2_map *map);
+void pmem2_set_writeback_fns(struct pmem2_map *map);
 
 #ifdef __cplusplus
 }
@@ -24,6 +24,7 @@ typedef void *(*memmove_nodrain_func)(void *pmemdest, const void *src,
 		size_t len, unsigned flags, flush_func flush);
 typedef void *(*memset_nodrain_func)(void *pmemdest, int c, size_t len,
 		unsigned flags, flush_func flush);
+typedef void (*memcpy_mcsafe_func)(void *dest, const void *src, size_t len);
 
 struct pmem2_arch_info {
 	memmove_nodrain_func memmove_nodrain;
@@ -33,6 +34,30 @@ struct pmem2_arch_info {
 	flush_func flush;
 	fence_func fence;
 	int flush_has_builtin_fence;
+	/* instruction of flush, used by the inline primitives of store.h */
+	enum pmem2_store_flavor store_flavor;
+
+	/*
+	 * Copies from the memory which may be poisoned (see mcsafe.c), it
+	 * reads the source in the order of addresses, one cache line at a time,
+	 * and does not read a line before the previous one is stored.
+	 */
+	memcpy_mcsafe_func memcpy_mcsafe;
+
+	/*
+	 * Optional, used by the calibration (see calibrate.c). The CPU model
+	 * names the cache of the results. There are nkernels families of
+	 * memmove/memset kernels, use_kernel replaces the functions in info
+	 * with the ones of the k-th family and returns its name.
+	 * The non-temporal stores are used for lengths of at least
+	 * *movnt_threshold, which is not to be changed if movnt_threshold_fixed
+	 * is set.
+	 */
+	void (*cpu_model)(char *buf, size_t size);
+	unsigned nkernels;
+	const char *(*use_kernel)(struct pmem2_arch_info *info, unsigned k);
+	size_t *movnt_threshold;
+	int movnt_threshold_fixed;
 };
 
 void pmem2_arch_init(struct pmem2_arch_info *info);
@@ -51,6 +76,7 @@ void *memmove_nodrain_generic(void *pmemdest, const void *src, size_t len,
 		unsigned flags, flush_func flush);
 void *memset_nodrain_generic(void *pmemdest, int c, size_t len, unsigned flags,
 		flush_func flush);
+void memcpy_mcsafe_generic(void *dest, const void *src, size_t len);
 
 #ifdef __cplusplus
 }
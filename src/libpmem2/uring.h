@@ -0,0 +1,35 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright 2020, Intel Corporation */
+
+/*
+ * uring.h -- internal definitions for the asynchronous persists done by
+ * the operating system
+ */
+#ifndef PMEM2_URING_H
+#define PMEM2_URING_H
+
+#include <stddef.h>
+
+#include "config.h"
+#include "map.h"
+#include "mover.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void pmem2_uring_init(void);
+void pmem2_uring_fini(void);
+
+int pmem2_uring_map_init(struct pmem2_map *map, const struct pmem2_config *cfg,
+		int fd, size_t offset);
+void pmem2_uring_map_drain(struct pmem2_map *map);
+void pmem2_uring_map_fini(struct pmem2_map *map);
+
+int pmem2_uring_persist(struct pmem2_future *future);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PMEM2_URING_H */
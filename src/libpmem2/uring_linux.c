@@ -0,0 +1,505 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2020, Intel Corporation */
+
+/*
+ * uring_linux.c -- asynchronous persists of page granularity mappings
+ * done by io_uring
+ *
+ * A persist of a mapping of a file in the page cache is an fdatasync of
+ * the corresponding range of the file, which io_uring can execute while
+ * the application does other work. The requests of all the mappings go to
+ * a single ring, set up with the first request and released with the last
+ * mapping using it, and a thread started on the first request waits for
+ * their completions and completes the futures.
+ *
+ * The mapping does not keep the file descriptor it was created from, so
+ * a duplicate of it is kept for the requests, but only if the config of
+ * the mapping asks for it with PMEM2_ASYNC_PERSIST_OS. If io_uring is not
+ * available, e.g. on an older kernel, when it is disabled or when
+ * the PMEM2_NO_URING environment variable is set to 1, the persists are done
+ * by the workers of the mover instead.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+
+#include "config.h"
+#include "libpmem2.h"
+#include "os.h"
+#include "os_thread.h"
+#include "out.h"
+#include "pmem2_utils.h"
+#include "source.h"
+#include "sys_util.h"
+#include "uring.h"
+#include "util.h"
+
+/* the numbers are the same on all the architectures */
+#ifndef __NR_io_uring_setup
+#define __NR_io_uring_setup 425
+#endif
+#ifndef __NR_io_uring_enter
+#define __NR_io_uring_enter 426
+#endif
+
+/* the maximum number of the requests in flight */
+#define URING_ENTRIES 64
+
+enum uring_state {
+	URING_UNKNOWN, /* not set up yet or released */
+	URING_READY,
+	URING_STOPPING, /* being released after the last mapping was deleted */
+	URING_UNAVAILABLE,
+};
+
+static struct {
+	os_mutex_t lock; /* protects the submission queue and the fields */
+	os_cond_t cond; /* signaled when a request completes or on release */
+
+	enum uring_state state;
+	int fd;
+	unsigned entries;
+	unsigned inflight;
+	unsigned nmaps; /* the number of the mappings using the ring */
+
+	void *sq_ring;
+	size_t sq_ring_size;
+	void *cq_ring;
+	size_t cq_ring_size;
+	struct io_uring_sqe *sqes;
+	size_t sqes_size;
+
+	unsigned *sq_tail;
+	unsigned *sq_mask;
+	unsigned *sq_array;
+
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned *cq_mask;
+	struct io_uring_cqe *cqes;
+
+	int reaper_running;
+	os_thread_t reaper;
+} Uring;
+
+/*
+ * uring_enter -- (internal) io_uring_enter(2) system call
+ */
+static int
+uring_enter(unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+	return (int)syscall(__NR_io_uring_enter, Uring.fd, to_submit,
+			min_complete, flags, NULL, 0);
+}
+
+/*
+ * uring_setup -- (internal) create the ring and map its queues, must be
+ * called with the lock held
+ */
+static void
+uring_setup(void)
+{
+	ASSERTeq(Uring.state, URING_UNKNOWN);
+
+	Uring.state = URING_UNAVAILABLE;
+
+	struct io_uring_params p;
+	memset(&p, 0, sizeof(p));
+
+	int fd = (int)syscall(__NR_io_uring_setup, URING_ENTRIES, &p);
+	if (fd < 0) {
+		LOG(3, "io_uring is not available, errno %d", errno);
+		return;
+	}
+
+	Uring.sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	Uring.cq_ring_size = p.cq_off.cqes +
+			p.cq_entries * sizeof(struct io_uring_cqe);
+	Uring.sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+
+	int single_mmap = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+	if (single_mmap) {
+		Uring.sq_ring_size = MAX(Uring.sq_ring_size,
+				Uring.cq_ring_size);
+		Uring.cq_ring_size = Uring.sq_ring_size;
+	}
+
+	Uring.sq_ring = mmap(NULL, Uring.sq_ring_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	if (Uring.sq_ring == MAP_FAILED)
+		goto err_close;
+
+	if (single_mmap) {
+		Uring.cq_ring = Uring.sq_ring;
+	} else {
+		Uring.cq_ring = mmap(NULL, Uring.cq_ring_size,
+				PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_POPULATE, fd,
+				IORING_OFF_CQ_RING);
+		if (Uring.cq_ring == MAP_FAILED)
+			goto err_unmap_sq;
+	}
+
+	Uring.sqes = mmap(NULL, Uring.sqes_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+	if (Uring.sqes == MAP_FAILED)
+		goto err_unmap_cq;
+
+	char *sq = Uring.sq_ring;
+	Uring.sq_tail = (unsigned *)(sq + p.sq_off.tail);
+	Uring.sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+	Uring.sq_array = (unsigned *)(sq + p.sq_off.array);
+
+	char *cq = Uring.cq_ring;
+	Uring.cq_head = (unsigned *)(cq + p.cq_off.head);
+	Uring.cq_tail = (unsigned *)(cq + p.cq_off.tail);
+	Uring.cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+	Uring.cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+	Uring.fd = fd;
+	Uring.entries = p.sq_entries;
+	Uring.state = URING_READY;
+
+	LOG(3, "io_uring with %u entries set up", Uring.entries);
+
+	return;
+
+err_unmap_cq:
+	if (!single_mmap)
+		munmap(Uring.cq_ring, Uring.cq_ring_size);
+err_unmap_sq:
+	munmap(Uring.sq_ring, Uring.sq_ring_size);
+err_close:
+	LOG(3, "cannot map io_uring queues, errno %d", errno);
+	close(fd);
+}
+
+/*
+ * uring_future_complete -- (internal) complete the future of a persist
+ * whose request finished with the result res
+ */
+static void
+uring_future_complete(struct pmem2_future *f, int res)
+{
+	if (res < 0) {
+		/* e.g. a file system which does not support the request */
+		LOG(2, "asynchronous persist failed with errno %d, retrying",
+			-res);
+		f->map->persist_fn(f->op.dest, f->op.len);
+	}
+
+	pmem2_mover_future_complete(f);
+}
+
+/*
+ * uring_reaper -- (internal) wait for the completions of the requests,
+ * a request with no future stops the thread
+ *
+ * A mapping is not deleted until the requests on it are accounted for,
+ * so it is still mapped when a failed request is retried.
+ */
+static void *
+uring_reaper(void *arg)
+{
+	int stop = 0;
+
+	while (!stop) {
+		if (uring_enter(0, 1, IORING_ENTER_GETEVENTS) < 0 &&
+				errno != EINTR)
+			FATAL("!io_uring_enter");
+
+		unsigned head = *Uring.cq_head;
+		unsigned tail;
+		util_atomic_load_explicit32(Uring.cq_tail, &tail,
+			memory_order_acquire);
+
+		for (; head != tail; ++head) {
+			struct io_uring_cqe *cqe =
+				&Uring.cqes[head & *Uring.cq_mask];
+			struct pmem2_future *f =
+				(struct pmem2_future *)cqe->user_data;
+			struct pmem2_map *map = NULL;
+
+			if (f == NULL) {
+				stop = 1;
+			} else {
+				/* the future may be freed once completed */
+				map = f->map;
+				uring_future_complete(f, cqe->res);
+			}
+
+			util_atomic_store_explicit32(Uring.cq_head, head + 1,
+				memory_order_release);
+
+			util_mutex_lock(&Uring.lock);
+			if (map)
+				map->uring_inflight--;
+			Uring.inflight--;
+			os_cond_broadcast(&Uring.cond);
+			util_mutex_unlock(&Uring.lock);
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * uring_submit -- (internal) queue and submit a single request, must be
+ * called with the lock held
+ */
+static int
+uring_submit(const struct io_uring_sqe *sqe)
+{
+	while (Uring.inflight == Uring.entries)
+		os_cond_wait(&Uring.cond, &Uring.lock);
+
+	unsigned tail = *Uring.sq_tail;
+	unsigned idx = tail & *Uring.sq_mask;
+
+	Uring.sqes[idx] = *sqe;
+	Uring.sq_array[idx] = idx;
+	util_atomic_store_explicit32(Uring.sq_tail, tail + 1,
+		memory_order_release);
+
+	/* without a polling thread the request is consumed by the call */
+	int ret;
+	do {
+		ret = uring_enter(1, 0, 0);
+	} while (ret < 0 && errno == EINTR);
+
+	if (ret != 1) {
+		/* take the request back, the kernel did not see it */
+		util_atomic_store_explicit32(Uring.sq_tail, tail,
+			memory_order_release);
+		if (ret >= 0)
+			errno = EAGAIN;
+		ERR("!io_uring_enter");
+		return PMEM2_E_ERRNO;
+	}
+
+	Uring.inflight++;
+
+	return 0;
+}
+
+/*
+ * pmem2_uring_persist -- submit an fdatasync of the range of the file
+ * corresponding to the only operation of the future
+ */
+int
+pmem2_uring_persist(struct pmem2_future *future)
+{
+	struct pmem2_map *map = future->map;
+	const struct pmem2_mover_op *op = &future->op;
+
+	if (map->uring_fd == INVALID_FD)
+		return PMEM2_E_NOSUPP;
+
+	ASSERTeq(op->type, PMEM2_MOVER_OP_PERSIST);
+
+	uintptr_t begin = ALIGN_DOWN((uintptr_t)op->dest, Pagesize);
+	uintptr_t end = ALIGN_UP((uintptr_t)op->dest + op->len, Pagesize);
+
+	struct io_uring_sqe sqe;
+	memset(&sqe, 0, sizeof(sqe));
+	sqe.opcode = IORING_OP_FSYNC;
+	sqe.fd = map->uring_fd;
+	sqe.fsync_flags = IORING_FSYNC_DATASYNC;
+	sqe.off = map->uring_offset + (begin - (uintptr_t)map->addr);
+	/* 0 means up to the end of the file */
+	sqe.len = end - begin > UINT32_MAX ? 0 : (uint32_t)(end - begin);
+	sqe.user_data = (uint64_t)future;
+
+	int ret = 0;
+
+	util_mutex_lock(&Uring.lock);
+
+	/* the ring is set up with the first request */
+	if (Uring.state == URING_UNKNOWN)
+		uring_setup();
+
+	if (Uring.state != URING_READY) {
+		ret = PMEM2_E_NOSUPP;
+		goto out;
+	}
+
+	if (!Uring.reaper_running) {
+		ret = os_thread_create(&Uring.reaper, NULL, uring_reaper, NULL);
+		if (ret) {
+			errno = ret;
+			ERR("!os_thread_create");
+			ret = PMEM2_E_ERRNO;
+			goto out;
+		}
+		Uring.reaper_running = 1;
+	}
+
+	ret = uring_submit(&sqe);
+	if (ret == 0)
+		map->uring_inflight++;
+
+out:
+	util_mutex_unlock(&Uring.lock);
+
+	return ret;
+}
+
+/*
+ * uring_release -- (internal) stop the thread and release the ring, must be
+ * called with the lock held, which is dropped for the time of the release
+ */
+static void
+uring_release(void)
+{
+	ASSERTeq(Uring.state, URING_READY);
+
+	if (Uring.reaper_running) {
+		struct io_uring_sqe sqe;
+		memset(&sqe, 0, sizeof(sqe));
+		sqe.opcode = IORING_OP_NOP;
+		sqe.user_data = 0;
+
+		/* the thread still uses the ring, so it cannot be released */
+		if (uring_submit(&sqe)) {
+			LOG(2, "cannot stop the io_uring completion thread");
+			return;
+		}
+	}
+
+	Uring.state = URING_STOPPING;
+	util_mutex_unlock(&Uring.lock);
+
+	if (Uring.reaper_running)
+		os_thread_join(&Uring.reaper, NULL);
+
+	munmap(Uring.sqes, Uring.sqes_size);
+	if (Uring.cq_ring != Uring.sq_ring)
+		munmap(Uring.cq_ring, Uring.cq_ring_size);
+	munmap(Uring.sq_ring, Uring.sq_ring_size);
+	close(Uring.fd);
+
+	util_mutex_lock(&Uring.lock);
+	Uring.fd = -1;
+	Uring.reaper_running = 0;
+	Uring.state = URING_UNKNOWN;
+	os_cond_broadcast(&Uring.cond);
+}
+
+/*
+ * pmem2_uring_map_init -- keep a duplicate of the file descriptor of
+ * the page granularity mapping of a regular file for its persists, if
+ * the config asks for them to be done by the operating system
+ */
+int
+pmem2_uring_map_init(struct pmem2_map *map, const struct pmem2_config *cfg,
+		int fd, size_t offset)
+{
+	map->uring_fd = INVALID_FD;
+	map->uring_offset = offset;
+	map->uring_inflight = 0;
+
+	if (cfg->async_persist != PMEM2_ASYNC_PERSIST_OS ||
+			map->effective_granularity != PMEM2_GRANULARITY_PAGE ||
+			map->source.type != PMEM2_SOURCE_FD ||
+			map->source.value.ftype != PMEM2_FTYPE_REG)
+		return 0;
+
+	int ret = 0;
+
+	util_mutex_lock(&Uring.lock);
+
+	while (Uring.state == URING_STOPPING)
+		os_cond_wait(&Uring.cond, &Uring.lock);
+
+	if (Uring.state != URING_UNAVAILABLE) {
+		int dup_fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+		if (dup_fd < 0) {
+			ERR("!fcntl");
+			ret = PMEM2_E_ERRNO;
+		} else {
+			map->uring_fd = dup_fd;
+			Uring.nmaps++;
+		}
+	}
+
+	util_mutex_unlock(&Uring.lock);
+
+	return ret;
+}
+
+/*
+ * pmem2_uring_map_drain -- wait for the requests on the mapping to complete
+ */
+void
+pmem2_uring_map_drain(struct pmem2_map *map)
+{
+	if (map->uring_fd == INVALID_FD)
+		return;
+
+	util_mutex_lock(&Uring.lock);
+	while (map->uring_inflight != 0)
+		os_cond_wait(&Uring.cond, &Uring.lock);
+	util_mutex_unlock(&Uring.lock);
+}
+
+/*
+ * pmem2_uring_map_fini -- close the duplicate of the file descriptor,
+ * the ring is released with the last mapping using it
+ */
+void
+pmem2_uring_map_fini(struct pmem2_map *map)
+{
+	if (map->uring_fd == INVALID_FD)
+		return;
+
+	pmem2_uring_map_drain(map);
+
+	close(map->uring_fd);
+	map->uring_fd = INVALID_FD;
+
+	util_mutex_lock(&Uring.lock);
+	ASSERTne(Uring.nmaps, 0);
+	if (--Uring.nmaps == 0 && Uring.state == URING_READY)
+		uring_release();
+	util_mutex_unlock(&Uring.lock);
+}
+
+/*
+ * pmem2_uring_init -- initialize the ring lock, io_uring is not used if
+ * PMEM2_NO_URING is set to 1
+ */
+void
+pmem2_uring_init(void)
+{
+	util_mutex_init(&Uring.lock);
+	util_cond_init(&Uring.cond);
+
+	Uring.state = URING_UNKNOWN;
+	Uring.fd = -1;
+
+	char *e = os_getenv("PMEM2_NO_URING");
+	if (e && strcmp(e, "1") == 0) {
+		LOG(3, "PMEM2_NO_URING set");
+		Uring.state = URING_UNAVAILABLE;
+	}
+}
+
+/*
+ * pmem2_uring_fini -- release the ring if some mapping was not deleted
+ */
+void
+pmem2_uring_fini(void)
+{
+	util_mutex_lock(&Uring.lock);
+	if (Uring.state == URING_READY)
+		uring_release();
+	util_mutex_unlock(&Uring.lock);
+
+	util_cond_destroy(&Uring.cond);
+	util_mutex_destroy(&Uring.lock);
+}
@@ -0,0 +1,66 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2020, Intel Corporation */
+
+/*
+ * uring_none.c -- asynchronous persists are done by the workers of a mover
+ * on the systems without io_uring
+ */
+
+#include "libpmem2.h"
+#include "source.h"
+#include "uring.h"
+
+/*
+ * pmem2_uring_init -- nothing to initialize
+ */
+void
+pmem2_uring_init(void)
+{
+}
+
+/*
+ * pmem2_uring_fini -- nothing to release
+ */
+void
+pmem2_uring_fini(void)
+{
+}
+
+/*
+ * pmem2_uring_map_init -- the mapping does not need a file descriptor
+ */
+int
+pmem2_uring_map_init(struct pmem2_map *map, const struct pmem2_config *cfg,
+		int fd, size_t offset)
+{
+	map->uring_fd = INVALID_FD;
+	map->uring_offset = offset;
+	map->uring_inflight = 0;
+
+	return 0;
+}
+
+/*
+ * pmem2_uring_map_drain -- there are no requests to wait for
+ */
+void
+pmem2_uring_map_drain(struct pmem2_map *map)
+{
+}
+
+/*
+ * pmem2_uring_map_fini -- nothing to release
+ */
+void
+pmem2_uring_map_fini(struct pmem2_map *map)
+{
+}
+
+/*
+ * pmem2_uring_persist -- not supported
+ */
+int
+pmem2_uring_persist(struct pmem2_future *future)
+{
+	return PMEM2_E_NOSUPP;
+}
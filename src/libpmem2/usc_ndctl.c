@@ -147,3 +147,55 @@ err:
 	ndctl_unref(ctx);
 	return ret;
 }
+
+/*
+ * pmem2_source_numa_node -- returns the NUMA node of the region of the source
+ */
+int
+pmem2_source_numa_node(const struct pmem2_source *src, int *numa_node)
+{
+	LOG(3, "type %d, numa_node %p", src->type, numa_node);
+	PMEM2_ERR_CLR();
+
+	if (src->type == PMEM2_SOURCE_ANON) {
+		ERR("Anonymous source does not have NUMA node");
+		return PMEM2_E_NOSUPP;
+	}
+
+	ASSERTeq(src->type, PMEM2_SOURCE_FD);
+
+	struct ndctl_ctx *ctx;
+	struct ndctl_region *region = NULL;
+	int ret;
+
+	errno = ndctl_new(&ctx) * (-1);
+	if (errno) {
+		ERR("!ndctl_new");
+		return PMEM2_E_ERRNO;
+	}
+
+	ret = pmem2_region_namespace(ctx, src, &region, NULL);
+	if (ret < 0)
+		goto end;
+
+	ret = PMEM2_E_NOSUPP;
+
+	if (region == NULL) {
+		ERR("NUMA node is not supported for this source");
+		goto end;
+	}
+
+	/* the platform does not have to describe the proximity of regions */
+	int node = ndctl_region_get_numa_node(region);
+	if (node < 0) {
+		ERR("NUMA node of the region is not known");
+		goto end;
+	}
+
+	*numa_node = node;
+	ret = 0;
+
+end:
+	ndctl_unref(ctx);
+	return ret;
+}
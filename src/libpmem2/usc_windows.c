@@ -228,3 +228,16 @@ pmem2_source_device_usc(const struct pmem2_source *src, uint64_t *usc)
 
 	return 0;
 }
+
+/*
+ * pmem2_source_numa_node -- the NUMA node of a volume is not exposed
+ * on Windows
+ */
+int
+pmem2_source_numa_node(const struct pmem2_source *src, int *numa_node)
+{
+	PMEM2_ERR_CLR();
+
+	ERR("Getting NUMA node is not supported on this system");
+	return PMEM2_E_NOSUPP;
+}
@@ -16,6 +16,9 @@
 #include <Windows.h>
 #endif
 
+#define MEGABYTE ((uintptr_t)1 << 20)
+#define GIGABYTE ((uintptr_t)1 << 30)
+
 struct pmem2_vm_reservation {
 	struct ravl_interval *itree;
 	void *addr;
@@ -26,6 +29,10 @@ struct pmem2_vm_reservation {
 int vm_reservation_reserve_memory(void *addr, size_t size, void **raddr,
 		size_t *rsize);
 int vm_reservation_release_memory(void *addr, size_t size);
+int vm_reservation_extend_memory(struct pmem2_vm_reservation *rsv,
+		void *addr, size_t size);
+int vm_reservation_shrink_memory(struct pmem2_vm_reservation *rsv,
+		void *addr, size_t size);
 struct ravl_interval *vm_reservation_get_interval_tree(
 		struct pmem2_vm_reservation *rsv);
 
@@ -38,7 +45,12 @@ pmem2_vm_reservation_get_address(struct pmem2_vm_reservation *rsv)
 	LOG(3, "reservation %p", rsv);
 	/* we do not need to clear err because this function cannot fail */
 
-	return rsv->addr;
+	/* the address changes when the reservation is shrunk */
+	util_rwlock_rdlock(&rsv->lock);
+	void *addr = rsv->addr;
+	util_rwlock_unlock(&rsv->lock);
+
+	return addr;
 }
 
 /*
@@ -50,6 +62,30 @@ pmem2_vm_reservation_get_size(struct pmem2_vm_reservation *rsv)
 	LOG(3, "reservation %p", rsv);
 	/* we do not need to clear err because this function cannot fail */
 
+	util_rwlock_rdlock(&rsv->lock);
+	size_t size = rsv->size;
+	util_rwlock_unlock(&rsv->lock);
+
+	return size;
+}
+
+/*
+ * vm_reservation_get_address -- get reservation address, the caller holds
+ * the lock acquired by vm_reservation_acquire
+ */
+void *
+vm_reservation_get_address(struct pmem2_vm_reservation *rsv)
+{
+	return rsv->addr;
+}
+
+/*
+ * vm_reservation_get_size -- get reservation size, the caller holds the lock
+ * acquired by vm_reservation_acquire
+ */
+size_t
+vm_reservation_get_size(struct pmem2_vm_reservation *rsv)
+{
 	return rsv->size;
 }
 
@@ -183,6 +219,113 @@ pmem2_vm_reservation_delete(struct pmem2_vm_reservation **rsv_ptr)
 	return 0;
 }
 
+/*
+ * pmem2_vm_reservation_extend -- extend the reservation in place by the given
+ *                                number of bytes
+ */
+int
+pmem2_vm_reservation_extend(struct pmem2_vm_reservation *rsv, size_t size)
+{
+	LOG(3, "reservation %p size %zu", rsv, size);
+	PMEM2_ERR_CLR();
+
+	if (size % Mmap_align) {
+		ERR("reservation extension size %zu is not a multiple of %llu",
+			size, Mmap_align);
+		return PMEM2_E_LENGTH_UNALIGNED;
+	}
+
+	if (size == 0)
+		return 0;
+
+	util_rwlock_wrlock(&rsv->lock);
+
+	/* the address space right behind the reservation has to be free */
+	void *end = (char *)rsv->addr + rsv->size;
+	int ret = vm_reservation_extend_memory(rsv, end, size);
+	if (!ret)
+		rsv->size += size;
+
+	util_rwlock_unlock(&rsv->lock);
+
+	return ret;
+}
+
+/*
+ * pmem2_vm_reservation_shrink -- release the given range at the beginning
+ *                                or at the end of the reservation
+ */
+int
+pmem2_vm_reservation_shrink(struct pmem2_vm_reservation *rsv, size_t offset,
+		size_t size)
+{
+	LOG(3, "reservation %p offset %zu size %zu", rsv, offset, size);
+	PMEM2_ERR_CLR();
+
+	if (offset % Mmap_align) {
+		ERR("reservation shrink offset %zu is not a multiple of %llu",
+			offset, Mmap_align);
+		return PMEM2_E_OFFSET_UNALIGNED;
+	}
+
+	if (size % Mmap_align) {
+		ERR("reservation shrink size %zu is not a multiple of %llu",
+			size, Mmap_align);
+		return PMEM2_E_LENGTH_UNALIGNED;
+	}
+
+	if (size == 0)
+		return 0;
+
+	util_rwlock_wrlock(&rsv->lock);
+
+	int ret;
+	if (offset >= rsv->size || size > rsv->size - offset) {
+		ERR("range at the offset %zu and length %zu exceeds "
+			"the reservation %p of size %zu",
+			offset, size, rsv, rsv->size);
+		ret = PMEM2_E_OFFSET_OUT_OF_RANGE;
+		goto out;
+	}
+
+	if (offset != 0 && offset + size != rsv->size) {
+		ERR("only the beginning or the end of the reservation "
+			"can be released");
+		ret = PMEM2_E_NOSUPP;
+		goto out;
+	}
+
+	if (size == rsv->size) {
+		ERR("shrinking the whole reservation %p, delete it instead",
+			rsv);
+		ret = PMEM2_E_NOSUPP;
+		goto out;
+	}
+
+	if (vm_reservation_map_find(rsv, offset, size)) {
+		ERR("range at the offset %zu and length %zu of the "
+			"reservation %p is occupied by a mapping",
+			offset, size, rsv);
+		ret = PMEM2_E_VM_RESERVATION_NOT_EMPTY;
+		goto out;
+	}
+
+	ret = vm_reservation_shrink_memory(rsv, (char *)rsv->addr + offset,
+			size);
+	if (ret)
+		goto out;
+
+	/* the mappings are tracked by their addresses, they stay valid */
+	if (offset == 0)
+		rsv->addr = (char *)rsv->addr + size;
+	rsv->size -= size;
+
+out:
+	util_rwlock_unlock(&rsv->lock);
+
+	return ret;
+}
+
 /*
  * vm_reservation_map_register_release -- register mapping in the mappings tree
  * of reservation structure and release previously acquired lock regardless
@@ -251,27 +394,77 @@ vm_reservation_map_find(struct pmem2_vm_reservation *rsv,
 }
 
 /*
- * vm_reservation_map_find_acquire -- find the earliest mapping overlapping
- * with (addr, addr+size) range. This function acquires a lock and keeps it
- * until next release operation.
+ * vm_reservation_place_aligned -- (internal) find the lowest offset of the free
+ * region of the reservation of the given length, aligned to the alignment
  */
-struct pmem2_map *
-vm_reservation_map_find_acquire(struct pmem2_vm_reservation *rsv,
-		size_t reserv_offset, size_t len)
+static int
+vm_reservation_place_aligned(struct pmem2_vm_reservation *rsv, size_t len,
+		size_t alignment, size_t *offset)
 {
-	struct pmem2_map map;
-	map.addr = (char *)rsv->addr + reserv_offset;
-	map.content_length = len;
+	uintptr_t start = (uintptr_t)rsv->addr;
+	uintptr_t end = start + rsv->size;
+	uintptr_t cur = start;
+
+	while (1) {
+		uintptr_t addr = ALIGN_UP(cur, (uintptr_t)alignment);
+		if (addr < cur || addr > end || len > end - addr)
+			return -1;
+
+		/* the earliest mapping in the way, skip past it */
+		struct pmem2_map *map = vm_reservation_map_find(rsv,
+				addr - start, len);
+		if (!map) {
+			*offset = addr - start;
+			return 0;
+		}
+
+		cur = ALIGN_UP((uintptr_t)map->addr + map->content_length,
+				(uintptr_t)Pagesize);
+	}
+}
 
-	struct ravl_interval_node *node;
+/*
+ * vm_reservation_map_place -- choose the offset of the mapping of the given
+ * length in the reservation, the caller holds the lock acquired by
+ * vm_reservation_acquire
+ *
+ * The mappings of at least 2 MiB are placed at 2 MiB (1 GiB, for the ones of
+ * at least 2 GiB) boundaries if there is such a free region, so that they can
+ * be backed by huge pages. Otherwise the alignment required by the source
+ * is enough.
+ */
+int
+vm_reservation_map_place(struct pmem2_vm_reservation *rsv, size_t len,
+		size_t alignment, size_t *offset)
+{
+	size_t huge = 0;
+	if (len >= 2 * GIGABYTE)
+		huge = GIGABYTE;
+	else if (len >= 2 * MEGABYTE)
+		huge = 2 * MEGABYTE;
 
-	util_rwlock_wrlock(&rsv->lock);
-	node = ravl_interval_find(rsv->itree, &map);
+	if (huge > alignment && vm_reservation_place_aligned(rsv, len, huge,
+			offset) == 0)
+		return 0;
 
-	if (!node)
-		return NULL;
+	if (vm_reservation_place_aligned(rsv, len, alignment, offset) == 0)
+		return 0;
 
-	return (struct pmem2_map *)ravl_interval_data(node);
+	ERR("reservation %p has no free region of length %zu aligned to %zu",
+		rsv, len, alignment);
+
+	return PMEM2_E_LENGTH_OUT_OF_RANGE;
+}
+
+/*
+ * vm_reservation_acquire -- acquire the lock of the reservation, which keeps
+ * its mappings, address and size from changing until the next release
+ * operation
+ */
+void
+vm_reservation_acquire(struct pmem2_vm_reservation *rsv)
+{
+	util_rwlock_wrlock(&rsv->lock);
 }
 
 /*
@@ -17,9 +17,11 @@ int vm_reservation_map_unregister_release(struct pmem2_vm_reservation *rsv,
 		struct pmem2_map *map);
 struct pmem2_map *vm_reservation_map_find(struct pmem2_vm_reservation *rsv,
 		size_t reserv_offset, size_t len);
-struct pmem2_map *vm_reservation_map_find_acquire(
-		struct pmem2_vm_reservation *rsv, size_t reserv_offset,
-		size_t len);
+int vm_reservation_map_place(struct pmem2_vm_reservation *rsv, size_t len,
+		size_t alignment, size_t *offset);
+void *vm_reservation_get_address(struct pmem2_vm_reservation *rsv);
+size_t vm_reservation_get_size(struct pmem2_vm_reservation *rsv);
+void vm_reservation_acquire(struct pmem2_vm_reservation *rsv);
 void vm_reservation_release(struct pmem2_vm_reservation *rsv);
 
 #endif /* vm_reservation.h */
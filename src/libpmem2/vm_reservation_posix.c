@@ -16,6 +16,10 @@
 int vm_reservation_reserve_memory(void *addr, size_t size, void **raddr,
 		size_t *rsize);
 int vm_reservation_release_memory(void *addr, size_t size);
+int vm_reservation_extend_memory(struct pmem2_vm_reservation *rsv,
+		void *addr, size_t size);
+int vm_reservation_shrink_memory(struct pmem2_vm_reservation *rsv,
+		void *addr, size_t size);
 
 /*
  * vm_reservation_reserve_memory -- create a blank virual memory mapping
@@ -83,3 +87,29 @@ vm_reservation_release_memory(void *addr, size_t size)
 
 	return 0;
 }
+
+/*
+ * vm_reservation_extend_memory -- reserve the blank virtual memory mapping
+ *                                 right behind the reservation
+ */
+int
+vm_reservation_extend_memory(struct pmem2_vm_reservation *rsv, void *addr,
+		size_t size)
+{
+	void *raddr = NULL;
+	size_t rsize = 0;
+
+	/* the adjacent mappings simply become one */
+	return vm_reservation_reserve_memory(addr, size, &raddr, &rsize);
+}
+
+/*
+ * vm_reservation_shrink_memory -- release the unoccupied part of
+ *                                 the reservation
+ */
+int
+vm_reservation_shrink_memory(struct pmem2_vm_reservation *rsv, void *addr,
+		size_t size)
+{
+	return vm_reservation_release_memory(addr, size);
+}
@@ -16,6 +16,12 @@
 int vm_reservation_reserve_memory(void *addr, size_t size, void **raddr,
 		size_t *rsize);
 int vm_reservation_release_memory(void *addr, size_t size);
+int vm_reservation_extend_memory(struct pmem2_vm_reservation *rsv,
+		void *addr, size_t size);
+int vm_reservation_shrink_memory(struct pmem2_vm_reservation *rsv,
+		void *addr, size_t size);
+int vm_reservation_split(struct pmem2_vm_reservation *rsv, size_t rsv_offset,
+		size_t length);
 struct pmem2_map *vm_reservation_map_find_closest_prior(
 		struct pmem2_vm_reservation *rsv,
 		size_t reserv_offset, size_t len);
@@ -72,6 +78,68 @@ vm_reservation_release_memory(void *addr, size_t size)
 	return 0;
 }
 
+/*
+ * vm_reservation_extend_memory -- reserve the placeholder right behind
+ *                                 the reservation
+ */
+int
+vm_reservation_extend_memory(struct pmem2_vm_reservation *rsv, void *addr,
+		size_t size)
+{
+	void *rsv_addr = vm_reservation_get_address(rsv);
+	size_t rsv_size = vm_reservation_get_size(rsv);
+	void *raddr = NULL;
+	size_t rsize = 0;
+
+	int ret = vm_reservation_reserve_memory(addr, size, &raddr, &rsize);
+	if (ret)
+		return ret;
+
+	/*
+	 * Every unoccupied region of the reservation is a single placeholder,
+	 * so the new one has to be merged with the unoccupied end of
+	 * the reservation, if there is one.
+	 */
+	if (vm_reservation_map_find(rsv, rsv_size - 1, 1))
+		return 0;
+
+	void *merge_addr = rsv_addr;
+	struct pmem2_map *map = vm_reservation_map_find_closest_prior(rsv,
+			rsv_size, 0);
+	if (map)
+		merge_addr = (char *)map->addr + map->reserved_length;
+
+	size_t merge_size = (size_t)((char *)addr + size - (char *)merge_addr);
+	if (!VirtualFree(merge_addr, merge_size,
+			MEM_RELEASE | MEM_COALESCE_PLACEHOLDERS)) {
+		ERR("!!VirtualFree");
+		ret = pmem2_lasterror_to_err();
+		vm_reservation_release_memory(addr, size);
+		return ret;
+	}
+
+	return 0;
+}
+
+/*
+ * vm_reservation_shrink_memory -- release the unoccupied part of
+ *                                 the reservation
+ */
+int
+vm_reservation_shrink_memory(struct pmem2_vm_reservation *rsv, void *addr,
+		size_t size)
+{
+	void *rsv_addr = vm_reservation_get_address(rsv);
+	size_t rsv_offset = (size_t)((char *)addr - (char *)rsv_addr);
+
+	/* cut the range out of the placeholder of the unoccupied region */
+	int ret = vm_reservation_split(rsv, rsv_offset, size);
+	if (ret)
+		return ret;
+
+	return vm_reservation_release_memory(addr, size);
+}
+
 /*
  * vm_reservation_map_find_closest_prior -- find closest mapping neighbor
  *                                          prior to the provided mapping
@@ -82,7 +150,7 @@ vm_reservation_map_find_closest_prior(struct pmem2_vm_reservation *rsv,
 {
 	struct pmem2_map map;
 
-	map.addr = (char *)pmem2_vm_reservation_get_address(rsv) +
+	map.addr = (char *)vm_reservation_get_address(rsv) +
 			reserv_offset;
 	map.content_length = len;
 
@@ -105,7 +173,7 @@ vm_reservation_map_find_closest_later(struct pmem2_vm_reservation *rsv,
 		size_t reserv_offset, size_t len)
 {
 	struct pmem2_map map;
-	map.addr = (char *)pmem2_vm_reservation_get_address(rsv) +
+	map.addr = (char *)vm_reservation_get_address(rsv) +
 			reserv_offset;
 	map.content_length = len;
 
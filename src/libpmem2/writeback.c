@@ -0,0 +1,333 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2020, Intel Corporation */
+
+/*
+ * writeback.c -- deferred write-back of page granularity mappings
+ *
+ * On a mapping of a file in the page cache every flush is an msync, so
+ * an application persisting many small scattered ranges pays a system call
+ * for each of them. In the deferred write-back mode the flushed ranges are
+ * only recorded, rounded to pages, and the drain writes back all of them at
+ * once, after sorting and merging the adjacent and overlapping ones.
+ *
+ * The drain function takes no mapping, so the set of the dirty ranges is
+ * shared by all the mappings of the process. It is also written back when
+ * it grows beyond WRITEBACK_MAX_DIRTY, by the flushing thread itself or,
+ * in the background mode, by a thread which does it periodically as well.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+
+#include "alloc.h"
+#include "libpmem2.h"
+#include "os.h"
+#include "os_thread.h"
+#include "out.h"
+#include "persist.h"
+#include "pmem2_utils.h"
+#include "sys_util.h"
+#include "util.h"
+#include "writeback.h"
+
+/* the initial capacity of the set of the dirty ranges */
+#define WRITEBACK_MIN_RANGES 64
+
+/* the amount of the recorded dirty data that forces a write-back */
+#define WRITEBACK_MAX_DIRTY (1ULL << 26) /* 64 MiB */
+
+/* the period of the write-backs done by the background thread */
+#define WRITEBACK_INTERVAL_MS 100
+
+/*
+ * writeback_range -- a page aligned range of dirty data
+ */
+struct writeback_range {
+	uintptr_t begin;
+	uintptr_t end;
+};
+
+static struct {
+	os_mutex_t lock; /* protects all the fields below but sync_lock */
+	struct writeback_range *ranges;
+	size_t nranges;
+	size_t capacity;
+	size_t dirty; /* the sum of the lengths of the ranges */
+
+	os_mutex_t sync_lock; /* serializes the write-backs */
+
+	os_cond_t cond; /* signaled when too much is dirty or on stop */
+	os_thread_t thread;
+	int running; /* the background thread was started */
+	int stop;
+} Wb;
+
+/*
+ * pmem2_writeback_init -- initialize the set of the dirty ranges
+ */
+void
+pmem2_writeback_init(void)
+{
+	util_mutex_init(&Wb.lock);
+	util_mutex_init(&Wb.sync_lock);
+	util_cond_init(&Wb.cond);
+}
+
+/*
+ * pmem2_writeback_fini -- stop the background thread and release the set
+ * of the dirty ranges
+ */
+void
+pmem2_writeback_fini(void)
+{
+	util_mutex_lock(&Wb.lock);
+	Wb.stop = 1;
+	os_cond_signal(&Wb.cond);
+	util_mutex_unlock(&Wb.lock);
+
+	if (Wb.running)
+		os_thread_join(&Wb.thread, NULL);
+
+	Free(Wb.ranges);
+
+	util_cond_destroy(&Wb.cond);
+	util_mutex_destroy(&Wb.sync_lock);
+	util_mutex_destroy(&Wb.lock);
+}
+
+/*
+ * writeback_range_cmp -- (internal) compare the ranges by their beginnings
+ */
+static int
+writeback_range_cmp(const void *a, const void *b)
+{
+	const struct writeback_range *ra = a;
+	const struct writeback_range *rb = b;
+
+	if (ra->begin < rb->begin)
+		return -1;
+	return ra->begin > rb->begin;
+}
+
+/*
+ * writeback_coalesce -- (internal) sort the ranges and merge the adjacent
+ * and overlapping ones, return the number of the ranges left
+ */
+static size_t
+writeback_coalesce(struct writeback_range *ranges, size_t nranges)
+{
+	if (nranges == 0)
+		return 0;
+
+	qsort(ranges, nranges, sizeof(*ranges), writeback_range_cmp);
+
+	size_t n = 0;
+	for (size_t i = 1; i < nranges; ++i) {
+		if (ranges[i].begin <= ranges[n].end) {
+			ranges[n].end = MAX(ranges[n].end, ranges[i].end);
+		} else {
+			ranges[++n] = ranges[i];
+		}
+	}
+
+	return n + 1;
+}
+
+/*
+ * writeback_reserve -- (internal) make room for one more range, merging
+ * the recorded ones first; must be called with the lock held
+ */
+static int
+writeback_reserve(void)
+{
+	if (Wb.nranges < Wb.capacity)
+		return 0;
+
+	Wb.nranges = writeback_coalesce(Wb.ranges, Wb.nranges);
+
+	Wb.dirty = 0;
+	for (size_t i = 0; i < Wb.nranges; ++i)
+		Wb.dirty += Wb.ranges[i].end - Wb.ranges[i].begin;
+
+	/* grow only if merging did not free a fair part of the set */
+	if (Wb.nranges < Wb.capacity / 2)
+		return 0;
+
+	size_t capacity = MAX(Wb.capacity * 2, WRITEBACK_MIN_RANGES);
+
+	/* the flushes cannot fail, so this is not reported as an error */
+	struct writeback_range *ranges = Realloc(Wb.ranges,
+			capacity * sizeof(*ranges));
+	if (ranges == NULL) {
+		LOG(2, "cannot grow the set of the dirty ranges");
+		return -1;
+	}
+
+	Wb.ranges = ranges;
+	Wb.capacity = capacity;
+
+	return 0;
+}
+
+/*
+ * pmem2_writeback_flush -- record the range to be written back by the next
+ * drain
+ */
+void
+pmem2_writeback_flush(const void *addr, size_t len)
+{
+	LOG(15, "addr %p len %zu", addr, len);
+
+	if (len == 0)
+		return;
+
+	uintptr_t begin = ALIGN_DOWN((uintptr_t)addr, Pagesize);
+	uintptr_t end = ALIGN_UP((uintptr_t)addr + len, Pagesize);
+
+	util_mutex_lock(&Wb.lock);
+
+	struct writeback_range *last = Wb.nranges ?
+			&Wb.ranges[Wb.nranges - 1] : NULL;
+
+	if (last && begin <= last->end && last->begin <= end) {
+		/* the common case of persisting a structure piece by piece */
+		Wb.dirty -= last->end - last->begin;
+		last->begin = MIN(last->begin, begin);
+		last->end = MAX(last->end, end);
+		Wb.dirty += last->end - last->begin;
+	} else if (writeback_reserve() == 0) {
+		Wb.ranges[Wb.nranges].begin = begin;
+		Wb.ranges[Wb.nranges].end = end;
+		Wb.nranges++;
+		Wb.dirty += end - begin;
+	} else {
+		util_mutex_unlock(&Wb.lock);
+
+		/* there's no memory to defer it, so write it back right now */
+		pmem2_persist_pages(addr, len);
+		return;
+	}
+
+	int sync = Wb.dirty >= WRITEBACK_MAX_DIRTY;
+	if (sync && Wb.running) {
+		os_cond_signal(&Wb.cond);
+		sync = 0;
+	}
+
+	util_mutex_unlock(&Wb.lock);
+
+	if (sync)
+		pmem2_writeback_sync();
+}
+
+/*
+ * pmem2_writeback_sync -- write back all the recorded ranges
+ */
+void
+pmem2_writeback_sync(void)
+{
+	LOG(15, NULL);
+
+	/*
+	 * The ranges are taken out of the set, so the other threads can
+	 * record new ones in the meantime, but a drain returns only after
+	 * the write-back of the ranges recorded before it has finished.
+	 */
+	util_mutex_lock(&Wb.sync_lock);
+
+	util_mutex_lock(&Wb.lock);
+	struct writeback_range *ranges = Wb.ranges;
+	size_t nranges = Wb.nranges;
+	Wb.ranges = NULL;
+	Wb.nranges = 0;
+	Wb.capacity = 0;
+	Wb.dirty = 0;
+	util_mutex_unlock(&Wb.lock);
+
+	nranges = writeback_coalesce(ranges, nranges);
+	for (size_t i = 0; i < nranges; ++i) {
+		pmem2_persist_pages((const void *)ranges[i].begin,
+				ranges[i].end - ranges[i].begin);
+	}
+
+	Free(ranges);
+
+	util_mutex_unlock(&Wb.sync_lock);
+}
+
+/*
+ * pmem2_writeback_drain -- write back the ranges recorded by the flushes
+ */
+void
+pmem2_writeback_drain(void)
+{
+	LOG(15, NULL);
+
+	pmem2_writeback_sync();
+}
+
+/*
+ * writeback_worker -- (internal) the routine of the background thread
+ */
+static void *
+writeback_worker(void *arg)
+{
+	util_mutex_lock(&Wb.lock);
+
+	while (!Wb.stop) {
+		struct timespec abstime;
+		os_clock_gettime(CLOCK_REALTIME, &abstime);
+		abstime.tv_nsec += WRITEBACK_INTERVAL_MS * 1000000L;
+		if (abstime.tv_nsec >= 1000000000L) {
+			abstime.tv_sec++;
+			abstime.tv_nsec -= 1000000000L;
+		}
+
+		os_cond_timedwait(&Wb.cond, &Wb.lock, &abstime);
+
+		if (Wb.stop || Wb.nranges == 0)
+			continue;
+
+		util_mutex_unlock(&Wb.lock);
+		pmem2_writeback_sync();
+		util_mutex_lock(&Wb.lock);
+	}
+
+	util_mutex_unlock(&Wb.lock);
+
+	return NULL;
+}
+
+/*
+ * pmem2_writeback_enable -- switch the page granularity mapping to
+ * the given write-back mode, starting the background thread if needed
+ */
+int
+pmem2_writeback_enable(struct pmem2_map *map, enum pmem2_writeback writeback)
+{
+	ASSERTeq(map->effective_granularity, PMEM2_GRANULARITY_PAGE);
+
+	if (writeback == PMEM2_WRITEBACK_BACKGROUND) {
+		int ret = 0;
+
+		util_mutex_lock(&Wb.lock);
+		if (!Wb.running) {
+			ret = os_thread_create(&Wb.thread, NULL,
+					writeback_worker, NULL);
+			if (ret == 0)
+				Wb.running = 1;
+		}
+		util_mutex_unlock(&Wb.lock);
+
+		if (ret) {
+			errno = ret;
+			ERR("!os_thread_create");
+			return PMEM2_E_ERRNO;
+		}
+	}
+
+	map->writeback = writeback;
+	pmem2_set_writeback_fns(map);
+
+	return 0;
+}
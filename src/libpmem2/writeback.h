@@ -0,0 +1,34 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright 2020, Intel Corporation */
+
+/*
+ * writeback.h -- internal definitions for the deferred write-back of
+ * page granularity mappings
+ */
+#ifndef PMEM2_WRITEBACK_H
+#define PMEM2_WRITEBACK_H
+
+#include <stddef.h>
+
+#include "libpmem2.h"
+#include "map.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void pmem2_writeback_init(void);
+void pmem2_writeback_fini(void);
+
+int pmem2_writeback_enable(struct pmem2_map *map,
+		enum pmem2_writeback writeback);
+
+void pmem2_writeback_flush(const void *addr, size_t len);
+void pmem2_writeback_drain(void);
+void pmem2_writeback_sync(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PMEM2_WRITEBACK_H */
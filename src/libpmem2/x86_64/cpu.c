@@ -13,6 +13,7 @@
  * https://support.amd.com/TechDocs/24594.pdf
  */
 
+#include <stdio.h>
 #include <string.h>
 
 #include "out.h"
@@ -113,6 +114,44 @@ is_cpu_genuine_intel(void)
 				sizeof(vendor.name))) == 0;
 }
 
+/*
+ * cpu_get_model -- write the vendor, family, model and stepping of the CPU
+ * to buf
+ */
+void
+cpu_get_model(char *buf, size_t size)
+{
+	unsigned cpuinfo[4] = { 0 };
+
+	union {
+		char name[0x20];
+		unsigned cpuinfo[3];
+	} vendor;
+
+	memset(&vendor, 0, sizeof(vendor));
+
+	cpuid(0x0, 0x0, cpuinfo);
+
+	vendor.cpuinfo[0] = cpuinfo[EBX_IDX];
+	vendor.cpuinfo[1] = cpuinfo[EDX_IDX];
+	vendor.cpuinfo[2] = cpuinfo[ECX_IDX];
+
+	cpuid(0x1, 0x0, cpuinfo);
+
+	unsigned eax = cpuinfo[EAX_IDX];
+	unsigned family = (eax >> 8) & 0xf;
+	unsigned model = (eax >> 4) & 0xf;
+	unsigned stepping = eax & 0xf;
+
+	if (family == 0x6 || family == 0xf)
+		model |= (eax >> 12) & 0xf0;
+	if (family == 0xf)
+		family += (eax >> 20) & 0xff;
+
+	snprintf(buf, size, "%s-%u-%u-%u", vendor.name, family, model,
+			stepping);
+}
+
 /*
  * is_cpu_clflush_present -- checks if CLFLUSH instruction is supported
  */
@@ -8,7 +8,10 @@
  * cpu.h -- definitions for "cpu" module
  */
 
+#include <stddef.h>
+
 int is_cpu_genuine_intel(void);
+void cpu_get_model(char *buf, size_t size);
 int is_cpu_clflush_present(void);
 int is_cpu_clflushopt_present(void);
 int is_cpu_clwb_present(void);
@@ -208,6 +208,12 @@ enum memcpy_impl {
 	MEMCPY_AVX512F
 };
 
+/* kernel families usable on this CPU, the last one is chosen by default */
+static enum memcpy_impl Kernels[MEMCPY_AVX512F];
+static unsigned Nkernels;
+
+static int Wc_workaround;
+
 /*
  * use_sse2_memcpy_memset -- (internal) SSE2 detected, use it if possible
  */
@@ -404,6 +410,57 @@ use_avx512f_memcpy_memset(struct pmem2_arch_info *info,
 #endif
 }
 
+#if AVX_AVAILABLE || AVX512F_AVAILABLE
+/*
+ * env_disabled -- (internal) check if the instruction set was disabled by
+ * the environment variable
+ */
+static int
+env_disabled(const char *name)
+{
+	char *e = os_getenv(name);
+
+	return e != NULL && strcmp(e, "0") == 0;
+}
+#endif
+
+/*
+ * use_mcsafe_memcpy -- (internal) choose the widest machine check safe
+ * memcpy the CPU supports
+ */
+static void
+use_mcsafe_memcpy(struct pmem2_arch_info *info)
+{
+#if SSE2_AVAILABLE
+	info->memcpy_mcsafe = memcpy_mcsafe_sse2;
+#endif
+#if AVX_AVAILABLE
+	if (is_cpu_avx_present() && !env_disabled("PMEM_AVX"))
+		info->memcpy_mcsafe = memcpy_mcsafe_avx;
+#endif
+#if AVX512F_AVAILABLE
+	if (is_cpu_avx512f_present() && !env_disabled("PMEM_AVX512F"))
+		info->memcpy_mcsafe = memcpy_mcsafe_avx512f;
+#endif
+}
+
+/*
+ * kernel_add -- (internal) remember a kernel family usable on this CPU
+ */
+static void
+kernel_add(enum memcpy_impl impl)
+{
+	if (impl == MEMCPY_INVALID)
+		return;
+
+	/* the family was disabled by an environment variable */
+	if (Nkernels > 0 && Kernels[Nkernels - 1] == impl)
+		return;
+
+	ASSERT(Nkernels < ARRAY_SIZE(Kernels));
+	Kernels[Nkernels++] = impl;
+}
+
 /*
  * pmem_get_cpuinfo -- configure libpmem based on CPUID
  */
@@ -418,6 +475,7 @@ pmem_cpuinfo_to_funcs(struct pmem2_arch_info *info, enum memcpy_impl *impl)
 		info->flush = flush_clflush;
 		info->flush_has_builtin_fence = 1;
 		info->fence = memory_barrier;
+		info->store_flavor = PMEM2_STORE_FLAVOR_CLFLUSH;
 	}
 
 	if (is_cpu_clflushopt_present()) {
@@ -430,6 +488,7 @@ pmem_cpuinfo_to_funcs(struct pmem2_arch_info *info, enum memcpy_impl *impl)
 			info->flush = flush_clflushopt;
 			info->flush_has_builtin_fence = 0;
 			info->fence = memory_barrier;
+			info->store_flavor = PMEM2_STORE_FLAVOR_CLFLUSHOPT;
 		}
 	}
 
@@ -443,6 +502,7 @@ pmem_cpuinfo_to_funcs(struct pmem2_arch_info *info, enum memcpy_impl *impl)
 			info->flush = flush_clwb;
 			info->flush_has_builtin_fence = 0;
 			info->fence = memory_barrier;
+			info->store_flavor = PMEM2_STORE_FLAVOR_CLWB;
 		}
 	}
 
@@ -466,21 +526,71 @@ pmem_cpuinfo_to_funcs(struct pmem2_arch_info *info, enum memcpy_impl *impl)
 		}
 	}
 	LOG(3, "WC workaround = %d", wc_workaround);
+	Wc_workaround = wc_workaround;
 
 	ptr = os_getenv("PMEM_NO_MOVNT");
 	if (ptr && strcmp(ptr, "1") == 0) {
 		LOG(3, "PMEM_NO_MOVNT forced no movnt");
 	} else {
 		use_sse2_memcpy_memset(info, impl, wc_workaround);
+		kernel_add(*impl);
 
-		if (is_cpu_avx_present())
+		if (is_cpu_avx_present()) {
 			use_avx_memcpy_memset(info, impl, wc_workaround);
+			kernel_add(*impl);
+		}
 
-		if (is_cpu_avx512f_present())
+		if (is_cpu_avx512f_present()) {
 			use_avx512f_memcpy_memset(info, impl);
+			kernel_add(*impl);
+		}
 	}
 }
 
+/*
+ * memcpy_impl_name -- (internal) return the name of the kernel family
+ */
+static const char *
+memcpy_impl_name(enum memcpy_impl impl)
+{
+	switch (impl) {
+		case MEMCPY_SSE2:
+			return "sse2";
+		case MEMCPY_AVX:
+			return "avx";
+		case MEMCPY_AVX512F:
+			return "avx512f";
+		default:
+			return "none";
+	}
+}
+
+/*
+ * use_kernel -- (internal) switch info to the k-th usable kernel family
+ */
+static const char *
+use_kernel(struct pmem2_arch_info *info, unsigned k)
+{
+	ASSERT(k < Nkernels);
+	enum memcpy_impl impl = MEMCPY_INVALID;
+
+	switch (Kernels[k]) {
+		case MEMCPY_SSE2:
+			use_sse2_memcpy_memset(info, &impl, Wc_workaround);
+			break;
+		case MEMCPY_AVX:
+			use_avx_memcpy_memset(info, &impl, Wc_workaround);
+			break;
+		case MEMCPY_AVX512F:
+			use_avx512f_memcpy_memset(info, &impl);
+			break;
+		default:
+			ASSERT(0);
+	}
+
+	return memcpy_impl_name(impl);
+}
+
 /*
  * pmem2_arch_init -- initialize architecture-specific list of pmem operations
  */
@@ -491,6 +601,7 @@ pmem2_arch_init(struct pmem2_arch_info *info)
 	enum memcpy_impl impl = MEMCPY_INVALID;
 
 	pmem_cpuinfo_to_funcs(info, &impl);
+	use_mcsafe_memcpy(info);
 
 	/*
 	 * For testing, allow overriding the default threshold
@@ -498,6 +609,7 @@ pmem2_arch_init(struct pmem2_arch_info *info)
 	 * and pmem_memset_*().
 	 * It has no effect if movnt is not supported or disabled.
 	 */
+	info->movnt_threshold_fixed = 0;
 	const char *ptr = os_getenv("PMEM_MOVNT_THRESHOLD");
 	if (ptr) {
 		long long val = atoll(ptr);
@@ -507,9 +619,15 @@ pmem2_arch_init(struct pmem2_arch_info *info)
 		} else {
 			LOG(3, "PMEM_MOVNT_THRESHOLD set to %zu", (size_t)val);
 			Movnt_threshold = (size_t)val;
+			info->movnt_threshold_fixed = 1;
 		}
 	}
 
+	info->cpu_model = cpu_get_model;
+	info->nkernels = Nkernels;
+	info->use_kernel = use_kernel;
+	info->movnt_threshold = &Movnt_threshold;
+
 	if (info->flush == flush_clwb)
 		LOG(3, "using clwb");
 	else if (info->flush == flush_clflushopt)
@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2020, Intel Corporation */
+
+/*
+ * memcpy_mcsafe_avx.c -- machine check safe memcpy using AVX
+ */
+
+#include <immintrin.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pmem2_arch.h"
+#include "avx.h"
+#include "memcpy_memset.h"
+
+/*
+ * memcpy_mcsafe_avx -- copy from memory which may be poisoned, see
+ * pmem2_arch_info.memcpy_mcsafe
+ */
+void
+memcpy_mcsafe_avx(void *dest, const void *src, size_t len)
+{
+	char *d = dest;
+	const char *s = src;
+
+	size_t head = memcpy_mcsafe_head_len(s, len);
+	memcpy_mcsafe_small(d, s, head);
+	d += head;
+	s += head;
+	len -= head;
+
+	while (len >= 64) {
+		__m256i ymm0 = _mm256_load_si256((const __m256i *)s + 0);
+		__m256i ymm1 = _mm256_load_si256((const __m256i *)s + 1);
+
+		_mm256_storeu_si256((__m256i *)d + 0, ymm0);
+		_mm256_storeu_si256((__m256i *)d + 1, ymm1);
+
+		/* the next line is not read before this one is stored */
+		barrier();
+
+		d += 64;
+		s += 64;
+		len -= 64;
+	}
+
+	avx_zeroupper();
+
+	memcpy_mcsafe_small(d, s, len);
+}
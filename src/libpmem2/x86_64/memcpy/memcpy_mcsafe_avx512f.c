@@ -0,0 +1,48 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2020, Intel Corporation */
+
+/*
+ * memcpy_mcsafe_avx512f.c -- machine check safe memcpy using AVX512F
+ */
+
+#include <immintrin.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pmem2_arch.h"
+#include "avx.h"
+#include "memcpy_memset.h"
+
+/*
+ * memcpy_mcsafe_avx512f -- copy from memory which may be poisoned, see
+ * pmem2_arch_info.memcpy_mcsafe
+ */
+void
+memcpy_mcsafe_avx512f(void *dest, const void *src, size_t len)
+{
+	char *d = dest;
+	const char *s = src;
+
+	size_t head = memcpy_mcsafe_head_len(s, len);
+	memcpy_mcsafe_small(d, s, head);
+	d += head;
+	s += head;
+	len -= head;
+
+	while (len >= 64) {
+		__m512i zmm0 = _mm512_load_si512((const __m512i *)s);
+
+		_mm512_storeu_si512((__m512i *)d, zmm0);
+
+		/* the next line is not read before this one is stored */
+		barrier();
+
+		d += 64;
+		s += 64;
+		len -= 64;
+	}
+
+	avx_zeroupper();
+
+	memcpy_mcsafe_small(d, s, len);
+}
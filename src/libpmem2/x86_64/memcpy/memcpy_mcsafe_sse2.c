@@ -0,0 +1,51 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2020, Intel Corporation */
+
+/*
+ * memcpy_mcsafe_sse2.c -- machine check safe memcpy using SSE2
+ */
+
+#include <immintrin.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pmem2_arch.h"
+#include "memcpy_memset.h"
+
+/*
+ * memcpy_mcsafe_sse2 -- copy from memory which may be poisoned, see
+ * pmem2_arch_info.memcpy_mcsafe
+ */
+void
+memcpy_mcsafe_sse2(void *dest, const void *src, size_t len)
+{
+	char *d = dest;
+	const char *s = src;
+
+	size_t head = memcpy_mcsafe_head_len(s, len);
+	memcpy_mcsafe_small(d, s, head);
+	d += head;
+	s += head;
+	len -= head;
+
+	while (len >= 64) {
+		__m128i xmm0 = _mm_load_si128((const __m128i *)s + 0);
+		__m128i xmm1 = _mm_load_si128((const __m128i *)s + 1);
+		__m128i xmm2 = _mm_load_si128((const __m128i *)s + 2);
+		__m128i xmm3 = _mm_load_si128((const __m128i *)s + 3);
+
+		_mm_storeu_si128((__m128i *)d + 0, xmm0);
+		_mm_storeu_si128((__m128i *)d + 1, xmm1);
+		_mm_storeu_si128((__m128i *)d + 2, xmm2);
+		_mm_storeu_si128((__m128i *)d + 3, xmm3);
+
+		/* the next line is not read before this one is stored */
+		barrier();
+
+		d += 64;
+		s += 64;
+		len -= 64;
+	}
+
+	memcpy_mcsafe_small(d, s, len);
+}
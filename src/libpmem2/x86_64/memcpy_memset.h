@@ -205,6 +205,39 @@ void memset_movnt_avx512f_empty(char *dest, int c, size_t len);
 void memset_movnt_avx512f_noflush(char *dest, int c, size_t len);
 #endif
 
+#if SSE2_AVAILABLE
+void memcpy_mcsafe_sse2(void *dest, const void *src, size_t len);
+#endif
+#if AVX_AVAILABLE
+void memcpy_mcsafe_avx(void *dest, const void *src, size_t len);
+#endif
+#if AVX512F_AVAILABLE
+void memcpy_mcsafe_avx512f(void *dest, const void *src, size_t len);
+#endif
+
+/*
+ * memcpy_mcsafe_head_len -- the number of bytes before the first cache line
+ * boundary of the source of a machine check safe copy
+ */
+static force_inline size_t
+memcpy_mcsafe_head_len(const char *src, size_t len)
+{
+	size_t head = (size_t)(0 - (uintptr_t)src) & (CACHELINE_SIZE - 1);
+
+	return MIN(head, len);
+}
+
+/*
+ * memcpy_mcsafe_small -- copy the part of a single cache line of the source
+ * of a machine check safe copy
+ */
+static force_inline void
+memcpy_mcsafe_small(char *dest, const char *src, size_t len)
+{
+	for (size_t i = 0; i < len; ++i)
+		dest[i] = src[i];
+}
+
 extern size_t Movnt_threshold;
 
 /*
@@ -540,6 +540,13 @@ pmemlog_appendv(PMEMlogpool *plp, const struct iovec *iov, int iovcnt)
 		goto end;
 	}
 
+	/*
+	 * Small fragments are stored without flushing and each run of them
+	 * is flushed at once, so that the cache lines they share are flushed
+	 * only once.
+	 */
+	uint64_t flush_offset = write_offset;
+
 	/* append the data */
 	for (i = 0; i < iovcnt; ++i) {
 		buf = iov[i].iov_base;
@@ -551,10 +558,17 @@ pmemlog_appendv(PMEMlogpool *plp, const struct iovec *iov, int iovcnt)
 		 */
 		RANGE_RW(&data[write_offset], count, plp->is_dev_dax);
 
-		if (plp->is_pmem)
-			pmem_memcpy_nodrain(&data[write_offset], buf, count);
-		else
+		if (!plp->is_pmem) {
 			memcpy(&data[write_offset], buf, count);
+		} else if (count < LOG_SMALL_FRAGMENT) {
+			pmem_memcpy(&data[write_offset], buf, count,
+				PMEM_F_MEM_NOFLUSH);
+		} else {
+			pmem_flush(&data[flush_offset],
+				write_offset - flush_offset);
+			pmem_memcpy_nodrain(&data[write_offset], buf, count);
+			flush_offset = write_offset + count;
+		}
 
 		/*
 		 * protect the log space range (debug version only)
@@ -564,6 +578,9 @@ pmemlog_appendv(PMEMlogpool *plp, const struct iovec *iov, int iovcnt)
 		write_offset += count;
 	}
 
+	if (plp->is_pmem)
+		pmem_flush(&data[flush_offset], write_offset - flush_offset);
+
 	/* persist the data and the metadata */
 	log_persist(plp, write_offset);
 
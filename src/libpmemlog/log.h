@@ -64,6 +64,12 @@ struct pmemlog {
 /* data area starts at this alignment after the struct pmemlog above */
 #define LOG_FORMAT_DATA_ALIGN ((uintptr_t)PMEM_PAGESIZE)
 
+/*
+ * fragments of pmemlog_appendv() shorter than this are copied with temporal
+ * stores anyway, so their flushes can be deferred and merged
+ */
+#define LOG_SMALL_FRAGMENT 256
+
 /*
  * log_convert2h -- convert pmemlog structure to host byte order
  */
@@ -1502,6 +1502,7 @@ heap_boot(struct palloc_heap *heap, void *heap_start, uint64_t heap_size,
 	heap->set = set;
 	heap->growsize = HEAP_DEFAULT_GROW_SIZE;
 	heap->alloc_pattern = PALLOC_CTL_DEBUG_NO_PATTERN;
+	heap->type_index = NULL;
 	VALGRIND_DO_CREATE_MEMPOOL(heap->layout, 0, 0);
 
 	for (unsigned i = 0; i < narenas_default; ++i) {
@@ -1550,6 +1551,43 @@ heap_write_header(struct heap_header *hdr)
 	*hdr = newhdr;
 }
 
+/* the maximum number of threads initializing the zones */
+#define HEAP_INIT_MAX_THREADS 4
+
+/*
+ * heap_init_arg -- the arguments of heap_init_zones
+ */
+struct heap_init_arg {
+	struct heap_layout *layout;
+	unsigned zones;
+	struct pmem_ops *p_ops;
+};
+
+/*
+ * heap_init_zones -- (internal) zeroes the headers of the zones which begin
+ *	in the given part of the heap
+ */
+static void
+heap_init_zones(char *addr, size_t len, void *arg)
+{
+	struct heap_init_arg *a = arg;
+
+	for (unsigned i = 0; i < a->zones; ++i) {
+		struct zone *zone = ZID_TO_ZONE(a->layout, i);
+		if ((char *)zone < addr || (char *)zone >= addr + len)
+			continue;
+
+		pmemops_memset(a->p_ops, &zone->header, 0,
+				sizeof(struct zone_header), 0);
+		pmemops_memset(a->p_ops, &zone->chunk_headers, 0,
+				sizeof(struct chunk_header), 0);
+
+		/* only explicitly allocated chunks should be accessible */
+		VALGRIND_DO_MAKE_MEM_NOACCESS(&zone->chunk_headers,
+			sizeof(struct chunk_header));
+	}
+}
+
 /*
  * heap_init -- initializes the heap
  *
@@ -1568,18 +1606,20 @@ heap_init(void *heap_start, uint64_t heap_size, uint64_t *sizep,
 	heap_write_header(&layout->header);
 	pmemops_persist(p_ops, &layout->header, sizeof(struct heap_header));
 
-	unsigned zones = heap_max_zone(heap_size);
-	for (unsigned i = 0; i < zones; ++i) {
-		struct zone *zone = ZID_TO_ZONE(layout, i);
-		pmemops_memset(p_ops, &zone->header, 0,
-				sizeof(struct zone_header), 0);
-		pmemops_memset(p_ops, &zone->chunk_headers, 0,
-				sizeof(struct chunk_header), 0);
+	/*
+	 * Every zone header lies on its own page, usually not allocated yet,
+	 * so the zones of a large heap are initialized by several threads.
+	 */
+	struct heap_init_arg arg = {layout, heap_max_zone(heap_size), p_ops};
+	unsigned nthreads = arg.zones;
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (nthreads > HEAP_INIT_MAX_THREADS)
+		nthreads = HEAP_INIT_MAX_THREADS;
+	if (cpus >= 1 && nthreads > (unsigned)cpus)
+		nthreads = (unsigned)cpus;
 
-		/* only explicitly allocated chunks should be accessible */
-		VALGRIND_DO_MAKE_MEM_NOACCESS(&zone->chunk_headers,
-			sizeof(struct chunk_header));
-	}
+	util_parallel_range(heap_start, heap_size, Pagesize, nthreads,
+		heap_init_zones, &arg);
 
 	*sizep = heap_size;
 	pmemops_persist(p_ops, sizep, sizeof(*sizep));
@@ -1587,6 +1627,30 @@ heap_init(void *heap_start, uint64_t heap_size, uint64_t *sizep,
 	return 0;
 }
 
+/*
+ * heap_prefault_metadata -- forces page allocation for the heap and zone
+ *	headers, the chunks themselves are faulted on first access
+ */
+void
+heap_prefault_metadata(void *heap_start, uint64_t heap_size)
+{
+	struct heap_layout *layout = heap_start;
+
+	/* the headers of unused chunks are not accessible */
+	VALGRIND_DO_DISABLE_ERROR_REPORTING;
+
+	util_prefault(&layout->header, sizeof(layout->header));
+
+	unsigned zones = heap_max_zone(heap_size);
+	for (unsigned i = 0; i < zones; ++i) {
+		struct zone *zone = ZID_TO_ZONE(layout, i);
+		util_prefault(zone, sizeof(struct zone_header) +
+			sizeof(struct chunk_header) * MAX_CHUNK);
+	}
+
+	VALGRIND_DO_ENABLE_ERROR_REPORTING;
+}
+
 /*
  * heap_cleanup -- cleanups the volatile heap state
  */
@@ -1834,6 +1898,72 @@ heap_foreach_object(struct palloc_heap *heap, object_callback cb, void *arg,
 	}
 }
 
+/*
+ * heap_foreach_object_part -- (internal) iterates through objects in one of
+ *	nparts equal partitions of the heap
+ *
+ * The chunks of all the zones are split into contiguous ranges and every
+ * object belongs to the range in which its chunk starts, so the partitions
+ * can be walked independently of each other. Returns non-zero if the
+ * iteration was terminated by the callback.
+ */
+int
+heap_foreach_object_part(struct palloc_heap *heap, object_callback cb,
+	void *arg, unsigned part, unsigned nparts)
+{
+	ASSERT(part < nparts);
+
+	uint64_t nchunks = 0;
+	for (uint32_t i = 0; i < heap->rt->nzones; ++i) {
+		struct zone *zone = ZID_TO_ZONE(heap->layout, i);
+		if (zone->header.magic != 0)
+			nchunks += zone->header.size_idx;
+	}
+
+	uint64_t begin = nchunks * part / nparts;
+	uint64_t end = nchunks * (part + 1) / nparts;
+
+	struct memory_block m = MEMORY_BLOCK_NONE;
+	uint64_t base = 0; /* index of the first chunk of the zone */
+	for (m.zone_id = 0; m.zone_id < heap->rt->nzones && base < end;
+			++m.zone_id) {
+		struct zone *zone = ZID_TO_ZONE(heap->layout, m.zone_id);
+		if (zone->header.magic == 0)
+			continue;
+
+		uint32_t size_idx = zone->header.size_idx;
+		if (base + size_idx <= begin) {
+			base += size_idx;
+			continue;
+		}
+
+		/*
+		 * Chunks have to be walked from the start of the zone, only
+		 * the first chunk of a multi-chunk block has a valid header.
+		 */
+		m.chunk_id = 0;
+		while (m.chunk_id < size_idx && base + m.chunk_id < end) {
+			struct chunk_header *hdr = heap_get_chunk_hdr(heap, &m);
+			uint32_t chunk_size_idx = hdr->size_idx;
+
+			if (base + m.chunk_id >= begin) {
+				memblock_rebuild_state(heap, &m);
+				m.size_idx = chunk_size_idx;
+
+				if (m.m_ops->iterate_used(&m, cb, arg) != 0)
+					return 1;
+			}
+
+			m.chunk_id += chunk_size_idx;
+			m.block_off = 0;
+		}
+
+		base += size_idx;
+	}
+
+	return 0;
+}
+
 #if VG_MEMCHECK_ENABLED
 
 /*
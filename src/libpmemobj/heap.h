@@ -34,6 +34,7 @@ int heap_boot(struct palloc_heap *heap, void *heap_start, uint64_t heap_size,
 		struct stats *stats, struct pool_set *set);
 int heap_init(void *heap_start, uint64_t heap_size, uint64_t *sizep,
 	struct pmem_ops *p_ops);
+void heap_prefault_metadata(void *heap_start, uint64_t heap_size);
 void heap_cleanup(struct palloc_heap *heap);
 int heap_check(void *heap_start, uint64_t heap_size);
 int heap_check_remote(void *heap_start, uint64_t heap_size,
@@ -77,6 +78,8 @@ heap_free_chunk_reuse(struct palloc_heap *heap,
 
 void heap_foreach_object(struct palloc_heap *heap, object_callback cb,
 	void *arg, struct memory_block start);
+int heap_foreach_object_part(struct palloc_heap *heap, object_callback cb,
+	void *arg, unsigned part, unsigned nparts);
 
 struct alloc_class_collection *heap_alloc_classes(struct palloc_heap *heap);
 
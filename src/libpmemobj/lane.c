@@ -247,6 +247,25 @@ lane_destroy(PMEMobjpool *pop, struct lane *lane)
 	operation_delete(lane->external);
 }
 
+/*
+ * lane_partitions_count -- (internal) returns the number of lane partitions
+ *	for the pool, one per NUMA node as long as the partitions don't become
+ *	too small
+ */
+static unsigned
+lane_partitions_count(PMEMobjpool *pop)
+{
+	unsigned nodes = os_numa_node_count();
+	unsigned max = pop->lanes_desc.runtime_nlanes / LANE_PARTITION_MIN_SIZE;
+
+	if (nodes > max)
+		nodes = max;
+
+	LOG(4, "lane partitions %u", nodes);
+
+	return nodes == 0 ? 1 : nodes;
+}
+
 /*
  * lane_boot -- initializes all lanes
  */
@@ -263,6 +282,7 @@ lane_boot(PMEMobjpool *pop)
 	}
 
 	pop->lanes_desc.next_lane_idx = 0;
+	pop->lanes_desc.npartitions = lane_partitions_count(pop);
 
 	pop->lanes_desc.lane_locks =
 		Zalloc(sizeof(*pop->lanes_desc.lane_locks) * pop->nlanes);
@@ -271,6 +291,16 @@ lane_boot(PMEMobjpool *pop)
 		goto error_locks_malloc;
 	}
 
+	pop->lanes_desc.lane_stats = util_aligned_malloc(CACHELINE_SIZE,
+		sizeof(*pop->lanes_desc.lane_stats) * pop->nlanes);
+	if (pop->lanes_desc.lane_stats == NULL) {
+		err = ENOMEM;
+		ERR("!Malloc for lane stats");
+		goto error_stats_malloc;
+	}
+	memset(pop->lanes_desc.lane_stats, 0,
+		sizeof(*pop->lanes_desc.lane_stats) * pop->nlanes);
+
 	/* add lanes to pmemcheck ignored list */
 	VALGRIND_ADD_TO_GLOBAL_TX_IGNORE((char *)pop + pop->lanes_offset,
 		(sizeof(struct lane_layout) * pop->nlanes));
@@ -290,6 +320,9 @@ lane_boot(PMEMobjpool *pop)
 error_lane_init:
 	for (; i >= 1; --i)
 		lane_destroy(pop, &pop->lanes_desc.lane[i - 1]);
+	util_aligned_free(pop->lanes_desc.lane_stats);
+	pop->lanes_desc.lane_stats = NULL;
+error_stats_malloc:
 	Free(pop->lanes_desc.lane_locks);
 	pop->lanes_desc.lane_locks = NULL;
 error_locks_malloc:
@@ -335,6 +368,8 @@ lane_cleanup(PMEMobjpool *pop)
 	pop->lanes_desc.lane = NULL;
 	Free(pop->lanes_desc.lane_locks);
 	pop->lanes_desc.lane_locks = NULL;
+	util_aligned_free(pop->lanes_desc.lane_stats);
+	pop->lanes_desc.lane_stats = NULL;
 
 	lane_info_cleanup(pop);
 }
@@ -417,39 +452,137 @@ lane_check(PMEMobjpool *pop)
 	return 0;
 }
 
+/*
+ * lane_npartitions -- (internal) returns the number of lane partitions,
+ *	never larger than the number of available lanes
+ */
+static inline uint64_t
+lane_npartitions(struct lane_descriptor *desc, uint64_t nlocks)
+{
+	uint64_t npartitions = desc->npartitions;
+	if (npartitions == 0)
+		return 1;
+
+	return npartitions > nlocks ? nlocks : npartitions;
+}
+
+/*
+ * lane_partition_range -- (internal) calculates the [first, end) range of lanes
+ *	belonging to the given partition
+ */
+static inline void
+lane_partition_range(struct lane_descriptor *desc, unsigned partition,
+	uint64_t nlocks, uint64_t *first, uint64_t *end)
+{
+	uint64_t npartitions = lane_npartitions(desc, nlocks);
+	uint64_t p = partition % npartitions;
+
+	*first = nlocks * p / npartitions;
+	*end = nlocks * (p + 1) / npartitions;
+}
+
+/*
+ * lane_info_partition -- (internal) assigns the thread to the lane partition
+ *	of the NUMA node it runs on and picks a primary lane within it
+ */
+static void
+lane_info_partition(struct lane_descriptor *desc, struct lane_info *info,
+	uint64_t nlocks)
+{
+	info->partition_refresh = LANE_PARTITION_REFRESH;
+
+	unsigned node = 0;
+	if (lane_npartitions(desc, nlocks) > 1 &&
+			os_thread_numa_node(&node) != 0)
+		node = 0;
+
+	unsigned partition = (unsigned)(node % lane_npartitions(desc, nlocks));
+	if (info->lane_idx != UINT64_MAX && partition == info->partition)
+		return;
+
+	info->partition = partition;
+
+	uint64_t first;
+	uint64_t end;
+	lane_partition_range(desc, partition, nlocks, &first, &end);
+
+	/* initial wrap to next CL */
+	uint32_t next = util_fetch_and_add32(&desc->next_lane_idx, LANE_JUMP);
+	info->primary = first + next % (end - first);
+	info->primary_attempts = LANE_PRIMARY_ATTEMPTS;
+}
+
 /*
  * get_lane -- (internal) get free lane index
+ *
+ * The primary lane is tried first, then the remaining lanes of the thread's
+ * partition, and only then the lanes of other partitions.
  */
 static inline void
-get_lane(uint64_t *locks, struct lane_info *info, uint64_t nlocks)
+get_lane(struct lane_descriptor *desc, struct lane_info *info, uint64_t nlocks)
 {
-	info->lane_idx = info->primary;
+	uint64_t *locks = desc->lane_locks;
+	uint64_t first;
+	uint64_t end;
+	lane_partition_range(desc, info->partition, nlocks, &first, &end);
+
+	/* the number of runtime lanes might have changed */
+	if (info->primary < first || info->primary >= end)
+		info->primary = first + info->primary % (end - first);
+
+	uint64_t primary_miss = 0;
+	uint64_t remote = 0;
+	uint64_t yields = 0;
+	uint64_t idx;
+
 	while (1) {
-		do {
-			info->lane_idx %= nlocks;
+		idx = info->primary;
+		for (uint64_t n = 0; n < end - first; ++n) {
 			if (likely(util_bool_compare_and_swap64(
-					&locks[info->lane_idx], 0, 1))) {
-				if (info->lane_idx == info->primary) {
+					&locks[idx], 0, 1))) {
+				if (idx == info->primary) {
 					info->primary_attempts =
 						LANE_PRIMARY_ATTEMPTS;
 				} else if (info->primary_attempts == 0) {
-					info->primary = info->lane_idx;
+					info->primary = idx;
 					info->primary_attempts =
 						LANE_PRIMARY_ATTEMPTS;
 				}
-				return;
+				goto acquired;
 			}
 
-			if (info->lane_idx == info->primary &&
-					info->primary_attempts > 0) {
-				info->primary_attempts--;
+			if (idx == info->primary) {
+				primary_miss = 1;
+				if (info->primary_attempts > 0)
+					info->primary_attempts--;
 			}
 
-			++info->lane_idx;
-		} while (info->lane_idx < nlocks);
+			if (++idx == end)
+				idx = first;
+		}
+
+		/* all local lanes are busy, borrow one from other partitions */
+		idx = end % nlocks;
+		for (; idx != first; idx = (idx + 1) % nlocks) {
+			if (util_bool_compare_and_swap64(&locks[idx], 0, 1)) {
+				remote = 1;
+				goto acquired;
+			}
+		}
 
+		yields++;
 		sched_yield();
 	}
+
+acquired:
+	info->lane_idx = idx;
+
+	/* the lane is now held exclusively, so are its counters */
+	struct lane_stats *stats = &desc->lane_stats[idx].stats;
+	stats->holds++;
+	stats->primary_misses += primary_miss;
+	stats->remote_holds += remote;
+	stats->yields += yields;
 }
 
 /*
@@ -482,6 +615,8 @@ get_lane_info_record(PMEMobjpool *pop)
 		info->prev = NULL;
 		info->primary = 0;
 		info->primary_attempts = LANE_PRIMARY_ATTEMPTS;
+		info->partition = 0;
+		info->partition_refresh = 0;
 		if (Lane_info_records) {
 			Lane_info_records->prev = info;
 		}
@@ -515,16 +650,16 @@ lane_hold(PMEMobjpool *pop, struct lane **lanep)
 	}
 
 	struct lane_info *lane = get_lane_info_record(pop);
-	while (unlikely(lane->lane_idx == UINT64_MAX)) {
-		/* initial wrap to next CL */
-		lane->primary = lane->lane_idx = util_fetch_and_add32(
-			&pop->lanes_desc.next_lane_idx, LANE_JUMP);
-	} /* handles wraparound */
+	struct lane_descriptor *desc = &pop->lanes_desc;
 
-	uint64_t *llocks = pop->lanes_desc.lane_locks;
 	/* grab next free lane from lanes available at runtime */
 	if (!lane->nest_count++) {
-		get_lane(llocks, lane, pop->lanes_desc.runtime_nlanes);
+		if (unlikely(lane->lane_idx == UINT64_MAX ||
+				--lane->partition_refresh == 0)) {
+			lane_info_partition(desc, lane, desc->runtime_nlanes);
+		}
+
+		get_lane(desc, lane, desc->runtime_nlanes);
 	}
 
 	struct lane *l = &pop->lanes_desc.lane[lane->lane_idx];
@@ -570,3 +705,21 @@ lane_release(PMEMobjpool *pop)
 		}
 	}
 }
+
+/*
+ * lane_stats_get -- sums up the contention counters of all lanes
+ */
+void
+lane_stats_get(PMEMobjpool *pop, struct lane_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+
+	for (uint64_t i = 0; i < pop->nlanes; ++i) {
+		struct lane_stats *ls = &pop->lanes_desc.lane_stats[i].stats;
+
+		stats->holds += ls->holds;
+		stats->primary_misses += ls->primary_misses;
+		stats->remote_holds += ls->remote_holds;
+		stats->yields += ls->yields;
+	}
+}
@@ -11,6 +11,7 @@
 #include <stdint.h>
 #include "ulog.h"
 #include "libpmemobj.h"
+#include "util.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -30,6 +31,11 @@ extern "C" {
  */
 #define LANE_PRIMARY_ATTEMPTS 128
 
+#define LANE_PARTITION_REFRESH 1024
+
+/* minimal number of lanes in a single partition */
+#define LANE_PARTITION_MIN_SIZE (LANE_JUMP * 2)
+
 #define RLANE_DEFAULT 0
 
 #define LANE_TOTAL_SIZE 3072 /* 3 * 1024 (sum of 3 old lane sections) */
@@ -80,6 +86,26 @@ struct lane_layout {
 	struct ULOG(LANE_UNDO_SIZE) undo;
 };
 
+/*
+ * Contention counters of a single lane. They are only modified by the thread
+ * holding the lane, so no atomic operations are needed.
+ */
+struct lane_stats {
+	uint64_t holds; /* number of times the lane was acquired */
+	uint64_t primary_misses; /* acquired because primary lane was busy */
+	uint64_t remote_holds; /* acquired by a thread of another partition */
+	uint64_t yields; /* times the acquiring thread found no free lane */
+};
+
+/*
+ * The counters are written on every acquisition of the lane, so each lane
+ * has them in a cache line of its own.
+ */
+union lane_stats_line {
+	struct lane_stats stats;
+	char padding[CACHELINE_SIZE];
+};
+
 struct lane {
 	struct lane_layout *layout; /* pointer to persistent layout */
 	struct operation_context *internal; /* context for internal ulog */
@@ -95,8 +121,15 @@ struct lane_descriptor {
 	 */
 	unsigned runtime_nlanes;
 	unsigned next_lane_idx;
+	/*
+	 * Number of disjoint ranges the runtime lanes are divided into, one
+	 * per NUMA node. Threads prefer lanes from the partition of the node
+	 * they run on, so that the lane's cache lines stay local.
+	 */
+	unsigned npartitions;
 	uint64_t *lane_locks;
 	struct lane *lane;
+	union lane_stats_line *lane_stats; /* aligned to a cache line */
 };
 
 typedef int (*section_layout_op)(PMEMobjpool *pop, void *data, unsigned length);
@@ -126,6 +159,13 @@ struct lane_info {
 	uint64_t primary;
 	int primary_attempts;
 
+	/*
+	 * The lane partition of the NUMA node the thread was last seen on,
+	 * re-evaluated every LANE_PARTITION_REFRESH outermost holds.
+	 */
+	unsigned partition;
+	unsigned partition_refresh;
+
 	struct lane_info *prev, *next;
 };
 
@@ -142,6 +182,8 @@ int lane_check(PMEMobjpool *pop);
 unsigned lane_hold(PMEMobjpool *pop, struct lane **lane);
 void lane_release(PMEMobjpool *pop);
 
+void lane_stats_get(PMEMobjpool *pop, struct lane_stats *stats);
+
 #ifdef __cplusplus
 }
 #endif
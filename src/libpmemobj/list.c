@@ -5,7 +5,9 @@
  * list.c -- implementation of persistent atomic lists module
  */
 #include <inttypes.h>
+#include <stdlib.h>
 
+#include "alloc.h"
 #include "list.h"
 #include "obj.h"
 #include "os_thread.h"
@@ -572,6 +574,254 @@ list_insert_new_user(PMEMobjpool *pop,
 	return ret;
 }
 
+/*
+ * list_fill_batch_persist -- (internal) link the elements into a chain placed
+ *	between the prev_offset and next_offset elements
+ *
+ * The elements are not reachable from the list until the redo log is
+ * processed, so their entries are written directly and drained once.
+ */
+static void
+list_fill_batch_persist(PMEMobjpool *pop, ssize_t pe_offset,
+	const uint64_t *offs, size_t noffs,
+	uint64_t prev_offset, uint64_t next_offset)
+{
+	LOG(15, NULL);
+
+	for (size_t i = 0; i < noffs; ++i) {
+		struct list_entry *entry_ptr =
+			(struct list_entry *)OBJ_OFF_TO_PTR(pop,
+				(uintptr_t)((ssize_t)offs[i] + pe_offset));
+
+		VALGRIND_ADD_TO_TX(entry_ptr, sizeof(*entry_ptr));
+		entry_ptr->pe_next.pool_uuid_lo = pop->uuid_lo;
+		entry_ptr->pe_next.off = i + 1 < noffs ?
+			offs[i + 1] : next_offset;
+
+		entry_ptr->pe_prev.pool_uuid_lo = pop->uuid_lo;
+		entry_ptr->pe_prev.off = i > 0 ? offs[i - 1] : prev_offset;
+		VALGRIND_REMOVE_FROM_TX(entry_ptr, sizeof(*entry_ptr));
+
+		pmemops_flush(&pop->p_ops, entry_ptr, sizeof(*entry_ptr));
+	}
+
+	pmemops_drain(&pop->p_ops);
+}
+
+/*
+ * list_insert_batch_user -- (internal) insert a chain of elements at
+ *	the destination of a user list
+ *
+ * Only the two neighbours of the chain are modified through the redo log,
+ * and the head only if the chain becomes the first part of the list. In
+ * particular, appending to a non-empty list does not write to the head.
+ */
+static void
+list_insert_batch_user(PMEMobjpool *pop,
+	struct operation_context *ctx, ssize_t pe_offset,
+	struct list_head *head, PMEMoid dest, int before,
+	const uint64_t *offs, size_t noffs)
+{
+	LOG(15, NULL);
+	ASSERTne(noffs, 0);
+
+	uint64_t first = offs[0];
+	uint64_t last = offs[noffs - 1];
+	uint64_t prev_offset;
+	uint64_t next_offset;
+
+	if (dest.off == 0) {
+		/* inserting the first elements on list, close the loop */
+		ASSERTeq(head->pe_first.off, 0);
+
+		prev_offset = last;
+		next_offset = first;
+
+		list_update_head(pop, ctx, head, first);
+	} else {
+		struct list_entry *dest_entry_ptr =
+			(struct list_entry *)OBJ_OFF_TO_PTR(pop,
+				(uintptr_t)((ssize_t)dest.off + pe_offset));
+
+		if (before) {
+			prev_offset = dest_entry_ptr->pe_prev.off;
+			next_offset = dest.off;
+		} else {
+			prev_offset = dest.off;
+			next_offset = dest_entry_ptr->pe_next.off;
+		}
+
+		/* prev->next = first and next->prev = last */
+		uint64_t prev_next_off = prev_offset + NEXT_OFF;
+		u64_add_offset(&prev_next_off, pe_offset);
+		uint64_t next_prev_off = next_offset + PREV_OFF;
+		u64_add_offset(&next_prev_off, pe_offset);
+
+		operation_add_entry(ctx, (char *)pop + prev_next_off, first,
+			ULOG_OPERATION_SET);
+		operation_add_entry(ctx, (char *)pop + next_prev_off, last,
+			ULOG_OPERATION_SET);
+
+		if (before && dest.off == head->pe_first.off) {
+			/* chain at first position */
+			list_update_head(pop, ctx, head, first);
+		}
+	}
+
+	list_fill_batch_persist(pop, pe_offset, offs, noffs,
+		prev_offset, next_offset);
+}
+
+/*
+ * list_insert_new_batch_user -- allocate and insert a chain of elements to
+ *	a user list
+ *
+ * pop         - pmemobj pool handle
+ * pe_offset   - offset to list entry on user list relative to user data
+ * user_head   - user list head
+ * dest        - destination on user list
+ * before      - insert before/after destination on user list
+ * size        - size of each allocation
+ * constructor - object's constructor, called for every element
+ * arg         - argument for object's constructor
+ * oids        - array of noids object IDs filled with the new elements
+ */
+int
+list_insert_new_batch_user(PMEMobjpool *pop,
+	size_t pe_offset, struct list_head *user_head, PMEMoid dest, int before,
+	size_t size, uint64_t type_num, palloc_constr constructor, void *arg,
+	PMEMoid *oids, size_t noids)
+{
+	LOG(3, NULL);
+	ASSERTne(noids, 0);
+
+	struct pobj_action *reserved = Malloc(noids * sizeof(*reserved));
+	if (reserved == NULL) {
+		ERR("!Malloc");
+		return -1;
+	}
+
+	uint64_t *offs = Malloc(noids * sizeof(*offs));
+	if (offs == NULL) {
+		ERR("!Malloc");
+		Free(reserved);
+		return -1;
+	}
+
+	int ret;
+	if ((ret = pmemobj_mutex_lock(pop, &user_head->lock))) {
+		errno = ret;
+		LOG(2, "pmemobj_mutex_lock failed");
+		ret = -1;
+		goto err_lock;
+	}
+
+	struct lane *lane;
+	lane_hold(pop, &lane);
+
+	for (size_t i = 0; i < noids; ++i) {
+		if (palloc_reserve(&pop->heap, size, constructor, arg,
+			type_num, 0, 0, 0, &reserved[i]) != 0) {
+			ERR("!palloc_reserve");
+			palloc_cancel(&pop->heap, reserved, i);
+			ret = -1;
+			goto err_pmalloc;
+		}
+		offs[i] = reserved[i].heap.offset;
+	}
+
+	struct operation_context *ctx = lane->external;
+	operation_start(ctx);
+
+	ASSERT((ssize_t)pe_offset >= 0);
+
+	dest = list_get_dest(pop, user_head, dest,
+		(ssize_t)pe_offset, before);
+
+	list_insert_batch_user(pop, ctx, (ssize_t)pe_offset, user_head,
+		dest, before, offs, noids);
+
+	palloc_publish(&pop->heap, reserved, noids, ctx);
+
+	for (size_t i = 0; i < noids; ++i) {
+		oids[i].pool_uuid_lo = pop->uuid_lo;
+		oids[i].off = offs[i];
+	}
+
+	ret = 0;
+
+err_pmalloc:
+	lane_release(pop);
+	pmemobj_mutex_unlock_nofail(pop, &user_head->lock);
+err_lock:
+	Free(offs);
+	Free(reserved);
+
+	ASSERT(ret == 0 || ret == -1);
+	return ret;
+}
+
+/*
+ * list_insert_batch -- insert a chain of objects to a single list
+ *
+ * pop          - pmemobj handle
+ * pe_offset    - offset to list entry on user list relative to user data
+ * head         - list head
+ * dest         - destination object ID
+ * before       - before/after destination
+ * oids         - array of noids objects, in the order of the chain
+ */
+int
+list_insert_batch(PMEMobjpool *pop,
+	ssize_t pe_offset, struct list_head *head,
+	PMEMoid dest, int before,
+	const PMEMoid *oids, size_t noids)
+{
+	LOG(3, NULL);
+	ASSERTne(head, NULL);
+	ASSERTne(noids, 0);
+
+	uint64_t *offs = Malloc(noids * sizeof(*offs));
+	if (offs == NULL) {
+		ERR("!Malloc");
+		return -1;
+	}
+
+	for (size_t i = 0; i < noids; ++i)
+		offs[i] = oids[i].off;
+
+	struct lane *lane;
+	lane_hold(pop, &lane);
+
+	int ret;
+
+	if ((ret = pmemobj_mutex_lock(pop, &head->lock))) {
+		errno = ret;
+		LOG(2, "pmemobj_mutex_lock failed");
+		ret = -1;
+		goto err;
+	}
+
+	struct operation_context *ctx = lane->external;
+	operation_start(ctx);
+
+	dest = list_get_dest(pop, head, dest, pe_offset, before);
+
+	list_insert_batch_user(pop, ctx, pe_offset, head, dest, before,
+		offs, noids);
+
+	operation_process(ctx);
+	operation_finish(ctx, 0);
+
+	pmemobj_mutex_unlock_nofail(pop, &head->lock);
+err:
+	lane_release(pop);
+	Free(offs);
+
+	ASSERT(ret == 0 || ret == -1);
+	return ret;
+}
+
 /*
  * list_insert -- insert object to a single list
  *
@@ -803,6 +1053,170 @@ err:
 	return ret;
 }
 
+/*
+ * list_offset_compare -- (internal) comparator of the offsets of elements
+ */
+static int
+list_offset_compare(const void *lhs, const void *rhs)
+{
+	uint64_t l = *(const uint64_t *)lhs;
+	uint64_t r = *(const uint64_t *)rhs;
+
+	if (l < r)
+		return -1;
+	if (l > r)
+		return 1;
+
+	return 0;
+}
+
+/*
+ * list_batch_contains -- (internal) check whether the element is one of
+ *	the sorted offsets
+ */
+static int
+list_batch_contains(const uint64_t *sorted, size_t noffs, uint64_t off)
+{
+	return bsearch(&off, sorted, noffs, sizeof(off),
+		list_offset_compare) != NULL;
+}
+
+/*
+ * list_remove_batch -- remove objects from list and optionally free them
+ *
+ * pop          - pmemobj handle
+ * pe_offset    - offset to list entry on user list relative to user data
+ * head         - list head
+ * oids         - array of noids distinct objects on the list
+ * free         - free the objects in the same redo log
+ *
+ * Adjacent elements are unlinked together, so only the neighbours of every
+ * removed run of elements are modified through the redo log.
+ */
+int
+list_remove_batch(PMEMobjpool *pop,
+	ssize_t pe_offset, struct list_head *head,
+	const PMEMoid *oids, size_t noids, int free)
+{
+	LOG(3, NULL);
+	ASSERTne(head, NULL);
+	ASSERTne(noids, 0);
+
+	int ret = -1;
+
+	uint64_t *sorted = Malloc(noids * sizeof(*sorted));
+	if (sorted == NULL) {
+		ERR("!Malloc");
+		return -1;
+	}
+
+	struct pobj_action *deferred = NULL;
+	if (free && (deferred = Malloc(noids * sizeof(*deferred))) == NULL) {
+		ERR("!Malloc");
+		goto err_alloc;
+	}
+
+	for (size_t i = 0; i < noids; ++i)
+		sorted[i] = oids[i].off;
+	qsort(sorted, noids, sizeof(*sorted), list_offset_compare);
+
+	struct lane *lane;
+	lane_hold(pop, &lane);
+
+	if ((ret = pmemobj_mutex_lock(pop, &head->lock))) {
+		errno = ret;
+		LOG(2, "pmemobj_mutex_lock failed");
+		ret = -1;
+		goto err;
+	}
+
+	struct operation_context *ctx = lane->external;
+	operation_start(ctx);
+
+	for (size_t i = 0; i < noids; ++i) {
+		struct list_entry *entry_ptr =
+			(struct list_entry *)OBJ_OFF_TO_PTR(pop,
+				(uintptr_t)((ssize_t)oids[i].off + pe_offset));
+
+		uint64_t prev_off = entry_ptr->pe_prev.off;
+		if (list_batch_contains(sorted, noids, prev_off))
+			continue;
+
+		/* first element of a run, find the element after the run */
+		uint64_t next_off = entry_ptr->pe_next.off;
+		while (list_batch_contains(sorted, noids, next_off)) {
+			struct list_entry *next_ptr =
+				(struct list_entry *)OBJ_OFF_TO_PTR(pop,
+				(uintptr_t)((ssize_t)next_off + pe_offset));
+			next_off = next_ptr->pe_next.off;
+		}
+
+		/* set next->prev = prev and prev->next = next */
+		uint64_t next_prev_off = next_off + PREV_OFF;
+		u64_add_offset(&next_prev_off, pe_offset);
+		uint64_t prev_next_off = prev_off + NEXT_OFF;
+		u64_add_offset(&prev_next_off, pe_offset);
+
+		operation_add_entry(ctx, (char *)pop + next_prev_off, prev_off,
+			ULOG_OPERATION_SET);
+		operation_add_entry(ctx, (char *)pop + prev_next_off, next_off,
+			ULOG_OPERATION_SET);
+	}
+
+	uint64_t first_off = head->pe_first.off;
+	if (list_batch_contains(sorted, noids, first_off)) {
+		/* first remaining element, if there's any */
+		uint64_t off = first_off;
+		do {
+			struct list_entry *ptr =
+				(struct list_entry *)OBJ_OFF_TO_PTR(pop,
+				(uintptr_t)((ssize_t)off + pe_offset));
+			off = ptr->pe_next.off;
+		} while (off != first_off &&
+			list_batch_contains(sorted, noids, off));
+
+		list_update_head(pop, ctx, head, off == first_off ? 0 : off);
+	}
+
+	if (free) {
+		for (size_t i = 0; i < noids; ++i)
+			palloc_defer_free(&pop->heap, oids[i].off,
+				&deferred[i]);
+
+		palloc_publish(&pop->heap, deferred, noids, ctx);
+	} else {
+		operation_process(ctx);
+		operation_finish(ctx, 0);
+
+		/* the elements are no longer reachable from the list */
+		for (size_t i = 0; i < noids; ++i) {
+			struct list_entry *entry_ptr =
+				(struct list_entry *)OBJ_OFF_TO_PTR(pop,
+				(uintptr_t)((ssize_t)oids[i].off + pe_offset));
+
+			VALGRIND_ADD_TO_TX(entry_ptr, sizeof(*entry_ptr));
+			entry_ptr->pe_next.off = 0;
+			entry_ptr->pe_prev.off = 0;
+			VALGRIND_REMOVE_FROM_TX(entry_ptr, sizeof(*entry_ptr));
+
+			pmemops_flush(&pop->p_ops, entry_ptr,
+				sizeof(*entry_ptr));
+		}
+		pmemops_drain(&pop->p_ops);
+	}
+
+	pmemobj_mutex_unlock_nofail(pop, &head->lock);
+	ret = 0;
+err:
+	lane_release(pop);
+	Free(deferred);
+err_alloc:
+	Free(sorted);
+
+	ASSERT(ret == 0 || ret == -1);
+	return ret;
+}
+
 /*
  * list_move -- move object between two lists
  *
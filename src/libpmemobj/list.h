@@ -40,6 +40,15 @@ int list_insert(PMEMobjpool *pop,
 	ssize_t pe_offset, struct list_head *head, PMEMoid dest, int before,
 	PMEMoid oid);
 
+int list_insert_new_batch_user(PMEMobjpool *pop,
+	size_t pe_offset, struct list_head *user_head, PMEMoid dest, int before,
+	size_t size, uint64_t type_num, palloc_constr constructor, void *arg,
+	PMEMoid *oids, size_t noids);
+
+int list_insert_batch(PMEMobjpool *pop,
+	ssize_t pe_offset, struct list_head *head, PMEMoid dest, int before,
+	const PMEMoid *oids, size_t noids);
+
 int list_remove_free_user(PMEMobjpool *pop,
 	size_t pe_offset, struct list_head *user_head,
 	PMEMoid *oidp);
@@ -48,6 +57,10 @@ int list_remove(PMEMobjpool *pop,
 	ssize_t pe_offset, struct list_head *head,
 	PMEMoid oid);
 
+int list_remove_batch(PMEMobjpool *pop,
+	ssize_t pe_offset, struct list_head *head,
+	const PMEMoid *oids, size_t noids, int free);
+
 int list_move(PMEMobjpool *pop,
 	size_t pe_offset_old, struct list_head *head_old,
 	size_t pe_offset_new, struct list_head *head_new,
@@ -14,6 +14,7 @@
  * The modifications are not visible until the context is processed.
  */
 
+#include "line_batch.h"
 #include "memops.h"
 #include "obj.h"
 #include "out.h"
@@ -71,6 +72,11 @@ struct operation_context {
 
 	/* collection used to look for potential merge candidates */
 	VECQ(, struct ulog_entry_val *) merge_entries;
+
+	struct operation_stats *stats; /* log counters, NULL if not collected */
+
+	/* cache lines modified by the processing, each flushed only once */
+	struct line_batch *flush_lines;
 };
 
 /*
@@ -205,6 +211,12 @@ operation_new(struct ulog *ulog, size_t ulog_base_nbytes,
 	    ulog_base_nbytes) != 0)
 		goto error_ulog_alloc;
 
+	ctx->flush_lines = line_batch_new(CACHELINE_SIZE);
+	if (ctx->flush_lines == NULL) {
+		ERR("!line_batch_new");
+		goto error_ulog_alloc;
+	}
+
 	return ctx;
 
 error_ulog_alloc:
@@ -221,6 +233,7 @@ operation_delete(struct operation_context *ctx)
 {
 	VECQ_DELETE(&ctx->merge_entries);
 	VEC_DELETE(&ctx->next);
+	line_batch_delete(ctx->flush_lines);
 	Free(ctx->pshadow_ops.ulog);
 	Free(ctx->transient_ops.ulog);
 	Free(ctx);
@@ -386,8 +399,11 @@ operation_add_typed_entry(struct operation_context *ctx,
 		oplog->ulog, oplog->offset, ptr, value, type,
 		log_type == LOG_TRANSIENT ? &ctx->t_ops : &ctx->s_ops);
 
-	if (log_type == LOG_PERSISTENT)
+	if (log_type == LOG_PERSISTENT) {
 		operation_merge_entry_add(ctx, entry);
+		if (ctx->stats != NULL)
+			ctx->stats->entries++;
+	}
 
 	oplog->offset += ulog_entry_size(&entry->base);
 
@@ -469,6 +485,9 @@ operation_add_buffer(struct operation_context *ctx,
 	ctx->ulog_curr_offset += entry_size;
 	ctx->ulog_curr_capacity -= entry_size;
 
+	if (ctx->stats != NULL)
+		ctx->stats->entries++;
+
 	/*
 	 * Recursively add the data to the log until the entire buffer is
 	 * processed.
@@ -610,6 +629,17 @@ operation_add_user_buffer(struct operation_context *ctx,
 	operation_set_any_user_buffer(ctx, 1);
 }
 
+/*
+ * operation_set_stats -- sets the counters to which the log activity of
+ *	the operation is accounted, NULL disables the accounting
+ */
+void
+operation_set_stats(struct operation_context *ctx,
+	struct operation_stats *stats)
+{
+	ctx->stats = stats;
+}
+
 /*
  * operation_set_auto_reserve -- set auto reserve value for context
  */
@@ -652,7 +682,7 @@ operation_process_persistent_redo(struct operation_context *ctx)
 		&ctx->next, ctx->p_ops);
 
 	ulog_process(ctx->pshadow_ops.ulog, OBJ_OFF_IS_VALID_FROM_CTX,
-		ctx->p_ops);
+		ctx->flush_lines, ctx->p_ops);
 
 	ulog_clobber(ctx->ulog, &ctx->next, ctx->p_ops);
 }
@@ -665,7 +695,8 @@ operation_process_persistent_undo(struct operation_context *ctx)
 {
 	ASSERTeq(ctx->pshadow_ops.capacity % CACHELINE_SIZE, 0);
 
-	ulog_process(ctx->ulog, OBJ_OFF_IS_VALID_FROM_CTX, ctx->p_ops);
+	ulog_process(ctx->ulog, OBJ_OFF_IS_VALID_FROM_CTX, ctx->flush_lines,
+		ctx->p_ops);
 }
 
 /*
@@ -688,6 +719,9 @@ operation_reserve(struct operation_context *ctx, size_t new_capacity)
 		    &ctx->next, ctx->p_ops) != 0)
 			return -1;
 		ctx->ulog_capacity = new_capacity;
+
+		if (ctx->stats != NULL)
+			ctx->stats->extensions++;
 	}
 
 	return 0;
@@ -788,7 +822,7 @@ operation_process(struct operation_context *ctx)
 
 	/* process transient entries with transient memory ops */
 	if (ctx->transient_ops.offset != 0)
-		ulog_process(ctx->transient_ops.ulog, NULL, &ctx->t_ops);
+		ulog_process(ctx->transient_ops.ulog, NULL, NULL, &ctx->t_ops);
 }
 
 /*
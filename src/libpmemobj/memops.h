@@ -39,6 +39,14 @@ struct user_buffer_def {
 	size_t size;
 };
 
+/*
+ * operation_stats -- counters of the persistent log activity of an operation
+ */
+struct operation_stats {
+	uint64_t entries; /* number of entries stored in the persistent log */
+	uint64_t extensions; /* number of times the log had to be extended */
+};
+
 struct operation_context;
 
 struct operation_context *
@@ -65,6 +73,8 @@ int operation_user_buffer_verify_align(struct operation_context *ctx,
 		struct user_buffer_def *userbuf);
 void operation_add_user_buffer(struct operation_context *ctx,
 		struct user_buffer_def *userbuf);
+void operation_set_stats(struct operation_context *ctx,
+	struct operation_stats *stats);
 void operation_set_auto_reserve(struct operation_context *ctx,
 		int auto_reserve);
 void operation_set_any_user_buffer(struct operation_context *ctx,
@@ -8,6 +8,7 @@
 #include <limits.h>
 #include <wchar.h>
 #include <stdbool.h>
+#include <unistd.h>
 
 #include "valgrind_internal.h"
 #include "libpmem.h"
@@ -19,10 +20,12 @@
 #include "ctl_global.h"
 #include "ravl.h"
 
+#include "heap.h"
 #include "heap_layout.h"
 #include "os.h"
 #include "os_thread.h"
 #include "pmemops.h"
+#include "replica.h"
 #include "set.h"
 #include "sync.h"
 #include "tx.h"
@@ -65,10 +68,126 @@ static struct critnib *pools_tree; /* tree used for searching by address */
 
 int _pobj_cache_invalidate;
 
+/* number of pools remembered by the per-thread pool cache */
+#define OBJ_POOL_CACHE_ENTRIES 8
+
 #ifndef _WIN32
 
 __thread struct _pobj_pcache _pobj_cached_pool;
 
+/*
+ * Per-thread cache of the recently used pools, consulted before pools_ht.
+ * Unlike _pobj_cached_pool, which is a part of the ABI and remembers only
+ * the last pool, it keeps threads alternating between a few pools away
+ * from the critnib lookup.
+ */
+static __thread struct obj_pool_cache {
+	struct {
+		uint64_t uuid_lo;
+		PMEMobjpool *pop;
+	} entries[OBJ_POOL_CACHE_ENTRIES];
+	unsigned next; /* the entry to be replaced on a miss */
+	int invalidate;
+} Pool_cache;
+
+#endif /* _WIN32 */
+
+/*
+ * obj_pool_by_uuid -- (internal) returns the pool handle with given uuid_lo
+ */
+static PMEMobjpool *
+obj_pool_by_uuid(uint64_t uuid_lo)
+{
+	/* XXX this is a temporary fix, to be fixed properly later */
+	if (pools_ht == NULL)
+		return NULL;
+
+#ifndef _WIN32
+	struct obj_pool_cache *cache = &Pool_cache;
+	if (cache->invalidate != _pobj_cache_invalidate) {
+		memset(cache->entries, 0, sizeof(cache->entries));
+		cache->invalidate = _pobj_cache_invalidate;
+	}
+
+	for (unsigned i = 0; i < OBJ_POOL_CACHE_ENTRIES; ++i) {
+		if (cache->entries[i].uuid_lo == uuid_lo)
+			return cache->entries[i].pop;
+	}
+
+	PMEMobjpool *pop = critnib_get(pools_ht, uuid_lo);
+	if (pop != NULL) {
+		unsigned i = cache->next++ % OBJ_POOL_CACHE_ENTRIES;
+		cache->entries[i].uuid_lo = uuid_lo;
+		cache->entries[i].pop = pop;
+	}
+
+	return pop;
+#else
+	return critnib_get(pools_ht, uuid_lo);
+#endif
+}
+
+/*
+ * obj_prefetch -- (internal) hints the processor that addr is about to be
+ *	accessed
+ */
+static inline void
+obj_prefetch(const void *addr)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	__builtin_prefetch(addr);
+#else
+	(void) addr;
+#endif
+}
+
+/*
+ * pmemobj_direct_batch -- translates an array of object handles into direct
+ *	pointers, with one pool lookup per run of objects from the same pool
+ */
+int
+pmemobj_direct_batch(const PMEMoid *oids, void **ptrs, size_t noids,
+	unsigned flags)
+{
+	LOG(3, "oids %p ptrs %p noids %zu flags 0x%x", oids, ptrs, noids,
+		flags);
+
+	if (flags & ~POBJ_DIRECT_VALID_FLAGS) {
+		ERR("unknown flags 0x%x", flags & ~POBJ_DIRECT_VALID_FLAGS);
+		errno = EINVAL;
+		return -1;
+	}
+
+	uint64_t uuid_lo = 0;
+	PMEMobjpool *pop = NULL;
+
+	for (size_t i = 0; i < noids; ++i) {
+		PMEMoid oid = oids[i];
+		if (oid.off == 0 || oid.pool_uuid_lo == 0) {
+			ptrs[i] = NULL;
+			continue;
+		}
+
+		if (oid.pool_uuid_lo != uuid_lo) {
+			uuid_lo = oid.pool_uuid_lo;
+			pop = obj_pool_by_uuid(uuid_lo);
+		}
+
+		if (pop == NULL) {
+			ptrs[i] = NULL;
+			continue;
+		}
+
+		ptrs[i] = (void *)((uintptr_t)pop + oid.off);
+		if (flags & POBJ_DIRECT_PREFETCH)
+			obj_prefetch(ptrs[i]);
+	}
+
+	return 0;
+}
+
+#ifndef _WIN32
+
 /*
  * pmemobj_direct -- returns the direct pointer of an object
  */
@@ -164,6 +283,7 @@ obj_ctl_init_and_load(PMEMobjpool *pop)
 		pmalloc_ctl_register(pop);
 		stats_ctl_register(pop);
 		debug_ctl_register(pop);
+		replica_ctl_register(pop);
 	}
 
 	char *env_config = os_getenv(OBJ_CONFIG_ENV_VARIABLE);
@@ -403,6 +523,135 @@ obj_remote_persist(PMEMobjpool *pop, const void *addr, size_t len,
 	return 0;
 }
 
+/* smallest memcpy or memset split between several threads */
+#define OBJ_PARALLEL_MIN_LEN (1ULL << 26) /* 64 MiB */
+
+/* smallest part of a memcpy or memset worth a separate thread */
+#define OBJ_PARALLEL_MIN_THREAD_LEN (1ULL << 24) /* 16 MiB */
+
+/* more threads are unlikely to add any bandwidth */
+#define OBJ_PARALLEL_MAX_THREADS 4
+
+/*
+ * obj_parallel_op -- a memcpy or memset to a local replica split between
+ *	threads
+ */
+struct obj_parallel_op {
+	PMEMobjpool *rep;
+	char *dest;
+	const char *src; /* NULL for memset */
+	int c;
+	unsigned flags;
+};
+
+/*
+ * obj_parallel_part -- (internal) do a part of the operation
+ */
+static void
+obj_parallel_part(char *addr, size_t len, void *arg)
+{
+	struct obj_parallel_op *op = arg;
+
+	if (op->src)
+		op->rep->memcpy_local(addr, op->src + (addr - op->dest), len,
+			op->flags);
+	else
+		op->rep->memset_local(addr, op->c, len, op->flags);
+}
+
+/*
+ * obj_parallel_nthreads -- (internal) returns the number of threads which
+ *	should write a range of the given length
+ */
+static unsigned
+obj_parallel_nthreads(size_t len)
+{
+	if (len < OBJ_PARALLEL_MIN_LEN)
+		return 1;
+
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t nthreads = len / OBJ_PARALLEL_MIN_THREAD_LEN;
+	if (nthreads > OBJ_PARALLEL_MAX_THREADS)
+		nthreads = OBJ_PARALLEL_MAX_THREADS;
+	if (cpus >= 1 && nthreads > (size_t)cpus)
+		nthreads = (size_t)cpus;
+
+	return (unsigned)nthreads;
+}
+
+/*
+ * obj_parallel_exec -- (internal) execute the operation on up to nthreads
+ *	threads
+ */
+static void
+obj_parallel_exec(struct obj_parallel_op *op, size_t len, unsigned nthreads)
+{
+	/* the caller has no way to drain the stores of the other threads */
+	op->flags &= ~PMEM_F_MEM_NODRAIN;
+
+	util_parallel_range(op->dest, len, Pagesize, nthreads,
+		obj_parallel_part, op);
+}
+
+/*
+ * obj_memcpy_local -- (internal) memcpy to a local replica, large ranges are
+ *	split between threads, as a single core cannot saturate the media
+ */
+static void *
+obj_memcpy_local(PMEMobjpool *rep, void *dest, const void *src, size_t len,
+		unsigned flags)
+{
+	unsigned nthreads = obj_parallel_nthreads(len);
+	if (nthreads == 1)
+		return rep->memcpy_local(dest, src, len, flags);
+
+	struct obj_parallel_op op = {rep, dest, src, 0, flags};
+	obj_parallel_exec(&op, len, nthreads);
+
+	return dest;
+}
+
+/*
+ * obj_memset_local -- (internal) memset to a local replica, large ranges are
+ *	split between threads, as a single core cannot saturate the media
+ */
+static void *
+obj_memset_local(PMEMobjpool *rep, void *dest, int c, size_t len,
+		unsigned flags)
+{
+	unsigned nthreads = obj_parallel_nthreads(len);
+	if (nthreads == 1)
+		return rep->memset_local(dest, c, len, flags);
+
+	struct obj_parallel_op op = {rep, dest, NULL, c, flags};
+	obj_parallel_exec(&op, len, nthreads);
+
+	return dest;
+}
+
+/*
+ * obj_tx_stats -- (internal) accounts flushes and drains of the pool to
+ *	the profiled transaction of the calling thread
+ */
+static inline void
+obj_tx_stats(PMEMobjpool *pop, unsigned flushes, unsigned drains)
+{
+	if (pop->tx_stats_enabled)
+		tx_stats_persist_ops(pop, flushes, drains);
+}
+
+/*
+ * obj_tx_stats_mem -- (internal) accounts a persistent memcpy, memmove or
+ *	memset performed with the given flags
+ */
+static inline void
+obj_tx_stats_mem(PMEMobjpool *pop, unsigned flags)
+{
+	if (pop->tx_stats_enabled && !(flags & PMEMOBJ_F_MEM_NOFLUSH))
+		tx_stats_persist_ops(pop, 1,
+			(flags & PMEMOBJ_F_MEM_NODRAIN) ? 0 : 1);
+}
+
 /*
  * XXX - Consider removing obj_norep_*() wrappers to call *_local()
  * functions directly.  Alternatively, always use obj_rep_*(), even
@@ -420,7 +669,9 @@ obj_norep_memcpy(void *ctx, void *dest, const void *src, size_t len,
 	LOG(15, "pop %p dest %p src %p len %zu flags 0x%x", pop, dest, src, len,
 			flags);
 
-	return pop->memcpy_local(dest, src, len,
+	obj_tx_stats_mem(pop, flags);
+
+	return obj_memcpy_local(pop, dest, src, len,
 					flags & PMEM_F_MEM_VALID_FLAGS);
 }
 
@@ -435,6 +686,8 @@ obj_norep_memmove(void *ctx, void *dest, const void *src, size_t len,
 	LOG(15, "pop %p dest %p src %p len %zu flags 0x%x", pop, dest, src, len,
 			flags);
 
+	obj_tx_stats_mem(pop, flags);
+
 	return pop->memmove_local(dest, src, len,
 					flags & PMEM_F_MEM_VALID_FLAGS);
 }
@@ -449,7 +702,10 @@ obj_norep_memset(void *ctx, void *dest, int c, size_t len, unsigned flags)
 	LOG(15, "pop %p dest %p c 0x%02x len %zu flags 0x%x", pop, dest, c, len,
 			flags);
 
-	return pop->memset_local(dest, c, len, flags & PMEM_F_MEM_VALID_FLAGS);
+	obj_tx_stats_mem(pop, flags);
+
+	return obj_memset_local(pop, dest, c, len,
+					flags & PMEM_F_MEM_VALID_FLAGS);
 }
 
 /*
@@ -461,6 +717,8 @@ obj_norep_persist(void *ctx, const void *addr, size_t len, unsigned flags)
 	PMEMobjpool *pop = ctx;
 	LOG(15, "pop %p addr %p len %zu", pop, addr, len);
 
+	obj_tx_stats(pop, 1, 1);
+
 	pop->persist_local(addr, len);
 
 	return 0;
@@ -475,6 +733,8 @@ obj_norep_flush(void *ctx, const void *addr, size_t len, unsigned flags)
 	PMEMobjpool *pop = ctx;
 	LOG(15, "pop %p addr %p len %zu", pop, addr, len);
 
+	obj_tx_stats(pop, 1, 0);
+
 	pop->flush_local(addr, len);
 
 	return 0;
@@ -489,6 +749,8 @@ obj_norep_drain(void *ctx)
 	PMEMobjpool *pop = ctx;
 	LOG(15, "pop %p", pop);
 
+	obj_tx_stats(pop, 0, 1);
+
 	pop->drain_local();
 }
 
@@ -520,19 +782,27 @@ obj_rep_memcpy(void *ctx, void *dest, const void *src, size_t len,
 	LOG(15, "pop %p dest %p src %p len %zu flags 0x%x", pop, dest, src, len,
 			flags);
 
+	obj_tx_stats_mem(pop, flags);
+
 	unsigned lane = UINT_MAX;
 
 	if (pop->has_remote_replicas)
 		lane = lane_hold(pop, NULL);
 
-	void *ret = pop->memcpy_local(dest, src, len, flags);
+	struct replica_op op = {REPLICA_OP_MEMCPY,
+		(uintptr_t)dest - (uintptr_t)pop, src, 0, len, flags};
+	struct replica_fanout fanout;
+	replica_fanout_start(pop->rep_engine, &op, &fanout);
+
+	void *ret = obj_memcpy_local(pop, dest, src, len, flags);
 
 	PMEMobjpool *rep = pop->replica;
 	while (rep) {
 		void *rdest = (char *)rep + (uintptr_t)dest - (uintptr_t)pop;
 		if (rep->rpp == NULL) {
-			rep->memcpy_local(rdest, src, len,
-						flags & PMEM_F_MEM_VALID_FLAGS);
+			if (!replica_fanout_owns(&fanout, rep))
+				obj_memcpy_local(rep, rdest, src, len,
+					flags & PMEM_F_MEM_VALID_FLAGS);
 		} else {
 			if (rep->persist_remote(rep, rdest, len, lane, flags))
 				obj_handle_remote_persist_error(pop);
@@ -540,6 +810,8 @@ obj_rep_memcpy(void *ctx, void *dest, const void *src, size_t len,
 		rep = rep->replica;
 	}
 
+	replica_fanout_finish(&fanout);
+
 	if (pop->has_remote_replicas)
 		lane_release(pop);
 
@@ -557,19 +829,27 @@ obj_rep_memmove(void *ctx, void *dest, const void *src, size_t len,
 	LOG(15, "pop %p dest %p src %p len %zu flags 0x%x", pop, dest, src, len,
 			flags);
 
+	obj_tx_stats_mem(pop, flags);
+
 	unsigned lane = UINT_MAX;
 
 	if (pop->has_remote_replicas)
 		lane = lane_hold(pop, NULL);
 
+	struct replica_op op = {REPLICA_OP_MEMMOVE,
+		(uintptr_t)dest - (uintptr_t)pop, src, 0, len, flags};
+	struct replica_fanout fanout;
+	replica_fanout_start(pop->rep_engine, &op, &fanout);
+
 	void *ret = pop->memmove_local(dest, src, len, flags);
 
 	PMEMobjpool *rep = pop->replica;
 	while (rep) {
 		void *rdest = (char *)rep + (uintptr_t)dest - (uintptr_t)pop;
 		if (rep->rpp == NULL) {
-			rep->memmove_local(rdest, src, len,
-						flags & PMEM_F_MEM_VALID_FLAGS);
+			if (!replica_fanout_owns(&fanout, rep))
+				rep->memmove_local(rdest, src, len,
+					flags & PMEM_F_MEM_VALID_FLAGS);
 		} else {
 			if (rep->persist_remote(rep, rdest, len, lane, flags))
 				obj_handle_remote_persist_error(pop);
@@ -577,6 +857,8 @@ obj_rep_memmove(void *ctx, void *dest, const void *src, size_t len,
 		rep = rep->replica;
 	}
 
+	replica_fanout_finish(&fanout);
+
 	if (pop->has_remote_replicas)
 		lane_release(pop);
 
@@ -593,19 +875,27 @@ obj_rep_memset(void *ctx, void *dest, int c, size_t len, unsigned flags)
 	LOG(15, "pop %p dest %p c 0x%02x len %zu flags 0x%x", pop, dest, c, len,
 			flags);
 
+	obj_tx_stats_mem(pop, flags);
+
 	unsigned lane = UINT_MAX;
 
 	if (pop->has_remote_replicas)
 		lane = lane_hold(pop, NULL);
 
-	void *ret = pop->memset_local(dest, c, len, flags);
+	struct replica_op op = {REPLICA_OP_MEMSET,
+		(uintptr_t)dest - (uintptr_t)pop, NULL, c, len, flags};
+	struct replica_fanout fanout;
+	replica_fanout_start(pop->rep_engine, &op, &fanout);
+
+	void *ret = obj_memset_local(pop, dest, c, len, flags);
 
 	PMEMobjpool *rep = pop->replica;
 	while (rep) {
 		void *rdest = (char *)rep + (uintptr_t)dest - (uintptr_t)pop;
 		if (rep->rpp == NULL) {
-			rep->memset_local(rdest, c, len,
-						flags & PMEM_F_MEM_VALID_FLAGS);
+			if (!replica_fanout_owns(&fanout, rep))
+				obj_memset_local(rep, rdest, c, len,
+					flags & PMEM_F_MEM_VALID_FLAGS);
 		} else {
 			if (rep->persist_remote(rep, rdest, len, lane, flags))
 				obj_handle_remote_persist_error(pop);
@@ -613,6 +903,8 @@ obj_rep_memset(void *ctx, void *dest, int c, size_t len, unsigned flags)
 		rep = rep->replica;
 	}
 
+	replica_fanout_finish(&fanout);
+
 	if (pop->has_remote_replicas)
 		lane_release(pop);
 
@@ -628,18 +920,26 @@ obj_rep_persist(void *ctx, const void *addr, size_t len, unsigned flags)
 	PMEMobjpool *pop = ctx;
 	LOG(15, "pop %p addr %p len %zu", pop, addr, len);
 
+	obj_tx_stats(pop, 1, 1);
+
 	unsigned lane = UINT_MAX;
 
 	if (pop->has_remote_replicas)
 		lane = lane_hold(pop, NULL);
 
+	struct replica_op op = {REPLICA_OP_MEMCPY,
+		(uintptr_t)addr - (uintptr_t)pop, addr, 0, len, 0};
+	struct replica_fanout fanout;
+	replica_fanout_start(pop->rep_engine, &op, &fanout);
+
 	pop->persist_local(addr, len);
 
 	PMEMobjpool *rep = pop->replica;
 	while (rep) {
 		void *raddr = (char *)rep + (uintptr_t)addr - (uintptr_t)pop;
 		if (rep->rpp == NULL) {
-			rep->memcpy_local(raddr, addr, len, 0);
+			if (!replica_fanout_owns(&fanout, rep))
+				rep->memcpy_local(raddr, addr, len, 0);
 		} else {
 			if (rep->persist_remote(rep, raddr, len, lane, flags))
 				obj_handle_remote_persist_error(pop);
@@ -647,6 +947,8 @@ obj_rep_persist(void *ctx, const void *addr, size_t len, unsigned flags)
 		rep = rep->replica;
 	}
 
+	replica_fanout_finish(&fanout);
+
 	if (pop->has_remote_replicas)
 		lane_release(pop);
 
@@ -662,19 +964,28 @@ obj_rep_flush(void *ctx, const void *addr, size_t len, unsigned flags)
 	PMEMobjpool *pop = ctx;
 	LOG(15, "pop %p addr %p len %zu", pop, addr, len);
 
+	obj_tx_stats(pop, 1, 0);
+
 	unsigned lane = UINT_MAX;
 
 	if (pop->has_remote_replicas)
 		lane = lane_hold(pop, NULL);
 
+	struct replica_op op = {REPLICA_OP_MEMCPY,
+		(uintptr_t)addr - (uintptr_t)pop, addr, 0, len,
+		PMEM_F_MEM_NODRAIN};
+	struct replica_fanout fanout;
+	replica_fanout_start(pop->rep_engine, &op, &fanout);
+
 	pop->flush_local(addr, len);
 
 	PMEMobjpool *rep = pop->replica;
 	while (rep) {
 		void *raddr = (char *)rep + (uintptr_t)addr - (uintptr_t)pop;
 		if (rep->rpp == NULL) {
-			rep->memcpy_local(raddr, addr, len,
-				PMEM_F_MEM_NODRAIN);
+			if (!replica_fanout_owns(&fanout, rep))
+				rep->memcpy_local(raddr, addr, len,
+					PMEM_F_MEM_NODRAIN);
 		} else {
 			if (rep->persist_remote(rep, raddr, len, lane, flags))
 				obj_handle_remote_persist_error(pop);
@@ -682,6 +993,8 @@ obj_rep_flush(void *ctx, const void *addr, size_t len, unsigned flags)
 		rep = rep->replica;
 	}
 
+	replica_fanout_finish(&fanout);
+
 	if (pop->has_remote_replicas)
 		lane_release(pop);
 
@@ -697,6 +1010,8 @@ obj_rep_drain(void *ctx)
 	PMEMobjpool *pop = ctx;
 	LOG(15, "pop %p", pop);
 
+	obj_tx_stats(pop, 0, 1);
+
 	pop->drain_local();
 
 	PMEMobjpool *rep = pop->replica;
@@ -842,6 +1157,15 @@ obj_runtime_init_common(PMEMobjpool *pop)
 		return errno;
 	}
 
+	pop->heap.type_index = type_index_new(pop);
+	if (pop->heap.type_index == NULL) {
+		ERR("!type_index_new");
+		errno = ENOMEM;
+		lane_section_cleanup(pop);
+		lane_cleanup(pop);
+		return errno;
+	}
+
 	pop->conversion_flags = 0;
 	pmemops_persist(&pop->p_ops,
 		&pop->conversion_flags, sizeof(pop->conversion_flags));
@@ -857,6 +1181,8 @@ obj_runtime_init_common(PMEMobjpool *pop)
 static void
 obj_runtime_cleanup_common(PMEMobjpool *pop)
 {
+	type_index_delete(pop->heap.type_index);
+	pop->heap.type_index = NULL;
 	lane_section_cleanup(pop);
 	lane_cleanup(pop);
 }
@@ -924,11 +1250,18 @@ obj_descr_create(PMEMobjpool *pop, const char *layout, size_t poolsize)
 		sizeof(pop->conversion_flags));
 
 	/*
+	 * No types are indexed in a new pool, the type indexes are zeroed
+	 * together with the reserved area which follows them.
+	 *
 	 * It's safe to use PMEMOBJ_F_RELAXED flag because the reserved
 	 * area must be entirely zeroed.
 	 */
-	pmemops_memset(p_ops, pop->pmem_reserved, 0,
-		sizeof(pop->pmem_reserved), PMEMOBJ_F_RELAXED);
+	COMPILE_ERROR_ON(offsetof(struct pmemobjpool, pmem_reserved) !=
+		offsetof(struct pmemobjpool, type_index) +
+		sizeof(struct type_index_layout));
+	pmemops_memset(p_ops, &pop->type_index, 0,
+		sizeof(pop->type_index) + sizeof(pop->pmem_reserved),
+		PMEMOBJ_F_RELAXED);
 
 	return 0;
 }
@@ -1115,6 +1448,7 @@ obj_replica_init(PMEMobjpool *rep, struct pool_set *set, unsigned repidx,
 			rep->p_ops.memset = obj_norep_memset;
 		}
 		rep->p_ops.base = rep;
+		rep->tx_stats_enabled = 0;
 	} else {
 		/* non-master replicas */
 		rep->is_master_replica = 0;
@@ -1156,6 +1490,25 @@ obj_replica_fini(struct pool_replica *repset)
 		obj_cleanup_remote(rep);
 }
 
+/*
+ * obj_prefault_metadata -- (internal) forces page allocation for the pool
+ *	metadata, the whole pool is prefaulted instead unless prefault.lazy_data
+ *	is set
+ */
+static void
+obj_prefault_metadata(PMEMobjpool *pop, int create)
+{
+	if (!Prefault_lazy_data ||
+			!(create ? Prefault_at_create : Prefault_at_open))
+		return;
+
+	/* pool descriptor and lanes */
+	util_prefault(pop, pop->heap_offset);
+
+	heap_prefault_metadata((char *)pop + pop->heap_offset,
+		pop->set->poolsize - pop->heap_offset);
+}
+
 /*
  * obj_runtime_init -- (internal) initialize runtime part of the pool header
  */
@@ -1190,6 +1543,10 @@ obj_runtime_init(PMEMobjpool *pop, int rdonly, int boot, unsigned nlanes)
 	if (pop->stats == NULL)
 		goto err_stat;
 
+	pop->rep_engine = replica_engine_new(pop);
+	if (pop->rep_engine == NULL)
+		goto err_rep_engine;
+
 	pop->user_data = NULL;
 
 	VALGRIND_REMOVE_PMEM_MAPPING(&pop->mutex_head,
@@ -1243,6 +1600,8 @@ obj_runtime_init(PMEMobjpool *pop, int rdonly, int boot, unsigned nlanes)
 	}
 	pop->ulog_user_buffers.verify = 0;
 
+	replica_engine_start(pop->rep_engine);
+
 	/*
 	 * If possible, turn off all permissions on the pool header page.
 	 *
@@ -1264,6 +1623,9 @@ err_tree_insert:
 err_critnib_insert:
 	obj_runtime_cleanup_common(pop);
 err_boot:
+	replica_engine_delete(pop->rep_engine);
+	pop->rep_engine = NULL;
+err_rep_engine:
 	stats_delete(pop, pop->stats);
 err_stat:
 	tx_params_delete(pop->tx_params);
@@ -1384,6 +1746,8 @@ pmemobj_createU(const char *path, const char *layout,
 		goto err;
 	}
 
+	obj_prefault_metadata(pop, 1 /* create */);
+
 	/* initialize runtime parts - lanes, obj stores, ... */
 	if (obj_runtime_init(pop, 0, 1 /* boot */,
 					runtime_nlanes) != 0) {
@@ -1754,6 +2118,8 @@ obj_open_common(const char *path, const char *layout, unsigned flags, int boot)
 	 */
 	pop->lanes_desc.runtime_nlanes = 0;
 
+	obj_prefault_metadata(pop, 0 /* open */);
+
 #if VG_MEMCHECK_ENABLED
 	pop->vg_boot = boot;
 #endif
@@ -1918,12 +2284,16 @@ obj_pool_cleanup(PMEMobjpool *pop)
 	ravl_delete(pop->ulog_user_buffers.map);
 	util_mutex_destroy(&pop->ulog_user_buffers.lock);
 
+	replica_engine_delete(pop->rep_engine);
+	pop->rep_engine = NULL;
 	stats_delete(pop, pop->stats);
 	tx_params_delete(pop->tx_params);
 	ctl_delete(pop->ctl);
 
 	obj_pool_lock_cleanup(pop);
 
+	type_index_delete(pop->heap.type_index);
+	pop->heap.type_index = NULL;
 	lane_section_cleanup(pop);
 	lane_cleanup(pop);
 
@@ -2005,6 +2375,8 @@ pmemobj_checkU(const char *path, const char *layout)
 	if (consistent) {
 		obj_pool_cleanup(pop);
 	} else {
+		replica_engine_delete(pop->rep_engine);
+		pop->rep_engine = NULL;
 		stats_delete(pop, pop->stats);
 		tx_params_delete(pop->tx_params);
 		ctl_delete(pop->ctl);
@@ -2071,11 +2443,7 @@ pmemobj_pool_by_oid(PMEMoid oid)
 {
 	LOG(3, "oid.off 0x%016" PRIx64, oid.off);
 
-	/* XXX this is a temporary fix, to be fixed properly later */
-	if (pools_ht == NULL)
-		return NULL;
-
-	return critnib_get(pools_ht, oid.pool_uuid_lo);
+	return obj_pool_by_uuid(oid.pool_uuid_lo);
 }
 
 /*
@@ -2131,6 +2499,24 @@ pmemobj_get_user_data(PMEMobjpool *pop)
 	return pop->user_data;
 }
 
+/*
+ * pmemobj_replica_sync -- waits until the lazily updated replicas catch up
+ * with all the writes completed before the call
+ */
+int
+pmemobj_replica_sync(PMEMobjpool *pop)
+{
+	LOG(3, "pop %p", pop);
+
+	PMEMOBJ_API_START();
+
+	int ret = replica_engine_sync(pop->rep_engine);
+
+	PMEMOBJ_API_END();
+
+	return ret;
+}
+
 /* arguments for constructor_alloc */
 struct constr_args {
 	int zero_init;
@@ -2967,6 +3353,97 @@ pmemobj_next(PMEMoid oid)
 	return curr;
 }
 
+struct obj_foreach_ctx {
+	PMEMobjpool *pop;
+	uint64_t type_num;
+	uint64_t flags;
+	pmemobj_foreach_cb cb;
+	void *arg;
+	int ret;
+};
+
+/*
+ * obj_foreach_cb -- (internal) passes the matching objects to the user's
+ *	callback
+ */
+static int
+obj_foreach_cb(const struct memory_block *m, void *arg)
+{
+	struct obj_foreach_ctx *ctx = arg;
+
+	if (m->m_ops->get_flags(m) & OBJ_INTERNAL_OBJECT_MASK)
+		return 0;
+
+	if ((ctx->flags & POBJ_FOREACH_TYPE_NUM) &&
+			m->m_ops->get_extra(m) != ctx->type_num)
+		return 0;
+
+	PMEMoid oid;
+	oid.pool_uuid_lo = ctx->pop->uuid_lo;
+	oid.off = (uintptr_t)m->m_ops->get_user_data(m) - (uintptr_t)ctx->pop;
+
+	ctx->ret = ctx->cb(oid, ctx->arg);
+
+	return ctx->ret;
+}
+
+/*
+ * obj_foreach_index_cb -- (internal) passes the objects of an indexed type
+ *	to the user's callback
+ */
+static int
+obj_foreach_index_cb(uint64_t off, void *arg)
+{
+	struct obj_foreach_ctx *ctx = arg;
+
+	PMEMoid oid;
+	oid.pool_uuid_lo = ctx->pop->uuid_lo;
+	oid.off = off;
+
+	ctx->ret = ctx->cb(oid, ctx->arg);
+
+	return ctx->ret;
+}
+
+/*
+ * pmemobj_foreach_part -- calls cb for every object in one of the nparts
+ *	partitions of the pool
+ */
+int
+pmemobj_foreach_part(PMEMobjpool *pop, unsigned part, unsigned nparts,
+	uint64_t type_num, uint64_t flags, pmemobj_foreach_cb cb, void *arg)
+{
+	LOG(3, "pop %p part %u nparts %u type_num %" PRIu64 " flags 0x%"
+		PRIx64, pop, part, nparts, type_num, flags);
+
+	if (nparts == 0 || part >= nparts) {
+		ERR("invalid partition %u of %u", part, nparts);
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (flags & ~POBJ_FOREACH_VALID_FLAGS) {
+		ERR("unknown flags 0x%" PRIx64,
+			flags & ~POBJ_FOREACH_VALID_FLAGS);
+		errno = EINVAL;
+		return -1;
+	}
+
+	PMEMOBJ_API_START();
+
+	struct obj_foreach_ctx ctx = {pop, type_num, flags, cb, arg, 0};
+
+	/* objects of an indexed type are found without scanning the heap */
+	if (!(flags & POBJ_FOREACH_TYPE_NUM) ||
+			type_index_foreach(pop->heap.type_index, type_num,
+			part, nparts, obj_foreach_index_cb, &ctx) != 0)
+		palloc_foreach_part(&pop->heap, part, nparts,
+			obj_foreach_cb, &ctx);
+
+	PMEMOBJ_API_END();
+	return ctx.ret;
+}
+
 /*
  * pmemobj_reserve -- reserves a single object
  */
@@ -3234,6 +3711,101 @@ pmemobj_list_remove(PMEMobjpool *pop, size_t pe_offset, void *head,
 	return ret;
 }
 
+/*
+ * pmemobj_list_insert_batch -- adds a chain of existing objects to a list
+ */
+int
+pmemobj_list_insert_batch(PMEMobjpool *pop, size_t pe_offset, void *head,
+		PMEMoid dest, int before, const PMEMoid *oids, size_t noids)
+{
+	LOG(3, "pop %p pe_offset %zu head %p dest.off 0x%016" PRIx64
+	    " before %d oids %p noids %zu",
+	    pop, pe_offset, head, dest.off, before, oids, noids);
+
+	/* log notice message if used inside a transaction */
+	_POBJ_DEBUG_NOTICE_IN_TX();
+	ASSERT(OBJ_OID_IS_VALID(pop, dest));
+
+	if (noids == 0)
+		return 0;
+
+	PMEMOBJ_API_START();
+
+	int ret = list_insert_batch(pop, (ssize_t)pe_offset, head, dest,
+		before, oids, noids);
+
+	PMEMOBJ_API_END();
+	return ret;
+}
+
+/*
+ * pmemobj_list_insert_new_batch -- adds a chain of new objects to a list
+ */
+int
+pmemobj_list_insert_new_batch(PMEMobjpool *pop, size_t pe_offset, void *head,
+			PMEMoid dest, int before, size_t size,
+			uint64_t type_num, pmemobj_constr constructor,
+			void *arg, PMEMoid *oids, size_t noids)
+{
+	LOG(3, "pop %p pe_offset %zu head %p dest.off 0x%016" PRIx64
+	    " before %d size %zu type_num %" PRIu64 " noids %zu",
+	    pop, pe_offset, head, dest.off, before, size, type_num, noids);
+
+	/* log notice message if used inside a transaction */
+	_POBJ_DEBUG_NOTICE_IN_TX();
+	ASSERT(OBJ_OID_IS_VALID(pop, dest));
+
+	ASSERT(pe_offset <= size - sizeof(struct list_entry));
+
+	if (size > PMEMOBJ_MAX_ALLOC_SIZE) {
+		ERR("requested size too large");
+		errno = ENOMEM;
+		return -1;
+	}
+
+	if (noids == 0)
+		return 0;
+
+	PMEMOBJ_API_START();
+	struct constr_args carg;
+
+	carg.constructor = constructor;
+	carg.arg = arg;
+	carg.zero_init = 0;
+
+	int ret = list_insert_new_batch_user(pop, pe_offset, head, dest,
+		before, size, type_num, constructor_alloc, &carg,
+		oids, noids);
+
+	PMEMOBJ_API_END();
+	return ret;
+}
+
+/*
+ * pmemobj_list_remove_batch -- removes objects from a list
+ */
+int
+pmemobj_list_remove_batch(PMEMobjpool *pop, size_t pe_offset, void *head,
+		const PMEMoid *oids, size_t noids, int free)
+{
+	LOG(3, "pop %p pe_offset %zu head %p oids %p noids %zu free %d",
+	    pop, pe_offset, head, oids, noids, free);
+
+	/* log notice message if used inside a transaction */
+	_POBJ_DEBUG_NOTICE_IN_TX();
+
+	if (noids == 0)
+		return 0;
+
+	PMEMOBJ_API_START();
+
+	int ret = list_remove_batch(pop, (ssize_t)pe_offset, head,
+		oids, noids, free);
+
+	PMEMOBJ_API_END();
+	return ret;
+}
+
 /*
  * pmemobj_list_move -- moves object between lists
  */
@@ -19,6 +19,7 @@
 #include "stats.h"
 #include "ctl_debug.h"
 #include "page_size.h"
+#include "type_index.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -38,8 +39,10 @@ extern "C" {
 #define OBJ_FORMAT_FEAT_DEFAULT \
 	{POOL_FEAT_COMPAT_DEFAULT, POOL_FEAT_INCOMPAT_DEFAULT, 0x0000}
 
+/* only libpmemobj updates replicas lazily */
 #define OBJ_FORMAT_FEAT_CHECK \
-	{POOL_FEAT_COMPAT_VALID, POOL_FEAT_INCOMPAT_VALID, 0x0000}
+	{POOL_FEAT_COMPAT_VALID, POOL_FEAT_INCOMPAT_VALID | POOL_FEAT_LAG, \
+	0x0000}
 
 static const features_t obj_format_feat_default = OBJ_FORMAT_FEAT_CHECK;
 
@@ -63,6 +66,11 @@ static const features_t obj_format_feat_default = OBJ_FORMAT_FEAT_CHECK;
 	(off) < (pop)->lanes_offset +\
 	(pop)->nlanes * sizeof(struct lane_layout))
 
+#define OBJ_OFF_FROM_TYPE_INDEX(pop, off)\
+	((off) >= OBJ_PTR_TO_OFF(pop, &(pop)->type_index) &&\
+	(off) < OBJ_PTR_TO_OFF(pop, &(pop)->type_index) +\
+	sizeof(struct type_index_layout))
+
 #define OBJ_PTR_FROM_POOL(pop, ptr)\
 	((uintptr_t)(ptr) >= (uintptr_t)(pop) &&\
 	(uintptr_t)(ptr) < (uintptr_t)(pop) +\
@@ -72,6 +80,7 @@ static const features_t obj_format_feat_default = OBJ_FORMAT_FEAT_CHECK;
 	(OBJ_OFF_FROM_HEAP(pop, off) ||\
 	(OBJ_PTR_TO_OFF(pop, &(pop)->root_offset) == (off)) ||\
 	(OBJ_PTR_TO_OFF(pop, &(pop)->root_size) == (off)) ||\
+	(OBJ_OFF_FROM_TYPE_INDEX(pop, off)) ||\
 	(OBJ_OFF_FROM_LANES(pop, off)))
 
 #define OBJ_PTR_IS_VALID(pop, ptr)\
@@ -95,7 +104,7 @@ typedef uint64_t type_num_t;
 #define CONVERSION_FLAG_OLD_SET_CACHE ((1ULL) << 0)
 
 /* PMEM_OBJ_POOL_HEAD_SIZE Without the unused and unused2 arrays */
-#define PMEM_OBJ_POOL_HEAD_SIZE 2196
+#define PMEM_OBJ_POOL_HEAD_SIZE 2236
 #define PMEM_OBJ_POOL_UNUSED2_SIZE (PMEM_PAGESIZE \
 					- OBJ_DSC_P_UNUSED\
 					- PMEM_OBJ_POOL_HEAD_SIZE)
@@ -129,7 +138,9 @@ struct pmemobjpool {
 
 	struct stats_persistent stats_persistent;
 
-	char pmem_reserved[496]; /* must be zeroed */
+	struct type_index_layout type_index; /* see type_index.c */
+
+	char pmem_reserved[296]; /* must be zeroed */
 
 	/* some run-time state, allocated out of memory pool... */
 	void *addr;		/* mapped region */
@@ -171,8 +182,10 @@ struct pmemobjpool {
 
 	int vg_boot;
 	int tx_debug_skip_expensive_checks;
+	int tx_stats_enabled; /* collect statistics of each transaction */
 
 	struct tx_parameters *tx_params;
+	struct replica_engine *rep_engine; /* fan-out of local replication */
 
 	/*
 	 * Locks are dynamically allocated on FreeBSD. Keep track so
@@ -28,9 +28,10 @@
  *	by the upper layer.
  *
  * General lock ordering:
- *	1. arenas.lock
- *	2. buckets (sorted by ID)
- *	3. memory blocks (sorted by lock address)
+ *	1. type index lock
+ *	2. arenas.lock
+ *	3. buckets (sorted by ID)
+ *	4. memory blocks (sorted by lock address)
  */
 
 #include "valgrind_internal.h"
@@ -41,6 +42,7 @@
 #include "sys_util.h"
 #include "palloc.h"
 #include "ravl.h"
+#include "type_index.h"
 #include "vec.h"
 
 struct pobj_action_internal {
@@ -515,6 +517,69 @@ palloc_action_compare(const void *lhs, const void *rhs)
 	return 0;
 }
 
+/*
+ * palloc_type_index_prepare -- (internal) adds the updates of the type
+ *	indexes of the allocated and freed objects to the operation, returns
+ *	the locked indexes if there are any updates and the number of inserts
+ */
+static struct type_index *
+palloc_type_index_prepare(struct palloc_heap *heap,
+	struct operation_context *ctx,
+	struct pobj_action_internal *actv,
+	size_t actvcnt, uint64_t *ninserts)
+{
+	struct type_index *ti = heap->type_index;
+	if (ti == NULL || type_index_empty(ti))
+		return NULL;
+
+	int locked = 0;
+	*ninserts = 0;
+
+	struct pobj_action_internal *act;
+	for (size_t i = 0; i < actvcnt; ++i) {
+		act = &actv[i];
+		if (act->type != POBJ_ACTION_TYPE_HEAP)
+			continue;
+
+		uint64_t type_num = act->m.m_ops->get_extra(&act->m);
+		if (!type_index_tracks(ti, type_num,
+				act->m.m_ops->get_flags(&act->m)))
+			continue;
+
+		if (!locked) {
+			type_index_lock(ti);
+			locked = 1;
+		}
+
+		if (act->new_state == MEMBLOCK_ALLOCATED)
+			(*ninserts)++;
+	}
+
+	if (!locked)
+		return NULL;
+
+	/* might allocate a bigger table, before any of the locks is taken */
+	type_index_prepare(ti, *ninserts);
+
+	for (size_t i = 0; i < actvcnt; ++i) {
+		act = &actv[i];
+		if (act->type != POBJ_ACTION_TYPE_HEAP)
+			continue;
+
+		uint64_t type_num = act->m.m_ops->get_extra(&act->m);
+		if (!type_index_tracks(ti, type_num,
+				act->m.m_ops->get_flags(&act->m)))
+			continue;
+
+		if (act->new_state == MEMBLOCK_ALLOCATED)
+			type_index_insert(ti, ctx, type_num, act->offset);
+		else
+			type_index_remove(ti, ctx, type_num, act->offset);
+	}
+
+	return ti;
+}
+
 /*
  * palloc_exec_actions -- perform the provided free/alloc operations
  */
@@ -535,6 +600,10 @@ palloc_exec_actions(struct palloc_heap *heap,
 		ASSERTeq(actvcnt, 0);
 	}
 
+	uint64_t ninserts;
+	struct type_index *ti = palloc_type_index_prepare(heap, ctx,
+		actv, actvcnt, &ninserts);
+
 	struct pobj_action_internal *act;
 	for (size_t i = 0; i < actvcnt; ++i) {
 		act = &actv[i];
@@ -561,6 +630,9 @@ palloc_exec_actions(struct palloc_heap *heap,
 	/* perform all persistent memory operations */
 	operation_process(ctx);
 
+	if (ti != NULL)
+		type_index_unlock(ti, ninserts);
+
 	for (size_t i = 0; i < actvcnt; ++i) {
 		act = &actv[i];
 
@@ -1236,6 +1308,17 @@ palloc_next(struct palloc_heap *heap, uint64_t off)
 	return HEAP_PTR_TO_OFF(heap, uptr);
 }
 
+/*
+ * palloc_foreach_part -- iterates through the objects in one of nparts
+ *	partitions of the heap, stops if the callback returns non-zero
+ */
+int
+palloc_foreach_part(struct palloc_heap *heap, unsigned part, unsigned nparts,
+	object_callback cb, void *arg)
+{
+	return heap_foreach_object_part(heap, cb, arg, part, nparts);
+}
+
 /*
  * palloc_boot -- initializes allocator section
  */
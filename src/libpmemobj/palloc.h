@@ -36,6 +36,8 @@ struct palloc_heap {
 	void *base;
 
 	int alloc_pattern;
+
+	struct type_index *type_index; /* indexes of the objects by type */
 };
 
 struct memory_block;
@@ -76,6 +78,12 @@ palloc_set_value(struct palloc_heap *heap, struct pobj_action *act,
 uint64_t palloc_first(struct palloc_heap *heap);
 uint64_t palloc_next(struct palloc_heap *heap, uint64_t off);
 
+/* foreach callback, terminates iteration if return value is non-zero */
+typedef int (*object_callback)(const struct memory_block *m, void *arg);
+
+int palloc_foreach_part(struct palloc_heap *heap, unsigned part,
+	unsigned nparts, object_callback cb, void *arg);
+
 size_t palloc_usable_size(struct palloc_heap *heap, uint64_t off);
 uint64_t palloc_extra(struct palloc_heap *heap, uint64_t off);
 uint16_t palloc_flags(struct palloc_heap *heap, uint64_t off);
@@ -99,9 +107,6 @@ size_t palloc_heap(void *heap_start);
 int palloc_defrag(struct palloc_heap *heap, uint64_t **objv, size_t objcnt,
 	struct operation_context *ctx, struct pobj_defrag_result *result);
 
-/* foreach callback, terminates iteration if return value is non-zero */
-typedef int (*object_callback)(const struct memory_block *m, void *arg);
-
 #if VG_MEMCHECK_ENABLED
 void palloc_heap_vg_open(struct palloc_heap *heap, int objects);
 #endif
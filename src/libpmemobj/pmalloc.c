@@ -170,6 +170,29 @@ pfree(PMEMobjpool *pop, uint64_t *off)
 	pmalloc_operation_release(pop);
 }
 
+/*
+ * pfree_replace -- deallocates a memory block previously allocated by pmalloc
+ *	and replaces its offset with the one in new_off
+ *
+ * Both the offset and the new offset variables are updated atomically with
+ * the deallocation, the latter is zeroed.
+ */
+void
+pfree_replace(PMEMobjpool *pop, uint64_t *off, uint64_t *new_off)
+{
+	struct operation_context *ctx =
+		pmalloc_operation_hold_type(pop, OPERATION_INTERNAL, 1);
+
+	uint64_t old_off = *off;
+	operation_add_entry(ctx, off, *new_off, ULOG_OPERATION_SET);
+
+	int ret = palloc_operation(&pop->heap, old_off, new_off, 0, NULL, NULL,
+		0, 0, 0, 0, ctx);
+	ASSERTeq(ret, 0);
+
+	pmalloc_operation_release(pop);
+}
+
 /*
  * pmalloc_boot -- global runtime init routine of allocator section
  */
@@ -777,12 +800,62 @@ static const struct ctl_node CTL_NODE(thread)[] = {
 	CTL_NODE_END
 };
 
+/*
+ * CTL_RUNNABLE_HANDLER(create, type_index) -- creates the index of the
+ *	objects of the given type
+ */
+static int
+CTL_RUNNABLE_HANDLER(create, type_index)(void *ctx,
+	enum ctl_query_source source, void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+
+	uint64_t type_num = *(uint64_t *)arg;
+
+	int ret = type_index_create(pop->heap.type_index, type_num);
+	if (ret != 0) {
+		errno = ret;
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * CTL_RUNNABLE_HANDLER(destroy, type_index) -- removes the index of the
+ *	objects of the given type
+ */
+static int
+CTL_RUNNABLE_HANDLER(destroy, type_index)(void *ctx,
+	enum ctl_query_source source, void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+
+	uint64_t type_num = *(uint64_t *)arg;
+
+	int ret = type_index_destroy(pop->heap.type_index, type_num);
+	if (ret != 0) {
+		errno = ret;
+		return -1;
+	}
+
+	return 0;
+}
+
+static const struct ctl_node CTL_NODE(type_index)[] = {
+	CTL_LEAF_RUNNABLE(create, type_index),
+	CTL_LEAF_RUNNABLE(destroy, type_index),
+
+	CTL_NODE_END
+};
+
 static const struct ctl_node CTL_NODE(heap)[] = {
 	CTL_CHILD(alloc_class),
 	CTL_CHILD(arena),
 	CTL_CHILD(size),
 	CTL_CHILD(thread),
 	CTL_CHILD(narenas),
+	CTL_CHILD(type_index),
 
 	CTL_NODE_END
 };
@@ -31,6 +31,7 @@ int prealloc(PMEMobjpool *pop, uint64_t *off, size_t size,
 	uint64_t extra_field, uint16_t object_flags);
 
 void pfree(PMEMobjpool *pop, uint64_t *off);
+void pfree_replace(PMEMobjpool *pop, uint64_t *off, uint64_t *new_off);
 
 /* external operation to be used together with context-aware palloc funcs */
 
@@ -0,0 +1,1065 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2020, Intel Corporation */
+
+/*
+ * replica.c -- local replication engine
+ *
+ * Every local replica (other than the master) gets a worker thread, bound to
+ * the NUMA node of the replica's memory. Large writes are handed off to the
+ * workers, so that the copies to all replicas and the write to the master
+ * replica happen concurrently instead of one after another.
+ *
+ * A worker executes one write at a time. If it is busy with a write of
+ * another thread, the caller mirrors the write to that replica by itself,
+ * so concurrent writers never wait for each other.
+ *
+ * A replica can also be switched to the lazy mode, in which writes are not
+ * mirrored at all. Instead, the written ranges are recorded in an interval
+ * tree and the worker copies them from the master replica in the background.
+ * Before a write is made to the master replica, the range of the lagging
+ * replica which may be stale is extended in its pool header and persisted,
+ * so that after a crash the replica can be brought up to date by copying
+ * only that range. The range grows in large aligned steps and is kept until
+ * the replica is synced explicitly, so the header is rarely written. While it
+ * is set, the replica is also marked with an incompat feature, so software
+ * unaware of the range refuses to open the pool.
+ */
+
+#include <endian.h>
+
+#include "ctl.h"
+#include "libpmem.h"
+#include "obj.h"
+#include "os_thread.h"
+#include "out.h"
+#include "ravl_interval.h"
+#include "replica.h"
+#include "set.h"
+#include "sys_util.h"
+#include "util.h"
+
+enum replica_worker_state {
+	REPLICA_WORKER_IDLE,
+	REPLICA_WORKER_PENDING, /* the write was submitted */
+	REPLICA_WORKER_DONE, /* the write is persistent in the replica */
+};
+
+/* range of the pool not copied to a lagging replica yet */
+struct replica_range {
+	size_t begin;
+	size_t end;
+};
+
+struct replica_worker {
+	PMEMobjpool *pop; /* the master replica */
+	PMEMobjpool *rep;
+	unsigned repn; /* index of the replica in the pool set */
+	os_thread_t thread;
+
+	int busy; /* claimed by a submitter */
+	int lagging; /* writes to the replica have to be recorded */
+
+	os_mutex_t lock;
+	os_cond_t job_cond;
+	os_cond_t done_cond;
+	os_cond_t synced_cond; /* signaled when lag or inflight drops to 0 */
+	enum replica_worker_state state;
+	int stop;
+	struct replica_op op;
+
+	int lazy; /* writes are not mirrored by the callers */
+	int failed; /* a write could not be recorded */
+	struct ravl_interval *dirty; /* ranges to be copied to the replica */
+	size_t lag; /* number of bytes in the dirty ranges */
+	unsigned inflight; /* writes which are not recorded yet */
+	int copying; /* a dirty range is being copied */
+};
+
+struct replica_engine {
+	PMEMobjpool *pop; /* the master replica */
+
+	int enabled;
+	size_t threshold;
+
+	os_mutex_t lock; /* serializes starting of the workers */
+	int started; /* the pool is open, workers may be started */
+	unsigned nrunning; /* number of started workers */
+
+	unsigned nworkers;
+	struct replica_worker workers[];
+};
+
+/*
+ * replica_range_min -- (internal) returns the beginning of the range
+ */
+static size_t
+replica_range_min(void *addr)
+{
+	return ((struct replica_range *)addr)->begin;
+}
+
+/*
+ * replica_range_max -- (internal) returns the end of the range
+ */
+static size_t
+replica_range_max(void *addr)
+{
+	return ((struct replica_range *)addr)->end;
+}
+
+/*
+ * replica_lag_supported -- (internal) returns whether the stale range can be
+ *	kept in the header of the replica, it is out of the checksummed part
+ *	of the header only with the CKSUM_2K feature
+ */
+static int
+replica_lag_supported(PMEMobjpool *rep)
+{
+	return (le32toh(rep->hdr.features.incompat) & POOL_FEAT_CKSUM_2K) != 0;
+}
+
+/*
+ * replica_lag_feature -- (internal) sets or clears the incompat feature of
+ *	the replica with a stale range
+ */
+static void
+replica_lag_feature(PMEMobjpool *rep, int lagging)
+{
+	struct pool_hdr *hdr = &rep->hdr;
+	uint32_t incompat = le32toh(hdr->features.incompat);
+	if (((incompat & POOL_FEAT_LAG) != 0) == (lagging != 0))
+		return;
+
+	if (lagging)
+		incompat |= POOL_FEAT_LAG;
+	else
+		incompat &= ~POOL_FEAT_LAG;
+
+	hdr->features.incompat = htole32(incompat);
+	util_checksum(hdr, sizeof(*hdr), &hdr->checksum, 1,
+		POOL_HDR_CSUM_END_OFF(hdr));
+	rep->persist_local(hdr, sizeof(*hdr));
+}
+
+/*
+ * replica_lag_extend -- (internal) makes sure the range of the pool is
+ *	marked as stale in the header of the replica, must be called before
+ *	the range is modified in the master replica
+ */
+static void
+replica_lag_extend(PMEMobjpool *rep, size_t off, size_t len)
+{
+	struct pool_hdr_lag *lag = &rep->hdr.lag;
+	uint64_t begin = le64toh(lag->begin);
+	uint64_t end = le64toh(lag->end);
+
+	if (end != 0 && begin <= off && off + len <= end)
+		return;
+
+	uint64_t new_begin = ALIGN_DOWN(off, REPLICA_LAG_ALIGN);
+	uint64_t new_end = ALIGN_UP(off + len, REPLICA_LAG_ALIGN);
+	if (end == 0) {
+		/* the feature is set before and cleared after the marker */
+		replica_lag_feature(rep, 1);
+	} else {
+		new_begin = MIN(begin, new_begin);
+		new_end = MAX(end, new_end);
+	}
+
+	/*
+	 * Both fields are persisted at once, every intermediate state still
+	 * covers the previous range.
+	 */
+	lag->begin = htole64(new_begin);
+	lag->end = htole64(new_end);
+	rep->persist_local(lag, sizeof(*lag));
+}
+
+/*
+ * replica_lag_clear -- (internal) marks the replica as up to date
+ */
+static void
+replica_lag_clear(PMEMobjpool *rep)
+{
+	struct pool_hdr_lag *lag = &rep->hdr.lag;
+	if (lag->end != 0) {
+		lag->end = 0;
+		lag->begin = 0;
+		rep->persist_local(lag, sizeof(*lag));
+	}
+
+	replica_lag_feature(rep, 0);
+}
+
+/*
+ * replica_lag_recover -- (internal) copies the range marked as stale after
+ *	an interrupted catch-up of the replica
+ */
+static void
+replica_lag_recover(PMEMobjpool *pop, PMEMobjpool *rep)
+{
+	struct pool_hdr_lag *lag = &rep->hdr.lag;
+	size_t begin = MAX(le64toh(lag->begin), sizeof(struct pool_hdr));
+	size_t end = MIN(le64toh(lag->end), pop->set->poolsize);
+
+	if (begin < end) {
+		LOG(3, "replica %p catching up, range 0x%zx-0x%zx", rep,
+			begin, end);
+
+		rep->memcpy_local((char *)rep + begin, (char *)pop + begin,
+			end - begin, PMEM_F_MEM_NODRAIN);
+		rep->drain_local();
+	}
+
+	/* the feature could also be left set without the marker */
+	replica_lag_clear(rep);
+}
+
+/*
+ * replica_dirty_add -- (internal) records the range as not copied to
+ *	the replica, merging it with the overlapping and adjacent ranges
+ */
+static int
+replica_dirty_add(struct replica_worker *w, size_t off, size_t len)
+{
+	if (len == 0)
+		return 0;
+
+	struct replica_range *range = Malloc(sizeof(*range));
+	if (range == NULL) {
+		ERR("!Malloc");
+		return -1;
+	}
+
+	range->begin = off;
+	range->end = off + len;
+
+	struct replica_range key;
+	struct ravl_interval_node *node;
+	while (1) {
+		key.begin = range->begin == 0 ? 0 : range->begin - 1;
+		key.end = range->end + 1;
+
+		node = ravl_interval_find(w->dirty, &key);
+		if (node == NULL)
+			break;
+
+		struct replica_range *r = ravl_interval_data(node);
+		range->begin = MIN(range->begin, r->begin);
+		range->end = MAX(range->end, r->end);
+		w->lag -= r->end - r->begin;
+
+		ravl_interval_remove(w->dirty, node);
+		Free(r);
+	}
+
+	if (ravl_interval_insert(w->dirty, range) != 0) {
+		ERR("!ravl_interval_insert");
+		Free(range);
+		return -1;
+	}
+
+	w->lag += range->end - range->begin;
+
+	return 0;
+}
+
+/*
+ * replica_dirty_take -- (internal) removes any dirty range from the tree
+ */
+static struct replica_range *
+replica_dirty_take(struct replica_worker *w)
+{
+	struct replica_range key = {0, SIZE_MAX};
+	struct ravl_interval_node *node = ravl_interval_find(w->dirty, &key);
+	if (node == NULL)
+		return NULL;
+
+	struct replica_range *range = ravl_interval_data(node);
+	ravl_interval_remove(w->dirty, node);
+	w->lag -= range->end - range->begin;
+
+	return range;
+}
+
+/*
+ * replica_worker_catch_up -- (internal) copies one dirty range from
+ *	the master replica, called with the worker lock held
+ */
+static void
+replica_worker_catch_up(PMEMobjpool *pop, struct replica_worker *w)
+{
+	struct replica_range *range = replica_dirty_take(w);
+	ASSERTne(range, NULL);
+
+	w->copying = 1;
+	util_mutex_unlock(&w->lock);
+
+	PMEMobjpool *rep = w->rep;
+	rep->memcpy_local((char *)rep + range->begin,
+		(char *)pop + range->begin, range->end - range->begin,
+		PMEM_F_MEM_NODRAIN);
+	rep->drain_local();
+	Free(range);
+
+	util_mutex_lock(&w->lock);
+	w->copying = 0;
+
+	if (w->lag != 0)
+		return;
+
+	os_cond_broadcast(&w->synced_cond);
+
+	/* the marker of a lazy replica stays until it's synced explicitly */
+	if (w->inflight != 0 || w->lazy)
+		return;
+
+	/* the marker stays if some write was lost, so it's fixed on open */
+	if (!w->failed)
+		replica_lag_clear(rep);
+
+	util_atomic_store_explicit32(&w->lagging, 0, memory_order_release);
+}
+
+/*
+ * replica_worker_catch_up_all -- (internal) copies all dirty ranges by
+ *	the calling thread and stops the tracking of writes to the replica,
+ *	called with the worker lock held
+ */
+static void
+replica_worker_catch_up_all(PMEMobjpool *pop, struct replica_worker *w)
+{
+	ASSERTeq(w->lazy, 0);
+
+	while (w->lagging) {
+		if (w->lag != 0) {
+			replica_worker_catch_up(pop, w);
+			continue;
+		}
+
+		if (w->inflight == 0) {
+			if (!w->failed)
+				replica_lag_clear(w->rep);
+			util_atomic_store_explicit32(&w->lagging, 0,
+				memory_order_release);
+			break;
+		}
+
+		/* wait for the pending writes to be recorded */
+		os_cond_wait(&w->synced_cond, &w->lock);
+	}
+}
+
+/*
+ * replica_op_execute -- (internal) mirrors the write to the replica
+ */
+static void
+replica_op_execute(PMEMobjpool *rep, const struct replica_op *op)
+{
+	void *dest = (char *)rep + op->off;
+	unsigned flags = (op->flags & PMEM_F_MEM_VALID_FLAGS) |
+		PMEM_F_MEM_NODRAIN;
+
+	switch (op->type) {
+		case REPLICA_OP_MEMCPY:
+			rep->memcpy_local(dest, op->src, op->len, flags);
+			break;
+		case REPLICA_OP_MEMSET:
+			rep->memset_local(dest, op->c, op->len, flags);
+			break;
+		default:
+			ASSERT(0);
+	}
+
+	/* a drain of the submitter does not cover stores of this thread */
+	rep->drain_local();
+}
+
+/*
+ * replica_worker_run -- (internal) worker thread routine
+ */
+static void *
+replica_worker_run(void *arg)
+{
+	struct replica_worker *w = arg;
+	PMEMobjpool *pop = w->pop;
+
+	unsigned node;
+	if (os_numa_node_count() > 1 &&
+			os_numa_node_of_addr(w->rep, &node) == 0 &&
+			os_thread_bind_numa_node(node) != 0)
+		LOG(2, "cannot bind replica worker to node %u", node);
+
+	util_mutex_lock(&w->lock);
+	while (1) {
+		while (w->state != REPLICA_WORKER_PENDING && !w->stop &&
+				w->lag == 0)
+			os_cond_wait(&w->job_cond, &w->lock);
+
+		if (w->stop)
+			break;
+
+		/* writes waited for by their callers go first */
+		if (w->state != REPLICA_WORKER_PENDING) {
+			replica_worker_catch_up(pop, w);
+			continue;
+		}
+
+		util_mutex_unlock(&w->lock);
+		replica_op_execute(w->rep, &w->op);
+		util_mutex_lock(&w->lock);
+
+		w->state = REPLICA_WORKER_DONE;
+		os_cond_signal(&w->done_cond);
+	}
+	util_mutex_unlock(&w->lock);
+
+	return NULL;
+}
+
+/*
+ * replica_engine_new -- creates the replication engine of the pool, workers
+ *	are not started until replica_engine_start is called
+ */
+struct replica_engine *
+replica_engine_new(PMEMobjpool *pop)
+{
+	unsigned nworkers = 0;
+	for (PMEMobjpool *rep = pop->replica; rep != NULL; rep = rep->replica) {
+		if (rep->rpp != NULL)
+			continue;
+
+		/* catch-up of the replica could have been interrupted */
+		replica_lag_recover(pop, rep);
+
+		if (nworkers < REPLICA_FANOUT_MAX)
+			nworkers++;
+	}
+
+	struct replica_engine *engine = Zalloc(sizeof(*engine) +
+		sizeof(struct replica_worker) * nworkers);
+	if (engine == NULL) {
+		ERR("!Zalloc");
+		return NULL;
+	}
+
+	engine->pop = pop;
+	engine->enabled = 1;
+	engine->threshold = REPLICA_FANOUT_THRESHOLD_DEFAULT;
+	util_mutex_init(&engine->lock);
+
+	unsigned i = 0;
+	unsigned repn = 1;
+	for (PMEMobjpool *rep = pop->replica; rep != NULL;
+			rep = rep->replica, ++repn) {
+		if (rep->rpp != NULL)
+			continue;
+
+		int lazy = REP(pop->set, repn)->lazy;
+		if (i == nworkers) {
+			if (lazy)
+				LOG(2, "replica %u without a worker thread "
+					"cannot be lazy", repn);
+			continue;
+		}
+
+		if (lazy && !replica_lag_supported(rep)) {
+			ERR("replica %u cannot be lazy without the CKSUM_2K "
+				"feature", repn);
+			errno = ENOTSUP;
+			goto err;
+		}
+
+		struct replica_worker *w = &engine->workers[i];
+		w->dirty = ravl_interval_new(replica_range_min,
+			replica_range_max);
+		if (w->dirty == NULL) {
+			ERR("!ravl_interval_new");
+			goto err;
+		}
+
+		w->pop = pop;
+		w->rep = rep;
+		w->repn = repn;
+		util_mutex_init(&w->lock);
+		util_cond_init(&w->job_cond);
+		util_cond_init(&w->done_cond);
+		util_cond_init(&w->synced_cond);
+		w->state = REPLICA_WORKER_IDLE;
+
+		/* lazy mode can be chosen in the pool set file */
+		w->lazy = lazy;
+		w->lagging = lazy;
+
+		engine->nworkers = ++i;
+	}
+
+	return engine;
+
+err:
+	replica_engine_delete(engine);
+	return NULL;
+}
+
+/*
+ * replica_engine_start_workers -- (internal) starts the worker threads,
+ *	failure to start a worker is not fatal, its replica is then written
+ *	by the callers
+ */
+static void
+replica_engine_start_workers(struct replica_engine *engine)
+{
+	unsigned i;
+	for (i = engine->nrunning; i < engine->nworkers; ++i) {
+		struct replica_worker *w = &engine->workers[i];
+		int ret = os_thread_create(&w->thread, NULL,
+			replica_worker_run, w);
+		if (ret != 0) {
+			errno = ret;
+			LOG(2, "!cannot start replica worker");
+			break;
+		}
+	}
+
+	util_atomic_store_explicit32(&engine->nrunning, i,
+		memory_order_release);
+
+	/* replicas without a worker cannot lag behind */
+	for (; i < engine->nworkers; ++i) {
+		struct replica_worker *w = &engine->workers[i];
+
+		util_mutex_lock(&w->lock);
+		if (w->lazy) {
+			LOG(2, "replica %u switched to synchronous mode",
+				w->repn);
+			w->lazy = 0;
+		}
+		replica_worker_catch_up_all(engine->pop, w);
+		util_mutex_unlock(&w->lock);
+	}
+}
+
+/*
+ * replica_engine_has_lazy -- (internal) returns whether any replica is lazy
+ */
+static int
+replica_engine_has_lazy(struct replica_engine *engine)
+{
+	for (unsigned i = 0; i < engine->nworkers; ++i) {
+		if (engine->workers[i].lazy)
+			return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * replica_engine_start -- starts the workers if fan-out is enabled or some
+ *	replica is lazy, called once the pool is opened and its configuration
+ *	is loaded
+ */
+void
+replica_engine_start(struct replica_engine *engine)
+{
+	util_mutex_lock(&engine->lock);
+
+	engine->started = 1;
+	if (engine->enabled || replica_engine_has_lazy(engine))
+		replica_engine_start_workers(engine);
+
+	util_mutex_unlock(&engine->lock);
+}
+
+/*
+ * replica_engine_enable -- (internal) enables or disables fan-out of writes,
+ *	the workers are started when enabled for the first time
+ */
+static void
+replica_engine_enable(struct replica_engine *engine, int enabled)
+{
+	util_mutex_lock(&engine->lock);
+
+	engine->enabled = enabled;
+	if (enabled && engine->started)
+		replica_engine_start_workers(engine);
+
+	util_mutex_unlock(&engine->lock);
+}
+
+/*
+ * replica_worker_set_lazy -- (internal) switches the replica between lazy
+ *	and synchronous mode, a replica switched to synchronous mode catches up
+ *	in the background
+ */
+static int
+replica_worker_set_lazy(struct replica_engine *engine,
+	struct replica_worker *w, int lazy)
+{
+	if (lazy && !replica_lag_supported(w->rep)) {
+		ERR("replica %u cannot be lazy without the CKSUM_2K feature",
+			w->repn);
+		errno = ENOTSUP;
+		return -1;
+	}
+
+	util_mutex_lock(&engine->lock);
+
+	util_mutex_lock(&w->lock);
+	w->lazy = lazy;
+	if (lazy) {
+		util_atomic_store_explicit32(&w->lagging, 1,
+			memory_order_release);
+	} else if (w->lag == 0 && w->inflight == 0 && !w->copying) {
+		if (!w->failed)
+			replica_lag_clear(w->rep);
+		util_atomic_store_explicit32(&w->lagging, 0,
+			memory_order_release);
+	}
+	util_mutex_unlock(&w->lock);
+
+	/* the worker could have failed to start */
+	if (lazy && engine->started)
+		replica_engine_start_workers(engine);
+
+	int ret = 0;
+	if (lazy && !w->lazy) {
+		ERR("replica %u cannot be lazy without a worker thread",
+			w->repn);
+		errno = EAGAIN;
+		ret = -1;
+	}
+
+	util_mutex_unlock(&engine->lock);
+
+	return ret;
+}
+
+/*
+ * replica_worker_sync -- (internal) waits until the replica has no dirty
+ *	ranges left and clears its marker if no write is pending
+ */
+static int
+replica_worker_sync(struct replica_worker *w)
+{
+	util_mutex_lock(&w->lock);
+	while (w->lag != 0 || w->copying)
+		os_cond_wait(&w->synced_cond, &w->lock);
+	int failed = w->failed;
+	if (!failed && w->inflight == 0)
+		replica_lag_clear(w->rep);
+	util_mutex_unlock(&w->lock);
+
+	return failed;
+}
+
+/*
+ * replica_engine_sync -- waits until all writes completed before the call
+ *	are copied to the lagging replicas
+ */
+int
+replica_engine_sync(struct replica_engine *engine)
+{
+	int failed = 0;
+
+	for (unsigned i = 0; i < engine->nworkers; ++i)
+		failed |= replica_worker_sync(&engine->workers[i]);
+
+	if (failed) {
+		ERR("some writes were not recorded, the lagging replicas "
+			"will be updated when the pool is opened again");
+		errno = ENOMEM;
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * replica_engine_delete -- stops the workers and deletes the engine, lagging
+ *	replicas are brought up to date first
+ */
+void
+replica_engine_delete(struct replica_engine *engine)
+{
+	for (unsigned i = 0; i < engine->nworkers; ++i) {
+		struct replica_worker *w = &engine->workers[i];
+		if (i < engine->nrunning) {
+			replica_worker_sync(w);
+
+			util_mutex_lock(&w->lock);
+			w->stop = 1;
+			os_cond_signal(&w->job_cond);
+			util_mutex_unlock(&w->lock);
+
+			os_thread_join(&w->thread, NULL);
+		}
+
+		struct replica_range *range;
+		while ((range = replica_dirty_take(w)) != NULL)
+			Free(range);
+		ravl_interval_delete(w->dirty);
+
+		util_cond_destroy(&w->synced_cond);
+		util_cond_destroy(&w->done_cond);
+		util_cond_destroy(&w->job_cond);
+		util_mutex_destroy(&w->lock);
+	}
+
+	util_mutex_destroy(&engine->lock);
+	Free(engine);
+}
+
+/*
+ * replica_fanout_record_start -- (internal) marks the write as pending for
+ *	all the lagging replicas
+ */
+static void
+replica_fanout_record_start(struct replica_engine *engine,
+	const struct replica_op *op, struct replica_fanout *fanout)
+{
+	for (unsigned i = 0; i < engine->nworkers; ++i) {
+		struct replica_worker *w = &engine->workers[i];
+
+		int lagging;
+		util_atomic_load_explicit32(&w->lagging, &lagging,
+			memory_order_acquire);
+		if (!lagging)
+			continue;
+
+		util_mutex_lock(&w->lock);
+		if (w->lagging) {
+			replica_lag_extend(w->rep, op->off, op->len);
+			w->inflight++;
+
+			fanout->recorded |= 1ULL << i;
+			if (w->lazy)
+				fanout->skipped |= 1ULL << i;
+		}
+		util_mutex_unlock(&w->lock);
+	}
+}
+
+/*
+ * replica_fanout_record_finish -- (internal) hands the write, which is now
+ *	complete in the master replica, to the workers of lagging replicas
+ */
+static void
+replica_fanout_record_finish(struct replica_fanout *fanout)
+{
+	struct replica_engine *engine = fanout->engine;
+
+	for (unsigned i = 0; fanout->recorded != 0; ++i) {
+		if ((fanout->recorded & (1ULL << i)) == 0)
+			continue;
+
+		struct replica_worker *w = &engine->workers[i];
+
+		util_mutex_lock(&w->lock);
+		if (replica_dirty_add(w, fanout->off, fanout->len) != 0) {
+			LOG(1, "replica %u will be updated on the next open",
+				w->repn);
+			w->failed = 1;
+		}
+		if (--w->inflight == 0)
+			os_cond_broadcast(&w->synced_cond);
+		os_cond_signal(&w->job_cond);
+		util_mutex_unlock(&w->lock);
+
+		fanout->recorded &= ~(1ULL << i);
+	}
+}
+
+/*
+ * replica_fanout_start -- hands the write off to all available workers and
+ *	marks it as pending for the lagging replicas
+ */
+void
+replica_fanout_start(struct replica_engine *engine,
+	const struct replica_op *op, struct replica_fanout *fanout)
+{
+	fanout->engine = engine;
+	fanout->workers = 0;
+	fanout->skipped = 0;
+	fanout->recorded = 0;
+	fanout->off = op->off;
+	fanout->len = op->len;
+
+	/* the engine doesn't exist yet when the pool is being created */
+	if (engine == NULL)
+		return;
+
+	replica_fanout_record_start(engine, op, fanout);
+
+	/* the source of memmove may be overwritten by the master write */
+	if (!engine->enabled || op->len < engine->threshold ||
+			op->type == REPLICA_OP_MEMMOVE)
+		return;
+
+	unsigned nrunning;
+	util_atomic_load_explicit32(&engine->nrunning, &nrunning,
+		memory_order_acquire);
+
+	for (unsigned i = 0; i < nrunning; ++i) {
+		struct replica_worker *w = &engine->workers[i];
+
+		if (fanout->skipped & (1ULL << i))
+			continue;
+
+		/* the caller writes to the replica itself */
+		if (!util_bool_compare_and_swap32(&w->busy, 0, 1))
+			continue;
+
+		util_mutex_lock(&w->lock);
+		w->op = *op;
+		w->state = REPLICA_WORKER_PENDING;
+		os_cond_signal(&w->job_cond);
+		util_mutex_unlock(&w->lock);
+
+		fanout->workers |= 1ULL << i;
+	}
+}
+
+/*
+ * replica_fanout_owns -- returns whether the write to the replica is done by
+ *	a worker
+ */
+int
+replica_fanout_owns(const struct replica_fanout *fanout, PMEMobjpool *rep)
+{
+	uint64_t owned = fanout->workers | fanout->skipped;
+	if (owned == 0)
+		return 0;
+
+	struct replica_engine *engine = fanout->engine;
+	for (unsigned i = 0; i < engine->nworkers; ++i) {
+		if (engine->workers[i].rep == rep)
+			return (owned & (1ULL << i)) != 0;
+	}
+
+	return 0;
+}
+
+/*
+ * replica_fanout_finish -- waits until the write is persistent in all
+ *	replicas written by the workers
+ */
+void
+replica_fanout_finish(struct replica_fanout *fanout)
+{
+	struct replica_engine *engine = fanout->engine;
+
+	for (unsigned i = 0; fanout->workers != 0; ++i) {
+		if ((fanout->workers & (1ULL << i)) == 0)
+			continue;
+
+		struct replica_worker *w = &engine->workers[i];
+
+		util_mutex_lock(&w->lock);
+		while (w->state != REPLICA_WORKER_DONE)
+			os_cond_wait(&w->done_cond, &w->lock);
+		w->state = REPLICA_WORKER_IDLE;
+		util_mutex_unlock(&w->lock);
+
+		util_atomic_store_explicit32(&w->busy, 0,
+			memory_order_release);
+
+		fanout->workers &= ~(1ULL << i);
+	}
+
+	if (fanout->recorded != 0)
+		replica_fanout_record_finish(fanout);
+}
+
+/*
+ * CTL_READ_HANDLER(enabled) -- returns whether writes are fanned out
+ */
+static int
+CTL_READ_HANDLER(enabled)(void *ctx,
+	enum ctl_query_source source, void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+
+	*(int *)arg = pop->rep_engine->enabled;
+
+	return 0;
+}
+
+/*
+ * CTL_WRITE_HANDLER(enabled) -- enables or disables fan-out of writes
+ */
+static int
+CTL_WRITE_HANDLER(enabled)(void *ctx,
+	enum ctl_query_source source, void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+
+	replica_engine_enable(pop->rep_engine, *(int *)arg);
+
+	return 0;
+}
+
+static const struct ctl_argument CTL_ARG(enabled) = CTL_ARG_BOOLEAN;
+
+/*
+ * CTL_READ_HANDLER(threshold) -- returns the minimal size of fanned out write
+ */
+static int
+CTL_READ_HANDLER(threshold)(void *ctx,
+	enum ctl_query_source source, void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+
+	*(size_t *)arg = pop->rep_engine->threshold;
+
+	return 0;
+}
+
+/*
+ * CTL_WRITE_HANDLER(threshold) -- sets the minimal size of fanned out write
+ */
+static int
+CTL_WRITE_HANDLER(threshold)(void *ctx,
+	enum ctl_query_source source, void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+
+	long long arg_in = *(long long *)arg;
+	if (arg_in < 0) {
+		ERR("invalid fan-out threshold, must not be negative");
+		errno = EINVAL;
+		return -1;
+	}
+
+	pop->rep_engine->threshold = (size_t)arg_in;
+
+	return 0;
+}
+
+static const struct ctl_argument CTL_ARG(threshold) = CTL_ARG_LONG_LONG;
+
+/*
+ * CTL_READ_HANDLER(workers) -- returns the number of running workers
+ */
+static int
+CTL_READ_HANDLER(workers)(void *ctx,
+	enum ctl_query_source source, void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+
+	util_atomic_load_explicit32(&pop->rep_engine->nrunning,
+		(unsigned *)arg, memory_order_acquire);
+
+	return 0;
+}
+
+static const struct ctl_node CTL_NODE(fanout)[] = {
+	CTL_LEAF_RW(enabled),
+	CTL_LEAF_RW(threshold),
+	CTL_LEAF_RO(workers),
+
+	CTL_NODE_END
+};
+
+/*
+ * replica_ctl_worker -- (internal) returns the worker of the indexed replica
+ */
+static struct replica_worker *
+replica_ctl_worker(PMEMobjpool *pop, struct ctl_indexes *indexes)
+{
+	struct ctl_index *idx = PMDK_SLIST_FIRST(indexes);
+	ASSERTeq(strcmp(idx->name, "replica_id"), 0);
+
+	struct replica_engine *engine = pop->rep_engine;
+	for (unsigned i = 0; i < engine->nworkers; ++i) {
+		if (engine->workers[i].repn == idx->value)
+			return &engine->workers[i];
+	}
+
+	ERR("replica %ld is not a local replica of the pool", idx->value);
+	errno = ERANGE;
+
+	return NULL;
+}
+
+/*
+ * CTL_READ_HANDLER(lazy) -- returns whether the replica is updated lazily
+ */
+static int
+CTL_READ_HANDLER(lazy)(void *ctx,
+	enum ctl_query_source source, void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+
+	struct replica_worker *w = replica_ctl_worker(pop, indexes);
+	if (w == NULL)
+		return -1;
+
+	util_mutex_lock(&w->lock);
+	*(int *)arg = w->lazy;
+	util_mutex_unlock(&w->lock);
+
+	return 0;
+}
+
+/*
+ * CTL_WRITE_HANDLER(lazy) -- switches the replica to lazy or synchronous
+ *	mode
+ */
+static int
+CTL_WRITE_HANDLER(lazy)(void *ctx,
+	enum ctl_query_source source, void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+
+	struct replica_worker *w = replica_ctl_worker(pop, indexes);
+	if (w == NULL)
+		return -1;
+
+	return replica_worker_set_lazy(pop->rep_engine, w, *(int *)arg);
+}
+
+static const struct ctl_argument CTL_ARG(lazy) = CTL_ARG_BOOLEAN;
+
+/*
+ * CTL_READ_HANDLER(lag) -- returns the number of bytes not copied to
+ *	the replica yet
+ */
+static int
+CTL_READ_HANDLER(lag)(void *ctx,
+	enum ctl_query_source source, void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+
+	struct replica_worker *w = replica_ctl_worker(pop, indexes);
+	if (w == NULL)
+		return -1;
+
+	util_mutex_lock(&w->lock);
+	*(size_t *)arg = w->lag;
+	util_mutex_unlock(&w->lock);
+
+	return 0;
+}
+
+static const struct ctl_node CTL_NODE(replica_id)[] = {
+	CTL_LEAF_RW(lazy),
+	CTL_LEAF_RO(lag),
+
+	CTL_NODE_END
+};
+
+static const struct ctl_node CTL_NODE(replica)[] = {
+	CTL_CHILD(fanout),
+	CTL_INDEXED(replica_id),
+
+	CTL_NODE_END
+};
+
+/*
+ * replica_ctl_register -- registers ctl nodes for the replication engine
+ */
+void
+replica_ctl_register(PMEMobjpool *pop)
+{
+	CTL_REGISTER_MODULE(pop->ctl, replica);
+}
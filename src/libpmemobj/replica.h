@@ -0,0 +1,79 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright 2020, Intel Corporation */
+
+/*
+ * replica.h -- internal definitions for the local replication engine
+ */
+#ifndef LIBPMEMOBJ_REPLICA_H
+#define LIBPMEMOBJ_REPLICA_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libpmemobj.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* maximum number of local replicas served by worker threads */
+#define REPLICA_FANOUT_MAX 64
+
+/* smallest write for which a hand-off to the workers pays off */
+#define REPLICA_FANOUT_THRESHOLD_DEFAULT (16 * 1024)
+
+/* granularity of the stale range marked in the header of a lazy replica */
+#define REPLICA_LAG_ALIGN (64ULL << 20) /* 64 MiB */
+
+enum replica_op_type {
+	REPLICA_OP_MEMCPY,
+	REPLICA_OP_MEMSET,
+	REPLICA_OP_MEMMOVE, /* only recorded for the lagging replicas */
+};
+
+/*
+ * A write to be mirrored to the local replicas, the destination is
+ * the same offset in every replica.
+ */
+struct replica_op {
+	enum replica_op_type type;
+	uintptr_t off; /* offset of the destination from the pool start */
+	const void *src; /* source of REPLICA_OP_MEMCPY/MEMMOVE */
+	int c; /* value of REPLICA_OP_MEMSET */
+	size_t len;
+	unsigned flags; /* PMEM_F_MEM_* flags */
+};
+
+struct replica_engine;
+
+/*
+ * Handle of a write being mirrored by the workers, replicas which are not
+ * owned by the fan-out have to be written by the caller.
+ */
+struct replica_fanout {
+	struct replica_engine *engine;
+	uint64_t workers; /* mask of the workers executing the write */
+	uint64_t skipped; /* mask of the lazy replicas, copied later */
+	uint64_t recorded; /* mask of the replicas tracking the write */
+	uintptr_t off;
+	size_t len;
+};
+
+struct replica_engine *replica_engine_new(PMEMobjpool *pop);
+void replica_engine_delete(struct replica_engine *engine);
+void replica_engine_start(struct replica_engine *engine);
+int replica_engine_sync(struct replica_engine *engine);
+
+void replica_fanout_start(struct replica_engine *engine,
+	const struct replica_op *op, struct replica_fanout *fanout);
+int replica_fanout_owns(const struct replica_fanout *fanout,
+	PMEMobjpool *rep);
+void replica_fanout_finish(struct replica_fanout *fanout);
+
+void replica_ctl_register(PMEMobjpool *pop);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBPMEMOBJ_REPLICA_H */
@@ -21,6 +21,162 @@ static const struct ctl_node CTL_NODE(heap)[] = {
 	CTL_NODE_END
 };
 
+STATS_CTL_HANDLER(transient, count, tx_count);
+STATS_CTL_HANDLER(transient, ranges, tx_ranges);
+STATS_CTL_HANDLER(transient, snapshot_bytes, tx_snapshot_bytes);
+STATS_CTL_HANDLER(transient, redo_entries, tx_redo_entries);
+STATS_CTL_HANDLER(transient, ulog_extensions, tx_ulog_extensions);
+STATS_CTL_HANDLER(transient, flushes, tx_flushes);
+STATS_CTL_HANDLER(transient, drains, tx_drains);
+
+STATS_CTL_HANDLER(transient, work, tx_work_ns);
+STATS_CTL_HANDLER(transient, oncommit, tx_oncommit_ns);
+STATS_CTL_HANDLER(transient, onabort, tx_onabort_ns);
+STATS_CTL_HANDLER(transient, finally, tx_finally_ns);
+
+static const struct ctl_node CTL_NODE(time)[] = {
+	STATS_CTL_LEAF(transient, work),
+	STATS_CTL_LEAF(transient, oncommit),
+	STATS_CTL_LEAF(transient, onabort),
+	STATS_CTL_LEAF(transient, finally),
+
+	CTL_NODE_END
+};
+
+/*
+ * CTL_READ_HANDLER(enabled, tx) -- returns whether or not transaction
+ *	statistics are enabled
+ */
+static int
+CTL_READ_HANDLER(enabled, tx)(void *ctx,
+	enum ctl_query_source source, void *arg,
+	struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+
+	int *arg_out = arg;
+
+	*arg_out = pop->tx_stats_enabled;
+
+	return 0;
+}
+
+/*
+ * CTL_WRITE_HANDLER(enabled, tx) -- enables or disables collection of
+ *	transaction statistics
+ */
+static int
+CTL_WRITE_HANDLER(enabled, tx)(void *ctx,
+	enum ctl_query_source source, void *arg,
+	struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+
+	/* sampled by every transaction when it begins */
+	pop->tx_stats_enabled = *(int *)arg;
+
+	return 0;
+}
+
+static const struct ctl_argument CTL_ARG(tx_enabled) = CTL_ARG_BOOLEAN;
+
+/*
+ * CTL_WRITE_HANDLER(callback) -- sets the function called with statistics
+ *	of each finished transaction
+ */
+static int
+CTL_WRITE_HANDLER(callback)(void *ctx,
+	enum ctl_query_source source, void *arg,
+	struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+
+	if (source != CTL_QUERY_PROGRAMMATIC) {
+		ERR("transaction statistics callback can only be set "
+			"programmatically");
+		errno = EINVAL;
+		return -1;
+	}
+
+	pop->stats->tx_callback =
+		*(struct pobj_tx_stats_callback_desc *)arg;
+
+	return 0;
+}
+
+static const struct ctl_argument CTL_ARG(callback) = {
+	.dest_size = sizeof(struct pobj_tx_stats_callback_desc),
+	.parsers = {
+		CTL_ARG_PARSER_END
+	}
+};
+
+static const struct ctl_node CTL_NODE(tx)[] = {
+	{CTL_STR(enabled), CTL_NODE_LEAF,
+		{CTL_READ_HANDLER(enabled, tx), CTL_WRITE_HANDLER(enabled, tx),
+		NULL}, &CTL_ARG(tx_enabled), NULL},
+	CTL_LEAF_WO(callback),
+	STATS_CTL_LEAF(transient, count),
+	STATS_CTL_LEAF(transient, ranges),
+	STATS_CTL_LEAF(transient, snapshot_bytes),
+	STATS_CTL_LEAF(transient, redo_entries),
+	STATS_CTL_LEAF(transient, ulog_extensions),
+	STATS_CTL_LEAF(transient, flushes),
+	STATS_CTL_LEAF(transient, drains),
+	CTL_CHILD(time),
+
+	CTL_NODE_END
+};
+
+/*
+ * LANE_STATS_CTL_HANDLER -- defines a read handler of the given lane
+ *	contention counter, summed up over all lanes
+ */
+#define LANE_STATS_CTL_HANDLER(name)\
+static int CTL_READ_HANDLER(lane_##name)(void *ctx,\
+	enum ctl_query_source source, void *arg, struct ctl_indexes *indexes)\
+{\
+	struct lane_stats stats;\
+	lane_stats_get(ctx, &stats);\
+	*(uint64_t *)arg = stats.name;\
+	return 0;\
+}
+
+#define LANE_STATS_CTL_LEAF(name)\
+{CTL_STR(name), CTL_NODE_LEAF,\
+{CTL_READ_HANDLER(lane_##name), NULL, NULL},\
+NULL, NULL}
+
+LANE_STATS_CTL_HANDLER(holds);
+LANE_STATS_CTL_HANDLER(primary_misses);
+LANE_STATS_CTL_HANDLER(remote_holds);
+LANE_STATS_CTL_HANDLER(yields);
+
+/*
+ * CTL_READ_HANDLER(partitions) -- returns the number of lane partitions
+ */
+static int
+CTL_READ_HANDLER(partitions)(void *ctx,
+	enum ctl_query_source source, void *arg,
+	struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+
+	*(unsigned *)arg = pop->lanes_desc.npartitions;
+
+	return 0;
+}
+
+static const struct ctl_node CTL_NODE(lane)[] = {
+	LANE_STATS_CTL_LEAF(holds),
+	LANE_STATS_CTL_LEAF(primary_misses),
+	LANE_STATS_CTL_LEAF(remote_holds),
+	LANE_STATS_CTL_LEAF(yields),
+	CTL_LEAF_RO(partitions),
+
+	CTL_NODE_END
+};
+
 /*
  * CTL_READ_HANDLER(enabled) -- returns whether or not statistics are enabled
  */
@@ -98,6 +254,8 @@ static const struct ctl_argument CTL_ARG(enabled) = {
 
 static const struct ctl_node CTL_NODE(stats)[] = {
 	CTL_CHILD(heap),
+	CTL_CHILD(tx),
+	CTL_CHILD(lane),
 	CTL_LEAF_RW(enabled),
 
 	CTL_NODE_END
@@ -116,6 +274,8 @@ stats_new(PMEMobjpool *pop)
 	}
 
 	s->enabled = POBJ_STATS_ENABLED_TRANSIENT;
+	s->tx_callback.cb = NULL;
+	s->tx_callback.arg = NULL;
 	s->persistent = &pop->stats_persistent;
 	VALGRIND_ADD_TO_GLOBAL_TX_IGNORE(s->persistent, sizeof(*s->persistent));
 	s->transient = Zalloc(sizeof(struct stats_transient));
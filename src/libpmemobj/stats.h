@@ -10,6 +10,7 @@
 
 #include "ctl.h"
 #include "libpmemobj/ctl.h"
+#include "pmemops.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -18,6 +19,17 @@ extern "C" {
 struct stats_transient {
 	uint64_t heap_run_allocated;
 	uint64_t heap_run_active;
+	uint64_t tx_count;
+	uint64_t tx_ranges;
+	uint64_t tx_snapshot_bytes;
+	uint64_t tx_redo_entries;
+	uint64_t tx_ulog_extensions;
+	uint64_t tx_flushes;
+	uint64_t tx_drains;
+	uint64_t tx_work_ns;
+	uint64_t tx_oncommit_ns;
+	uint64_t tx_onabort_ns;
+	uint64_t tx_finally_ns;
 };
 
 struct stats_persistent {
@@ -28,6 +40,8 @@ struct stats {
 	enum pobj_stats_enabled enabled;
 	struct stats_transient *transient;
 	struct stats_persistent *persistent;
+
+	struct pobj_tx_stats_callback_desc tx_callback;
 };
 
 #define STATS_INC(stats, type, name, value) do {\
@@ -11,6 +11,7 @@
 #include "queue.h"
 #include "ravl.h"
 #include "obj.h"
+#include "os.h"
 #include "out.h"
 #include "pmalloc.h"
 #include "tx.h"
@@ -32,6 +33,7 @@ struct tx {
 	PMDK_SLIST_HEAD(txd, tx_data) tx_entries;
 
 	struct ravl *ranges;
+	struct ravl *shadows;
 
 	VEC(, struct pobj_action) actions;
 	VEC(, struct user_buffer_def) redo_userbufs;
@@ -43,6 +45,12 @@ struct tx {
 	int first_snapshot;
 
 	void *user_data;
+
+	int stats_enabled; /* cached "stats.tx.enabled" of the pool */
+	struct pobj_tx_stats stats;
+	struct operation_stats undo_stats;
+	struct operation_stats redo_stats;
+	uint64_t stage_start; /* time of the last stage change, in ns */
 };
 
 /*
@@ -101,6 +109,43 @@ tx_range_def_cmp(const void *lhs, const void *rhs)
 	return 0;
 }
 
+/*
+ * tx_shadow -- volatile copy of a snapshotted range, used at commit to find
+ *	the cache lines that were actually modified by the transaction
+ */
+struct tx_shadow {
+	uint64_t offset;
+	uint64_t size;
+	void *data;
+};
+
+/*
+ * tx_shadow_cmp -- compares two shadow copies
+ */
+static int
+tx_shadow_cmp(const void *lhs, const void *rhs)
+{
+	const struct tx_shadow *l = lhs;
+	const struct tx_shadow *r = rhs;
+
+	if (l->offset > r->offset)
+		return 1;
+	else if (l->offset < r->offset)
+		return -1;
+
+	return 0;
+}
+
+/*
+ * tx_shadow_free -- (internal) frees the data of one shadow copy
+ */
+static void
+tx_shadow_free(void *data, void *ctx)
+{
+	struct tx_shadow *shadow = data;
+	Free(shadow->data);
+}
+
 /*
  * tx_params_new -- creates a new transactional parameters instance and fills it
  *	with default values.
@@ -113,6 +158,7 @@ tx_params_new(void)
 		return NULL;
 
 	tx_params->cache_size = TX_DEFAULT_RANGE_CACHE_SIZE;
+	tx_params->diff_flush = 0;
 
 	return tx_params;
 }
@@ -167,6 +213,147 @@ obj_tx_fail_null(int errnum, uint64_t flags)
 		FATAL("%s called in invalid stage %d", __func__, (tx)->stage);\
 } while (0)
 
+/*
+ * The transaction of the calling thread while its statistics are collected,
+ * NULL otherwise. The memory operations of the pool check it only if
+ * the statistics are enabled, so that other threads do not pay for it.
+ */
+static __thread struct tx *Tx_profiled;
+
+/*
+ * tx_stats_now -- (internal) returns the current time in nanoseconds
+ */
+static uint64_t
+tx_stats_now(void)
+{
+	struct timespec ts;
+	os_clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * tx_set_stage -- (internal) changes the stage of the transaction, accounting
+ *	the time spent in the previous one
+ */
+static void
+tx_set_stage(struct tx *tx, enum pobj_tx_stage stage)
+{
+	if (tx->stats_enabled) {
+		uint64_t now = tx_stats_now();
+		uint64_t elapsed = now - tx->stage_start;
+		tx->stage_start = now;
+
+		switch (tx->stage) {
+			case TX_STAGE_WORK:
+				tx->stats.work_ns += elapsed;
+				break;
+			case TX_STAGE_ONCOMMIT:
+				tx->stats.oncommit_ns += elapsed;
+				break;
+			case TX_STAGE_ONABORT:
+				tx->stats.onabort_ns += elapsed;
+				break;
+			case TX_STAGE_FINALLY:
+				tx->stats.finally_ns += elapsed;
+				break;
+			default:
+				break;
+		}
+	}
+
+	tx->stage = stage;
+}
+
+/*
+ * tx_stats_start -- (internal) starts collecting statistics of the outermost
+ *	transaction, if enabled in the pool
+ */
+static void
+tx_stats_start(struct tx *tx)
+{
+	struct lane *lane = tx->lane;
+
+	tx->stats_enabled = tx->pop->tx_stats_enabled;
+	if (!tx->stats_enabled) {
+		operation_set_stats(lane->undo, NULL);
+		operation_set_stats(lane->external, NULL);
+		return;
+	}
+
+	memset(&tx->stats, 0, sizeof(tx->stats));
+	memset(&tx->undo_stats, 0, sizeof(tx->undo_stats));
+	memset(&tx->redo_stats, 0, sizeof(tx->redo_stats));
+	operation_set_stats(lane->undo, &tx->undo_stats);
+	operation_set_stats(lane->external, &tx->redo_stats);
+	tx->stage_start = tx_stats_now();
+	Tx_profiled = tx;
+}
+
+/*
+ * tx_stats_lane_release -- (internal) stops accounting the log activity of
+ *	the lane to the transaction, must be called before the lane is released
+ */
+static void
+tx_stats_lane_release(struct tx *tx)
+{
+	if (!tx->stats_enabled)
+		return;
+
+	operation_set_stats(tx->lane->undo, NULL);
+	operation_set_stats(tx->lane->external, NULL);
+}
+
+/*
+ * tx_stats_finish -- (internal) publishes the statistics of the finished
+ *	outermost transaction
+ */
+static void
+tx_stats_finish(struct tx *tx)
+{
+	if (!tx->stats_enabled)
+		return;
+
+	tx_set_stage(tx, tx->stage);
+	tx->stats_enabled = 0;
+	Tx_profiled = NULL;
+
+	struct pobj_tx_stats *ts = &tx->stats;
+	ts->redo_entries = tx->redo_stats.entries;
+	ts->ulog_extensions = tx->undo_stats.extensions +
+		tx->redo_stats.extensions;
+
+	struct stats *s = tx->pop->stats;
+	STATS_INC(s, transient, tx_count, 1);
+	STATS_INC(s, transient, tx_ranges, ts->ranges);
+	STATS_INC(s, transient, tx_snapshot_bytes, ts->snapshot_bytes);
+	STATS_INC(s, transient, tx_redo_entries, ts->redo_entries);
+	STATS_INC(s, transient, tx_ulog_extensions, ts->ulog_extensions);
+	STATS_INC(s, transient, tx_flushes, ts->flushes);
+	STATS_INC(s, transient, tx_drains, ts->drains);
+	STATS_INC(s, transient, tx_work_ns, ts->work_ns);
+	STATS_INC(s, transient, tx_oncommit_ns, ts->oncommit_ns);
+	STATS_INC(s, transient, tx_onabort_ns, ts->onabort_ns);
+	STATS_INC(s, transient, tx_finally_ns, ts->finally_ns);
+
+	if (s->tx_callback.cb != NULL)
+		s->tx_callback.cb(tx->pop, ts, s->tx_callback.arg);
+}
+
+/*
+ * tx_stats_persist_ops -- accounts flushes and drains performed on the pool
+ *	to the profiled transaction of the calling thread, if there is one
+ */
+void
+tx_stats_persist_ops(PMEMobjpool *pop, unsigned flushes, unsigned drains)
+{
+	struct tx *tx = Tx_profiled;
+	if (tx != NULL && tx->pop == pop) {
+		tx->stats.flushes += flushes;
+		tx->stats.drains += drains;
+	}
+}
+
 /*
  * tx_action_reserve -- (internal) reserve space for the given number of actions
  */
@@ -408,6 +595,98 @@ tx_flush_range(void *data, void *ctx)
 		range->size);
 }
 
+/*
+ * tx_flush_shadow -- (internal) flush only those cache lines of a shadowed
+ *	range that differ from its shadow copy
+ *
+ * The lines that were not modified are marked as clean, their content is
+ * identical to the one that was made persistent before the snapshot.
+ */
+static void
+tx_flush_shadow(PMEMobjpool *pop, const struct tx_shadow *shadow)
+{
+	char *begin = OBJ_OFF_TO_PTR(pop, shadow->offset);
+	char *end = begin + shadow->size;
+	const char *copy = shadow->data;
+
+	char *dirty = NULL; /* beginning of the pending run of modified lines */
+	char *line = (char *)ALIGN_DOWN((uintptr_t)begin, CACHELINE_SIZE);
+	for (; line < end; line += CACHELINE_SIZE) {
+		char *lbegin = MAX(line, begin);
+		char *lend = MIN(line + CACHELINE_SIZE, end);
+		size_t len = (size_t)(lend - lbegin);
+
+		if (memcmp(lbegin, copy + (lbegin - begin), len) != 0) {
+			if (dirty == NULL)
+				dirty = lbegin;
+			continue;
+		}
+
+		VALGRIND_SET_CLEAN(lbegin, len);
+
+		if (dirty != NULL) {
+			pmemops_xflush(&pop->p_ops, dirty,
+				(size_t)(lbegin - dirty), PMEMOBJ_F_RELAXED);
+			dirty = NULL;
+		}
+	}
+
+	if (dirty != NULL) {
+		pmemops_xflush(&pop->p_ops, dirty, (size_t)(end - dirty),
+			PMEMOBJ_F_RELAXED);
+	}
+}
+
+/*
+ * tx_flush_range_diff -- (internal) flush one range, skipping the cache lines
+ *	of shadowed snapshots that were not modified
+ */
+static void
+tx_flush_range_diff(void *data, void *ctx)
+{
+	struct tx *tx = ctx;
+	PMEMobjpool *pop = tx->pop;
+	struct tx_range_def *range = data;
+
+	if (range->flags & POBJ_FLAG_NO_FLUSH) {
+		VALGRIND_REMOVE_FROM_TX(OBJ_OFF_TO_PTR(pop, range->offset),
+			range->size);
+		return;
+	}
+
+	uint64_t offset = range->offset;
+	uint64_t end = range->offset + range->size;
+
+	/*
+	 * Shadows are created only for the parts of ranges that were
+	 * snapshotted, so each of them lies entirely within one range.
+	 */
+	while (offset < end) {
+		struct tx_shadow search = {offset, 0, NULL};
+		struct ravl_node *n = ravl_find(tx->shadows, &search,
+			RAVL_PREDICATE_GREATER_EQUAL);
+		struct tx_shadow *shadow = n ? ravl_data(n) : NULL;
+
+		uint64_t next = shadow == NULL || shadow->offset >= end ?
+			end : shadow->offset;
+		if (next != offset) {
+			pmemops_xflush(&pop->p_ops,
+				OBJ_OFF_TO_PTR(pop, offset), next - offset,
+				PMEMOBJ_F_RELAXED);
+		}
+
+		if (next == end)
+			break;
+
+		ASSERT(shadow->offset + shadow->size <= end);
+		tx_flush_shadow(pop, shadow);
+		offset = shadow->offset + shadow->size;
+	}
+
+	VALGRIND_REMOVE_FROM_TX(OBJ_OFF_TO_PTR(pop, range->offset),
+		range->size);
+}
+
 /*
  * tx_clean_range -- (internal) clean one range
  */
@@ -430,7 +709,13 @@ tx_pre_commit(struct tx *tx)
 	LOG(5, NULL);
 
 	/* Flush all regions and destroy the whole tree. */
-	ravl_delete_cb(tx->ranges, tx_flush_range, tx->pop);
+	if (tx->shadows != NULL) {
+		ravl_delete_cb(tx->ranges, tx_flush_range_diff, tx);
+		ravl_delete_cb(tx->shadows, tx_shadow_free, NULL);
+		tx->shadows = NULL;
+	} else {
+		ravl_delete_cb(tx->ranges, tx_flush_range, tx->pop);
+	}
 	tx->ranges = NULL;
 }
 
@@ -447,6 +732,10 @@ tx_abort(PMEMobjpool *pop, struct lane *lane)
 	tx_abort_set(pop, lane);
 
 	ravl_delete_cb(tx->ranges, tx_clean_range, pop);
+	if (tx->shadows != NULL) {
+		ravl_delete_cb(tx->shadows, tx_shadow_free, NULL);
+		tx->shadows = NULL;
+	}
 	palloc_cancel(&pop->heap,
 		VEC_ARR(&tx->actions), VEC_SIZE(&tx->actions));
 	tx->ranges = NULL;
@@ -749,12 +1038,15 @@ pmemobj_tx_begin(PMEMobjpool *pop, jmp_buf env, ...)
 
 		tx->ranges = ravl_new_sized(tx_range_def_cmp,
 			sizeof(struct tx_range_def));
+		tx->shadows = NULL;
 
 		tx->pop = pop;
 
 		tx->first_snapshot = 1;
 
 		tx->user_data = NULL;
+
+		tx_stats_start(tx);
 	} else {
 		FATAL("Invalid stage %d to begin new transaction", tx->stage);
 	}
@@ -776,7 +1068,7 @@ pmemobj_tx_begin(PMEMobjpool *pop, jmp_buf env, ...)
 
 	PMDK_SLIST_INSERT_HEAD(&tx->tx_entries, txd, tx_entry);
 
-	tx->stage = TX_STAGE_WORK;
+	tx_set_stage(tx, TX_STAGE_WORK);
 
 	/* handle locks */
 	va_list argp;
@@ -819,7 +1111,7 @@ err_abort:
 	if (tx->stage == TX_STAGE_WORK)
 		obj_tx_abort(err, 0);
 	else
-		tx->stage = TX_STAGE_ONABORT;
+		tx_set_stage(tx, TX_STAGE_ONABORT);
 	return err;
 }
 
@@ -915,7 +1207,7 @@ obj_tx_abort(int errnum, int user)
 	if (errnum == 0)
 		errnum = ECANCELED;
 
-	tx->stage = TX_STAGE_ONABORT;
+	tx_set_stage(tx, TX_STAGE_ONABORT);
 	struct tx_data *txd = PMDK_SLIST_FIRST(&tx->tx_entries);
 
 	if (PMDK_SLIST_NEXT(txd, tx_entry) == NULL) {
@@ -924,6 +1216,7 @@ obj_tx_abort(int errnum, int user)
 		/* process the undo log */
 		tx_abort(tx->pop, tx->lane);
 
+		tx_stats_lane_release(tx);
 		lane_release(tx->pop);
 		tx->lane = NULL;
 	}
@@ -1012,12 +1305,13 @@ pmemobj_tx_commit(void)
 
 		tx_post_commit(tx);
 
+		tx_stats_lane_release(tx);
 		lane_release(pop);
 
 		tx->lane = NULL;
 	}
 
-	tx->stage = TX_STAGE_ONCOMMIT;
+	tx_set_stage(tx, TX_STAGE_ONCOMMIT);
 
 	/* ONCOMMIT */
 	obj_tx_callback(tx);
@@ -1043,7 +1337,7 @@ pmemobj_tx_end(void)
 	if (tx->stage_callback &&
 			(tx->stage == TX_STAGE_ONCOMMIT ||
 			tx->stage == TX_STAGE_ONABORT)) {
-		tx->stage = TX_STAGE_FINALLY;
+		tx_set_stage(tx, TX_STAGE_FINALLY);
 		obj_tx_callback(tx);
 	}
 
@@ -1058,6 +1352,7 @@ pmemobj_tx_end(void)
 		ASSERTeq(tx->lane, NULL);
 
 		release_and_free_tx_locks(tx);
+		tx_stats_finish(tx);
 		tx->pop = NULL;
 		tx->stage = TX_STAGE_NONE;
 		VEC_DELETE(&tx->actions);
@@ -1074,7 +1369,7 @@ pmemobj_tx_end(void)
 		}
 	} else {
 		/* resume the next transaction */
-		tx->stage = TX_STAGE_WORK;
+		tx_set_stage(tx, TX_STAGE_WORK);
 
 		/* abort called within inner transaction, waterfall the error */
 		if (tx->last_errnum)
@@ -1103,11 +1398,11 @@ pmemobj_tx_process(void)
 		break;
 	case TX_STAGE_ONABORT:
 	case TX_STAGE_ONCOMMIT:
-		tx->stage = TX_STAGE_FINALLY;
+		tx_set_stage(tx, TX_STAGE_FINALLY);
 		obj_tx_callback(tx);
 		break;
 	case TX_STAGE_FINALLY:
-		tx->stage = TX_STAGE_NONE;
+		tx_set_stage(tx, TX_STAGE_NONE);
 		break;
 	default:
 		ASSERT(0);
@@ -1147,6 +1442,35 @@ vg_verify_initialized(PMEMobjpool *pop, const struct tx_range_def *def)
 #endif
 }
 
+/*
+ * tx_add_shadow -- (internal) creates a volatile copy of the snapshotted range
+ */
+static int
+tx_add_shadow(struct tx *tx, const struct tx_range_def *snapshot)
+{
+	if (tx->shadows == NULL) {
+		tx->shadows = ravl_new_sized(tx_shadow_cmp,
+			sizeof(struct tx_shadow));
+		if (tx->shadows == NULL)
+			return -1;
+	}
+
+	struct tx_shadow shadow = {snapshot->offset, snapshot->size, NULL};
+	shadow.data = Malloc(snapshot->size);
+	if (shadow.data == NULL)
+		return -1;
+
+	memcpy(shadow.data, OBJ_OFF_TO_PTR(tx->pop, snapshot->offset),
+		snapshot->size);
+
+	if (ravl_emplace_copy(tx->shadows, &shadow) != 0) {
+		Free(shadow.data);
+		return -1;
+	}
+
+	return 0;
+}
+
 /*
  * pmemobj_tx_add_snapshot -- (internal) creates a variably sized snapshot
  */
@@ -1165,6 +1489,9 @@ pmemobj_tx_add_snapshot(struct tx *tx, struct tx_range_def *snapshot)
 	if (snapshot->flags & POBJ_XADD_NO_SNAPSHOT)
 		return 0;
 
+	if (tx->stats_enabled)
+		tx->stats.snapshot_bytes += snapshot->size;
+
 	if (!(snapshot->flags & POBJ_XADD_ASSUME_INITIALIZED))
 		vg_verify_initialized(tx->pop, snapshot);
 
@@ -1185,8 +1512,20 @@ pmemobj_tx_add_snapshot(struct tx *tx, struct tx_range_def *snapshot)
 		tx->first_snapshot = 0;
 	}
 
-	return operation_add_buffer(tx->lane->undo, ptr, ptr, snapshot->size,
-		ULOG_OPERATION_BUF_CPY);
+	if (operation_add_buffer(tx->lane->undo, ptr, ptr, snapshot->size,
+		ULOG_OPERATION_BUF_CPY) != 0)
+		return -1;
+
+	/*
+	 * Ranges that span more than a single cache line are worth comparing
+	 * at commit, as long as the flush is not going to be skipped anyway.
+	 */
+	if (tx->pop->tx_params->diff_flush &&
+	    snapshot->size > CACHELINE_SIZE &&
+	    !(snapshot->flags & POBJ_XADD_NO_FLUSH))
+		return tx_add_shadow(tx, snapshot);
+
+	return 0;
 }
 
 /*
@@ -1227,6 +1566,9 @@ pmemobj_tx_add_common(struct tx *tx, struct tx_range_def *args)
 		return obj_tx_fail_err(EINVAL, args->flags);
 	}
 
+	if (tx->stats_enabled)
+		tx->stats.ranges++;
+
 	int ret = 0;
 
 	/*
@@ -2228,6 +2570,45 @@ static const struct ctl_node CTL_NODE(cache)[] = {
 	CTL_NODE_END
 };
 
+/*
+ * CTL_READ_HANDLER(diff_flush) -- returns "diff_flush" transaction parameter
+ */
+static int
+CTL_READ_HANDLER(diff_flush)(void *ctx,
+	enum ctl_query_source source, void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+
+	int *arg_out = arg;
+
+	*arg_out = pop->tx_params->diff_flush;
+
+	return 0;
+}
+
+/*
+ * CTL_WRITE_HANDLER(diff_flush) -- sets "diff_flush" transaction parameter
+ */
+static int
+CTL_WRITE_HANDLER(diff_flush)(void *ctx,
+	enum ctl_query_source source, void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+
+	int arg_in = *(int *)arg;
+
+	pop->tx_params->diff_flush = arg_in;
+	return 0;
+}
+
+static const struct ctl_argument CTL_ARG(diff_flush) = CTL_ARG_BOOLEAN;
+
+static const struct ctl_node CTL_NODE(commit)[] = {
+	CTL_LEAF_RW(diff_flush),
+
+	CTL_NODE_END
+};
+
 /*
  * CTL_READ_HANDLER(skip_expensive_checks) -- returns "skip_expensive_checks"
  * var from pool ctl
@@ -2360,6 +2741,7 @@ static const struct ctl_node CTL_NODE(post_commit)[] = {
 static const struct ctl_node CTL_NODE(tx)[] = {
 	CTL_CHILD(debug),
 	CTL_CHILD(cache),
+	CTL_CHILD(commit),
 	CTL_CHILD(post_commit),
 
 	CTL_NODE_END
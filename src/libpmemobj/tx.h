@@ -34,6 +34,7 @@ extern "C" {
 
 struct tx_parameters {
 	size_t cache_size;
+	int diff_flush; /* flush only the modified cache lines on commit */
 };
 
 /*
@@ -44,6 +45,9 @@ PMEMobjpool *tx_get_pop(void);
 
 void tx_ctl_register(PMEMobjpool *pop);
 
+void tx_stats_persist_ops(PMEMobjpool *pop, unsigned flushes,
+	unsigned drains);
+
 struct tx_parameters *tx_params_new(void);
 void tx_params_delete(struct tx_parameters *tx_params);
 
@@ -0,0 +1,824 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2020, Intel Corporation */
+
+/*
+ * type_index.c -- persistent per-type indexes of the objects
+ *
+ * An index is an open-addressing hash table of the offsets of all the objects
+ * of a single type, allocated on the heap as an internal object. The slots of
+ * the table are modified through the same redo log as the heap metadata of
+ * the allocations and deallocations, so the index is always consistent with
+ * the heap, even after a failure.
+ *
+ * The allocations update the indexes concurrently: a slot is claimed in
+ * the runtime bitmap of the table with a compare-and-swap, and a slot of
+ * a removed object is not reused until the table is rehashed. A table is
+ * replaced only while no update is in progress.
+ *
+ * The indexes are maintained only by this library, a pool modified by a
+ * version which is not aware of them is detected on the next open through
+ * the run_id of the pool, and its indexes are rebuilt.
+ */
+
+#include <inttypes.h>
+#include <string.h>
+
+#include "alloc.h"
+#include "heap.h"
+#include "memblock.h"
+#include "memops.h"
+#include "obj.h"
+#include "out.h"
+#include "palloc.h"
+#include "pmalloc.h"
+#include "sys_util.h"
+#include "type_index.h"
+#include "util.h"
+#include "valgrind_internal.h"
+
+/* initial number of the slots of a table */
+#define TYPE_INDEX_MIN_CAPACITY 1024
+
+/* values of the slots which do not hold an offset of an object */
+#define TYPE_INDEX_SLOT_EMPTY 0
+#define TYPE_INDEX_SLOT_REMOVED 1
+
+/* persistent hash table of an index */
+struct type_index_table {
+	uint64_t capacity; /* number of slots, always a power of two */
+	uint64_t unused[7];
+	uint64_t slots[];
+};
+
+/* runtime state of the index of a single type */
+struct type_index_rt {
+	int active; /* accessed atomically */
+	uint64_t type_num;
+	struct type_index_entry *entry;
+	struct type_index_table *table;
+
+	/* bitmap of the slots which are not empty (atomic) */
+	uint64_t *occupied;
+
+	uint64_t used; /* slots holding an object (atomic) */
+	uint64_t removed; /* slots holding TYPE_INDEX_SLOT_REMOVED (atomic) */
+};
+
+struct type_index {
+	PMEMobjpool *pop;
+	struct type_index_layout *layout;
+
+	/*
+	 * Taken for reading by the allocations which update the indexes,
+	 * for writing to create, replace or destroy a table.
+	 */
+	os_rwlock_t lock;
+
+	/* inserts of the updates in progress, to any of the indexes (atomic) */
+	uint64_t reserved;
+
+	/*
+	 * Set when an index could not be updated, the indexes are not used
+	 * until the pool is reopened and they are rebuilt (atomic).
+	 */
+	int stale;
+
+	unsigned nactive; /* number of the active indexes (atomic) */
+
+	struct type_index_rt rt[TYPE_INDEX_MAX];
+};
+
+/*
+ * type_index_hash -- (internal) returns the first slot to probe for the
+ *	given offset
+ */
+static inline uint64_t
+type_index_hash(uint64_t off, uint64_t capacity)
+{
+	uint64_t h = off * 0x9e3779b97f4a7c15ULL;
+
+	return (h ^ (h >> 29)) & (capacity - 1);
+}
+
+/*
+ * type_index_capacity -- (internal) returns the capacity of a table which
+ *	can hold the given number of objects with some room to spare
+ */
+static uint64_t
+type_index_capacity(uint64_t nobjs)
+{
+	uint64_t capacity = TYPE_INDEX_MIN_CAPACITY;
+	while (capacity < nobjs * 2)
+		capacity <<= 1;
+
+	return capacity;
+}
+
+/*
+ * type_index_table_size -- (internal) returns the size of a table
+ */
+static size_t
+type_index_table_size(uint64_t capacity)
+{
+	return sizeof(struct type_index_table) + capacity * sizeof(uint64_t);
+}
+
+/*
+ * type_index_table_constr -- (internal) constructor of an empty table
+ */
+static int
+type_index_table_constr(void *base, void *ptr, size_t usable_size, void *arg)
+{
+	PMEMobjpool *pop = base;
+	struct type_index_table *table = ptr;
+
+	pmemops_memset(&pop->p_ops, table, 0,
+		type_index_table_size(*(uint64_t *)arg), PMEMOBJ_F_MEM_NODRAIN);
+	table->capacity = *(uint64_t *)arg;
+	pmemops_persist(&pop->p_ops, &table->capacity,
+		sizeof(table->capacity));
+
+	return 0;
+}
+
+/*
+ * type_index_table_put -- (internal) stores the offset in a table which is
+ *	not yet reachable from the pool, the caller persists the whole table
+ */
+static void
+type_index_table_put(struct type_index_table *table, uint64_t off)
+{
+	uint64_t mask = table->capacity - 1;
+	uint64_t slot = type_index_hash(off, table->capacity);
+	while (table->slots[slot] != TYPE_INDEX_SLOT_EMPTY)
+		slot = (slot + 1) & mask;
+
+	table->slots[slot] = off;
+}
+
+/*
+ * type_index_stale -- (internal) stops using the indexes until the pool is
+ *	reopened, the run_id recorded in the layout makes the next open rebuild
+ *	them
+ */
+static void
+type_index_stale(struct type_index *ti)
+{
+	LOG(2, "type indexes of pool %p are stale", ti->pop);
+
+	ti->layout->run_id = 0;
+	pmemops_persist(&ti->pop->p_ops, &ti->layout->run_id,
+		sizeof(ti->layout->run_id));
+
+	util_atomic_store_explicit32(&ti->stale, 1, memory_order_release);
+}
+
+/*
+ * type_index_is_stale -- (internal) returns whether the indexes are no longer
+ *	used
+ */
+static int
+type_index_is_stale(struct type_index *ti)
+{
+	int stale;
+	util_atomic_load_explicit32(&ti->stale, &stale, memory_order_acquire);
+
+	return stale;
+}
+
+/*
+ * type_index_find -- (internal) returns the runtime state of the index of
+ *	the given type, NULL if the type is not indexed
+ */
+static struct type_index_rt *
+type_index_find(struct type_index *ti, uint64_t type_num)
+{
+	for (unsigned i = 0; i < TYPE_INDEX_MAX; ++i) {
+		struct type_index_rt *rt = &ti->rt[i];
+		int active;
+		util_atomic_load_explicit32(&rt->active, &active,
+			memory_order_acquire);
+		if (active && rt->type_num == type_num)
+			return rt;
+	}
+
+	return NULL;
+}
+
+/*
+ * type_index_load -- (internal) rebuilds the runtime state of an index from
+ *	its persistent table
+ */
+static int
+type_index_load(struct type_index *ti, struct type_index_rt *rt)
+{
+	struct type_index_table *table = OBJ_OFF_TO_PTR(ti->pop,
+		rt->entry->table_off);
+
+	uint64_t *occupied = Zalloc(sizeof(uint64_t) *
+		((table->capacity + 63) / 64));
+	if (occupied == NULL) {
+		ERR("!Zalloc");
+		return -1;
+	}
+
+	rt->used = 0;
+	rt->removed = 0;
+	for (uint64_t i = 0; i < table->capacity; ++i) {
+		uint64_t slot = table->slots[i];
+		if (slot == TYPE_INDEX_SLOT_EMPTY)
+			continue;
+
+		if (slot == TYPE_INDEX_SLOT_REMOVED)
+			rt->removed++;
+		else
+			rt->used++;
+
+		occupied[i / 64] |= 1ULL << (i % 64);
+	}
+
+	Free(rt->occupied);
+	rt->occupied = occupied;
+	rt->table = table;
+	rt->type_num = rt->entry->type_num;
+
+	return 0;
+}
+
+struct type_index_scan {
+	uint64_t type_num;
+	struct type_index_table *table; /* NULL when counting */
+	uint64_t nobjs;
+};
+
+/*
+ * type_index_scan_cb -- (internal) counts or stores the objects of a type
+ */
+static int
+type_index_scan_cb(const struct memory_block *m, void *arg)
+{
+	struct type_index_scan *scan = arg;
+
+	if (m->m_ops->get_flags(m) & OBJ_INTERNAL_OBJECT_MASK)
+		return 0;
+
+	if (m->m_ops->get_extra(m) != scan->type_num)
+		return 0;
+
+	if (scan->table != NULL)
+		type_index_table_put(scan->table,
+			HEAP_PTR_TO_OFF(m->heap, m->m_ops->get_user_data(m)));
+
+	scan->nobjs++;
+
+	return 0;
+}
+
+/*
+ * type_index_install -- (internal) makes the table allocated in next_off
+ *	the index of the entry
+ */
+static void
+type_index_install(struct type_index *ti, struct type_index_entry *entry)
+{
+	PMEMobjpool *pop = ti->pop;
+
+	if (entry->table_off == 0) {
+		/* a crash in between is handled by type_index_recover() */
+		entry->table_off = entry->next_off;
+		pmemops_persist(&pop->p_ops, &entry->table_off,
+			sizeof(entry->table_off));
+		entry->next_off = 0;
+		pmemops_persist(&pop->p_ops, &entry->next_off,
+			sizeof(entry->next_off));
+	} else {
+		pfree_replace(pop, &entry->table_off, &entry->next_off);
+	}
+}
+
+/*
+ * type_index_build -- (internal) creates the table of an index from
+ *	the current content of the heap
+ */
+static int
+type_index_build(struct type_index *ti, struct type_index_entry *entry)
+{
+	PMEMobjpool *pop = ti->pop;
+
+	struct type_index_scan scan = {entry->type_num, NULL, 0};
+	palloc_foreach_part(&pop->heap, 0, 1, type_index_scan_cb, &scan);
+
+	uint64_t capacity = type_index_capacity(scan.nobjs);
+	if (pmalloc_construct(pop, &entry->next_off,
+			type_index_table_size(capacity),
+			type_index_table_constr, &capacity,
+			0, OBJ_INTERNAL_OBJECT_MASK, 0) != 0) {
+		ERR("!pmalloc_construct");
+		return -1;
+	}
+
+	scan.table = OBJ_OFF_TO_PTR(pop, entry->next_off);
+	scan.nobjs = 0;
+	palloc_foreach_part(&pop->heap, 0, 1, type_index_scan_cb, &scan);
+	pmemops_persist(&pop->p_ops, scan.table->slots,
+		capacity * sizeof(uint64_t));
+
+	type_index_install(ti, entry);
+
+	return 0;
+}
+
+/*
+ * type_index_grow -- (internal) moves the objects of an index to a bigger
+ *	table
+ */
+static int
+type_index_grow(struct type_index *ti, struct type_index_rt *rt,
+	uint64_t capacity)
+{
+	PMEMobjpool *pop = ti->pop;
+	struct type_index_entry *entry = rt->entry;
+
+	if (pmalloc_construct(pop, &entry->next_off,
+			type_index_table_size(capacity),
+			type_index_table_constr, &capacity,
+			0, OBJ_INTERNAL_OBJECT_MASK, 0) != 0) {
+		ERR("!pmalloc_construct");
+		return -1;
+	}
+
+	struct type_index_table *table = OBJ_OFF_TO_PTR(pop, entry->next_off);
+	for (uint64_t i = 0; i < rt->table->capacity; ++i) {
+		uint64_t slot = rt->table->slots[i];
+		if (slot != TYPE_INDEX_SLOT_EMPTY &&
+				slot != TYPE_INDEX_SLOT_REMOVED)
+			type_index_table_put(table, slot);
+	}
+	pmemops_persist(&pop->p_ops, table->slots,
+		capacity * sizeof(uint64_t));
+
+	type_index_install(ti, entry);
+
+	return type_index_load(ti, rt);
+}
+
+/*
+ * type_index_recover -- (internal) finishes or rolls back the replacement
+ *	of the table of an entry interrupted by a failure
+ */
+static void
+type_index_recover(struct type_index *ti, struct type_index_entry *entry)
+{
+	PMEMobjpool *pop = ti->pop;
+
+	if (entry->next_off == 0)
+		return;
+
+	if (entry->next_off == entry->table_off) {
+		entry->next_off = 0;
+		pmemops_persist(&pop->p_ops, &entry->next_off,
+			sizeof(entry->next_off));
+	} else {
+		pfree(pop, &entry->next_off);
+	}
+}
+
+/*
+ * type_index_new -- boots the indexes of the pool, rebuilding them if
+ *	the pool was modified without maintaining them
+ */
+struct type_index *
+type_index_new(PMEMobjpool *pop)
+{
+	struct type_index *ti = Zalloc(sizeof(*ti));
+	if (ti == NULL) {
+		ERR("!Zalloc");
+		return NULL;
+	}
+
+	ti->pop = pop;
+	ti->layout = &pop->type_index;
+	util_rwlock_init(&ti->lock);
+
+	/* the indexes are valid only if they were maintained last time */
+	uint64_t prev_run_id = pop->run_id - 2;
+	int rebuild = ti->layout->run_id != prev_run_id;
+
+	for (unsigned i = 0; i < TYPE_INDEX_MAX; ++i) {
+		struct type_index_rt *rt = &ti->rt[i];
+		struct type_index_entry *entry = &ti->layout->entries[i];
+		rt->entry = entry;
+
+		type_index_recover(ti, entry);
+
+		if (entry->table_off == 0)
+			continue;
+
+		if (rebuild && type_index_build(ti, entry) != 0)
+			goto err;
+
+		if (type_index_load(ti, rt) != 0)
+			goto err;
+
+		rt->active = 1;
+		ti->nactive++;
+	}
+
+	/*
+	 * A pool without indexes has nothing to rebuild, its run_id is
+	 * recorded once an index is created. A lost update makes the next
+	 * open rebuild the indexes, so it's not drained here.
+	 */
+	if (ti->nactive != 0) {
+		ti->layout->run_id = pop->run_id;
+		pmemops_flush(&pop->p_ops, &ti->layout->run_id,
+			sizeof(ti->layout->run_id));
+	}
+
+	return ti;
+
+err:
+	/* the pool remains usable, the indexes are rebuilt on the next open */
+	type_index_stale(ti);
+	return ti;
+}
+
+/*
+ * type_index_delete -- deletes the runtime state of the indexes
+ */
+void
+type_index_delete(struct type_index *ti)
+{
+	if (ti == NULL)
+		return;
+
+	for (unsigned i = 0; i < TYPE_INDEX_MAX; ++i)
+		Free(ti->rt[i].occupied);
+
+	util_rwlock_destroy(&ti->lock);
+	Free(ti);
+}
+
+/*
+ * type_index_create -- creates the index of the given type
+ */
+int
+type_index_create(struct type_index *ti, uint64_t type_num)
+{
+	PMEMobjpool *pop = ti->pop;
+	int ret = 0;
+
+	util_rwlock_wrlock(&ti->lock);
+
+	if (ti->stale) {
+		ERR("type indexes are stale until the pool is reopened");
+		ret = EAGAIN;
+		goto out;
+	}
+
+	if (type_index_find(ti, type_num) != NULL) {
+		ERR("type %" PRIu64 " is already indexed", type_num);
+		ret = EEXIST;
+		goto out;
+	}
+
+	struct type_index_rt *rt = NULL;
+	for (unsigned i = 0; i < TYPE_INDEX_MAX; ++i) {
+		if (ti->rt[i].entry->table_off == 0) {
+			rt = &ti->rt[i];
+			break;
+		}
+	}
+
+	if (rt == NULL) {
+		ERR("no more than %d types can be indexed", TYPE_INDEX_MAX);
+		ret = ENOSPC;
+		goto out;
+	}
+
+	rt->entry->type_num = type_num;
+	pmemops_persist(&pop->p_ops, &rt->entry->type_num,
+		sizeof(rt->entry->type_num));
+
+	if (ti->layout->run_id != pop->run_id) {
+		ti->layout->run_id = pop->run_id;
+		pmemops_persist(&pop->p_ops, &ti->layout->run_id,
+			sizeof(ti->layout->run_id));
+	}
+
+	if (type_index_build(ti, rt->entry) != 0) {
+		ret = ENOMEM;
+		goto out;
+	}
+
+	if (type_index_load(ti, rt) != 0) {
+		/* the table is not going to be updated from now on */
+		type_index_stale(ti);
+		ret = ENOMEM;
+		goto out;
+	}
+
+	util_atomic_store_explicit32(&rt->active, 1, memory_order_release);
+	util_fetch_and_add32(&ti->nactive, 1);
+
+out:
+	util_rwlock_unlock(&ti->lock);
+	return ret;
+}
+
+/*
+ * type_index_destroy -- removes the index of the given type
+ */
+int
+type_index_destroy(struct type_index *ti, uint64_t type_num)
+{
+	int ret = 0;
+
+	util_rwlock_wrlock(&ti->lock);
+
+	struct type_index_rt *rt = type_index_find(ti, type_num);
+	if (rt == NULL) {
+		ERR("type %" PRIu64 " is not indexed", type_num);
+		ret = ENOENT;
+		goto out;
+	}
+
+	util_atomic_store_explicit32(&rt->active, 0, memory_order_release);
+	util_fetch_and_sub32(&ti->nactive, 1);
+
+	/* the table is an internal object, it's not tracked by any index */
+	pfree(ti->pop, &rt->entry->table_off);
+
+	Free(rt->occupied);
+	rt->occupied = NULL;
+	rt->table = NULL;
+
+out:
+	util_rwlock_unlock(&ti->lock);
+	return ret;
+}
+
+/*
+ * type_index_empty -- returns whether there are no indexes to update,
+ *	does not require the lock
+ */
+int
+type_index_empty(struct type_index *ti)
+{
+	unsigned nactive;
+	util_atomic_load_explicit32(&ti->nactive, &nactive,
+		memory_order_acquire);
+
+	return nactive == 0;
+}
+
+/*
+ * type_index_tracks -- returns whether allocations of the given type have to
+ *	update an index, does not require the lock
+ */
+int
+type_index_tracks(struct type_index *ti, uint64_t type_num, uint16_t flags)
+{
+	if (ti == NULL || (flags & OBJ_INTERNAL_OBJECT_MASK))
+		return 0;
+
+	if (type_index_is_stale(ti))
+		return 0;
+
+	return type_index_find(ti, type_num) != NULL;
+}
+
+/*
+ * type_index_lock -- starts the update of the indexes
+ */
+void
+type_index_lock(struct type_index *ti)
+{
+	util_rwlock_rdlock(&ti->lock);
+}
+
+/*
+ * type_index_full -- (internal) returns whether an index has to get a bigger
+ *	table before the reserved inserts are done
+ */
+static int
+type_index_full(struct type_index *ti)
+{
+	if (type_index_is_stale(ti))
+		return 0;
+
+	uint64_t reserved;
+	util_atomic_load_explicit64(&ti->reserved, &reserved,
+		memory_order_acquire);
+
+	for (unsigned i = 0; i < TYPE_INDEX_MAX; ++i) {
+		struct type_index_rt *rt = &ti->rt[i];
+		if (!rt->active)
+			continue;
+
+		uint64_t used;
+		uint64_t removed;
+		util_atomic_load_explicit64(&rt->used, &used,
+			memory_order_acquire);
+		util_atomic_load_explicit64(&rt->removed, &removed,
+			memory_order_acquire);
+
+		/* keep at least a quarter of the slots empty for probing */
+		if ((used + removed + reserved) * 4 > rt->table->capacity * 3)
+			return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * type_index_grow_full -- (internal) replaces the tables of all the indexes
+ *	which are full, must be called with the lock taken for writing
+ */
+static int
+type_index_grow_full(struct type_index *ti)
+{
+	for (unsigned i = 0; i < TYPE_INDEX_MAX; ++i) {
+		struct type_index_rt *rt = &ti->rt[i];
+		if (!rt->active)
+			continue;
+
+		uint64_t capacity = rt->table->capacity;
+		if ((rt->used + rt->removed + ti->reserved) * 4 <=
+				capacity * 3)
+			continue;
+
+		/* a table full of removed slots is rehashed at the same size */
+		uint64_t nobjs = rt->used + ti->reserved;
+		if (type_index_grow(ti, rt, type_index_capacity(nobjs)) == 0)
+			continue;
+
+		/* without a new table an insert needs at least one slot */
+		if (rt->used + rt->removed + ti->reserved > capacity)
+			type_index_stale(ti);
+
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * type_index_prepare -- makes room for the given number of inserts of
+ *	the update, might wait for the other updates to finish
+ */
+void
+type_index_prepare(struct type_index *ti, uint64_t ninserts)
+{
+	util_fetch_and_add64(&ti->reserved, ninserts);
+
+	while (type_index_full(ti)) {
+		util_rwlock_unlock(&ti->lock);
+
+		util_rwlock_wrlock(&ti->lock);
+		int ret = type_index_grow_full(ti);
+		util_rwlock_unlock(&ti->lock);
+
+		util_rwlock_rdlock(&ti->lock);
+
+		/* the updates go to the tables which have some room left */
+		if (ret != 0)
+			break;
+	}
+}
+
+/*
+ * type_index_claim -- (internal) takes the slot for an insert, returns 0 if
+ *	it's not empty
+ */
+static int
+type_index_claim(struct type_index_rt *rt, uint64_t slot)
+{
+	uint64_t *word = &rt->occupied[slot / 64];
+	uint64_t bit = 1ULL << (slot % 64);
+
+	uint64_t val;
+	util_atomic_load_explicit64(word, &val, memory_order_acquire);
+	while (!(val & bit)) {
+		if (util_bool_compare_and_swap64(word, val, val | bit))
+			return 1;
+
+		util_atomic_load_explicit64(word, &val, memory_order_acquire);
+	}
+
+	return 0;
+}
+
+/*
+ * type_index_insert -- adds the update of the index of the object to
+ *	the operation
+ */
+void
+type_index_insert(struct type_index *ti, struct operation_context *ctx,
+	uint64_t type_num, uint64_t off)
+{
+	if (type_index_is_stale(ti))
+		return;
+
+	struct type_index_rt *rt = type_index_find(ti, type_num);
+	if (rt == NULL)
+		return;
+
+	uint64_t capacity = rt->table->capacity;
+	uint64_t slot = type_index_hash(off, capacity);
+	for (uint64_t n = 0; !type_index_claim(rt, slot); ++n) {
+		if (n == capacity) {
+			type_index_stale(ti);
+			return;
+		}
+		slot = (slot + 1) & (capacity - 1);
+	}
+
+	if (operation_add_entry(ctx, &rt->table->slots[slot], off,
+			ULOG_OPERATION_SET) != 0) {
+		type_index_stale(ti);
+		return;
+	}
+
+	util_fetch_and_add64(&rt->used, 1);
+}
+
+/*
+ * type_index_remove -- adds the removal of the object from the index to
+ *	the operation
+ */
+void
+type_index_remove(struct type_index *ti, struct operation_context *ctx,
+	uint64_t type_num, uint64_t off)
+{
+	if (type_index_is_stale(ti))
+		return;
+
+	struct type_index_rt *rt = type_index_find(ti, type_num);
+	if (rt == NULL)
+		return;
+
+	/* the slots claimed by the pending inserts might still be empty */
+	uint64_t mask = rt->table->capacity - 1;
+	uint64_t slot = type_index_hash(off, rt->table->capacity);
+	while (rt->table->slots[slot] != off) {
+		uint64_t val;
+		util_atomic_load_explicit64(&rt->occupied[slot / 64], &val,
+			memory_order_acquire);
+		if (!(val & (1ULL << (slot % 64)))) {
+			ASSERT(0); /* all the objects of the type are indexed */
+			return;
+		}
+		slot = (slot + 1) & mask;
+	}
+
+	if (operation_add_entry(ctx, &rt->table->slots[slot],
+			TYPE_INDEX_SLOT_REMOVED, ULOG_OPERATION_SET) != 0) {
+		type_index_stale(ti);
+		return;
+	}
+
+	util_fetch_and_sub64(&rt->used, 1);
+	util_fetch_and_add64(&rt->removed, 1);
+}
+
+/*
+ * type_index_unlock -- ends the update of the indexes once the operation is
+ *	processed, ninserts is the value passed to type_index_prepare()
+ */
+void
+type_index_unlock(struct type_index *ti, uint64_t ninserts)
+{
+	util_fetch_and_sub64(&ti->reserved, ninserts);
+	util_rwlock_unlock(&ti->lock);
+}
+
+/*
+ * type_index_foreach -- calls cb for the objects of the given type from one
+ *	of the nparts partitions of the index, returns -1 if the type is not
+ *	indexed
+ */
+int
+type_index_foreach(struct type_index *ti, uint64_t type_num,
+	unsigned part, unsigned nparts, type_index_cb cb, void *arg)
+{
+	if (!type_index_tracks(ti, type_num, 0))
+		return -1;
+
+	struct type_index_rt *rt = type_index_find(ti, type_num);
+	struct type_index_table *table = rt->table;
+
+	uint64_t begin = table->capacity * part / nparts;
+	uint64_t end = table->capacity * (part + 1) / nparts;
+	for (uint64_t i = begin; i < end; ++i) {
+		uint64_t slot = table->slots[i];
+		if (slot == TYPE_INDEX_SLOT_EMPTY ||
+				slot == TYPE_INDEX_SLOT_REMOVED)
+			continue;
+
+		if (cb(slot, arg))
+			break;
+	}
+
+	return 0;
+}
@@ -0,0 +1,74 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright 2020, Intel Corporation */
+
+/*
+ * type_index.h -- internal definitions for persistent per-type indexes
+ */
+#ifndef LIBPMEMOBJ_TYPE_INDEX_H
+#define LIBPMEMOBJ_TYPE_INDEX_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libpmemobj.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* maximum number of indexed types in a single pool */
+#define TYPE_INDEX_MAX 8
+
+/*
+ * Persistent descriptor of the index of a single type, the index does not
+ * exist if table_off is zero.
+ */
+struct type_index_entry {
+	uint64_t type_num;
+	uint64_t table_off; /* hash table of the offsets of the objects */
+	uint64_t next_off; /* table being filled, zero unless it's replaced */
+};
+
+/* persistent state of the indexes, part of the pool descriptor */
+struct type_index_layout {
+	uint64_t run_id; /* run of the pool which last maintained the indexes */
+	struct type_index_entry entries[TYPE_INDEX_MAX];
+};
+
+struct operation_context;
+struct type_index;
+
+struct type_index *type_index_new(PMEMobjpool *pop);
+void type_index_delete(struct type_index *ti);
+
+int type_index_create(struct type_index *ti, uint64_t type_num);
+int type_index_destroy(struct type_index *ti, uint64_t type_num);
+
+/*
+ * Updates of the indexes done alongside allocations, all of them have to
+ * happen between type_index_lock() and type_index_unlock() - the latter is
+ * called once the operation context is processed. The updates of different
+ * threads are done concurrently.
+ */
+int type_index_empty(struct type_index *ti);
+int type_index_tracks(struct type_index *ti, uint64_t type_num,
+	uint16_t flags);
+void type_index_lock(struct type_index *ti);
+void type_index_prepare(struct type_index *ti, uint64_t ninserts);
+void type_index_insert(struct type_index *ti, struct operation_context *ctx,
+	uint64_t type_num, uint64_t off);
+void type_index_remove(struct type_index *ti, struct operation_context *ctx,
+	uint64_t type_num, uint64_t off);
+void type_index_unlock(struct type_index *ti, uint64_t ninserts);
+
+/* iteration callback, terminates iteration if return value is non-zero */
+typedef int (*type_index_cb)(uint64_t off, void *arg);
+
+int type_index_foreach(struct type_index *ti, uint64_t type_num,
+	unsigned part, unsigned nparts, type_index_cb cb, void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBPMEMOBJ_TYPE_INDEX_H */
@@ -9,6 +9,7 @@
 #include <string.h>
 
 #include "libpmemobj.h"
+#include "line_batch.h"
 #include "pmemops.h"
 #include "ulog.h"
 #include "obj.h"
@@ -519,6 +520,28 @@ ulog_entry_buf_create(struct ulog *ulog, size_t offset, uint64_t gen_num,
 	return e;
 }
 
+/*
+ * ulog_entry_val_apply -- (internal) stores the result of a value entry
+ */
+static inline void
+ulog_entry_val_apply(const struct ulog_entry_val *ev, ulog_operation_type t,
+	uint64_t *dst)
+{
+	switch (t) {
+		case ULOG_OPERATION_AND:
+			*dst &= ev->value;
+		break;
+		case ULOG_OPERATION_OR:
+			*dst |= ev->value;
+		break;
+		case ULOG_OPERATION_SET:
+			*dst = ev->value;
+		break;
+		default:
+			ASSERT(0);
+	}
+}
+
 /*
  * ulog_entry_apply -- applies modifications of a single ulog entry
  */
@@ -539,26 +562,12 @@ ulog_entry_apply(const struct ulog_entry_base *e, int persist,
 
 	switch (t) {
 		case ULOG_OPERATION_AND:
-			ev = (struct ulog_entry_val *)e;
-
-			VALGRIND_ADD_TO_TX(dst, dst_size);
-			*dst &= ev->value;
-			f(p_ops->base, dst, sizeof(uint64_t),
-				PMEMOBJ_F_RELAXED);
-		break;
 		case ULOG_OPERATION_OR:
-			ev = (struct ulog_entry_val *)e;
-
-			VALGRIND_ADD_TO_TX(dst, dst_size);
-			*dst |= ev->value;
-			f(p_ops->base, dst, sizeof(uint64_t),
-				PMEMOBJ_F_RELAXED);
-		break;
 		case ULOG_OPERATION_SET:
 			ev = (struct ulog_entry_val *)e;
 
 			VALGRIND_ADD_TO_TX(dst, dst_size);
-			*dst = ev->value;
+			ulog_entry_val_apply(ev, t, dst);
 			f(p_ops->base, dst, sizeof(uint64_t),
 				PMEMOBJ_F_RELAXED);
 		break;
@@ -585,16 +594,44 @@ ulog_entry_apply(const struct ulog_entry_base *e, int persist,
 }
 
 /*
- * ulog_process_entry -- (internal) processes a single ulog entry
+ * ulog_process_entry -- (internal) processes a single ulog entry, the flushes
+ *	of the value entries are deferred to the batch of lines, if any
  */
 static int
 ulog_process_entry(struct ulog_entry_base *e, void *arg,
 	const struct pmem_ops *p_ops)
 {
-	ulog_entry_apply(e, 0, p_ops);
+	struct line_batch *lines = arg;
+	ulog_operation_type t = ulog_entry_type(e);
+
+	if (lines == NULL || t == ULOG_OPERATION_BUF_SET ||
+	    t == ULOG_OPERATION_BUF_CPY) {
+		ulog_entry_apply(e, 0, p_ops);
+		return 0;
+	}
+
+	uint64_t *dst = (uint64_t *)((uintptr_t)p_ops->base +
+		ulog_entry_offset(e));
+
+	VALGRIND_ADD_TO_TX(dst, sizeof(uint64_t));
+	ulog_entry_val_apply((struct ulog_entry_val *)e, t, dst);
+	if (line_batch_add(lines, dst, sizeof(uint64_t)) != 0)
+		pmemops_xflush(p_ops, dst, sizeof(uint64_t), PMEMOBJ_F_RELAXED);
+	VALGRIND_REMOVE_FROM_TX(dst, sizeof(uint64_t));
 
 	return 0;
 }
+
+/*
+ * ulog_flush_lines -- (internal) flushes a range of lines of the batch
+ */
+static void
+ulog_flush_lines(const void *addr, size_t len, void *arg)
+{
+	const struct pmem_ops *p_ops = arg;
+
+	pmemops_xflush(p_ops, addr, len, PMEMOBJ_F_RELAXED);
+}
 /*
  * ulog_inc_gen_num -- (internal) increments gen num in the ulog
  */
@@ -779,10 +816,13 @@ ulog_clobber_data(struct ulog *ulog_first,
 
 /*
  * ulog_process -- process ulog entries
+ *
+ * If lines is not NULL, every cache line modified by the value entries is
+ * flushed only once, however many of them it holds, right before the drain.
  */
 void
 ulog_process(struct ulog *ulog, ulog_check_offset_fn check,
-	const struct pmem_ops *p_ops)
+	struct line_batch *lines, const struct pmem_ops *p_ops)
 {
 	LOG(15, "ulog %p", ulog);
 
@@ -791,7 +831,9 @@ ulog_process(struct ulog *ulog, ulog_check_offset_fn check,
 		ulog_check(ulog, check, p_ops);
 #endif
 
-	ulog_foreach_entry(ulog, ulog_process_entry, NULL, p_ops);
+	ulog_foreach_entry(ulog, ulog_process_entry, lines, p_ops);
+	if (lines != NULL)
+		line_batch_flush(lines, ulog_flush_lines, (void *)p_ops);
 	pmemops_drain(p_ops);
 }
 
@@ -844,7 +886,7 @@ ulog_recover(struct ulog *ulog, ulog_check_offset_fn check,
 	LOG(15, "ulog %p", ulog);
 
 	if (ulog_recovery_needed(ulog, 1)) {
-		ulog_process(ulog, check, p_ops);
+		ulog_process(ulog, check, NULL, p_ops);
 		ulog_clobber(ulog, NULL, p_ops);
 	}
 }
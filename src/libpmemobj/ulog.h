@@ -132,8 +132,10 @@ int ulog_clobber_data(struct ulog *dest,
 void ulog_clobber_entry(const struct ulog_entry_base *e,
 	const struct pmem_ops *p_ops);
 
+struct line_batch;
+
 void ulog_process(struct ulog *ulog, ulog_check_offset_fn check,
-	const struct pmem_ops *p_ops);
+	struct line_batch *lines, const struct pmem_ops *p_ops);
 
 size_t ulog_base_nbytes(struct ulog *ulog);
 int ulog_recovery_needed(struct ulog *ulog, int verify_checksum);
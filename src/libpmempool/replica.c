@@ -315,6 +315,16 @@ replica_is_replica_consistent(unsigned repn,
 	return !(REP_HEALTH(set_hs, repn)->flags & IS_INCONSISTENT);
 }
 
+/*
+ * replica_is_replica_lagging -- check if replica is marked as lagging
+ */
+int
+replica_is_replica_lagging(unsigned repn,
+		struct poolset_health_status *set_hs)
+{
+	return REP_HEALTH(set_hs, repn)->flags & IS_LAGGING;
+}
+
 /*
  * replica_has_bad_blocks -- check if replica has bad blocks
  */
@@ -366,6 +376,7 @@ replica_is_replica_healthy(unsigned repn, struct poolset_health_status *set_hs)
 
 	int ret = !replica_is_replica_broken(repn, set_hs) &&
 			replica_is_replica_consistent(repn, set_hs) &&
+			!replica_is_replica_lagging(repn, set_hs) &&
 			!replica_has_bad_blocks(repn, set_hs);
 
 	LOG(4, "return %i", ret);
@@ -1478,6 +1489,39 @@ check_shutdown_state(struct pool_set *set,
 	return 0;
 }
 
+/*
+ * check_replica_lag -- (internal) check if catch-up of a lazily updated
+ *			replica was interrupted
+ */
+static void
+check_replica_lag(struct pool_set *set, struct poolset_health_status *set_hs)
+{
+	LOG(3, "set %p, set_hs %p", set, set_hs);
+	for (unsigned r = 0; r < set->nreplicas; ++r) {
+		struct pool_replica *rep = set->replica[r];
+		struct replica_health_status *rep_hs = set_hs->replica[r];
+		struct pool_hdr *hdrp = HDR(rep, 0);
+
+		/* broken replicas are recreated anyway */
+		if (rep->remote || hdrp == NULL ||
+				replica_is_replica_broken(r, set_hs))
+			continue;
+
+		/* the feature can be left without the marker by a crash */
+		uint64_t end = le64toh(hdrp->lag.end);
+		if (end == 0 && (le32toh(hdrp->features.incompat) &
+				POOL_FEAT_LAG) == 0)
+			continue;
+
+		rep_hs->lag_begin = le64toh(hdrp->lag.begin);
+		rep_hs->lag_end = end;
+		rep_hs->flags |= IS_LAGGING;
+
+		LOG(1, "replica %u is lagging, range 0x%zx-0x%zx", r,
+			rep_hs->lag_begin, rep_hs->lag_end);
+	}
+}
+
 /*
  * check_uuids_between_parts -- (internal) check if uuids between adjacent
  *                              parts are consistent for a given replica
@@ -2042,6 +2086,8 @@ replica_check_poolset_health(struct pool_set *set,
 		goto err;
 	}
 
+	check_replica_lag(set, set_hs);
+
 	/* check if uuids in parts across each replica are consistent */
 	if (check_replicas_consistency(set, set_hs)) {
 		LOG(1, "replica consistency check failed");
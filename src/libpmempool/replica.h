@@ -40,6 +40,12 @@ extern "C" {
  */
 #define HAS_CORRUPTED_HEADER	(1U << 3)
 
+/*
+ * A replica marked in this way was updated lazily and a range of its data may
+ * be older than in the other replicas
+ */
+#define IS_LAGGING		(1U << 4)
+
 /*
  * A flag which can be passed to sync_replica() to indicate that the function is
  * called by pmempool_transform
@@ -71,6 +77,9 @@ struct replica_health_status {
 	unsigned flags;
 	/* effective size of a pool, valid only for healthy replica */
 	size_t pool_size;
+	/* range of data to be copied, valid only for lagging replica */
+	size_t lag_begin;
+	size_t lag_end;
 	/* flags for each part */
 	struct part_health_status part[];
 };
@@ -180,6 +189,8 @@ int replica_is_replica_broken(unsigned repn,
 		struct poolset_health_status *set_hs);
 int replica_is_replica_consistent(unsigned repn,
 		struct poolset_health_status *set_hs);
+int replica_is_replica_lagging(unsigned repn,
+		struct poolset_health_status *set_hs);
 int replica_is_replica_healthy(unsigned repn,
 		struct poolset_health_status *set_hs);
 
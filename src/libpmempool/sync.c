@@ -1134,6 +1134,58 @@ copy_data_to_broken_parts(struct pool_set *set, unsigned healthy_replica,
 	return 0;
 }
 
+/*
+ * copy_data_to_lagging_replicas -- (internal) copy the stale range of data to
+ *                                  all lazily updated replicas
+ */
+static int
+copy_data_to_lagging_replicas(struct pool_set *set, unsigned healthy_replica,
+		struct poolset_health_status *set_hs)
+{
+	LOG(3, "set %p, healthy_replica %u, set_hs %p", set, healthy_replica,
+			set_hs);
+
+	size_t poolsize = set->poolsize;
+
+	for (unsigned r = 0; r < set_hs->nreplicas; ++r) {
+		/* broken replicas have all their data copied */
+		if (!replica_is_replica_lagging(r, set_hs) ||
+				replica_is_replica_broken(r, set_hs))
+			continue;
+
+		struct replica_health_status *rep_hs = REP_HEALTH(set_hs, r);
+		struct pool_replica *rep = REP(set, r);
+		struct pool_replica *rep_h = REP(set, healthy_replica);
+
+		size_t off = MAX(rep_hs->lag_begin, POOL_HDR_SIZE);
+		size_t end = MIN(rep_hs->lag_end, poolsize);
+
+		if (off < end) {
+			void *src_addr = ADDR_SUM(rep_h->part[0].addr, off);
+			void *dst_addr = ADDR_SUM(rep->part[0].addr, off);
+
+			if (sync_copy_data(src_addr, dst_addr, off, end - off,
+					rep_h, rep, &rep->part[0]))
+				return -1;
+		}
+
+		/* the replica is up to date now */
+		struct pool_hdr *hdrp = HDR(rep, 0);
+		hdrp->lag.end = 0;
+		hdrp->lag.begin = 0;
+		util_persist(PART(rep, 0)->is_dev_dax, &hdrp->lag,
+			sizeof(hdrp->lag));
+
+		hdrp->features.incompat &= htole32(~POOL_FEAT_LAG);
+		util_checksum(hdrp, sizeof(*hdrp), &hdrp->checksum, 1,
+			POOL_HDR_CSUM_END_OFF(hdrp));
+		util_persist(PART(rep, 0)->is_dev_dax, hdrp, sizeof(*hdrp));
+
+		rep_hs->flags &= ~IS_LAGGING;
+	}
+	return 0;
+}
+
 /*
  * grant_created_parts_perm -- (internal) set RW permission rights to all
  *                            the parts created in place of the broken ones
@@ -1626,6 +1678,13 @@ replica_sync(struct pool_set *set, struct poolset_health_status *s_hs,
 		goto out;
 	}
 
+	/* copy data written lazily but not replicated before a crash */
+	if (copy_data_to_lagging_replicas(set, healthy_replica, set_hs)) {
+		ERR("copying data to lagging replicas failed");
+		ret = -1;
+		goto out;
+	}
+
 	/* update uuids of replicas and parts */
 	if (update_uuids(set, set_hs)) {
 		ERR("updating uuids failed");
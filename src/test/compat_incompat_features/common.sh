@@ -37,7 +37,7 @@ let "POOL_FEAT_SDS = 0x0004"
 UNKNOWN_COMPAT=(2 4 8 1024)
 
 # Unknown incompat flags:
-UNKNOWN_INCOMPAT=(8 15 1111)
+UNKNOWN_INCOMPAT=(16 31 1111)
 
 # set compat flags in header
 set_compat() {
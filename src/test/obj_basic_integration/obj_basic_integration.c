@@ -619,6 +619,19 @@ test_root_size(PMEMobjpool *pop)
 	UT_ASSERTeq(pmemobj_root_size(pop), sizeof(struct dummy_root));
 }
 
+/*
+ * test_replica_sync -- waits for the lazily updated replicas, if any
+ */
+static void
+test_replica_sync(PMEMobjpool *pop)
+{
+	UT_ASSERTeq(pmemobj_replica_sync(pop), 0);
+
+	size_t lag;
+	if (pmemobj_ctl_get(pop, "replica.1.lag", &lag) == 0)
+		UT_ASSERTeq(lag, 0);
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -646,6 +659,7 @@ main(int argc, char *argv[])
 	test_action_api(pop);
 	test_offsetof();
 	test_layout();
+	test_replica_sync(pop);
 
 	pmemobj_close(pop);
 
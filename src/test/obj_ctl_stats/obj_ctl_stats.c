@@ -7,6 +7,176 @@
 
 #include "unittest.h"
 
+struct tx_stats_cb_arg {
+	unsigned calls;
+	struct pobj_tx_stats last;
+};
+
+/*
+ * tx_stats_cb -- saves the statistics of the last finished transaction
+ */
+static void
+tx_stats_cb(PMEMobjpool *pop, const struct pobj_tx_stats *stats, void *arg)
+{
+	struct tx_stats_cb_arg *cb_arg = arg;
+
+	cb_arg->calls++;
+	cb_arg->last = *stats;
+}
+
+/*
+ * test_tx_stats -- verifies the per-transaction statistics
+ */
+static void
+test_tx_stats(PMEMobjpool *pop)
+{
+	enum pobj_stats_enabled enum_enabled = POBJ_STATS_ENABLED_TRANSIENT;
+	int ret = pmemobj_ctl_set(pop, "stats.enabled", &enum_enabled);
+	UT_ASSERTeq(ret, 0);
+
+	PMEMoid oid;
+	ret = pmemobj_zalloc(pop, &oid, 1024, 0);
+	UT_ASSERTeq(ret, 0);
+
+	int enabled;
+	ret = pmemobj_ctl_get(pop, "stats.tx.enabled", &enabled);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(enabled, 0);
+
+	/* disabled statistics are not collected */
+	TX_BEGIN(pop) {
+		pmemobj_tx_add_range(oid, 0, 64);
+	} TX_END
+
+	uint64_t count = 1;
+	ret = pmemobj_ctl_get(pop, "stats.tx.count", &count);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(count, 0);
+
+	struct tx_stats_cb_arg cb_arg;
+	memset(&cb_arg, 0, sizeof(cb_arg));
+	struct pobj_tx_stats_callback_desc desc = {tx_stats_cb, &cb_arg};
+	ret = pmemobj_ctl_set(pop, "stats.tx.callback", &desc);
+	UT_ASSERTeq(ret, 0);
+
+	enabled = 1;
+	ret = pmemobj_ctl_set(pop, "stats.tx.enabled", &enabled);
+	UT_ASSERTeq(ret, 0);
+
+	char *data = pmemobj_direct(oid);
+	TX_BEGIN(pop) {
+		pmemobj_tx_add_range(oid, 0, 64);
+		memset(data, 1, 64);
+		TX_BEGIN(pop) {
+			pmemobj_tx_add_range(oid, 512, 256);
+			memset(data + 512, 1, 256);
+		} TX_END
+		pmemobj_tx_xadd_range(oid, 64, 64, POBJ_XADD_NO_SNAPSHOT);
+		pmemobj_tx_free(pmemobj_tx_alloc(16, 0));
+	} TX_END
+
+	/* nested transactions are accounted to the outermost one */
+	UT_ASSERTeq(cb_arg.calls, 1);
+	UT_ASSERTeq(cb_arg.last.ranges, 3);
+	UT_ASSERTeq(cb_arg.last.snapshot_bytes, 64 + 256);
+	UT_ASSERT(cb_arg.last.redo_entries > 0);
+	UT_ASSERT(cb_arg.last.flushes > 0);
+	UT_ASSERT(cb_arg.last.drains > 0);
+	UT_ASSERT(cb_arg.last.work_ns > 0);
+	UT_ASSERTeq(cb_arg.last.onabort_ns, 0);
+
+	ret = pmemobj_ctl_get(pop, "stats.tx.count", &count);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(count, 1);
+
+	uint64_t val;
+	ret = pmemobj_ctl_get(pop, "stats.tx.ranges", &val);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(val, 3);
+
+	ret = pmemobj_ctl_get(pop, "stats.tx.snapshot_bytes", &val);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(val, 64 + 256);
+
+	ret = pmemobj_ctl_get(pop, "stats.tx.flushes", &val);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(val, cb_arg.last.flushes);
+
+	ret = pmemobj_ctl_get(pop, "stats.tx.time.work", &val);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(val, cb_arg.last.work_ns);
+
+	/* an aborted transaction is accounted as well */
+	TX_BEGIN(pop) {
+		pmemobj_tx_add_range(oid, 0, 64);
+		pmemobj_tx_abort(ECANCELED);
+	} TX_END
+
+	UT_ASSERTeq(cb_arg.calls, 2);
+	UT_ASSERTeq(cb_arg.last.ranges, 1);
+	UT_ASSERT(cb_arg.last.onabort_ns > 0);
+	UT_ASSERTeq(cb_arg.last.oncommit_ns, 0);
+
+	ret = pmemobj_ctl_get(pop, "stats.tx.count", &count);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(count, 2);
+
+	enabled = 0;
+	ret = pmemobj_ctl_set(pop, "stats.tx.enabled", &enabled);
+	UT_ASSERTeq(ret, 0);
+
+	TX_BEGIN(pop) {
+		pmemobj_tx_add_range(oid, 0, 64);
+	} TX_END
+
+	UT_ASSERTeq(cb_arg.calls, 2);
+	ret = pmemobj_ctl_get(pop, "stats.tx.count", &count);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(count, 2);
+
+	pmemobj_free(&oid);
+}
+
+/*
+ * test_lane_stats -- verifies the lane contention counters
+ */
+static void
+test_lane_stats(PMEMobjpool *pop)
+{
+	unsigned partitions = 0;
+	int ret = pmemobj_ctl_get(pop, "stats.lane.partitions", &partitions);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERT(partitions >= 1);
+
+	uint64_t holds;
+	ret = pmemobj_ctl_get(pop, "stats.lane.holds", &holds);
+	UT_ASSERTeq(ret, 0);
+
+	TX_BEGIN(pop) {
+		TX_BEGIN(pop) {
+		} TX_END
+	} TX_END
+
+	/* a nested hold doesn't acquire another lane */
+	uint64_t tmp;
+	ret = pmemobj_ctl_get(pop, "stats.lane.holds", &tmp);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(tmp, holds + 1);
+
+	/* a single thread never has to wait for a lane */
+	ret = pmemobj_ctl_get(pop, "stats.lane.primary_misses", &tmp);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(tmp, 0);
+
+	ret = pmemobj_ctl_get(pop, "stats.lane.remote_holds", &tmp);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(tmp, 0);
+
+	ret = pmemobj_ctl_get(pop, "stats.lane.yields", &tmp);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(tmp, 0);
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -116,6 +286,9 @@ main(int argc, char *argv[])
 	UT_ASSERTeq(ret, 0);
 	UT_ASSERTeq(tmp, run_allocated + oid_size);
 
+	test_tx_stats(pop);
+	test_lane_stats(pop);
+
 	pmemobj_close(pop);
 
 	DONE(NULL);
@@ -2,7 +2,7 @@
 /* Copyright 2015-2020, Intel Corporation */
 
 /*
- * obj_direct.c -- unit test for pmemobj_direct()
+ * obj_direct.c -- unit test for pmemobj_direct() and pmemobj_direct_batch()
  */
 #include "obj.h"
 #include "obj_direct.h"
@@ -26,9 +26,42 @@ obj_direct(PMEMoid oid)
 	void *ptr1 = obj_direct_inline(oid);
 	void *ptr2 = obj_direct_non_inline(oid);
 	UT_ASSERTeq(ptr1, ptr2);
+
+	void *ptr3;
+	int ret = pmemobj_direct_batch(&oid, &ptr3, 1, 0);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(ptr1, ptr3);
 	return ptr1;
 }
 
+/*
+ * test_batch -- translates objects interleaved from all the pools at once
+ */
+static void
+test_batch(PMEMoid *oids, unsigned npools)
+{
+	size_t noids = 4 * (size_t)npools;
+	PMEMoid *batch = MALLOC(noids * sizeof(PMEMoid));
+	void **ptrs = MALLOC(noids * sizeof(void *));
+
+	for (size_t i = 0; i < noids; ++i)
+		batch[i] = (i % 5 == 4) ? OID_NULL : oids[i % npools];
+
+	int ret = pmemobj_direct_batch(batch, ptrs, noids,
+		POBJ_DIRECT_PREFETCH);
+	UT_ASSERTeq(ret, 0);
+
+	for (size_t i = 0; i < noids; ++i)
+		UT_ASSERTeq(ptrs[i], pmemobj_direct(batch[i]));
+
+	ret = pmemobj_direct_batch(batch, ptrs, noids, ~0U);
+	UT_ASSERTeq(ret, -1);
+	UT_ASSERTeq(errno, EINVAL);
+
+	FREE(ptrs);
+	FREE(batch);
+}
+
 static void *
 test_worker(void *arg)
 {
@@ -104,6 +137,8 @@ main(int argc, char *argv[])
 		UT_ASSERTeq(r, 0);
 	}
 
+	test_batch(tmpoids, npools);
+
 	r = pmemobj_alloc(pops[0], &thread_oid, 100, 2, NULL, NULL);
 	UT_ASSERTeq(r, 0);
 	UT_ASSERTne(obj_direct(thread_oid), NULL);
@@ -2,7 +2,8 @@
 /* Copyright 2015-2018, Intel Corporation */
 
 /*
- * obj_first_next.c -- unit tests for POBJ_FIRST macro
+ * obj_first_next.c -- unit tests for POBJ_FIRST macro and
+ *	pmemobj_foreach_part
  */
 
 #include <stddef.h>
@@ -264,6 +265,251 @@ test_internal_object_mask(PMEMobjpool *pop)
 	}
 }
 
+#define FOREACH_TYPE_NUM 2
+#define FOREACH_NOBJS 200
+#define FOREACH_NPARTS 4
+
+struct foreach_part {
+	unsigned part;
+	uint64_t flags;
+	uint64_t nobjs;
+	uint64_t ids; /* sum of the ids of the iterated objects */
+};
+
+/*
+ * foreach_part_cb -- counts the objects of a partition
+ */
+static int
+foreach_part_cb(PMEMoid oid, void *arg)
+{
+	struct foreach_part *p = arg;
+
+	p->nobjs++;
+	if (pmemobj_type_num(oid) == FOREACH_TYPE_NUM)
+		p->ids += *(uint64_t *)pmemobj_direct(oid);
+
+	return 0;
+}
+
+/*
+ * foreach_part_worker -- iterates through one of the partitions
+ */
+static void *
+foreach_part_worker(void *arg)
+{
+	struct foreach_part *p = arg;
+
+	int ret = pmemobj_foreach_part(pop, p->part, FOREACH_NPARTS,
+		FOREACH_TYPE_NUM, p->flags, foreach_part_cb, p);
+	UT_ASSERTeq(ret, 0);
+
+	return NULL;
+}
+
+/*
+ * foreach_parts -- iterates through all the partitions concurrently
+ */
+static void
+foreach_parts(uint64_t flags, uint64_t *nobjs, uint64_t *ids)
+{
+	os_thread_t threads[FOREACH_NPARTS];
+	struct foreach_part parts[FOREACH_NPARTS];
+
+	for (unsigned i = 0; i < FOREACH_NPARTS; ++i) {
+		parts[i] = (struct foreach_part){i, flags, 0, 0};
+		THREAD_CREATE(&threads[i], NULL, foreach_part_worker,
+			&parts[i]);
+	}
+
+	*nobjs = 0;
+	*ids = 0;
+	for (unsigned i = 0; i < FOREACH_NPARTS; ++i) {
+		THREAD_JOIN(&threads[i], NULL);
+		*nobjs += parts[i].nobjs;
+		*ids += parts[i].ids;
+	}
+}
+
+/*
+ * foreach_stop_cb -- terminates the iteration on the first object
+ */
+static int
+foreach_stop_cb(PMEMoid oid, void *arg)
+{
+	(*(unsigned *)arg)++;
+
+	return 5;
+}
+
+/*
+ * test_foreach_part -- verifies that the partitions cover every object once
+ */
+static void
+test_foreach_part(void)
+{
+	uint64_t nobjs;
+	uint64_t ids;
+	uint64_t ids_expected = 0;
+	PMEMoid oid;
+
+	/* objects of other types are there already */
+	uint64_t nobjs_other = 0;
+	POBJ_FOREACH(pop, oid)
+		nobjs_other++;
+
+	for (uint64_t i = 1; i <= FOREACH_NOBJS; ++i) {
+		/* mix of run and huge allocations */
+		size_t size = (i % 100 == 0) ? (300 << 10) : 64;
+		int ret = pmemobj_zalloc(pop, &oid, size, FOREACH_TYPE_NUM);
+		UT_ASSERTeq(ret, 0);
+		*(uint64_t *)pmemobj_direct(oid) = i;
+		pmemobj_persist(pop, pmemobj_direct(oid), sizeof(uint64_t));
+		ids_expected += i;
+	}
+
+	foreach_parts(0, &nobjs, &ids);
+	UT_ASSERTeq(nobjs, FOREACH_NOBJS + nobjs_other);
+	UT_ASSERTeq(ids, ids_expected);
+
+	foreach_parts(POBJ_FOREACH_TYPE_NUM, &nobjs, &ids);
+	UT_ASSERTeq(nobjs, FOREACH_NOBJS);
+	UT_ASSERTeq(ids, ids_expected);
+
+	unsigned ncalls = 0;
+	int ret = pmemobj_foreach_part(pop, 0, 1, 0, 0, foreach_stop_cb,
+		&ncalls);
+	UT_ASSERTeq(ret, 5);
+	UT_ASSERTeq(ncalls, 1);
+
+	ret = pmemobj_foreach_part(pop, 1, 1, 0, 0, foreach_stop_cb, &ncalls);
+	UT_ASSERTeq(ret, -1);
+	UT_ASSERTeq(errno, EINVAL);
+
+	ret = pmemobj_foreach_part(pop, 0, 1, 0, ~0ULL, foreach_stop_cb,
+		&ncalls);
+	UT_ASSERTeq(ret, -1);
+	UT_ASSERTeq(errno, EINVAL);
+	UT_ASSERTeq(ncalls, 1);
+
+	PMEMoid oid_tmp;
+	POBJ_FOREACH_SAFE(pop, oid, oid_tmp) {
+		if (pmemobj_type_num(oid) == FOREACH_TYPE_NUM)
+			pmemobj_free(&oid);
+	}
+}
+
+#define INDEX_NOBJS 1000
+
+/*
+ * check_type_index -- verifies that the partitioned iteration through
+ *	the objects of the indexed type finds all of them
+ */
+static void
+check_type_index(void)
+{
+	uint64_t nobjs_expected = 0;
+	uint64_t ids_expected = 0;
+	PMEMoid oid;
+	POBJ_FOREACH(pop, oid) {
+		if (pmemobj_type_num(oid) != FOREACH_TYPE_NUM)
+			continue;
+
+		nobjs_expected++;
+		ids_expected += *(uint64_t *)pmemobj_direct(oid);
+	}
+
+	uint64_t nobjs;
+	uint64_t ids;
+	foreach_parts(POBJ_FOREACH_TYPE_NUM, &nobjs, &ids);
+	UT_ASSERTeq(nobjs, nobjs_expected);
+	UT_ASSERTeq(ids, ids_expected);
+}
+
+/*
+ * test_type_index -- verifies that the index of a type follows all kinds of
+ *	allocations and deallocations, also across reopen of the pool
+ */
+static void
+test_type_index(const char *path)
+{
+	uint64_t type_num = FOREACH_TYPE_NUM;
+	PMEMoid oid;
+
+	/* objects allocated before the index is created */
+	for (uint64_t i = 1; i <= 100; ++i) {
+		int ret = pmemobj_zalloc(pop, &oid, 64, FOREACH_TYPE_NUM);
+		UT_ASSERTeq(ret, 0);
+		*(uint64_t *)pmemobj_direct(oid) = i;
+		pmemobj_persist(pop, pmemobj_direct(oid), sizeof(uint64_t));
+	}
+
+	int ret = pmemobj_ctl_exec(pop, "heap.type_index.create", &type_num);
+	UT_ASSERTeq(ret, 0);
+	ret = pmemobj_ctl_exec(pop, "heap.type_index.create", &type_num);
+	UT_ASSERTeq(ret, -1);
+	UT_ASSERTeq(errno, EEXIST);
+	check_type_index();
+
+	/* enough objects for the table to grow */
+	for (uint64_t i = 101; i <= 100 + INDEX_NOBJS; ++i) {
+		if (i % 3 == 0) {
+			ret = pmemobj_zalloc(pop, &oid, 64, FOREACH_TYPE_NUM);
+			UT_ASSERTeq(ret, 0);
+		} else if (i % 3 == 1) {
+			TX_BEGIN(pop) {
+				oid = pmemobj_tx_zalloc(64, FOREACH_TYPE_NUM);
+			} TX_ONABORT {
+				UT_ASSERT(0);
+			} TX_END
+		} else {
+			struct pobj_action act;
+			oid = pmemobj_reserve(pop, &act, 64, FOREACH_TYPE_NUM);
+			UT_ASSERT(!OID_IS_NULL(oid));
+			ret = pmemobj_publish(pop, &act, 1);
+			UT_ASSERTeq(ret, 0);
+		}
+		*(uint64_t *)pmemobj_direct(oid) = i;
+		pmemobj_persist(pop, pmemobj_direct(oid), sizeof(uint64_t));
+	}
+	check_type_index();
+
+	/* free every fourth object, atomically and in transactions */
+	PMEMoid oid_tmp;
+	POBJ_FOREACH_SAFE(pop, oid, oid_tmp) {
+		if (pmemobj_type_num(oid) != FOREACH_TYPE_NUM)
+			continue;
+
+		uint64_t id = *(uint64_t *)pmemobj_direct(oid);
+		if (id % 8 == 0) {
+			pmemobj_free(&oid);
+		} else if (id % 4 == 0) {
+			TX_BEGIN(pop) {
+				pmemobj_tx_free(oid);
+			} TX_ONABORT {
+				UT_ASSERT(0);
+			} TX_END
+		}
+	}
+	check_type_index();
+
+	pmemobj_close(pop);
+	pop = pmemobj_open(path, LAYOUT_NAME);
+	UT_ASSERTne(pop, NULL);
+	check_type_index();
+
+	ret = pmemobj_ctl_exec(pop, "heap.type_index.destroy", &type_num);
+	UT_ASSERTeq(ret, 0);
+	ret = pmemobj_ctl_exec(pop, "heap.type_index.destroy", &type_num);
+	UT_ASSERTeq(ret, -1);
+	UT_ASSERTeq(errno, ENOENT);
+	check_type_index();
+
+	POBJ_FOREACH_SAFE(pop, oid, oid_tmp) {
+		if (pmemobj_type_num(oid) == FOREACH_TYPE_NUM)
+			pmemobj_free(&oid);
+	}
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -272,7 +518,7 @@ main(int argc, char *argv[])
 		FATAL_USAGE();
 
 	const char *path = argv[1];
-	if ((pop = pmemobj_create(path, LAYOUT_NAME, PMEMOBJ_MIN_POOL,
+	if ((pop = pmemobj_create(path, LAYOUT_NAME, 4 * PMEMOBJ_MIN_POOL,
 						S_IWUSR | S_IRUSR)) == NULL)
 		UT_FATAL("!pmemobj_create");
 
@@ -302,6 +548,9 @@ main(int argc, char *argv[])
 			FATAL_USAGE();
 		}
 	}
+	test_foreach_part();
+	test_type_index(path);
+
 	do_cleanup();
 
 	test_internal_object_mask(pop);
@@ -129,6 +129,8 @@ test_lane_hold_release(void)
 	pop->p.lanes_desc.next_lane_idx = 0;
 
 	pop->p.lanes_desc.lane_locks = CALLOC(OBJ_NLANES, sizeof(uint64_t));
+	pop->p.lanes_desc.lane_stats = CALLOC(OBJ_NLANES,
+		sizeof(union lane_stats_line));
 	pop->p.lanes_offset = (uint64_t)&pop->l - (uint64_t)&pop->p;
 	pop->p.uuid_lo = 123456;
 	base_ptr = &pop->p;
@@ -158,6 +160,7 @@ test_lane_hold_release(void)
 
 	SIGACTION(SIGABRT, &old, NULL);
 
+	FREE(pop->p.lanes_desc.lane_stats);
 	FREE(pop->p.lanes_desc.lane_locks);
 	FREE(pop);
 	operation_delete(ctx);
@@ -352,9 +352,10 @@ FUNC_MOCK_END
  * ulog_process -- ulog_process mock
  */
 FUNC_MOCK(ulog_process, void, struct ulog *ulog,
-	ulog_check_offset_fn check, const struct pmem_ops *p_ops)
+	ulog_check_offset_fn check, struct line_batch *lines,
+	const struct pmem_ops *p_ops)
 		FUNC_MOCK_RUN_DEFAULT {
-			_FUNC_REAL(ulog_process)(ulog, check, p_ops);
+			_FUNC_REAL(ulog_process)(ulog, check, lines, p_ops);
 			if (Ulog_fail == FAIL_AFTER_PROCESS) {
 				DONEW(NULL);
 			}
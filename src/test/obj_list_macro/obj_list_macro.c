@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: BSD-3-Clause
-/* Copyright 2015-2019, Intel Corporation */
+/* Copyright 2015-2020, Intel Corporation */
 
 /*
  * obj_list_macro.c -- unit tests for list module
@@ -29,7 +29,7 @@ static TOID(struct list) List_sec;
 
 /* usage macros */
 #define FATAL_USAGE()\
-	UT_FATAL("usage: obj_list_macro <file> [PRnifr]")
+	UT_FATAL("usage: obj_list_macro <file> [PRnifrmNID]")
 #define FATAL_USAGE_PRINT()\
 	UT_FATAL("usage: obj_list_macro <file> P:<list>")
 #define FATAL_USAGE_PRINT_REVERSE()\
@@ -44,6 +44,14 @@ static TOID(struct list) List_sec;
 	UT_FATAL("usage: obj_list_macro <file> r:<list>:<num>")
 #define FATAL_USAGE_MOVE()\
 	UT_FATAL("usage: obj_list_macro <file> m:<num>:<where>:<num>")
+#define FATAL_USAGE_INSERT_NEW_BATCH()\
+	UT_FATAL("usage: obj_list_macro <file> N:<count>:<id>")
+#define FATAL_USAGE_INSERT_BATCH()\
+	UT_FATAL("usage: obj_list_macro <file> I:<where>:<num>:<count>:<id>")
+#define FATAL_USAGE_REMOVE_BATCH()\
+	UT_FATAL("usage: obj_list_macro <file> D:<list>:<free>:<num>[,<num>]")
+
+#define BATCH_MAX 16
 
 /*
  * get_item_list -- get nth item from list
@@ -135,6 +143,21 @@ item_constructor(PMEMobjpool *pop, void *ptr, void *arg)
 	return 0;
 }
 
+/*
+ * item_batch_constructor -- constructor which sets the item's id to
+ * the next value from the sequence
+ */
+static int
+item_batch_constructor(PMEMobjpool *pop, void *ptr, void *arg)
+{
+	int id = (*(int *)arg)++;
+	struct item *item = (struct item *)ptr;
+	item->id = id;
+	UT_OUT("constructor(id = %d)", id);
+
+	return 0;
+}
+
 /*
  * do_insert_new -- insert new element to list
  */
@@ -299,6 +322,137 @@ do_remove(PMEMobjpool *pop, const char *arg)
 	POBJ_FREE(&item);
 }
 
+/*
+ * do_insert_new_batch -- append a chain of new elements to list
+ */
+static void
+do_insert_new_batch(PMEMobjpool *pop, const char *arg)
+{
+	int count;
+	int id;
+	if (sscanf(arg, "N:%d:%d", &count, &id) != 2 ||
+			count <= 0 || count > BATCH_MAX)
+		FATAL_USAGE_INSERT_NEW_BATCH();
+
+	PMEMoid oids[BATCH_MAX];
+	errno = 0;
+	int ret = POBJ_LIST_INSERT_NEW_TAIL_BATCH(pop, &D_RW(List)->head,
+			next, sizeof(struct item), item_batch_constructor,
+			&id, oids, (size_t)count);
+	if (ret) {
+		UT_ASSERTeq(ret, -1);
+		UT_ASSERTne(errno, 0);
+		UT_FATAL("POBJ_LIST_INSERT_NEW_TAIL_BATCH");
+	}
+
+	TOID(struct item) last = POBJ_LIST_LAST(&D_RW(List)->head, next);
+	UT_ASSERT(OID_EQUALS(last.oid, oids[count - 1]));
+}
+
+/*
+ * do_insert_batch -- insert a chain of elements to list
+ */
+static void
+do_insert_batch(PMEMobjpool *pop, const char *arg)
+{
+	int n;		/* which element on List */
+	int before;
+	int count;
+	int id;
+	if (sscanf(arg, "I:%d:%d:%d:%d", &before, &n, &count, &id) != 4 ||
+			count <= 0 || count > BATCH_MAX)
+		FATAL_USAGE_INSERT_BATCH();
+
+	PMEMoid oids[BATCH_MAX];
+	for (int i = 0; i < count; ++i) {
+		TOID(struct item) item;
+		int item_id = id + i;
+		POBJ_NEW(pop, &item, struct item, item_constructor, &item_id);
+		UT_ASSERT(!TOID_IS_NULL(item));
+		oids[i] = item.oid;
+	}
+
+	PMEMoid dest = OID_NULL;
+	if (!POBJ_LIST_EMPTY(&D_RW(List)->head)) {
+		dest = get_item_list(List, n).oid;
+		UT_ASSERT(!OID_IS_NULL(dest));
+	}
+
+	errno = 0;
+	int ret = pmemobj_list_insert_batch(pop,
+		TOID_OFFSETOF(POBJ_LIST_FIRST(&D_RW(List)->head), next),
+		&D_RW(List)->head, dest, before, oids, (size_t)count);
+	if (ret) {
+		UT_ASSERTeq(ret, -1);
+		UT_ASSERTne(errno, 0);
+		UT_FATAL("pmemobj_list_insert_batch");
+	}
+}
+
+/*
+ * do_remove_batch -- remove elements from list, either freeing them or
+ * appending them to the second list
+ */
+static void
+do_remove_batch(PMEMobjpool *pop, const char *arg)
+{
+	int L;	/* which list */
+	int free;
+	int pos;
+	if (sscanf(arg, "D:%d:%d:%n", &L, &free, &pos) != 2)
+		FATAL_USAGE_REMOVE_BATCH();
+
+	TOID(struct list) tmp_list;
+	if (L == 1)
+		tmp_list = List;
+	else if (L == 2)
+		tmp_list = List_sec;
+	else
+		FATAL_USAGE_REMOVE_BATCH();
+
+	/* look up all the elements before the list is modified */
+	PMEMoid oids[BATCH_MAX];
+	size_t count = 0;
+	const char *nums = arg + pos;
+	while (*nums != '\0') {
+		if (count == BATCH_MAX)
+			FATAL_USAGE_REMOVE_BATCH();
+
+		char *end;
+		int n = (int)strtol(nums, &end, 10);
+		if (end == nums || (*end != ',' && *end != '\0'))
+			FATAL_USAGE_REMOVE_BATCH();
+
+		TOID(struct item) item = get_item_list(tmp_list, n);
+		UT_ASSERT(!TOID_IS_NULL(item));
+		oids[count++] = item.oid;
+		nums = *end == ',' ? end + 1 : end;
+	}
+
+	errno = 0;
+	int ret = free ?
+		POBJ_LIST_REMOVE_FREE_BATCH(pop, &D_RW(tmp_list)->head,
+			oids, count, next) :
+		POBJ_LIST_REMOVE_BATCH(pop, &D_RW(tmp_list)->head,
+			oids, count, next);
+	if (ret) {
+		UT_ASSERTeq(ret, -1);
+		UT_ASSERTne(errno, 0);
+		UT_FATAL("pmemobj_list_remove_batch");
+	}
+
+	if (free)
+		return;
+
+	ret = POBJ_LIST_INSERT_TAIL_BATCH(pop, &D_RW(List_sec)->head,
+		oids, count, next);
+	if (ret) {
+		UT_ASSERTeq(ret, -1);
+		UT_ASSERTne(errno, 0);
+		UT_FATAL("POBJ_LIST_INSERT_TAIL_BATCH");
+	}
+}
+
 /*
  * do_move -- move element from one list to another
  */
@@ -410,6 +564,15 @@ main(int argc, char *argv[])
 		case 'm':
 			do_move(pop, argv[i]);
 			break;
+		case 'N':
+			do_insert_new_batch(pop, argv[i]);
+			break;
+		case 'I':
+			do_insert_batch(pop, argv[i]);
+			break;
+		case 'D':
+			do_remove_batch(pop, argv[i]);
+			break;
 		default:
 			FATAL_USAGE();
 		}
@@ -5,9 +5,15 @@
  * obj_mem.c -- simple test for pmemobj_memcpy, pmemobj_memmove and
  * pmemobj_memset that verifies nothing blows up on pmemobj side.
  * Real consistency tests are for libpmem.
+ *
+ * With the "bulk" argument it also checks the contents of writes large
+ * enough to be split between several threads.
  */
 #include "unittest.h"
 
+/* larger than the smallest range libpmemobj splits between threads */
+#define BULK_SIZE ((size_t)72 << 20)
+
 static unsigned Flags[] = {
 		0,
 		PMEMOBJ_F_MEM_NODRAIN,
@@ -24,13 +30,44 @@ static unsigned Flags[] = {
 			PMEMOBJ_F_MEM_WC | PMEMOBJ_F_MEM_WB,
 };
 
+/*
+ * check_bulk -- check large memset and memcpy on the pool, with and without
+ * the NODRAIN flag
+ */
+static void
+check_bulk(PMEMobjpool *pop)
+{
+	PMEMoid oid;
+	int ret = pmemobj_zalloc(pop, &oid, BULK_SIZE, 0);
+	UT_ASSERTeq(ret, 0);
+
+	char *data = pmemobj_direct(oid);
+	for (size_t i = 0; i < BULK_SIZE; ++i)
+		UT_ASSERTeq(data[i], 0);
+
+	pmemobj_memset(pop, data, 0x5a, BULK_SIZE, PMEMOBJ_F_MEM_NODRAIN);
+	pmemobj_drain(pop);
+	for (size_t i = 0; i < BULK_SIZE; ++i)
+		UT_ASSERTeq(data[i], 0x5a);
+
+	char *src = MALLOC(BULK_SIZE);
+	for (size_t i = 0; i < BULK_SIZE; ++i)
+		src[i] = (char)(i * 31 + i / 4096);
+
+	pmemobj_memcpy_persist(pop, data, src, BULK_SIZE);
+	UT_ASSERTeq(memcmp(data, src, BULK_SIZE), 0);
+
+	FREE(src);
+	pmemobj_free(&oid);
+}
+
 int
 main(int argc, char *argv[])
 {
 	START(argc, argv, "obj_mem");
 
-	if (argc != 2)
-		UT_FATAL("usage: %s [directory]", argv[0]);
+	if (argc < 2 || argc > 3)
+		UT_FATAL("usage: %s directory [bulk]", argv[0]);
 
 	PMEMobjpool *pop = pmemobj_create(argv[1], "obj_mem", 0,
 			S_IWUSR | S_IRUSR);
@@ -62,6 +99,9 @@ main(int argc, char *argv[])
 			pmemobj_persist(pop, r, sizeof(*r));
 	}
 
+	if (argc == 3 && strcmp(argv[2], "bulk") == 0)
+		check_bulk(pop);
+
 	pmemobj_close(pop);
 
 	DONE(NULL);
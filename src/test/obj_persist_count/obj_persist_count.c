@@ -432,6 +432,34 @@ main(int argc, char *argv[])
 	} TX_END
 	print_reset_counters("tx_add_lnext", 1);
 
+	TX_BEGIN(pop) {
+		pmemobj_tx_add_range_direct(&flarge->snapshot,
+			sizeof(flarge->snapshot));
+		flarge->snapshot[LARGE_SNAPSHOT / 2] = 1;
+	} TX_END
+	unsigned full_cls = ops_counter.n_cl_stores;
+	print_reset_counters("tx_add_lmod", 1);
+
+	/* only the modified line of the snapshot is flushed on commit */
+	int diff_flush = 1;
+	ret = pmemobj_ctl_set(pop, "tx.commit.diff_flush", &diff_flush);
+	UT_ASSERTeq(ret, 0);
+
+	TX_BEGIN(pop) {
+		pmemobj_tx_add_range_direct(&flarge->snapshot,
+			sizeof(flarge->snapshot));
+		flarge->snapshot[LARGE_SNAPSHOT / 2] = 2;
+	} TX_END
+	uintptr_t align = pop->is_pmem ? FLUSH_ALIGN : Pagesize;
+	UT_ASSERTeq(full_cls - ops_counter.n_cl_stores,
+		cl_flushed(flarge->snapshot, LARGE_SNAPSHOT, align) -
+		cl_flushed(&flarge->snapshot[LARGE_SNAPSHOT / 2], 1, align));
+	print_reset_counters("tx_add_ldiff", 1);
+
+	diff_flush = 0;
+	ret = pmemobj_ctl_set(pop, "tx.commit.diff_flush", &diff_flush);
+	UT_ASSERTeq(ret, 0);
+
 	pmalloc(pop, &f->dest, sizeof(f->val), 0, 0);
 	print_reset_counters("pmalloc", 0);
 
@@ -46,3 +46,12 @@ class TEST3(t.Test):
     def run(self, ctx):
         testfile = path.join(ctx.testdir, 'testfile3')
         ctx.exec('obj_tx_add_range', testfile, '0')
+
+
+@t.require_valgrind_disabled('memcheck', 'pmemcheck')
+class TEST4(t.Test):
+    test_type = t.Medium
+
+    def run(self, ctx):
+        testfile = path.join(ctx.testdir, 'testfile4')
+        ctx.exec('obj_tx_add_range', testfile, '2')
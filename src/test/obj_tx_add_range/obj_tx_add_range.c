@@ -997,6 +997,104 @@ do_tx_add_range_reopen(char *path)
 	}
 }
 
+/*
+ * do_tx_add_range_diff_flush_commit -- call pmemobj_tx_add_range on the whole
+ * object with tx.commit.diff_flush enabled, modify only some of its cache
+ * lines and commit the tx
+ */
+static void
+do_tx_add_range_diff_flush_commit(PMEMobjpool *pop)
+{
+	int ret;
+	TOID(struct object) obj;
+	TOID_ASSIGN(obj, do_tx_zalloc(pop, TYPE_OBJ));
+
+	TX_BEGIN(pop) {
+		ret = pmemobj_tx_add_range(obj.oid, 0, OBJ_SIZE);
+		UT_ASSERTeq(ret, 0);
+
+		D_RW(obj)->value = TEST_VALUE_1;
+		D_RW(obj)->data[DATA_SIZE / 2] = TEST_VALUE_2;
+		D_RW(obj)->data[DATA_SIZE - 1] = TEST_VALUE_2;
+	} TX_ONABORT {
+		UT_ASSERT(0);
+	} TX_END
+
+	UT_ASSERTeq(D_RO(obj)->value, TEST_VALUE_1);
+	for (size_t i = 0; i < DATA_SIZE; i++) {
+		if (i == DATA_SIZE / 2 || i == DATA_SIZE - 1)
+			UT_ASSERTeq(D_RO(obj)->data[i], TEST_VALUE_2);
+		else
+			UT_ASSERTeq(D_RO(obj)->data[i], 0);
+	}
+}
+
+/*
+ * do_tx_add_range_diff_flush_abort -- call pmemobj_tx_add_range on parts of
+ * the object with tx.commit.diff_flush enabled, modify them and abort the tx
+ */
+static void
+do_tx_add_range_diff_flush_abort(PMEMobjpool *pop)
+{
+	int ret;
+	TOID(struct object) obj;
+	TOID_ASSIGN(obj, do_tx_zalloc(pop, TYPE_OBJ));
+
+	TX_BEGIN(pop) {
+		ret = pmemobj_tx_add_range(obj.oid, VALUE_OFF, VALUE_SIZE);
+		UT_ASSERTeq(ret, 0);
+
+		D_RW(obj)->value = TEST_VALUE_1;
+
+		ret = pmemobj_tx_add_range(obj.oid, DATA_OFF, DATA_SIZE);
+		UT_ASSERTeq(ret, 0);
+
+		D_RW(obj)->data[0] = TEST_VALUE_2;
+
+		pmemobj_tx_abort(-1);
+	} TX_ONCOMMIT {
+		UT_ASSERT(0);
+	} TX_END
+
+	UT_ASSERTeq(D_RO(obj)->value, 0);
+	UT_ASSERT(util_is_zeroed(D_RO(obj)->data, DATA_SIZE));
+}
+
+/*
+ * do_tx_add_range_diff_flush_nested -- call pmemobj_tx_add_range on
+ * overlapping ranges in nested transactions with tx.commit.diff_flush enabled
+ */
+static void
+do_tx_add_range_diff_flush_nested(PMEMobjpool *pop)
+{
+	int ret;
+	TOID(struct object) obj;
+	TOID_ASSIGN(obj, do_tx_zalloc(pop, TYPE_OBJ));
+
+	TX_BEGIN(pop) {
+		ret = pmemobj_tx_add_range(obj.oid, DATA_OFF, DATA_SIZE / 2);
+		UT_ASSERTeq(ret, 0);
+
+		D_RW(obj)->data[1] = TEST_VALUE_1;
+
+		TX_BEGIN(pop) {
+			ret = pmemobj_tx_add_range(obj.oid, 0, OBJ_SIZE);
+			UT_ASSERTeq(ret, 0);
+
+			D_RW(obj)->value = TEST_VALUE_2;
+			D_RW(obj)->data[DATA_SIZE - 1] = TEST_VALUE_2;
+		} TX_ONABORT {
+			UT_ASSERT(0);
+		} TX_END
+	} TX_ONABORT {
+		UT_ASSERT(0);
+	} TX_END
+
+	UT_ASSERTeq(D_RO(obj)->value, TEST_VALUE_2);
+	UT_ASSERTeq(D_RO(obj)->data[1], TEST_VALUE_1);
+	UT_ASSERTeq(D_RO(obj)->data[DATA_SIZE - 1], TEST_VALUE_2);
+}
+
 static void
 do_tx_add_range_too_large(PMEMobjpool *pop)
 {
@@ -1080,9 +1178,10 @@ main(int argc, char *argv[])
 	util_init();
 
 	if (argc != 3)
-		UT_FATAL("usage: %s [file] [0|1]", argv[0]);
+		UT_FATAL("usage: %s [file] [0|1|2]", argv[0]);
 
-	int do_reopen = atoi(argv[2]);
+	int do_reopen = atoi(argv[2]) == 1;
+	int do_diff_flush = atoi(argv[2]) == 2;
 
 	PMEMobjpool *pop;
 	if ((pop = pmemobj_create(argv[1], LAYOUT_NAME, PMEMOBJ_MIN_POOL * 2,
@@ -1092,6 +1191,20 @@ main(int argc, char *argv[])
 	if (do_reopen) {
 		pmemobj_close(pop);
 		do_tx_add_range_reopen(argv[1]);
+	} else if (do_diff_flush) {
+		int enabled = 1;
+		int ret = pmemobj_ctl_set(pop, "tx.commit.diff_flush",
+			&enabled);
+		UT_ASSERTeq(ret, 0);
+
+		do_tx_add_range_diff_flush_commit(pop);
+		do_tx_add_range_diff_flush_abort(pop);
+		do_tx_add_range_diff_flush_nested(pop);
+		do_tx_add_range_commit(pop);
+		do_tx_add_range_abort(pop);
+		do_tx_add_range_overlapping(pop);
+		do_tx_xadd_range_no_flush_commit(pop);
+		pmemobj_close(pop);
 	} else {
 		do_tx_add_range_commit(pop);
 		VALGRIND_WRITE_STATS;
@@ -92,3 +92,31 @@ class TEST12(Pmem2ConfigNoDir):
     setting a invalid protection flags
     """
     test_case = "test_set_invalid_prot_flag"
+
+
+class TEST13(Pmem2ConfigNoDir):
+    """
+    setting valid and invalid calibration
+    """
+    test_case = "test_set_calibration"
+
+
+class TEST14(Pmem2ConfigNoDir):
+    """
+    setting valid and invalid write-back mode
+    """
+    test_case = "test_set_writeback"
+
+
+class TEST15(Pmem2ConfigNoDir):
+    """
+    setting valid and invalid NUMA node
+    """
+    test_case = "test_set_numa_node"
+
+
+class TEST16(Pmem2ConfigNoDir):
+    """
+    setting valid and invalid async persist value
+    """
+    test_case = "test_set_async_persist"
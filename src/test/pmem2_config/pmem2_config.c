@@ -263,6 +263,100 @@ test_set_invalid_prot_flag(const struct test_case *tc, int argc,
 	return 0;
 }
 
+/*
+ * test_set_calibration -- set valid and invalid calibration
+ */
+static int
+test_set_calibration(const struct test_case *tc, int argc, char *argv[])
+{
+	struct pmem2_config cfg;
+	pmem2_config_init(&cfg);
+	UT_ASSERTeq(cfg.calibration, PMEM2_CALIBRATION_NONE);
+
+	int ret = pmem2_config_set_calibration(&cfg, PMEM2_CALIBRATION_FORCE);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	UT_ASSERTeq(cfg.calibration, PMEM2_CALIBRATION_FORCE);
+
+	ret = pmem2_config_set_calibration(&cfg, (enum pmem2_calibration)777);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_INVALID_CALIBRATION_VALUE);
+	UT_ASSERTeq(cfg.calibration, PMEM2_CALIBRATION_FORCE);
+
+	return 0;
+}
+
+/*
+ * test_set_writeback -- set valid and invalid write-back mode
+ */
+static int
+test_set_writeback(const struct test_case *tc, int argc, char *argv[])
+{
+	struct pmem2_config cfg;
+	pmem2_config_init(&cfg);
+	UT_ASSERTeq(cfg.writeback, PMEM2_WRITEBACK_IMMEDIATE);
+
+	int ret = pmem2_config_set_writeback(&cfg, PMEM2_WRITEBACK_BACKGROUND);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	UT_ASSERTeq(cfg.writeback, PMEM2_WRITEBACK_BACKGROUND);
+
+	ret = pmem2_config_set_writeback(&cfg, (enum pmem2_writeback)777);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_INVALID_WRITEBACK_VALUE);
+	UT_ASSERTeq(cfg.writeback, PMEM2_WRITEBACK_BACKGROUND);
+
+	return 0;
+}
+
+/*
+ * test_set_numa_node -- set valid and invalid NUMA node
+ */
+static int
+test_set_numa_node(const struct test_case *tc, int argc, char *argv[])
+{
+	struct pmem2_config cfg;
+	pmem2_config_init(&cfg);
+	UT_ASSERTeq(cfg.numa_node, PMEM2_NUMA_NODE_ANY);
+
+	/* there is always the node 0 */
+	int ret = pmem2_config_set_numa_node(&cfg, 0);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	UT_ASSERTeq(cfg.numa_node, 0);
+
+	ret = pmem2_config_set_numa_node(&cfg, -2);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_INVALID_NUMA_NODE);
+	UT_ASSERTeq(cfg.numa_node, 0);
+
+	ret = pmem2_config_set_numa_node(&cfg, INT_MAX);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_INVALID_NUMA_NODE);
+	UT_ASSERTeq(cfg.numa_node, 0);
+
+	ret = pmem2_config_set_numa_node(&cfg, PMEM2_NUMA_NODE_ANY);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	UT_ASSERTeq(cfg.numa_node, PMEM2_NUMA_NODE_ANY);
+
+	return 0;
+}
+
+/*
+ * test_set_async_persist -- set valid and invalid async persist value
+ */
+static int
+test_set_async_persist(const struct test_case *tc, int argc, char *argv[])
+{
+	struct pmem2_config cfg;
+	pmem2_config_init(&cfg);
+	UT_ASSERTeq(cfg.async_persist, PMEM2_ASYNC_PERSIST_MOVER);
+
+	int ret = pmem2_config_set_async_persist(&cfg, PMEM2_ASYNC_PERSIST_OS);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	UT_ASSERTeq(cfg.async_persist, PMEM2_ASYNC_PERSIST_OS);
+
+	ret = pmem2_config_set_async_persist(&cfg,
+			(enum pmem2_async_persist)777);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_INVALID_ASYNC_PERSIST_VALUE);
+	UT_ASSERTeq(cfg.async_persist, PMEM2_ASYNC_PERSIST_OS);
+
+	return 0;
+}
+
 /*
  * test_cases -- available test cases
  */
@@ -280,6 +374,10 @@ static struct test_case test_cases[] = {
 	TEST_CASE(test_set_sharing_invalid),
 	TEST_CASE(test_set_valid_prot_flag),
 	TEST_CASE(test_set_invalid_prot_flag),
+	TEST_CASE(test_set_calibration),
+	TEST_CASE(test_set_writeback),
+	TEST_CASE(test_set_numa_node),
+	TEST_CASE(test_set_async_persist),
 };
 
 #define NTESTS (sizeof(test_cases) / sizeof(test_cases[0]))
@@ -28,3 +28,14 @@ class TEST1(PMEM2_DEEP_FLUSH):
 class TEST2(PMEM2_DEEP_FLUSH):
     """test pmem2_deep_flush with range beyond mapping"""
     test_case = "test_deep_flush_range_beyond_mapping"
+
+
+class TEST3(PMEM2_DEEP_FLUSH):
+    """test pmem2_deep_flush_batch"""
+    test_case = "test_deep_flush_batch"
+
+
+@t.linux_only
+class TEST4(PMEM2_DEEP_FLUSH):
+    """test pmem2_deep_flush_batch with mocked DAX devices"""
+    test_case = "test_deep_flush_batch_devdax"
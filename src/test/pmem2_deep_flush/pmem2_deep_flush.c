@@ -16,10 +16,11 @@
  * - pmem2_get_type_from_stat is used to determine a file type
  * - for regular files performs pmem2_flush_file_buffers_os OR
  * - for Device DAX:
- *     - is looking for Device DAX region (pmem2_get_region_id)
- *     - is constructing the region deep flush file paths
- *     - opens deep_flush file (os_open)
- *     - reads deep_flush file (read)
+ *     - is looking for Device DAX region (pmem2_get_region_id), only once
+ *     for a mapping
+ *     - is constructing the region deep flush file paths, opens deep_flush
+ *     file (os_open) and reads it (read), only once for a region, unless
+ *     opening or reading the file failed
  *     - performs a write to it (write)
  *
  * Where pmem2_persist_cpu_cache performs:
@@ -48,6 +49,7 @@
 #include <sys/sysmacros.h>
 #endif
 
+#include "deep_flush.h"
 #include "mmap.h"
 #include "persist.h"
 #include "pmem2_arch.h"
@@ -64,11 +66,12 @@ static int n_reads = 0;
 static enum pmem2_file_type *ftype_value;
 static int read_invalid = 0;
 static int deep_flush_not_needed = 0;
+static int n_region_lookups = 0;
 
 #ifndef _WIN32
 #define MOCK_FD 999
-#define MOCK_REG_ID 888
-#define MOCK_BUS_DEVICE_PATH "/sys/bus/nd/devices/region888/deep_flush"
+#define MOCK_REG_ID 88
+#define MOCK_BUS_DEVICE_PATH "/sys/bus/nd/devices/region88/deep_flush"
 #define MOCK_DEV_ID 777UL
 
 /*
@@ -79,6 +82,7 @@ pmem2_get_region_id(const struct pmem2_source *src,
 	unsigned *region_id)
 {
 	*region_id = MOCK_REG_ID;
+	++n_region_lookups;
 
 	return 0;
 }
@@ -290,39 +294,148 @@ test_deep_flush_func_devdax(const struct test_case *tc, int argc, char *argv[])
 	size_t len = map.content_length;
 	*ftype_value = PMEM2_FTYPE_DEVDAX;
 
+	enum pmem2_granularity gran[] = {
+		PMEM2_GRANULARITY_CACHE_LINE,
+		PMEM2_GRANULARITY_BYTE,
+	};
+
+	for (size_t i = 0; i < ARRAY_SIZE(gran); ++i) {
+		map.effective_granularity = gran[i];
+		pmem2_set_flush_fns(&map);
+
+		/* the deep_flush file is read only once */
+		int ret = pmem2_deep_flush(&map, addr, len);
+		UT_PMEM2_EXPECT_RETURN(ret, 0);
+		counters_check_n_reset(0, 1, 1, 1, 1);
+
+		ret = pmem2_deep_flush(&map, addr, len);
+		UT_PMEM2_EXPECT_RETURN(ret, 0);
+		counters_check_n_reset(0, 1, 1, 1, 0);
+		UT_ASSERTeq(n_region_lookups, 1);
+		n_region_lookups = 0;
+		pmem2_deep_flush_fini();
+
+		deep_flush_not_needed = 1;
+		ret = pmem2_deep_flush(&map, addr, len);
+		UT_PMEM2_EXPECT_RETURN(ret, 0);
+		counters_check_n_reset(0, 1, 1, 0, 1);
+
+		ret = pmem2_deep_flush(&map, addr, len);
+		UT_PMEM2_EXPECT_RETURN(ret, 0);
+		counters_check_n_reset(0, 1, 1, 0, 0);
+		pmem2_deep_flush_fini();
+
+		/* a failed read is retried on the next call */
+		read_invalid = 1;
+		ret = pmem2_deep_flush(&map, addr, len);
+		UT_PMEM2_EXPECT_RETURN(ret, 0);
+		counters_check_n_reset(0, 1, 1, 0, 1);
+
+		ret = pmem2_deep_flush(&map, addr, len);
+		UT_PMEM2_EXPECT_RETURN(ret, 0);
+		counters_check_n_reset(0, 1, 1, 1, 1);
+
+		ret = pmem2_deep_flush(&map, addr, len);
+		UT_PMEM2_EXPECT_RETURN(ret, 0);
+		counters_check_n_reset(0, 1, 1, 1, 0);
+		pmem2_deep_flush_fini();
+		n_region_lookups = 0;
+	}
+
+	FREE(map.addr);
+
+	return 0;
+}
+
+/*
+ * test_deep_flush_batch -- test pmem2_deep_flush_batch on regular files
+ */
+static int
+test_deep_flush_batch(const struct test_case *tc, int argc, char *argv[])
+{
+	struct pmem2_map map;
+	map_init(&map);
+	*ftype_value = PMEM2_FTYPE_REG;
+
+	char *addr = (char *)ALIGN_UP((uintptr_t)map.addr, Pagesize);
 	map.effective_granularity = PMEM2_GRANULARITY_CACHE_LINE;
 	pmem2_set_flush_fns(&map);
-	int ret = pmem2_deep_flush(&map, addr, len);
-	UT_PMEM2_EXPECT_RETURN(ret, 0);
-	counters_check_n_reset(0, 1, 1, 1, 1);
 
-	deep_flush_not_needed = 1;
-	ret = pmem2_deep_flush(&map, addr, len);
-	UT_PMEM2_EXPECT_RETURN(ret, 0);
-	counters_check_n_reset(0, 1, 1, 0, 1);
+	/* the first four ranges share a page */
+	struct pmem2_deep_flush_desc descs[] = {
+		{&map, addr + 3 * Pagesize, 10},
+		{&map, addr + 50, 100},
+		{&map, addr, 100},
+		{&map, addr + Pagesize - 1, 2},
+		{&map, addr + 5, 0},
+	};
 
-	read_invalid = 1;
-	ret = pmem2_deep_flush(&map, addr, len);
+	int ret = pmem2_deep_flush_batch(descs, ARRAY_SIZE(descs));
 	UT_PMEM2_EXPECT_RETURN(ret, 0);
-	counters_check_n_reset(0, 1, 1, 0, 1);
+	counters_check_n_reset(2, 0, 0, 0, 0);
 
-	map.effective_granularity = PMEM2_GRANULARITY_BYTE;
-	pmem2_set_flush_fns(&map);
-	ret = pmem2_deep_flush(&map, addr, len);
+	ret = pmem2_deep_flush_batch(NULL, 0);
 	UT_PMEM2_EXPECT_RETURN(ret, 0);
-	counters_check_n_reset(0, 1, 1, 1, 1);
+	counters_check_n_reset(0, 0, 0, 0, 0);
 
-	deep_flush_not_needed = 1;
-	ret = pmem2_deep_flush(&map, addr, len);
+	/* nothing is flushed if any of the ranges is invalid */
+	descs[1].ptr = addr + map.content_length;
+	ret = pmem2_deep_flush_batch(descs, ARRAY_SIZE(descs));
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_DEEP_FLUSH_RANGE);
+	counters_check_n_reset(0, 0, 0, 0, 0);
+
+	FREE(map.addr);
+
+	return 0;
+}
+
+/*
+ * test_deep_flush_batch_devdax -- test pmem2_deep_flush_batch with mocked
+ * DAX devices
+ */
+static int
+test_deep_flush_batch_devdax(const struct test_case *tc, int argc,
+		char *argv[])
+{
+	struct pmem2_map map1;
+	map_init(&map1);
+	struct pmem2_map map2;
+	map_init(&map2);
+	map1.source.value.ftype = PMEM2_FTYPE_DEVDAX;
+	map2.source.value.ftype = PMEM2_FTYPE_DEVDAX;
+
+	map1.effective_granularity = PMEM2_GRANULARITY_CACHE_LINE;
+	pmem2_set_flush_fns(&map1);
+	map2.effective_granularity = PMEM2_GRANULARITY_BYTE;
+	pmem2_set_flush_fns(&map2);
+
+	char *addr1 = map1.addr;
+	char *addr2 = map2.addr;
+
+	/* both mappings belong to the same region */
+	struct pmem2_deep_flush_desc descs[] = {
+		{&map1, addr1, 64},
+		{&map2, addr2 + 4 * Pagesize, 64},
+		{&map1, addr1 + 64, 64},
+		{&map2, addr2, 64},
+		{&map1, addr1 + 2 * Pagesize, 64},
+	};
+
+	int ret = pmem2_deep_flush_batch(descs, ARRAY_SIZE(descs));
 	UT_PMEM2_EXPECT_RETURN(ret, 0);
-	counters_check_n_reset(0, 1, 1, 0, 1);
+	counters_check_n_reset(0, 4, 4, 1, 1);
+	UT_ASSERTeq(n_region_lookups, 2);
+	n_region_lookups = 0;
 
-	read_invalid = 1;
-	ret = pmem2_deep_flush(&map, addr, len);
+	ret = pmem2_deep_flush_batch(descs, ARRAY_SIZE(descs));
 	UT_PMEM2_EXPECT_RETURN(ret, 0);
-	counters_check_n_reset(0, 1, 1, 0, 1);
+	counters_check_n_reset(0, 4, 4, 1, 0);
+	UT_ASSERTeq(n_region_lookups, 0);
 
-	FREE(map.addr);
+	pmem2_deep_flush_fini();
+
+	FREE(map1.addr);
+	FREE(map2.addr);
 
 	return 0;
 }
@@ -366,6 +479,8 @@ static struct test_case test_cases[] = {
 	TEST_CASE(test_deep_flush_func),
 	TEST_CASE(test_deep_flush_func_devdax),
 	TEST_CASE(test_deep_flush_range_beyond_mapping),
+	TEST_CASE(test_deep_flush_batch),
+	TEST_CASE(test_deep_flush_batch_devdax),
 };
 
 #define NTESTS (sizeof(test_cases) / sizeof(test_cases[0]))
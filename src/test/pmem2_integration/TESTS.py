@@ -4,8 +4,11 @@
 #
 
 
+import os
+
 import testframework as t
 from testframework import granularity as g
+import futils
 
 
 class Granularity(str):
@@ -303,3 +306,144 @@ class TES40(PMEM2_INTEGRATION):
 class TEST41(PMEM2_INTEGRATION_DEV_DAXES):
     """compare normal map vs map_from_existing on devdax"""
     test_case = "test_map_from_existing"
+
+
+class TEST42(PMEM2_INTEGRATION):
+    """copy and fill data asynchronously"""
+    test_case = "test_mover_async"
+
+
+class TEST43(PMEM2_INTEGRATION):
+    """try to submit asynchronous operations exceeding the mapping"""
+    test_case = "test_mover_e_range"
+
+
+class TEST44(PMEM2_INTEGRATION):
+    """copy and move vectors of fragments"""
+    test_case = "test_memcpyv_memmovev"
+
+
+@t.require_architectures('x86_64')
+class TEST45(PMEM2_INTEGRATION):
+    """calibrate the memcpy functions on the mapping"""
+    test_case = "test_calibrate"
+    granularity = None
+
+    def run(self, ctx):
+        ctx.env['PMEM2_CALIBRATION_DIR'] = ctx.testdir
+        if self.granularity:
+            ctx.env['PMEM2_FORCE_GRANULARITY'] = self.granularity
+        filepath = ctx.create_holey_file(16 * t.MiB, 'testfile')
+        # the second run reads the result cached by the first one
+        ctx.exec('pmem2_integration', self.test_case, filepath)
+        ctx.exec('pmem2_integration', self.test_case, filepath)
+
+        if self.granularity == 'CACHE_LINE':
+            # the result is cached per device of the mapping
+            dev = os.stat(filepath).st_dev
+            medium = '_dev{}-{}'.format(os.major(dev), os.minor(dev))
+            cached = [f for f in os.listdir(ctx.testdir)
+                      if f.startswith('pmem2_calibration_')]
+            if len(cached) != 1 or not cached[0].endswith(medium):
+                raise futils.Fail('unexpected calibration cache {}'
+                                  .format(cached))
+
+
+@t.require_architectures('x86_64')
+class TEST46(TEST45):
+    """calibrate the memcpy functions on the mapping with cache line
+    granularity"""
+    granularity = 'CACHE_LINE'
+
+
+@t.require_architectures('x86_64')
+class TEST47(TEST45):
+    """calibrate the memcpy functions on the mapping with byte granularity"""
+    granularity = 'BYTE'
+
+
+class TEST48(PMEM2_INTEGRATION):
+    """fill and copy data using several threads"""
+    test_case = "test_parallel"
+
+
+class TEST49(PMEM2_INTEGRATION):
+    """deep flush scattered ranges of two mappings at once"""
+    test_case = "test_deep_flush_batch"
+
+
+@t.windows_exclude
+class TEST50(PMEM2_INTEGRATION_DEV_DAXES):
+    """deep flush scattered ranges of two mappings of Device DAX at once"""
+    test_case = "test_deep_flush_batch"
+
+
+class TEST51(PMEM2_INTEGRATION):
+    """defer the write-back of the flushed ranges until the drain"""
+    test_case = "test_writeback"
+    mode = 'deferred'
+
+    def run(self, ctx):
+        filepath = ctx.create_holey_file(16 * t.MiB, 'testfile')
+        ctx.exec('pmem2_integration', self.test_case, filepath, self.mode)
+
+
+class TEST52(TEST51):
+    """write back the flushed ranges on a background thread"""
+    mode = 'background'
+
+
+class TEST53(PMEM2_INTEGRATION):
+    """persist scattered ranges in the background by the operating system"""
+    test_case = "test_persist_async"
+    mode = 'os'
+    env = {}
+
+    def run(self, ctx):
+        for name, value in self.env.items():
+            ctx.env[name] = value
+        filepath = ctx.create_holey_file(16 * t.MiB, 'testfile')
+        ctx.exec('pmem2_integration', self.test_case, filepath, self.mode)
+
+
+class TEST54(TEST53):
+    """persist scattered ranges in the background without io_uring"""
+    env = {'PMEM2_NO_URING': '1'}
+
+
+class TEST55(TEST53):
+    """persist scattered ranges of a mapping with cache line granularity
+    in the background"""
+    env = {'PMEM2_FORCE_GRANULARITY': 'CACHE_LINE'}
+
+
+@t.windows_exclude
+class TEST56(PMEM2_INTEGRATION):
+    """copy from a mapping partially beyond the end of the file without
+    crashing"""
+    test_case = "test_memcpy_mcsafe"
+    env = {}
+
+    def run(self, ctx):
+        for name, value in self.env.items():
+            ctx.env[name] = value
+        filepath = ctx.create_holey_file(16 * t.MiB, 'testfile')
+        ctx.exec('pmem2_integration', self.test_case, filepath)
+
+
+@t.windows_exclude
+@t.require_architectures('x86_64')
+class TEST57(TEST56):
+    """copy from a mapping partially beyond the end of the file using
+    the SSE2 kernel"""
+    env = {'PMEM_AVX': '0', 'PMEM_AVX512F': '0'}
+
+
+class TEST58(PMEM2_INTEGRATION):
+    """map a file and an anonymous source with a preferred NUMA node"""
+    test_case = "test_numa_node"
+
+
+class TEST59(TEST53):
+    """persist scattered ranges in the background by the mover"""
+    mode = 'mover'
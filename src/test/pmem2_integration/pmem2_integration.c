@@ -589,6 +589,56 @@ test_deep_flush_valid(const struct test_case *tc, int argc, char *argv[])
 	return 1;
 }
 
+/*
+ * test_deep_flush_batch -- deep flush scattered ranges of two mappings of
+ * the same file at once
+ */
+static int
+test_deep_flush_batch(const struct test_case *tc, int argc, char *argv[])
+{
+	char *file = argv[0];
+	int fd = OPEN(file, O_RDWR);
+
+	struct pmem2_config *cfg;
+	struct pmem2_source *src;
+	PMEM2_PREPARE_CONFIG_INTEGRATION(&cfg, &src, fd,
+						PMEM2_GRANULARITY_PAGE);
+
+	size_t len;
+	PMEM2_SOURCE_SIZE(src, &len);
+
+	struct pmem2_map *map1 = map_valid(cfg, src, len);
+	struct pmem2_map *map2 = map_valid(cfg, src, len);
+
+	char *addr1 = pmem2_map_get_address(map1);
+	char *addr2 = pmem2_map_get_address(map2);
+	memset(addr1, 1, len);
+	pmem2_get_persist_fn(map1)(addr1, len);
+
+	struct pmem2_deep_flush_desc descs[] = {
+		{map1, addr1 + len / 2, 100},
+		{map2, addr2, len},
+		{map1, addr1, 1},
+		{map1, addr1 + 10, 10},
+		{map2, addr2 + len - 1, 1},
+	};
+
+	int ret = pmem2_deep_flush_batch(descs, ARRAY_SIZE(descs));
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	descs[3].map = map2;
+	ret = pmem2_deep_flush_batch(descs, ARRAY_SIZE(descs));
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_DEEP_FLUSH_RANGE);
+
+	pmem2_map_delete(&map2);
+	pmem2_map_delete(&map1);
+	PMEM2_CONFIG_DELETE(&cfg);
+	PMEM2_SOURCE_DELETE(&src);
+	CLOSE(fd);
+
+	return 1;
+}
+
 /*
  * test_deep_flush_e_range_behind -- try deep_flush for range behind a map
  */
@@ -967,6 +1017,8 @@ test_map_from_existing(const struct test_case *tc, int argc, char *argv[])
 	void *memmove = pmem2_get_memmove_fn(map);
 	void *memcpy = pmem2_get_memcpy_fn(map);
 	void *memset = pmem2_get_memset_fn(map);
+	void *memmovev = pmem2_get_memmovev_fn(map);
+	void *memcpyv = pmem2_get_memcpyv_fn(map);
 
 	UT_PMEM2_EXPECT_RETURN(pmem2_map_delete(&map), 0);
 	void *addr = FILE_MAP(fd, size);
@@ -981,6 +1033,8 @@ test_map_from_existing(const struct test_case *tc, int argc, char *argv[])
 	UT_ASSERTeq(pmem2_get_memmove_fn(map), memmove);
 	UT_ASSERTeq(pmem2_get_memcpy_fn(map), memcpy);
 	UT_ASSERTeq(pmem2_get_memset_fn(map), memset);
+	UT_ASSERTeq(pmem2_get_memmovev_fn(map), memmovev);
+	UT_ASSERTeq(pmem2_get_memcpyv_fn(map), memcpyv);
 
 	pmem2_map_delete(&map);
 	pmem2_config_delete(&cfg);
@@ -990,6 +1044,703 @@ test_map_from_existing(const struct test_case *tc, int argc, char *argv[])
 }
 #undef COMPARE_FUNCS
 
+/*
+ * test_memcpyv_memmovev -- copy vectors of fragments and check the result
+ * against the same copies done one by one in DRAM
+ */
+static int
+test_memcpyv_memmovev(const struct test_case *tc, int argc, char *argv[])
+{
+	if (argc < 1)
+		UT_FATAL("usage: test_memcpyv_memmovev <file>");
+
+	char *file = argv[0];
+	int fd = OPEN(file, O_RDWR);
+
+	struct pmem2_config *cfg;
+	struct pmem2_source *src;
+	PMEM2_PREPARE_CONFIG_INTEGRATION(&cfg, &src, fd,
+						PMEM2_GRANULARITY_PAGE);
+
+	size_t size;
+	UT_ASSERTeq(pmem2_source_size(src, &size), 0);
+
+	struct pmem2_map *map = map_valid(cfg, src, size);
+	char *addr = pmem2_map_get_address(map);
+
+	size_t len = 16384;
+	char *buf = MALLOC(len);
+	char *expected = MALLOC(len);
+	for (size_t i = 0; i < len; ++i)
+		buf[i] = (char)(i % 253);
+
+	memset(addr, 0, len);
+	memset(expected, 0, len);
+
+	/*
+	 * adjacent fragments, fragments sharing cache lines with each other,
+	 * an empty one and one large enough for non-temporal stores
+	 */
+	struct pmem2_memcpy_desc cdescs[] = {
+		{addr, buf, 10},
+		{addr + 10, buf + 10, 20},
+		{addr + 30, buf + 100, 5},
+		{addr + 40, buf + 200, 3},
+		{addr + 193, buf + 300, 5000},
+		{addr + 6000, buf, 0},
+		{addr + 8000, buf + 1, 100},
+		{addr + 8100, buf + 1000, 28},
+	};
+
+	pmem2_memcpyv_fn memcpyv_fn = pmem2_get_memcpyv_fn(map);
+	memcpyv_fn(cdescs, ARRAY_SIZE(cdescs), 0);
+	for (size_t i = 0; i < ARRAY_SIZE(cdescs); ++i) {
+		char *dest = expected + ((char *)cdescs[i].pmemdest - addr);
+		memcpy(dest, cdescs[i].src, cdescs[i].len);
+	}
+	UT_ASSERTeq(memcmp(addr, expected, len), 0);
+
+	memcpyv_fn(cdescs, ARRAY_SIZE(cdescs), PMEM2_F_MEM_NONTEMPORAL);
+	UT_ASSERTeq(memcmp(addr, expected, len), 0);
+
+	/* each move sees the result of the previous ones */
+	struct pmem2_memcpy_desc mdescs[] = {
+		{addr + 10, addr, 20},
+		{addr + 30, addr + 20, 20},
+		{addr + 100, addr + 120, 300},
+		{addr + 4000, addr + 3990, 2000},
+	};
+
+	pmem2_memmovev_fn memmovev_fn = pmem2_get_memmovev_fn(map);
+	memmovev_fn(mdescs, ARRAY_SIZE(mdescs), 0);
+	for (size_t i = 0; i < ARRAY_SIZE(mdescs); ++i) {
+		char *dest = expected + ((char *)mdescs[i].pmemdest - addr);
+		const char *s = expected + ((char *)mdescs[i].src - addr);
+		memmove(dest, s, mdescs[i].len);
+	}
+	UT_ASSERTeq(memcmp(addr, expected, len), 0);
+
+	FREE(expected);
+	FREE(buf);
+	pmem2_map_delete(&map);
+	pmem2_config_delete(&cfg);
+	pmem2_source_delete(&src);
+	CLOSE(fd);
+
+	return 1;
+}
+
+/*
+ * test_calibrate -- calibrate the memcpy functions on the mapping
+ */
+static int
+test_calibrate(const struct test_case *tc, int argc, char *argv[])
+{
+	if (argc < 1)
+		UT_FATAL("usage: test_calibrate <file>");
+
+	char *file = argv[0];
+	int fd = OPEN(file, O_RDWR);
+
+	struct pmem2_config *cfg;
+	struct pmem2_source *src;
+	PMEM2_PREPARE_CONFIG_INTEGRATION(&cfg, &src, fd,
+						PMEM2_GRANULARITY_PAGE);
+
+	size_t size;
+	UT_ASSERTeq(pmem2_source_size(src, &size), 0);
+
+	struct pmem2_map *map = map_valid(cfg, src, size);
+	char *addr = pmem2_map_get_address(map);
+	enum pmem2_granularity gran = pmem2_map_get_store_granularity(map);
+
+	/* the calibration rewrites the mapping with its own content */
+	size_t len = 4 << 20;
+	for (size_t i = 0; i < len; ++i)
+		addr[i] = (char)(i % 251);
+	pmem2_get_persist_fn(map)(addr, len);
+
+	char *expected = MALLOC(len);
+	memcpy(expected, addr, len);
+
+	int ret = pmem2_map_calibrate(map, (enum pmem2_calibration)3);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_INVALID_CALIBRATION_VALUE);
+
+	ret = pmem2_map_calibrate(map, PMEM2_CALIBRATION_NONE);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	/* reuses the result cached by a previous run, if any */
+	ret = pmem2_map_calibrate(map, PMEM2_CALIBRATION_CACHED);
+	if (gran == PMEM2_GRANULARITY_PAGE) {
+		UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_NOSUPP);
+		goto out;
+	}
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	size_t threshold = pmem2_map_get_movnt_threshold(map);
+	if (gran == PMEM2_GRANULARITY_BYTE)
+		UT_ASSERTeq(threshold, SIZE_MAX);
+	else
+		UT_ASSERT(threshold >= 256 && threshold <= 128 << 10);
+
+	/* the functions of this process are not switched again */
+	ret = pmem2_map_calibrate(map, PMEM2_CALIBRATION_FORCE);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	UT_ASSERTeq(pmem2_map_get_movnt_threshold(map), threshold);
+
+	/* the result of this process is reused */
+	ret = pmem2_map_calibrate(map, PMEM2_CALIBRATION_CACHED);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	UT_ASSERTeq(pmem2_map_get_movnt_threshold(map), threshold);
+
+	struct pmem2_map *map2;
+	ret = pmem2_config_set_calibration(cfg, PMEM2_CALIBRATION_CACHED);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	map2 = map_valid(cfg, src, size);
+	UT_ASSERTeq(pmem2_map_get_movnt_threshold(map2), threshold);
+	pmem2_map_delete(&map2);
+
+out:
+	/* the content of the mapping is intact */
+	UT_ASSERTeq(memcmp(addr, expected, len), 0);
+
+	FREE(expected);
+	pmem2_map_delete(&map);
+	pmem2_config_delete(&cfg);
+	pmem2_source_delete(&src);
+	CLOSE(fd);
+
+	return 1;
+}
+
+/*
+ * test_mover_async -- fill and copy data with the asynchronous mover
+ */
+static int
+test_mover_async(const struct test_case *tc, int argc, char *argv[])
+{
+	if (argc < 1)
+		UT_FATAL("usage: test_mover_async <file>");
+
+	char *file = argv[0];
+	int fd = OPEN(file, O_RDWR);
+
+	struct pmem2_config *cfg;
+	struct pmem2_source *src;
+	PMEM2_PREPARE_CONFIG_INTEGRATION(&cfg, &src, fd,
+						PMEM2_GRANULARITY_PAGE);
+
+	size_t size;
+	UT_ASSERTeq(pmem2_source_size(src, &size), 0);
+
+	struct pmem2_map *map = map_valid(cfg, src, size);
+	char *addr = pmem2_map_get_address(map);
+
+	struct pmem2_mover *mover;
+	UT_PMEM2_EXPECT_RETURN(pmem2_mover_new(&mover, 2), 0);
+
+	/* spans several chunks of the worker pool */
+	size_t len = size / 2 + 13;
+	char *buf = MALLOC(len);
+	for (size_t i = 0; i < len; ++i)
+		buf[i] = (char)(i % 251);
+
+	struct pmem2_future *future;
+	UT_PMEM2_EXPECT_RETURN(pmem2_memset_async(mover, map, addr, 'x',
+			size, 0, &future), 0);
+	UT_PMEM2_EXPECT_RETURN(pmem2_future_wait(&future), 0);
+	UT_ASSERTeq(future, NULL);
+	for (size_t i = 0; i < size; ++i)
+		UT_ASSERTeq(addr[i], 'x');
+
+	UT_PMEM2_EXPECT_RETURN(pmem2_memcpy_async(mover, map, addr + 1, buf,
+			len, PMEM2_F_MEM_NONTEMPORAL, &future), 0);
+	while (!pmem2_future_poll(future))
+		;
+	UT_PMEM2_EXPECT_RETURN(pmem2_future_wait(&future), 0);
+	UT_ASSERTeq(addr[0], 'x');
+	UT_ASSERTeq(memcmp(addr + 1, buf, len), 0);
+	UT_ASSERTeq(addr[len + 1], 'x');
+
+	/* the copies of a batch are done in any order */
+	struct pmem2_memcpy_desc descs[] = {
+		{addr + size - 100, buf, 100},
+		{addr + size - 200, buf + 100, 100},
+		{addr, buf + 200, 0},
+		{addr + size / 4, buf + 1000, 3 * size / 8},
+	};
+	UT_PMEM2_EXPECT_RETURN(pmem2_memcpy_async_batch(mover, map, descs,
+			ARRAY_SIZE(descs), 0, &future), 0);
+	UT_PMEM2_EXPECT_RETURN(pmem2_future_wait(&future), 0);
+	for (size_t i = 0; i < ARRAY_SIZE(descs); ++i)
+		UT_ASSERTeq(memcmp(descs[i].pmemdest, descs[i].src,
+				descs[i].len), 0);
+
+	/* an empty batch completes immediately */
+	UT_PMEM2_EXPECT_RETURN(pmem2_memcpy_async_batch(mover, map, NULL, 0,
+			0, &future), 0);
+	UT_ASSERTeq(pmem2_future_poll(future), 1);
+	UT_PMEM2_EXPECT_RETURN(pmem2_future_wait(&future), 0);
+
+	/* queued operations are finished before the mover is deleted */
+	struct pmem2_future *futures[8];
+	for (size_t i = 0; i < ARRAY_SIZE(futures); ++i)
+		UT_PMEM2_EXPECT_RETURN(pmem2_memset_async(mover, map,
+				addr + i * (size / 8), (int)i, size / 8, 0,
+				&futures[i]), 0);
+
+	UT_PMEM2_EXPECT_RETURN(pmem2_mover_delete(&mover), 0);
+	UT_ASSERTeq(mover, NULL);
+
+	for (size_t i = 0; i < ARRAY_SIZE(futures); ++i) {
+		UT_ASSERTeq(pmem2_future_poll(futures[i]), 1);
+		UT_PMEM2_EXPECT_RETURN(pmem2_future_wait(&futures[i]), 0);
+		UT_ASSERTeq(addr[i * (size / 8)], (char)i);
+		UT_ASSERTeq(addr[(i + 1) * (size / 8) - 1], (char)i);
+	}
+
+	FREE(buf);
+	pmem2_map_delete(&map);
+	pmem2_config_delete(&cfg);
+	pmem2_source_delete(&src);
+	CLOSE(fd);
+
+	return 1;
+}
+
+/*
+ * test_mover_e_range -- try to submit operations exceeding the mapping
+ */
+static int
+test_mover_e_range(const struct test_case *tc, int argc, char *argv[])
+{
+	if (argc < 1)
+		UT_FATAL("usage: test_mover_e_range <file>");
+
+	char *file = argv[0];
+	int fd = OPEN(file, O_RDWR);
+
+	struct pmem2_config *cfg;
+	struct pmem2_source *src;
+	PMEM2_PREPARE_CONFIG_INTEGRATION(&cfg, &src, fd,
+						PMEM2_GRANULARITY_PAGE);
+
+	size_t size;
+	UT_ASSERTeq(pmem2_source_size(src, &size), 0);
+
+	struct pmem2_map *map = map_valid(cfg, src, size);
+	char *addr = pmem2_map_get_address(map);
+
+	struct pmem2_mover *mover;
+	UT_PMEM2_EXPECT_RETURN(pmem2_mover_new(&mover, 0), 0);
+
+	char buf[2] = {0};
+	struct pmem2_future *future = (struct pmem2_future *)0x7;
+	int ret = pmem2_memcpy_async(mover, map, addr + size - 1, buf, 2, 0,
+			&future);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_ASYNC_RANGE);
+	UT_ASSERTeq(future, NULL);
+
+	ret = pmem2_memset_async(mover, map, addr - 1, 0, 1, 0, &future);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_ASYNC_RANGE);
+
+	struct pmem2_memcpy_desc descs[] = {
+		{addr, buf, 1},
+		{addr + size, buf, 1},
+	};
+	ret = pmem2_memcpy_async_batch(mover, map, descs, ARRAY_SIZE(descs),
+			0, &future);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_ASYNC_RANGE);
+	UT_ASSERTeq(future, NULL);
+
+	pmem2_mover_delete(&mover);
+	pmem2_map_delete(&map);
+	pmem2_config_delete(&cfg);
+	pmem2_source_delete(&src);
+	CLOSE(fd);
+
+	return 1;
+}
+
+/*
+ * test_parallel -- fill and copy data using several threads
+ */
+static int
+test_parallel(const struct test_case *tc, int argc, char *argv[])
+{
+	if (argc < 1)
+		UT_FATAL("usage: test_parallel <file>");
+
+	char *file = argv[0];
+	int fd = OPEN(file, O_RDWR);
+
+	struct pmem2_config *cfg;
+	struct pmem2_source *src;
+	PMEM2_PREPARE_CONFIG_INTEGRATION(&cfg, &src, fd,
+						PMEM2_GRANULARITY_PAGE);
+
+	size_t size;
+	UT_ASSERTeq(pmem2_source_size(src, &size), 0);
+
+	struct pmem2_map *map = map_valid(cfg, src, size);
+	char *addr = pmem2_map_get_address(map);
+
+	size_t len = size / 2 + 13;
+	char *buf = MALLOC(len);
+	for (size_t i = 0; i < len; ++i)
+		buf[i] = (char)(i % 251);
+
+	UT_PMEM2_EXPECT_RETURN(pmem2_memset_parallel(map, addr, 'x', size, 0),
+			0);
+	for (size_t i = 0; i < size; ++i)
+		UT_ASSERTeq(addr[i], 'x');
+
+	UT_PMEM2_EXPECT_RETURN(pmem2_memcpy_parallel(map, addr + 1, buf, len,
+			PMEM2_F_MEM_NODRAIN), 0);
+	UT_ASSERTeq(addr[0], 'x');
+	UT_ASSERTeq(memcmp(addr + 1, buf, len), 0);
+	UT_ASSERTeq(addr[len + 1], 'x');
+
+	/* too small to be split, done by the calling thread */
+	UT_PMEM2_EXPECT_RETURN(pmem2_memset_parallel(map, addr + 5, 'y', 100,
+			0), 0);
+	UT_ASSERTeq(addr[5], 'y');
+	UT_ASSERTeq(addr[104], 'y');
+	UT_ASSERTeq(addr[105], buf[104]);
+
+	UT_PMEM2_EXPECT_RETURN(pmem2_memcpy_parallel(map, addr + size - 1,
+			buf, 2, 0), PMEM2_E_ASYNC_RANGE);
+	UT_PMEM2_EXPECT_RETURN(pmem2_memset_parallel(map, addr + 1, 0, size,
+			0), PMEM2_E_ASYNC_RANGE);
+
+	FREE(buf);
+	pmem2_map_delete(&map);
+	pmem2_config_delete(&cfg);
+	pmem2_source_delete(&src);
+	CLOSE(fd);
+
+	return 1;
+}
+
+/*
+ * test_writeback -- persist scattered ranges of a page granularity mapping
+ * with the write-back deferred until the drain
+ */
+static int
+test_writeback(const struct test_case *tc, int argc, char *argv[])
+{
+	if (argc < 2)
+		UT_FATAL("usage: test_writeback <file> deferred|background");
+
+	char *file = argv[0];
+	enum pmem2_writeback writeback;
+	if (strcmp(argv[1], "deferred") == 0)
+		writeback = PMEM2_WRITEBACK_DEFERRED;
+	else if (strcmp(argv[1], "background") == 0)
+		writeback = PMEM2_WRITEBACK_BACKGROUND;
+	else
+		UT_FATAL("unknown write-back mode: %s", argv[1]);
+
+	int fd = OPEN(file, O_RDWR);
+
+	struct pmem2_config *cfg;
+	struct pmem2_source *src;
+	PMEM2_PREPARE_CONFIG_INTEGRATION(&cfg, &src, fd,
+						PMEM2_GRANULARITY_PAGE);
+	UT_PMEM2_EXPECT_RETURN(pmem2_config_set_writeback(cfg, writeback), 0);
+
+	size_t size;
+	UT_ASSERTeq(pmem2_source_size(src, &size), 0);
+
+	struct pmem2_map *map = map_valid(cfg, src, size);
+	char *addr = pmem2_map_get_address(map);
+
+	pmem2_flush_fn flush = pmem2_get_flush_fn(map);
+	pmem2_drain_fn drain = pmem2_get_drain_fn(map);
+	pmem2_persist_fn persist = pmem2_get_persist_fn(map);
+	pmem2_memcpy_fn memcpy_fn = pmem2_get_memcpy_fn(map);
+	pmem2_memset_fn memset_fn = pmem2_get_memset_fn(map);
+	pmem2_memcpyv_fn memcpyv_fn = pmem2_get_memcpyv_fn(map);
+
+	/* scattered, overlapping and adjacent ranges in reverse order */
+	size_t step = size / 64;
+	for (size_t off = size - step; off > 0; off -= step) {
+		memset(addr + off, (int)(off / step), 100);
+		flush(addr + off, 100);
+		flush(addr + off + 50, 100);
+		flush(addr + off + 100, step - 100);
+	}
+	drain();
+
+	memcpy_fn(addr + 1, "writeback", 10, PMEM2_F_MEM_NODRAIN);
+	memset_fn(addr + size - 10, 'w', 10, PMEM2_F_MEM_NODRAIN);
+
+	char buf[] = "vector";
+	struct pmem2_memcpy_desc descs[] = {
+		{addr + step + 1, buf, sizeof(buf)},
+		{addr + 3 * step + 1, buf, sizeof(buf)},
+	};
+	memcpyv_fn(descs, ARRAY_SIZE(descs), PMEM2_F_MEM_NODRAIN);
+
+	/* a persist does not wait for the drain */
+	addr[2 * step + 1] = 'p';
+	persist(addr + 2 * step + 1, 1);
+
+	memset_fn(addr + 4 * step, 'x', 10, 0);
+
+	int ret = pmem2_deep_flush(map, addr, size);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	/* left for the deletion of the mapping to write back */
+	addr[5 * step + 1] = 'd';
+	flush(addr + 5 * step + 1, 1);
+
+	pmem2_map_delete(&map);
+
+	char *data = MALLOC(size);
+	LSEEK(fd, 0, SEEK_SET);
+	UT_ASSERTeq(READ(fd, data, size), size);
+
+	UT_ASSERTeq(memcmp(data + 1, "writeback", 10), 0);
+	UT_ASSERTeq(data[size - 1], 'w');
+	UT_ASSERTeq(memcmp(data + step + 1, buf, sizeof(buf)), 0);
+	UT_ASSERTeq(data[step], 1);
+	UT_ASSERTeq(data[2 * step + 1], 'p');
+	UT_ASSERTeq(memcmp(data + 3 * step + 1, buf, sizeof(buf)), 0);
+	UT_ASSERTeq(data[4 * step + 9], 'x');
+	UT_ASSERTeq(data[5 * step + 1], 'd');
+	UT_ASSERTeq(data[63 * step], 63);
+
+	FREE(data);
+	PMEM2_CONFIG_DELETE(&cfg);
+	PMEM2_SOURCE_DELETE(&src);
+	CLOSE(fd);
+
+	return 2;
+}
+
+/*
+ * test_persist_async -- persist scattered ranges in the background
+ */
+static int
+test_persist_async(const struct test_case *tc, int argc, char *argv[])
+{
+	if (argc < 2)
+		UT_FATAL("usage: test_persist_async <file> mover|os");
+
+	char *file = argv[0];
+	enum pmem2_async_persist async_persist;
+	if (strcmp(argv[1], "mover") == 0)
+		async_persist = PMEM2_ASYNC_PERSIST_MOVER;
+	else if (strcmp(argv[1], "os") == 0)
+		async_persist = PMEM2_ASYNC_PERSIST_OS;
+	else
+		UT_FATAL("unknown async persist value: %s", argv[1]);
+
+	int fd = OPEN(file, O_RDWR);
+
+	struct pmem2_config *cfg;
+	struct pmem2_source *src;
+	PMEM2_PREPARE_CONFIG_INTEGRATION(&cfg, &src, fd,
+						PMEM2_GRANULARITY_PAGE);
+	UT_PMEM2_EXPECT_RETURN(pmem2_config_set_async_persist(cfg,
+			async_persist), 0);
+
+	size_t size;
+	UT_ASSERTeq(pmem2_source_size(src, &size), 0);
+
+	struct pmem2_map *map = map_valid(cfg, src, size);
+	char *addr = pmem2_map_get_address(map);
+
+	struct pmem2_mover *mover;
+	UT_PMEM2_EXPECT_RETURN(pmem2_mover_new(&mover, 2), 0);
+
+	/* more than the requests which can be in flight at once */
+	struct pmem2_future *futures[100];
+	size_t step = size / ARRAY_SIZE(futures);
+	for (size_t i = 0; i < ARRAY_SIZE(futures); ++i) {
+		char *ptr = addr + i * step + 7;
+		memset(ptr, (int)i, 100);
+		UT_PMEM2_EXPECT_RETURN(pmem2_persist_async(mover, map, ptr,
+				100, &futures[i]), 0);
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(futures); ++i) {
+		while (!pmem2_future_poll(futures[i]))
+			;
+		UT_PMEM2_EXPECT_RETURN(pmem2_future_wait(&futures[i]), 0);
+		UT_ASSERTeq(futures[i], NULL);
+	}
+
+	/* the whole mapping at once */
+	struct pmem2_future *future;
+	UT_PMEM2_EXPECT_RETURN(pmem2_persist_async(mover, map, addr, size,
+			&future), 0);
+	UT_PMEM2_EXPECT_RETURN(pmem2_future_wait(&future), 0);
+
+	UT_PMEM2_EXPECT_RETURN(pmem2_persist_async(mover, map, addr, 0,
+			&future), 0);
+	UT_PMEM2_EXPECT_RETURN(pmem2_future_wait(&future), 0);
+
+	future = (struct pmem2_future *)0x7;
+	UT_PMEM2_EXPECT_RETURN(pmem2_persist_async(mover, map, addr + 1, size,
+			&future), PMEM2_E_ASYNC_RANGE);
+	UT_ASSERTeq(future, NULL);
+
+	pmem2_mover_delete(&mover);
+	pmem2_map_delete(&map);
+
+	char *data = MALLOC(size);
+	LSEEK(fd, 0, SEEK_SET);
+	UT_ASSERTeq(READ(fd, data, size), size);
+	for (size_t i = 0; i < ARRAY_SIZE(futures); ++i) {
+		UT_ASSERTeq(data[i * step + 7], (char)i);
+		UT_ASSERTeq(data[i * step + 106], (char)i);
+	}
+
+	FREE(data);
+	PMEM2_CONFIG_DELETE(&cfg);
+	PMEM2_SOURCE_DELETE(&src);
+	CLOSE(fd);
+
+	return 2;
+}
+
+/*
+ * test_memcpy_mcsafe -- copy from a mapping with the pages behind the end
+ * of the truncated file, which fault like poisoned memory
+ */
+static int
+test_memcpy_mcsafe(const struct test_case *tc, int argc, char *argv[])
+{
+	if (argc < 1)
+		UT_FATAL("usage: test_memcpy_mcsafe <file>");
+
+	char *file = argv[0];
+	int fd = OPEN(file, O_RDWR);
+
+	struct pmem2_config *cfg;
+	struct pmem2_source *src;
+	PMEM2_PREPARE_CONFIG_INTEGRATION(&cfg, &src, fd,
+						PMEM2_GRANULARITY_PAGE);
+
+	size_t size;
+	UT_ASSERTeq(pmem2_source_size(src, &size), 0);
+
+	struct pmem2_map *map = map_valid(cfg, src, size);
+	char *addr = pmem2_map_get_address(map);
+
+	size_t valid = size / 2 + Ut_pagesize;
+	for (size_t i = 0; i < valid; ++i)
+		addr[i] = (char)(i * 7);
+
+	char *buf = MALLOC(size);
+	size_t off = SIZE_MAX;
+
+	/* unaligned source, destination and length */
+	UT_PMEM2_EXPECT_RETURN(pmem2_memcpy_mcsafe(map, buf + 3, addr + 5,
+			valid - 13, &off), 0);
+	UT_ASSERTeq(memcmp(buf + 3, addr + 5, valid - 13), 0);
+	UT_ASSERTeq(off, SIZE_MAX);
+
+	FTRUNCATE(fd, (os_off_t)valid);
+
+	/* everything before the first faulting page is copied */
+	char *from = addr + size / 2 - 1003;
+	memset(buf, 0, size);
+	UT_PMEM2_EXPECT_RETURN(pmem2_memcpy_mcsafe(map, buf, from, size / 4,
+			&off), PMEM2_E_MEMORY_POISONED);
+	UT_ASSERTeq(off, (size_t)(addr + valid - from));
+	UT_ASSERTeq(memcmp(buf, from, off), 0);
+
+	UT_PMEM2_EXPECT_RETURN(pmem2_memcpy_mcsafe(map, buf,
+			addr + valid + 100, 10, &off), PMEM2_E_MEMORY_POISONED);
+	UT_ASSERTeq(off, 0);
+
+	/* the copies ending before the faulting pages are not affected */
+	UT_PMEM2_EXPECT_RETURN(pmem2_memcpy_mcsafe(map, buf, addr + valid - 10,
+			10, NULL), 0);
+	UT_ASSERTeq(memcmp(buf, addr + valid - 10, 10), 0);
+
+	UT_PMEM2_EXPECT_RETURN(pmem2_memcpy_mcsafe(map, buf, addr, 0, NULL),
+			0);
+
+	UT_PMEM2_EXPECT_RETURN(pmem2_memcpy_mcsafe(map, buf, addr + 1, size,
+			&off), PMEM2_E_LENGTH_OUT_OF_RANGE);
+	UT_PMEM2_EXPECT_RETURN(pmem2_memcpy_mcsafe(map, buf, addr - 1, 1,
+			&off), PMEM2_E_LENGTH_OUT_OF_RANGE);
+
+	FREE(buf);
+	pmem2_map_delete(&map);
+	PMEM2_CONFIG_DELETE(&cfg);
+	PMEM2_SOURCE_DELETE(&src);
+	CLOSE(fd);
+
+	return 1;
+}
+
+/*
+ * test_numa_node -- query the NUMA node of the sources and map them with
+ * a preferred node
+ */
+static int
+test_numa_node(const struct test_case *tc, int argc, char *argv[])
+{
+	if (argc < 1)
+		UT_FATAL("usage: test_numa_node <file>");
+
+	char *file = argv[0];
+	int fd = OPEN(file, O_RDWR);
+
+	struct pmem2_config *cfg;
+	struct pmem2_source *src;
+	PMEM2_PREPARE_CONFIG_INTEGRATION(&cfg, &src, fd,
+						PMEM2_GRANULARITY_PAGE);
+
+	/* the node is known only for the files on persistent memory */
+	int node = -1;
+	int ret = pmem2_source_numa_node(src, &node);
+	if (ret == 0)
+		UT_ASSERT(node >= 0);
+	else
+		UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_NOSUPP);
+
+	UT_PMEM2_EXPECT_RETURN(pmem2_config_set_numa_node(cfg, 0), 0);
+
+	size_t size;
+	UT_ASSERTeq(pmem2_source_size(src, &size), 0);
+
+	struct pmem2_map *map = map_valid(cfg, src, size);
+	char *addr = pmem2_map_get_address(map);
+	pmem2_memset_fn memset_fn = pmem2_get_memset_fn(map);
+	memset_fn(addr, 0xAB, size, 0);
+	pmem2_map_delete(&map);
+	PMEM2_SOURCE_DELETE(&src);
+
+	char *data = MALLOC(size);
+	UT_ASSERTeq(READ(fd, data, size), size);
+	for (size_t i = 0; i < size; ++i)
+		UT_ASSERTeq(data[i], (char)0xAB);
+	FREE(data);
+
+	/* an anonymous source has no node until it is mapped */
+	UT_ASSERTeq(pmem2_source_from_anon(&src, size), 0);
+	UT_PMEM2_EXPECT_RETURN(pmem2_source_numa_node(src, &node),
+			PMEM2_E_NOSUPP);
+
+	map = map_valid(cfg, src, size);
+	addr = pmem2_map_get_address(map);
+	memset(addr, 0xCD, size);
+	UT_ASSERTeq(addr[size - 1], (char)0xCD);
+	pmem2_map_delete(&map);
+
+	PMEM2_CONFIG_DELETE(&cfg);
+	PMEM2_SOURCE_DELETE(&src);
+	CLOSE(fd);
+
+	return 1;
+}
+
 /*
  * test_cases -- available test cases
  */
@@ -1016,7 +1767,17 @@ static struct test_case test_cases[] = {
 	TEST_CASE(test_source_anon_zero_len),
 	TEST_CASE(test_unaligned_persist),
 	TEST_CASE(test_map_from_existing_map),
-	TEST_CASE(test_map_from_existing)
+	TEST_CASE(test_map_from_existing),
+	TEST_CASE(test_mover_async),
+	TEST_CASE(test_mover_e_range),
+	TEST_CASE(test_memcpyv_memmovev),
+	TEST_CASE(test_calibrate),
+	TEST_CASE(test_parallel),
+	TEST_CASE(test_deep_flush_batch),
+	TEST_CASE(test_writeback),
+	TEST_CASE(test_persist_async),
+	TEST_CASE(test_memcpy_mcsafe),
+	TEST_CASE(test_numa_node),
 };
 
 #define NTESTS (sizeof(test_cases) / sizeof(test_cases[0]))
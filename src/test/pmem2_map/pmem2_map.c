@@ -14,6 +14,7 @@
 #include "out.h"
 #include "pmem2.h"
 #include "unittest.h"
+#include "uring.h"
 #include "ut_pmem2.h"
 #include "ut_pmem2_setup.h"
 
@@ -63,6 +64,7 @@ prepare_map(struct pmem2_map **map_ptr,
 	map->reserved_length = map->content_length = cfg->length;
 	map->effective_granularity = PMEM2_GRANULARITY_PAGE;
 	map->reserv = NULL;
+	map->uring_fd = INVALID_FD;
 
 	*map_ptr = map;
 
@@ -100,6 +102,7 @@ prepare_map(struct pmem2_map **map_ptr,
 	map->reserved_length = map->content_length = cfg->length;
 	map->effective_granularity = PMEM2_GRANULARITY_PAGE;
 	map->reserv = NULL;
+	map->uring_fd = INVALID_FD;
 
 	*map_ptr = map;
 
@@ -119,6 +122,7 @@ unmap_map(struct pmem2_map *map)
 	UT_ASSERTeq(munmap(map->addr, map->reserved_length), 0);
 #endif
 	UT_ASSERTeq(pmem2_unregister_mapping(map), 0);
+	pmem2_uring_map_fini(map);
 }
 
 /*
@@ -479,7 +483,8 @@ test_unmap_unaligned_addr(const struct test_case *tc, int argc, char *argv[])
 
 	char *file = argv[0];
 	size_t size = ATOUL(argv[1]);
-	unmap_invalid_common(file, size, map_spoil_set_unaligned_addr, -EINVAL);
+	unmap_invalid_common(file, size, map_spoil_set_unaligned_addr,
+			PMEM2_E_MAPPING_NOT_FOUND);
 
 	return 2;
 }
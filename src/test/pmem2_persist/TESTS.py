@@ -1,7 +1,7 @@
 #!../env.py
 #
 # SPDX-License-Identifier: BSD-3-Clause
-# Copyright 2019, Intel Corporation
+# Copyright 2019-2020, Intel Corporation
 
 import testframework as t
 from testframework import granularity as g
@@ -28,3 +28,18 @@ class TEST1(PMEM2_PERSIST):
 class TEST2(PMEM2_PERSIST):
     """test getting pmem2 drain functions"""
     test_case = "test_get_drain_funcs"
+
+
+class TEST3(PMEM2_PERSIST):
+    """test flushing every line of the flush batch once"""
+    test_case = "test_flush_batch"
+
+
+class TEST4(PMEM2_PERSIST):
+    """test the flavors of the inline store primitives"""
+    test_case = "test_store_ops"
+
+
+class TEST5(PMEM2_PERSIST):
+    """test the number of the write-backs in the deferred write-back mode"""
+    test_case = "test_writeback"
@@ -2,19 +2,30 @@
 /* Copyright 2019-2020, Intel Corporation */
 
 /*
- * pmem2_persist.c -- pmem2_get_[flush|drain|persist]_fn unittests
+ * pmem2_persist.c -- pmem2_get_[flush|drain|persist]_fn, pmem2_flush_batch,
+ * pmem2_get_store_ops and deferred write-back unittests
  */
 
+#include <libpmem2/store.h>
+
 #include "mmap.h"
 #include "persist.h"
 #include "pmem2_arch.h"
 #include "out.h"
 #include "unittest.h"
+#include "writeback.h"
 
 static int n_flushes = 0;
 static int n_fences = 0;
 static int n_msynces = 0;
 
+/* the ranges of the first msyncs since the last check */
+#define MAX_MSYNCES 16
+static struct {
+	const char *addr;
+	size_t len;
+} msynces[MAX_MSYNCES];
+
 /*
  * mock_flush -- count flush calls in the test
  */
@@ -69,6 +80,11 @@ pmem2_flush_file_buffers_os(struct pmem2_map *map, const void *addr, size_t len,
 {
 	UT_ASSERTeq((uintptr_t)addr % Pagesize, 0);
 
+	if (n_msynces < MAX_MSYNCES) {
+		msynces[n_msynces].addr = addr;
+		msynces[n_msynces].len = len;
+	}
+
 	++n_msynces;
 
 	return 0;
@@ -209,6 +225,279 @@ test_get_drain_funcs(const struct test_case *tc, int argc, char *argv[])
 	return 0;
 }
 
+/*
+ * test_flush_batch -- test flushing every line of the batch once
+ */
+static int
+test_flush_batch(const struct test_case *tc, int argc, char *argv[])
+{
+	struct pmem2_map map;
+	prepare_map(&map);
+	char *addr = map.addr;
+
+	struct pmem2_flush_batch *batch;
+
+	/* scattered fields, some of them in the same or adjacent lines */
+	map.effective_granularity = PMEM2_GRANULARITY_CACHE_LINE;
+	pmem2_set_flush_fns(&map);
+	int ret = pmem2_flush_batch_new(&batch, &map);
+	UT_ASSERTeq(ret, 0);
+
+	pmem2_flush_batch_add(batch, addr + 5 * CACHELINE_SIZE, 8);
+	pmem2_flush_batch_add(batch, addr + 0, 8);
+	pmem2_flush_batch_add(batch, addr + 16, 8);
+	pmem2_flush_batch_add(batch, addr + 5 * CACHELINE_SIZE + 8, 8);
+	pmem2_flush_batch_add(batch, addr + CACHELINE_SIZE + 8, 8);
+	pmem2_flush_batch_add(batch, addr + 5 * CACHELINE_SIZE, 8);
+	pmem2_flush_batch_add(batch, addr + 40, 0);
+	pmem2_flush_batch_persist(batch);
+	counters_check_n_reset(0, 2, 1);
+
+	/* the batch is empty after the persist */
+	pmem2_flush_batch_persist(batch);
+	counters_check_n_reset(0, 0, 1);
+
+	/* enough lines to grow the batch, each of them added twice */
+	for (int pass = 0; pass < 2; ++pass) {
+		for (size_t i = 1000; i > 0; --i) {
+			pmem2_flush_batch_add(batch,
+				addr + 2 * i * CACHELINE_SIZE, 8);
+		}
+	}
+	pmem2_flush_batch_persist(batch);
+	counters_check_n_reset(0, 1000, 1);
+
+	pmem2_flush_batch_delete(&batch);
+	UT_ASSERTeq(batch, NULL);
+
+	/* the lines are pages */
+	map.effective_granularity = PMEM2_GRANULARITY_PAGE;
+	pmem2_set_flush_fns(&map);
+	ret = pmem2_flush_batch_new(&batch, &map);
+	UT_ASSERTeq(ret, 0);
+
+	pmem2_flush_batch_add(batch, addr + 3 * Pagesize + 8, 8);
+	pmem2_flush_batch_add(batch, addr + 8, 8);
+	pmem2_flush_batch_add(batch, addr + 3 * Pagesize + 16, 8);
+	pmem2_flush_batch_add(batch, addr + 128, 8);
+	pmem2_flush_batch_persist(batch);
+	counters_check_n_reset(2, 0, 0);
+
+	pmem2_flush_batch_delete(&batch);
+
+	/* nothing has to be flushed */
+	map.effective_granularity = PMEM2_GRANULARITY_BYTE;
+	pmem2_set_flush_fns(&map);
+	ret = pmem2_flush_batch_new(&batch, &map);
+	UT_ASSERTeq(ret, 0);
+
+	pmem2_flush_batch_add(batch, addr, 8);
+	pmem2_flush_batch_persist(batch);
+	counters_check_n_reset(0, 0, 1);
+
+	pmem2_flush_batch_delete(&batch);
+
+	FREE(map.addr);
+
+	return 0;
+}
+
+/*
+ * get_store_ops -- set the granularity of the mapping and get its store ops
+ */
+static enum pmem2_store_flavor
+get_store_ops(struct pmem2_map *map, enum pmem2_granularity granularity,
+		struct pmem2_store_ops *ops)
+{
+	map->effective_granularity = granularity;
+	pmem2_set_flush_fns(map);
+	pmem2_get_store_ops(map, ops);
+
+	UT_ASSERTeq(ops->persist, pmem2_get_persist_fn(map));
+	UT_ASSERTeq(ops->flush, pmem2_get_flush_fn(map));
+	UT_ASSERTeq(ops->drain, pmem2_get_drain_fn(map));
+
+	return ops->flavor;
+}
+
+/*
+ * do_stores -- store with every primitive, check the stored data and
+ * the counts of flushes and fences
+ */
+static void
+do_stores(const struct pmem2_store_ops *ops, char *line, int flushes,
+		int fences)
+{
+	char src[PMEM2_STORE_LINE_SIZE];
+	for (unsigned i = 0; i < sizeof(src); ++i)
+		src[i] = (char)i;
+
+	pmem2_store64_flush(ops, (uint64_t *)line + 1, 0x1122334455667788);
+	UT_ASSERTeq(((uint64_t *)line)[1], 0x1122334455667788);
+	counters_check_n_reset(0, flushes, 0);
+
+	pmem2_store_drain(ops);
+	counters_check_n_reset(0, 0, fences);
+
+	pmem2_store64_persist(ops, (uint64_t *)line + 7, 0x8877665544332211);
+	UT_ASSERTeq(((uint64_t *)line)[7], 0x8877665544332211);
+	counters_check_n_reset(0, flushes, fences);
+
+	pmem2_store128_persist(ops, line + 16, src + 1);
+	UT_ASSERTeq(memcmp(line + 16, src + 1, 16), 0);
+	counters_check_n_reset(0, flushes, fences);
+
+	memset(line, 0, PMEM2_STORE_LINE_SIZE);
+	pmem2_store_line_persist(ops, line, src);
+	UT_ASSERTeq(memcmp(line, src, sizeof(src)), 0);
+	counters_check_n_reset(0, flushes, fences);
+
+	/* the non-temporal stores need no flushes, but they have to drain */
+	memset(line, 0, PMEM2_STORE_LINE_SIZE);
+	pmem2_store_line_nt(ops, line, src);
+	UT_ASSERTeq(memcmp(line, src, sizeof(src)), 0);
+	counters_check_n_reset(0, flushes, fences);
+}
+
+/*
+ * test_store_ops -- test the flavors of the inline store primitives and
+ * their fallback to the functions of the mapping
+ */
+static int
+test_store_ops(const struct test_case *tc, int argc, char *argv[])
+{
+	struct pmem2_map map;
+	prepare_map(&map);
+	char *line = (char *)ALIGN_UP((uintptr_t)map.addr,
+			(uintptr_t)PMEM2_STORE_LINE_SIZE);
+
+	struct pmem2_arch_info *info = pmem2_persist_get_arch_info();
+	enum pmem2_store_flavor flavor = info->store_flavor;
+	struct pmem2_store_ops ops;
+
+	/* the architecture has no inline flushes */
+	info->store_flavor = PMEM2_STORE_FLAVOR_GENERIC;
+	UT_ASSERTeq(get_store_ops(&map, PMEM2_GRANULARITY_PAGE, &ops),
+			PMEM2_STORE_FLAVOR_GENERIC);
+	UT_ASSERTeq(get_store_ops(&map, PMEM2_GRANULARITY_BYTE, &ops),
+			PMEM2_STORE_FLAVOR_GENERIC);
+	UT_ASSERTeq(get_store_ops(&map, PMEM2_GRANULARITY_CACHE_LINE, &ops),
+			PMEM2_STORE_FLAVOR_GENERIC);
+
+	/* each primitive calls the flush function once */
+	do_stores(&ops, line, 1, 1);
+
+	info->store_flavor = PMEM2_STORE_FLAVOR_CLFLUSH;
+	UT_ASSERTeq(get_store_ops(&map, PMEM2_GRANULARITY_PAGE, &ops),
+			PMEM2_STORE_FLAVOR_GENERIC);
+	UT_ASSERTeq(get_store_ops(&map, PMEM2_GRANULARITY_BYTE, &ops),
+			PMEM2_STORE_FLAVOR_NOFLUSH);
+#if defined(__x86_64__) || defined(_M_X64)
+	/* no function of the mapping is called */
+	do_stores(&ops, line, 0, 0);
+#endif
+
+	UT_ASSERTeq(get_store_ops(&map, PMEM2_GRANULARITY_CACHE_LINE, &ops),
+			PMEM2_STORE_FLAVOR_CLFLUSH);
+#if defined(__x86_64__) || defined(_M_X64)
+	do_stores(&ops, line, 0, 0);
+#endif
+
+	info->store_flavor = flavor;
+
+	FREE(map.addr);
+
+	return 0;
+}
+
+/*
+ * check_msync -- check the range of the nth msync, in pages of the mapping
+ */
+static void
+check_msync(int n, const char *addr, size_t first, size_t npages)
+{
+	UT_ASSERTeq(msynces[n].addr, addr + first * Pagesize);
+	UT_ASSERTeq(msynces[n].len, npages * Pagesize);
+}
+
+/*
+ * test_writeback -- test the number of the write-backs of the ranges
+ * flushed in the deferred write-back mode
+ */
+static int
+test_writeback(const struct test_case *tc, int argc, char *argv[])
+{
+	struct pmem2_map map;
+	prepare_map(&map);
+	char *addr = (char *)ALIGN_UP((uintptr_t)map.addr, Pagesize);
+
+	map.effective_granularity = PMEM2_GRANULARITY_PAGE;
+	pmem2_set_flush_fns(&map);
+	pmem2_set_writeback_fns(&map);
+
+	pmem2_flush_fn flush = pmem2_get_flush_fn(&map);
+	pmem2_drain_fn drain = pmem2_get_drain_fn(&map);
+	pmem2_persist_fn persist = pmem2_get_persist_fn(&map);
+
+	/* scattered, overlapping and adjacent ranges in reverse order */
+	flush(addr + 40 * Pagesize + 8, 8);
+	flush(addr + 21 * Pagesize, 4 * Pagesize);
+	flush(addr + 20 * Pagesize + 100, Pagesize);
+	flush(addr + 10 * Pagesize + 100, 100);
+	flush(addr + 4 * Pagesize, 100);
+	flush(addr + 10 * Pagesize + 8, 8);
+	flush(addr + 3 * Pagesize + 8, Pagesize - 8);
+
+	/* nothing is written back before the drain */
+	counters_check_n_reset(0, 0, 0);
+
+	drain();
+	check_msync(0, addr, 3, 2);
+	check_msync(1, addr, 10, 1);
+	check_msync(2, addr, 20, 5);
+	check_msync(3, addr, 40, 1);
+	counters_check_n_reset(4, 0, 0);
+
+	/* the drain emptied the set */
+	drain();
+	counters_check_n_reset(0, 0, 0);
+
+	/* a persist does not wait for the drain */
+	flush(addr + 7 * Pagesize, 8);
+	persist(addr + 5 * Pagesize + 8, 8);
+	UT_ASSERTeq(msynces[0].addr, addr + 5 * Pagesize);
+	UT_ASSERTeq(msynces[0].len, 16);
+	counters_check_n_reset(1, 0, 0);
+
+	/* a range flushed again after the persist is written back once */
+	flush(addr + 7 * Pagesize + 16, 8);
+	drain();
+	check_msync(0, addr, 7, 1);
+	counters_check_n_reset(1, 0, 0);
+
+	/* enough ranges to grow the set, each of them flushed twice */
+	for (int pass = 0; pass < 2; ++pass) {
+		for (size_t i = 1000; i > 0; --i)
+			flush(addr + 2 * i * Pagesize, 8);
+	}
+	counters_check_n_reset(0, 0, 0);
+
+	drain();
+	check_msync(0, addr, 2, 1);
+	counters_check_n_reset(1000, 0, 0);
+
+	/* the adjacent pages are written back at once */
+	for (size_t i = 1000; i > 0; --i)
+		flush(addr + i * Pagesize, 8);
+	drain();
+	check_msync(0, addr, 1, 1000);
+	counters_check_n_reset(1, 0, 0);
+
+	FREE(map.addr);
+
+	return 0;
+}
+
 /*
  * test_cases -- available test cases
  */
@@ -216,6 +505,9 @@ static struct test_case test_cases[] = {
 	TEST_CASE(test_get_persist_funcs),
 	TEST_CASE(test_get_flush_funcs),
 	TEST_CASE(test_get_drain_funcs),
+	TEST_CASE(test_flush_batch),
+	TEST_CASE(test_store_ops),
+	TEST_CASE(test_writeback),
 };
 
 #define NTESTS (sizeof(test_cases) / sizeof(test_cases[0]))
@@ -225,6 +517,7 @@ main(int argc, char *argv[])
 {
 	START(argc, argv, "pmem2_persist");
 	pmem2_persist_init();
+	pmem2_writeback_init();
 	util_init();
 	TEST_CASE_PROCESS(argc, argv, test_cases, NTESTS);
 	DONE(NULL);
@@ -301,3 +301,13 @@ class TEST32(PMEM2_VM_RESERVATION_ASYNC_DEVDAX):
     test_case = "test_vm_reserv_async_map_unmap_multiple_files"
     threads = 32
     ops_per_thread = 1000
+
+
+class TEST33(PMEM2_VM_RESERVATION):
+    """extend a vm reservation in place and shrink it from both ends"""
+    test_case = "test_vm_reserv_extend_shrink"
+
+
+class TEST34(PMEM2_VM_RESERVATION):
+    """let the mappings be placed in a vm reservation automatically"""
+    test_case = "test_vm_reserv_map_any_offset"
@@ -1088,6 +1088,175 @@ test_vm_reserv_async_map_unmap_multiple_files(const struct test_case *tc,
 	return 4;
 }
 
+/*
+ * test_vm_reserv_extend_shrink - extend a vm reservation in place and shrink
+ *                                it from both ends
+ */
+static int
+test_vm_reserv_extend_shrink(const struct test_case *tc,
+		int argc, char *argv[])
+{
+	if (argc < 2)
+		UT_FATAL("usage: test_vm_reserv_extend_shrink <file> <size>");
+
+	char *file = argv[0];
+	size_t size = ATOUL(argv[1]);
+	size_t align = Ut_mmap_align;
+	char *rsv_addr;
+	struct FHandle *fh;
+	struct pmem2_config cfg;
+	struct pmem2_map *map;
+	struct pmem2_vm_reservation *rsv;
+	struct pmem2_vm_reservation *rsv2;
+	struct pmem2_source *src;
+
+	/* the last third is released, so it is known to be free */
+	int ret = pmem2_vm_reservation_new(&rsv, NULL, 3 * size);
+	UT_ASSERTeq(ret, 0);
+	rsv_addr = pmem2_vm_reservation_get_address(rsv);
+
+	ret = pmem2_vm_reservation_shrink(rsv, 2 * size, size);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	UT_ASSERTeq(pmem2_vm_reservation_get_address(rsv), rsv_addr);
+	UT_ASSERTeq(pmem2_vm_reservation_get_size(rsv), 2 * size);
+
+	/* the adjacent address space is occupied */
+	ret = pmem2_vm_reservation_new(&rsv2, rsv_addr + 2 * size, size);
+	UT_ASSERTeq(ret, 0);
+	ret = pmem2_vm_reservation_extend(rsv, size);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_MAPPING_EXISTS);
+	UT_ASSERTeq(pmem2_vm_reservation_get_size(rsv), 2 * size);
+	ret = pmem2_vm_reservation_delete(&rsv2);
+	UT_ASSERTeq(ret, 0);
+
+	ret = pmem2_vm_reservation_extend(rsv, size);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	UT_ASSERTeq(pmem2_vm_reservation_get_address(rsv), rsv_addr);
+	UT_ASSERTeq(pmem2_vm_reservation_get_size(rsv), 3 * size);
+
+	ret = pmem2_vm_reservation_extend(rsv, align / 2);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_LENGTH_UNALIGNED);
+
+	/* map the file in the middle third */
+	ut_pmem2_prepare_config(&cfg, &src, &fh, FH_FD, file, 0, 0, FH_RDWR);
+	pmem2_config_set_vm_reservation(&cfg, rsv, size);
+
+	ret = pmem2_map_new(&map, &cfg, src);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	char *addr = pmem2_map_get_address(map);
+	UT_ASSERTeq(addr, rsv_addr + size);
+
+	ret = pmem2_vm_reservation_shrink(rsv, size, align);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_NOSUPP);
+
+	ret = pmem2_vm_reservation_shrink(rsv, 0, 3 * size);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_NOSUPP);
+
+	ret = pmem2_vm_reservation_shrink(rsv, 2 * size, 2 * size);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_OFFSET_OUT_OF_RANGE);
+
+	ret = pmem2_vm_reservation_shrink(rsv, 2 * size + align / 2, align);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_OFFSET_UNALIGNED);
+
+	ret = pmem2_vm_reservation_shrink(rsv, 0, size + align);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_VM_RESERVATION_NOT_EMPTY);
+
+	/* release both ends, the mapping stays where it was */
+	ret = pmem2_vm_reservation_shrink(rsv, 0, size);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	UT_ASSERTeq(pmem2_vm_reservation_get_address(rsv), rsv_addr + size);
+	UT_ASSERTeq(pmem2_vm_reservation_get_size(rsv), 2 * size);
+
+	ret = pmem2_vm_reservation_shrink(rsv, size, size);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	UT_ASSERTeq(pmem2_vm_reservation_get_address(rsv), rsv_addr + size);
+	UT_ASSERTeq(pmem2_vm_reservation_get_size(rsv), size);
+
+	UT_ASSERTeq(pmem2_map_get_address(map), addr);
+	addr[0] = 1;
+	addr[size - 1] = 1;
+
+	ret = pmem2_vm_reservation_delete(&rsv);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_VM_RESERVATION_NOT_EMPTY);
+
+	ret = pmem2_map_delete(&map);
+	UT_ASSERTeq(ret, 0);
+	ret = pmem2_vm_reservation_delete(&rsv);
+	UT_ASSERTeq(ret, 0);
+	PMEM2_SOURCE_DELETE(&src);
+	UT_FH_CLOSE(fh);
+
+	return 2;
+}
+
+/*
+ * test_vm_reserv_map_any_offset - let the mappings be placed in
+ *                                 the vm reservation automatically
+ */
+static int
+test_vm_reserv_map_any_offset(const struct test_case *tc,
+		int argc, char *argv[])
+{
+	if (argc < 2)
+		UT_FATAL("usage: test_vm_reserv_map_any_offset <file> <size>");
+
+	char *file = argv[0];
+	size_t size = ATOUL(argv[1]);
+	size_t huge = 2 << 20; /* 2 MiB */
+	char *rsv_addr;
+	size_t rsv_size = 3 * size;
+	struct FHandle *fh;
+	struct pmem2_config cfg;
+	struct pmem2_map *map[4];
+	struct pmem2_vm_reservation *rsv;
+	struct pmem2_source *src;
+
+	UT_ASSERT(size >= huge);
+
+	int ret = pmem2_vm_reservation_new(&rsv, NULL, rsv_size);
+	UT_ASSERTeq(ret, 0);
+	rsv_addr = pmem2_vm_reservation_get_address(rsv);
+
+	ut_pmem2_prepare_config(&cfg, &src, &fh, FH_FD, file, 0, 0, FH_RDWR);
+	pmem2_config_set_vm_reservation(&cfg, rsv,
+			PMEM2_VM_RESERVATION_OFFSET_ANY);
+
+	/* the big mappings are aligned for the huge pages */
+	char *first = (char *)ALIGN_UP((uintptr_t)rsv_addr, huge);
+	for (size_t i = 0; i < 2; ++i) {
+		ret = pmem2_map_new(&map[i], &cfg, src);
+		UT_PMEM2_EXPECT_RETURN(ret, 0);
+		UT_ASSERTeq(pmem2_map_get_address(map[i]), first + i * size);
+	}
+
+	/* the small one takes the lowest free region */
+	char *expected = rsv_addr;
+	if (first == rsv_addr)
+		expected = rsv_addr + 2 * size;
+
+	pmem2_config_set_length(&cfg, Ut_mmap_align);
+	ret = pmem2_map_new(&map[2], &cfg, src);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	UT_ASSERTeq(pmem2_map_get_address(map[2]), expected);
+
+	/* there is no room for the whole file */
+	pmem2_config_set_length(&cfg, 0);
+	ret = pmem2_map_new(&map[3], &cfg, src);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_LENGTH_OUT_OF_RANGE);
+
+	for (size_t i = 0; i < 3; ++i) {
+		ret = pmem2_map_delete(&map[i]);
+		UT_ASSERTeq(ret, 0);
+	}
+
+	ret = pmem2_vm_reservation_delete(&rsv);
+	UT_ASSERTeq(ret, 0);
+	PMEM2_SOURCE_DELETE(&src);
+	UT_FH_CLOSE(fh);
+
+	return 2;
+}
+
 /*
  * test_cases -- available test cases
  */
@@ -1110,6 +1279,8 @@ static struct test_case test_cases[] = {
 	TEST_CASE(test_vm_reserv_map_partial_overlap_below),
 	TEST_CASE(test_vm_reserv_map_invalid_granularity),
 	TEST_CASE(test_vm_reserv_async_map_unmap_multiple_files),
+	TEST_CASE(test_vm_reserv_extend_shrink),
+	TEST_CASE(test_vm_reserv_map_any_offset),
 };
 
 #define NTESTS (sizeof(test_cases) / sizeof(test_cases[0]))
@@ -713,6 +713,22 @@ pmemspoil_process_shutdown_state(struct pmemspoil *psp,
 	return PROCESS_RET;
 }
 
+/*
+ * pmemspoil_process_lag -- process lag fields
+ */
+static int
+pmemspoil_process_lag(struct pmemspoil *psp,
+	struct pmemspoil_list *pfp, void *arg)
+{
+	struct pool_hdr_lag *lag = arg;
+	PROCESS_BEGIN(psp, pfp) {
+		PROCESS_FIELD_LE(lag, begin, uint64_t);
+		PROCESS_FIELD_LE(lag, end, uint64_t);
+	} PROCESS_END;
+
+	return PROCESS_RET;
+}
+
 /*
  * pmemspoil_process_features -- process features fields
  */
@@ -762,6 +778,7 @@ pmemspoil_process_pool_hdr(struct pmemspoil *psp,
 		PROCESS(features, &pool_hdr.features, 1, features_t *);
 		PROCESS_FIELD_LE(&pool_hdr, crtime, uint64_t);
 		PROCESS_FIELD(&pool_hdr, arch_flags, char); /* XXX */
+		PROCESS(lag, &pool_hdr.lag, 1, struct pool_hdr_lag *);
 		PROCESS(shutdown_state, &pool_hdr.sds, 1,
 			struct shutdown_state *);
 		PROCESS_FIELD_LE(&pool_hdr, checksum, uint64_t);
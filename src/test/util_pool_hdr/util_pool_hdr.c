@@ -15,7 +15,7 @@
 
 #define POOL_HDR_SIG_LEN_V1 (8)
 #define POOL_HDR_UNUSED_LEN_V1 (1904)
-#define POOL_HDR_UNUSED2_LEN_V1 (1976)
+#define POOL_HDR_UNUSED2_LEN_V1 (1960)
 #define POOL_HDR_2K_CHECKPOINT (2048UL)
 
 #define FEATURES_T_SIZE_V1 (12)
@@ -23,6 +23,8 @@
 #define ARCH_FLAGS_SIZE_V1 (16)
 #define ARCH_FLAGS_RESERVED_LEN_V1 (4)
 
+#define POOL_HDR_LAG_SIZE_V1 (16)
+
 #define SHUTDOWN_STATE_SIZE_V1 (64)
 #define SHUTDOWN_STATE_RESERVED_LEN_V1 (39)
 
@@ -50,6 +52,7 @@ test_layout()
 	ASSERT_OFFSET_CHECKPOINT(struct pool_hdr, POOL_HDR_2K_CHECKPOINT);
 	ASSERT_ALIGNED_FIELD(struct pool_hdr, unused2);
 	ASSERT_FIELD_SIZE(unused2, POOL_HDR_UNUSED2_LEN_V1);
+	ASSERT_ALIGNED_FIELD(struct pool_hdr, lag);
 	ASSERT_ALIGNED_FIELD(struct pool_hdr, sds);
 	ASSERT_ALIGNED_FIELD(struct pool_hdr, checksum);
 #if PMEM_PAGESIZE > 4096
@@ -74,6 +77,13 @@ test_layout()
 	ASSERT_ALIGNED_CHECK(struct arch_flags);
 	UT_COMPILE_ERROR_ON(sizeof(struct arch_flags) != ARCH_FLAGS_SIZE_V1);
 
+	ASSERT_ALIGNED_BEGIN(struct pool_hdr_lag);
+	ASSERT_ALIGNED_FIELD(struct pool_hdr_lag, begin);
+	ASSERT_ALIGNED_FIELD(struct pool_hdr_lag, end);
+	ASSERT_ALIGNED_CHECK(struct pool_hdr_lag);
+	UT_COMPILE_ERROR_ON(sizeof(struct pool_hdr_lag) !=
+			POOL_HDR_LAG_SIZE_V1);
+
 	ASSERT_ALIGNED_BEGIN(struct shutdown_state);
 	ASSERT_ALIGNED_FIELD(struct shutdown_state, usc);
 	ASSERT_ALIGNED_FIELD(struct shutdown_state, uuid);
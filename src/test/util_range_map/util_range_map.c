@@ -0,0 +1,273 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2020, Intel Corporation */
+
+/*
+ * util_range_map.c -- unit test for range_map
+ *
+ * usage: util_range_map nreaders nwriters nops
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "range_map.h"
+#include "util.h"
+#include "unittest.h"
+#include "alloc.h"
+
+/* the address space of every writer thread */
+#define SLOT_SIZE (1 << 20)
+#define NRANGES 16
+#define RANGE_SIZE (SLOT_SIZE / NRANGES)
+
+/*
+ * range -- the data of a registered range, describing the range itself
+ */
+struct range {
+	uintptr_t addr;
+	size_t len;
+};
+
+static struct range_map *Rm;
+static struct range *Ranges;
+static unsigned Nwriters;
+static unsigned Nops;
+static int Stop;
+
+/* the allocations of the calling thread fail */
+static __thread int Out_of_memory;
+
+/*
+ * malloc_oom -- malloc failing in the threads which ran out of memory
+ */
+static void *
+malloc_oom(size_t size)
+{
+	if (Out_of_memory) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	return malloc(size);
+}
+
+/*
+ * remove_oom -- remove the range, with or without memory
+ */
+static int
+remove_oom(struct range_map *rm, const struct range *r, int oom)
+{
+	Out_of_memory = oom;
+	int ret = range_map_remove(rm, r->addr, r->len);
+	Out_of_memory = 0;
+
+	return ret;
+}
+
+/*
+ * range_check -- check that the range found for the given address covers it
+ */
+static void
+range_check(const struct range *r, uintptr_t addr)
+{
+	if (r == NULL)
+		return;
+
+	UT_ASSERT(r->addr <= addr && addr < r->addr + r->len);
+}
+
+/*
+ * test_basic -- insert, find and remove a few ranges
+ */
+static void
+test_basic(void)
+{
+	struct range_map *rm = range_map_new();
+	UT_ASSERTne(rm, NULL);
+
+	struct range a = {0x1000, 0x1000};
+	struct range b = {0x3000, 0x2000};
+
+	UT_ASSERTeq(range_map_insert(rm, a.addr, a.len, &a), 0);
+	UT_ASSERTeq(range_map_insert(rm, b.addr, b.len, &b), 0);
+	UT_ASSERTeq(range_map_insert(rm, 0x1800, 0x100, &a), -EEXIST);
+	UT_ASSERTeq(range_map_insert(rm, 0x2800, 0x1000, &a), -EEXIST);
+
+	UT_ASSERTeq(range_map_find(rm, 0x0, 0x1000), NULL);
+	UT_ASSERTeq(range_map_find(rm, 0x1fff, 1), &a);
+	UT_ASSERTeq(range_map_find(rm, 0x2000, 0x1000), NULL);
+	UT_ASSERTeq(range_map_find(rm, 0x0, 0x10000), &a);
+	UT_ASSERTeq(range_map_find(rm, 0x2000, 0x10000), &b);
+
+	/* only the exact range is removed */
+	UT_ASSERTeq(range_map_remove(rm, 0x0, 0x10000), -ENOENT);
+	UT_ASSERTeq(range_map_remove(rm, b.addr, b.len / 2), -ENOENT);
+	UT_ASSERTeq(range_map_remove(rm, b.addr + 0x1000, 0x1000), -ENOENT);
+	UT_ASSERTeq(range_map_find(rm, b.addr, 1), &b);
+
+	UT_ASSERTeq(range_map_remove(rm, b.addr, b.len), 0);
+	UT_ASSERTeq(range_map_find(rm, b.addr, 1), NULL);
+	UT_ASSERTeq(range_map_find(rm, a.addr, 1), &a);
+	UT_ASSERTeq(range_map_remove(rm, b.addr, b.len), -ENOENT);
+
+	UT_ASSERTeq(range_map_remove(rm, a.addr, a.len), 0);
+	UT_ASSERTeq(range_map_find(rm, 0x0, 0x10000), NULL);
+
+	range_map_delete(rm);
+}
+
+/*
+ * test_remove_oom -- removal does not fail when out of memory
+ */
+static void
+test_remove_oom(void)
+{
+	struct range_map *rm = range_map_new();
+	UT_ASSERTne(rm, NULL);
+
+	struct range r[NRANGES];
+	for (unsigned i = 0; i < NRANGES; ++i) {
+		r[i].addr = (i + 1) * RANGE_SIZE;
+		r[i].len = RANGE_SIZE;
+		UT_ASSERTeq(range_map_insert(rm, r[i].addr, r[i].len, &r[i]),
+			0);
+	}
+
+	/* every other removal reuses the memory of a replaced snapshot */
+	for (unsigned i = 0; i < NRANGES; ++i) {
+		unsigned n = (i * 7) % NRANGES;
+		UT_ASSERTeq(remove_oom(rm, &r[n], i % 2 == 0), 0);
+		UT_ASSERTeq(range_map_find(rm, r[n].addr, r[n].len), NULL);
+
+		for (unsigned j = 0; j < NRANGES; ++j) {
+			void *data = range_map_find(rm, r[j].addr, 1);
+			if (data != NULL)
+				UT_ASSERTeq(data, &r[j]);
+		}
+	}
+
+	UT_ASSERTeq(range_map_find(rm, 0, (NRANGES + 1) * RANGE_SIZE), NULL);
+
+	range_map_delete(rm);
+}
+
+/*
+ * reader -- look up random addresses until the writers are done
+ */
+static void *
+reader(void *arg)
+{
+	unsigned seed = (unsigned)(uintptr_t)arg;
+	int stop = 0;
+
+	while (!stop) {
+		util_atomic_load_explicit32(&Stop, &stop,
+			memory_order_acquire);
+
+		uintptr_t addr = SLOT_SIZE +
+			(uintptr_t)os_rand_r(&seed) % (Nwriters * SLOT_SIZE);
+		range_check(range_map_find(Rm, addr, 1), addr);
+	}
+
+	return NULL;
+}
+
+/*
+ * writer -- insert and remove the ranges of its own slot, every change
+ * replaces the snapshot read by the readers
+ */
+static void *
+writer(void *arg)
+{
+	unsigned w = (unsigned)(uintptr_t)arg;
+	struct range *ranges = &Ranges[w * NRANGES];
+	unsigned seed = w;
+
+	for (unsigned i = 0; i < NRANGES; ++i) {
+		ranges[i].addr = (w + 1) * (uintptr_t)SLOT_SIZE +
+			i * (uintptr_t)RANGE_SIZE;
+		ranges[i].len = RANGE_SIZE;
+	}
+
+	for (unsigned op = 0; op < Nops; ++op) {
+		struct range *r = &ranges[os_rand_r(&seed) % NRANGES];
+
+		if (range_map_find(Rm, r->addr, r->len) == r) {
+			UT_ASSERTeq(remove_oom(Rm, r, op % 4 == 0), 0);
+		} else {
+			UT_ASSERTeq(range_map_insert(Rm, r->addr, r->len, r),
+				0);
+		}
+
+		range_check(range_map_find(Rm, r->addr, 1), r->addr);
+	}
+
+	for (unsigned i = 0; i < NRANGES; ++i)
+		range_map_remove(Rm, ranges[i].addr, ranges[i].len);
+
+	return NULL;
+}
+
+/*
+ * test_concurrent -- run the lookups concurrently with the changes
+ */
+static void
+test_concurrent(unsigned nreaders, unsigned nwriters, unsigned nops)
+{
+	Rm = range_map_new();
+	UT_ASSERTne(Rm, NULL);
+
+	Nwriters = nwriters;
+	Nops = nops;
+	Stop = 0;
+	Ranges = MALLOC(nwriters * NRANGES * sizeof(*Ranges));
+
+	os_thread_t *readers = MALLOC(nreaders * sizeof(*readers));
+	os_thread_t *writers = MALLOC(nwriters * sizeof(*writers));
+
+	for (unsigned i = 0; i < nreaders; ++i)
+		THREAD_CREATE(&readers[i], NULL, reader,
+			(void *)(uintptr_t)(i + 1));
+	for (unsigned i = 0; i < nwriters; ++i)
+		THREAD_CREATE(&writers[i], NULL, writer,
+			(void *)(uintptr_t)i);
+
+	for (unsigned i = 0; i < nwriters; ++i)
+		THREAD_JOIN(&writers[i], NULL);
+
+	util_atomic_store_explicit32(&Stop, 1, memory_order_release);
+
+	for (unsigned i = 0; i < nreaders; ++i)
+		THREAD_JOIN(&readers[i], NULL);
+
+	/* all the ranges are gone */
+	UT_ASSERTeq(range_map_find(Rm, 0, (nwriters + 1) * SLOT_SIZE), NULL);
+
+	range_map_delete(Rm);
+
+	FREE(writers);
+	FREE(readers);
+	FREE(Ranges);
+}
+
+int
+main(int argc, char *argv[])
+{
+	START(argc, argv, "util_range_map");
+
+	if (argc != 4)
+		UT_FATAL("usage: %s nreaders nwriters nops", argv[0]);
+
+	unsigned nreaders = ATOU(argv[1]);
+	unsigned nwriters = ATOU(argv[2]);
+	unsigned nops = ATOU(argv[3]);
+
+	set_func_malloc(malloc_oom);
+
+	test_basic();
+	test_remove_oom();
+	test_concurrent(nreaders, nwriters, nops);
+
+	DONE(NULL);
+}